@@ -58,6 +58,94 @@ char *g_mountpoint;
 int g_fuse_argc = 0;
 char **g_fuse_argv = NULL;
 
+static struct spdk_blobfs_fuse_opts g_fuse_opts;
+
+static const struct option g_fuse_long_opts[] = {
+	{"multithread",		no_argument,		NULL, 'M'},
+	{"max-write",		required_argument,	NULL, 'w'},
+	{"max-read",		required_argument,	NULL, 'r'},
+	{"direct-io",		no_argument,		NULL, 'D'},
+	{"splice",		no_argument,		NULL, 'S'},
+	{"writeback-cache",	no_argument,		NULL, 'W'},
+	{NULL,			0,			NULL, 0}
+};
+
+static void
+usage(char *name)
+{
+	fprintf(stderr, "usage: %s [options] <bdev name> <config.json path> <mountpoint>\n", name);
+	fprintf(stderr, "ex) %s unvme_bdev0n1 lba_sdk_config.json /opt\n", name);
+	fprintf(stderr, "options:\n");
+	fprintf(stderr, " -M, --multithread        serve FUSE requests from a pool of threads\n");
+	fprintf(stderr, " -w, --max-write <size>   largest write request, e.g. 1M (max %uK)\n",
+		SPDK_BLOBFS_FUSE_MAX_IO_SIZE / 1024);
+	fprintf(stderr, " -r, --max-read <size>    largest read request, e.g. 1M (max %uK)\n",
+		SPDK_BLOBFS_FUSE_MAX_IO_SIZE / 1024);
+	fprintf(stderr, " -D, --direct-io          bypass the page cache\n");
+	fprintf(stderr, " -S, --splice             move request data with splice()\n");
+	fprintf(stderr, " -W, --writeback-cache    let the kernel cache writes (ignored with -D)\n");
+}
+
+static int
+parse_io_size(const char *arg, uint32_t *size)
+{
+	uint64_t val;
+	bool has_prefix;
+
+	if (spdk_parse_capacity(arg, &val, &has_prefix) != 0 ||
+	    val == 0 || val > SPDK_BLOBFS_FUSE_MAX_IO_SIZE) {
+		fprintf(stderr, "Invalid request size %s, must be 1 to %u bytes\n",
+			arg, SPDK_BLOBFS_FUSE_MAX_IO_SIZE);
+		return -EINVAL;
+	}
+
+	*size = (uint32_t)val;
+	return 0;
+}
+
+static int
+parse_fuse_args(int argc, char **argv)
+{
+	int ch;
+
+	spdk_blobfs_fuse_opts_init(&g_fuse_opts);
+
+	while ((ch = getopt_long(argc, argv, "+Mw:r:DSW", g_fuse_long_opts, NULL)) != -1) {
+		switch (ch) {
+		case 'M':
+			g_fuse_opts.multithread = true;
+			break;
+		case 'w':
+			if (parse_io_size(optarg, &g_fuse_opts.max_write) != 0) {
+				return -EINVAL;
+			}
+			break;
+		case 'r':
+			if (parse_io_size(optarg, &g_fuse_opts.max_read) != 0) {
+				return -EINVAL;
+			}
+			break;
+		case 'D':
+			g_fuse_opts.direct_io = true;
+			break;
+		case 'S':
+			g_fuse_opts.splice = true;
+			break;
+		case 'W':
+			g_fuse_opts.writeback_cache = true;
+			break;
+		default:
+			return -EINVAL;
+		}
+	}
+
+	if (argc - optind < 3) {
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
 static void
 fuse_run_cb(void *cb_arg, int fserrno)
 {
@@ -79,7 +167,7 @@ spdk_fuse_run(void *arg1)
 	       g_bdev_name, g_mountpoint);
 	fflush(stdout);
 
-	spdk_blobfs_bdev_mount(g_bdev_name, g_mountpoint, fuse_run_cb, NULL);
+	spdk_blobfs_bdev_mount_ext(g_bdev_name, g_mountpoint, &g_fuse_opts, fuse_run_cb, NULL);
 }
 
 static void
@@ -98,17 +186,16 @@ int main(int argc, char **argv)
 	uint64_t fs_cache_size_mb;
 	int rc = 0;
 
-	if (argc < 4) {
-		fprintf(stderr, "usage: %s <bdev name> <config.json path> <mountpoint>\n", argv[0]);
-		fprintf(stderr, "ex) %s unvme_bdev0n1 lba_sdk_config.json /opt\n", argv[0]);
+	if (parse_fuse_args(argc, argv) != 0) {
+		usage(argv[0]);
 		exit(1);
 	}
 
-	g_bdev_name = argv[1];
-	config_json_path = argv[2];
-	g_mountpoint = argv[3];
-	g_fuse_argc = argc - 2;
-	g_fuse_argv = &argv[1];
+	g_bdev_name = argv[optind];
+	config_json_path = argv[optind + 1];
+	g_mountpoint = argv[optind + 2];
+	g_fuse_argc = argc - optind - 1;
+	g_fuse_argv = &argv[optind];
 
 	memset(&sdk_opt, 0, sizeof(kv_sdk));
 	rc = kv_sdk_load_option(&sdk_opt, config_json_path);
@@ -35,19 +35,40 @@
 
 #include "spdk/blobfs.h"
 #include "spdk/bdev.h"
+#include "spdk/env.h"
 #include "spdk/event.h"
 #include "spdk/blob_bdev.h"
 #include "spdk/log.h"
 #include "spdk/string.h"
+#include "spdk/util.h"
 
 #include "kv_types.h"
 #include "kv_apis.h"
 
 #define MIN_APP_HUGEMEM_SIZE_MB (256ULL)
 
+/* Blobstore metadata page size, clusters are made of whole pages */
+#define MKFS_PAGE_SIZE (4096U)
+
+/* Metadata pages reserved per expected file when sized with -F. A file of
+ * contiguous clusters fits one page, the rest is room for fragmentation and
+ * xattrs.
+ */
+#define MKFS_MD_PAGES_PER_FILE (4ULL)
+#define MKFS_MIN_MD_PAGES (4096ULL)
+
+/* Cluster size picked for -F without -C, as a fraction of the file size */
+#define MKFS_CLUSTERS_PER_FILE (16ULL)
+#define MKFS_MIN_CLUSTER_SIZE (1024ULL * 1024)
+#define MKFS_MAX_CLUSTER_SIZE (64ULL * 1024 * 1024)
+
 struct spdk_bs_dev *g_bs_dev;
 const char *g_bdev_name;
 static uint64_t g_cluster_size;
+static uint64_t g_file_size;
+static uint64_t g_num_md_pages;
+static uint64_t g_start_tsc;
+static uint32_t g_progress_pct;
 
 static void
 stop_cb(void *ctx, int fserrno)
@@ -60,7 +81,8 @@ shutdown_cb(void *arg1, void *arg2)
 {
 	struct spdk_filesystem *fs = arg1;
 
-	printf("done.\n");
+	printf("done in %.1f seconds.\n",
+	       (double)(spdk_get_ticks() - g_start_tsc) / spdk_get_ticks_hz());
 	spdk_fs_unload(fs, stop_cb, NULL);
 }
 
@@ -80,10 +102,52 @@ init_cb(void *ctx, struct spdk_filesystem *fs, int fserrno)
 }
 
 static void
-spdk_mkfs_run(void *arg1, void *arg2)
+progress_cb(void *ctx, uint64_t done, uint64_t total)
+{
+	uint32_t pct = total ? done * 100 / total : 100;
+
+	/* Report every 5%, and the end once */
+	if (pct < g_progress_pct + 5 && !(pct == 100 && g_progress_pct != 100)) {
+		return;
+	}
+	g_progress_pct = pct;
+
+	printf("  cleared %3u%% (%" PRIu64 " of %" PRIu64 " MiB)\n", pct,
+	       done >> 20, total >> 20);
+	fflush(stdout);
+}
+
+/* Sizes the metadata region for the expected number of files instead of one
+ * page per cluster, which on a large drive is tens of GiB to clear.
+ */
+static void
+mkfs_size_for_files(struct spdk_bdev *bdev, struct spdk_blobfs_opts *blobfs_opt)
+{
+	uint64_t dev_size, num_files, num_md_pages;
+
+	if (g_cluster_size == 0) {
+		blobfs_opt->cluster_sz = spdk_min(spdk_max(g_file_size / MKFS_CLUSTERS_PER_FILE,
+					  MKFS_MIN_CLUSTER_SIZE), MKFS_MAX_CLUSTER_SIZE);
+		/* Whole pages */
+		blobfs_opt->cluster_sz &= ~(MKFS_PAGE_SIZE - 1);
+	}
+
+	if (g_num_md_pages == 0) {
+		dev_size = spdk_bdev_get_num_blocks(bdev) * spdk_bdev_get_block_size(bdev);
+		num_files = spdk_divide_round_up(dev_size, g_file_size);
+		num_md_pages = spdk_max(num_files * MKFS_MD_PAGES_PER_FILE, MKFS_MIN_MD_PAGES);
+		/* Never more than the blobstore default of one per cluster */
+		num_md_pages = spdk_min(num_md_pages, dev_size / blobfs_opt->cluster_sz);
+		blobfs_opt->num_md_pages = num_md_pages;
+	}
+}
+
+static void
+spdk_mkfs_run(void *arg1)
 {
 	struct spdk_bdev *bdev;
 	struct spdk_blobfs_opts blobfs_opt;
+	char md_pages[32];
 
 	bdev = spdk_bdev_get_by_name(g_bdev_name);
 
@@ -100,32 +164,72 @@ spdk_mkfs_run(void *arg1, void *arg2)
 	if (g_cluster_size) {
 		blobfs_opt.cluster_sz = g_cluster_size;
 	}
-	g_bs_dev = spdk_bdev_create_bs_dev(bdev, NULL, NULL);
-	if (blobfs_opt.cluster_sz) {
-		spdk_fs_init(g_bs_dev, &blobfs_opt, NULL, init_cb, NULL);
+	if (g_num_md_pages) {
+		blobfs_opt.num_md_pages = g_num_md_pages;
+	}
+	if (g_file_size) {
+		mkfs_size_for_files(bdev, &blobfs_opt);
+	}
+	blobfs_opt.init_progress_fn = progress_cb;
+
+	if (blobfs_opt.num_md_pages) {
+		snprintf(md_pages, sizeof(md_pages), "%u", blobfs_opt.num_md_pages);
 	} else {
-		spdk_fs_init(g_bs_dev, NULL, NULL, init_cb, NULL);
+		snprintf(md_pages, sizeof(md_pages), "one per cluster");
 	}
+	printf("  cluster size %u KiB, %s metadata pages, %s\n", blobfs_opt.cluster_sz >> 10, md_pages,
+	       spdk_bdev_io_type_supported(bdev, SPDK_BDEV_IO_TYPE_WRITE_ZEROES) ?
+	       "metadata cleared by write zeroes" : "metadata cleared by writing zero buffers");
+	fflush(stdout);
+
+	g_start_tsc = spdk_get_ticks();
+	g_bs_dev = spdk_bdev_create_bs_dev(bdev, NULL, NULL);
+	spdk_fs_init(g_bs_dev, &blobfs_opt, NULL, init_cb, NULL);
 }
 
 static void
 mkfs_usage(void)
 {
 	printf(" -C cluster size\n");
+	printf(" -F expected file size, e.g. the RocksDB target file size; sizes the\n"
+	       "    metadata region for the number of files that fit the device, and\n"
+	       "    the cluster size when -C is not given\n");
+	printf(" -M number of metadata pages, default one per cluster\n");
 }
 
-static void
+static int
 mkfs_parse_arg(int ch, char *arg)
 {
 	bool has_prefix;
+	long long val;
 
 	switch (ch) {
 	case 'C':
-		spdk_parse_capacity(arg, &g_cluster_size, &has_prefix);
+		if (spdk_parse_capacity(arg, &g_cluster_size, &has_prefix) != 0 ||
+		    g_cluster_size == 0 || g_cluster_size % MKFS_PAGE_SIZE != 0) {
+			fprintf(stderr, "Cluster size must be a multiple of %u\n", MKFS_PAGE_SIZE);
+			return -EINVAL;
+		}
 		break;
-	default:
+	case 'F':
+		if (spdk_parse_capacity(arg, &g_file_size, &has_prefix) != 0 || g_file_size == 0) {
+			fprintf(stderr, "Invalid file size %s\n", arg);
+			return -EINVAL;
+		}
+		break;
+	case 'M':
+		val = spdk_strtoll(arg, 0);
+		if (val <= 0 || val > UINT32_MAX) {
+			fprintf(stderr, "Invalid number of metadata pages %s\n", arg);
+			return -EINVAL;
+		}
+		g_num_md_pages = val;
 		break;
+	default:
+		return -EINVAL;
 	}
+
+	return 0;
 }
 
 int main(int argc, char **argv)
@@ -179,7 +283,7 @@ int main(int argc, char **argv)
 	opts.shutdown_cb = NULL;
 
 	spdk_fs_set_cache_size(fs_cache_size_mb);
-	if ((rc = spdk_app_parse_args(argc, argv, &opts, "C:", NULL,
+	if ((rc = spdk_app_parse_args(argc, argv, &opts, "C:F:M:", NULL,
 				      mkfs_parse_arg, mkfs_usage)) !=
 	    SPDK_APP_PARSE_ARGS_SUCCESS) {
 		exit(rc);
@@ -1128,6 +1128,8 @@ std::vector<Status> DBImpl::MultiGet(
   struct MultiGetColumnFamilyData {
     ColumnFamilyData* cfd;
     SuperVersion* super_version;
+    // Internal keys that are looked up in the output files
+    std::vector<std::string> file_lookup_keys;
   };
   std::unordered_map<uint32_t, MultiGetColumnFamilyData*> multiget_cf_data;
   // fill up and allocate outside of mutex
@@ -1156,14 +1158,15 @@ std::vector<Status> DBImpl::MultiGet(
   }
   mutex_.Unlock();
 
-  // Contain a list of merge operations if merge occurs.
-  MergeContext merge_context;
-
   // Note: this always resizes the values array
   size_t num_keys = keys.size();
   std::vector<Status> stat_list(num_keys);
   values->resize(num_keys);
 
+  // Contain a list of merge operations of each key if merge occurs.
+  std::vector<MergeContext> merge_contexts(num_keys);
+  std::vector<std::unique_ptr<RangeDelAggregator>> range_del_aggs(num_keys);
+
   // Keep track of bytes that we read for statistics-recording later
   uint64_t bytes_read = 0;
   PERF_TIMER_STOP(get_snapshot_time);
@@ -1172,16 +1175,18 @@ std::vector<Status> DBImpl::MultiGet(
   // First look in the memtable, then in the immutable memtable (if any).
   // s is both in/out. When in, s could either be OK or MergeInProgress.
   // merge_operands will contain the sequence of merges in the latter case.
+  // The keys that are not resolved by the memtables are looked up in the
+  // output files afterwards, once the blocks they need were read in a batch.
   size_t num_found = 0;
+  std::vector<size_t> file_lookups;
   for (size_t i = 0; i < num_keys; ++i) {
-    merge_context.Clear();
     Status& s = stat_list[i];
     std::string* value = &(*values)[i];
 
     LookupKey lkey(keys[i], snapshot);
     auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[i]);
-    RangeDelAggregator range_del_agg(cfh->cfd()->internal_comparator(),
-                                     snapshot);
+    range_del_aggs[i].reset(new RangeDelAggregator(
+        cfh->cfd()->internal_comparator(), snapshot));
     auto mgd_iter = multiget_cf_data.find(cfh->cfd()->GetID());
     assert(mgd_iter != multiget_cf_data.end());
     auto mgd = mgd_iter->second;
@@ -1191,24 +1196,52 @@ std::vector<Status> DBImpl::MultiGet(
          has_unpersisted_data_.load(std::memory_order_relaxed));
     bool done = false;
     if (!skip_memtable) {
-      if (super_version->mem->Get(lkey, value, &s, &merge_context,
-                                  &range_del_agg, read_options)) {
+      if (super_version->mem->Get(lkey, value, &s, &merge_contexts[i],
+                                  range_del_aggs[i].get(), read_options)) {
         done = true;
         RecordTick(stats_, MEMTABLE_HIT);
-      } else if (super_version->imm->Get(lkey, value, &s, &merge_context,
-                                         &range_del_agg, read_options)) {
+      } else if (super_version->imm->Get(lkey, value, &s, &merge_contexts[i],
+                                         range_del_aggs[i].get(),
+                                         read_options)) {
         done = true;
         RecordTick(stats_, MEMTABLE_HIT);
       }
     }
     if (!done) {
-      PinnableSlice pinnable_val;
+      file_lookups.push_back(i);
+      mgd->file_lookup_keys.push_back(lkey.internal_key().ToString());
+      continue;
+    }
+
+    if (s.ok()) {
+      bytes_read += value->size();
+      num_found++;
+    }
+  }
+
+  for (auto mgd_iter : multiget_cf_data) {
+    auto mgd = mgd_iter.second;
+    if (mgd->file_lookup_keys.size() > 1) {
       PERF_TIMER_GUARD(get_from_output_files_time);
-      super_version->current->Get(read_options, lkey, &pinnable_val, &s,
-                                  &merge_context, &range_del_agg);
-      value->assign(pinnable_val.data(), pinnable_val.size());
-      RecordTick(stats_, MEMTABLE_MISS);
+      std::vector<Slice> ikeys(mgd->file_lookup_keys.begin(),
+                               mgd->file_lookup_keys.end());
+      mgd->super_version->current->PrepareMultiGet(read_options, ikeys);
     }
+  }
+
+  for (size_t i : file_lookups) {
+    Status& s = stat_list[i];
+    std::string* value = &(*values)[i];
+
+    LookupKey lkey(keys[i], snapshot);
+    auto cfh = reinterpret_cast<ColumnFamilyHandleImpl*>(column_family[i]);
+    auto super_version = multiget_cf_data[cfh->cfd()->GetID()]->super_version;
+    PinnableSlice pinnable_val;
+    PERF_TIMER_GUARD(get_from_output_files_time);
+    super_version->current->Get(read_options, lkey, &pinnable_val, &s,
+                                &merge_contexts[i], range_del_aggs[i].get());
+    value->assign(pinnable_val.data(), pinnable_val.size());
+    RecordTick(stats_, MEMTABLE_MISS);
 
     if (s.ok()) {
       bytes_read += value->size();
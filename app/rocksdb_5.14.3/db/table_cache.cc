@@ -427,6 +427,32 @@ Status TableCache::Get(const ReadOptions& options,
   return s;
 }
 
+void TableCache::PrepareMultiGet(
+    const ReadOptions& options,
+    const InternalKeyComparator& internal_comparator, const FileDescriptor& fd,
+    const std::vector<Slice>& keys, HistogramImpl* file_read_hist,
+    bool skip_filters, int level) {
+  if (options.read_tier == kBlockCacheTier) {
+    return;
+  }
+  TableReader* t = fd.table_reader;
+  Cache::Handle* handle = nullptr;
+  if (t == nullptr) {
+    Status s = FindTable(env_options_, internal_comparator, fd, &handle,
+                         false /* no_io */, true /* record_read_stats */,
+                         file_read_hist, skip_filters, level);
+    if (!s.ok()) {
+      // Get() runs into the same error and reports it
+      return;
+    }
+    t = GetTableReaderFromHandle(handle);
+  }
+  t->PrepareMultiGet(options, keys, skip_filters);
+  if (handle != nullptr) {
+    ReleaseHandle(handle);
+  }
+}
+
 Status TableCache::GetTableProperties(
     const EnvOptions& env_options,
     const InternalKeyComparator& internal_comparator, const FileDescriptor& fd,
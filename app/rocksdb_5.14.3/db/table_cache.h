@@ -78,6 +78,15 @@ class TableCache {
              GetContext* get_context, HistogramImpl* file_read_hist = nullptr,
              bool skip_filters = false, int level = -1);
 
+  // Let the table reader of the file prepare the Get() of each of the
+  // internal keys "keys", see TableReader::PrepareMultiGet()
+  void PrepareMultiGet(const ReadOptions& options,
+                       const InternalKeyComparator& internal_comparator,
+                       const FileDescriptor& file_fd,
+                       const std::vector<Slice>& keys,
+                       HistogramImpl* file_read_hist = nullptr,
+                       bool skip_filters = false, int level = -1);
+
   // Evict any entry for the specified file number
   static void Evict(Cache* cache, uint64_t file_number);
 
@@ -1268,6 +1268,48 @@ void Version::Get(const ReadOptions& read_options, const LookupKey& k,
   }
 }
 
+void Version::PrepareMultiGet(const ReadOptions& read_options,
+                              const std::vector<Slice>& keys) {
+  struct FileKeys {
+    FdWithKeyRange* file;
+    unsigned int level;
+    bool skip_filters;
+    std::vector<Slice> keys;
+  };
+  std::vector<FileKeys> files;
+  std::unordered_map<uint64_t, size_t> file_index;
+
+  for (const auto& ikey : keys) {
+    FilePicker fp(
+        storage_info_.files_, ExtractUserKey(ikey), ikey,
+        &storage_info_.level_files_brief_, storage_info_.num_non_empty_levels_,
+        &storage_info_.file_indexer_, user_comparator(),
+        internal_comparator());
+    for (FdWithKeyRange* f = fp.GetNextFile(); f != nullptr;
+         f = fp.GetNextFile()) {
+      auto it = file_index.find(f->fd.GetNumber());
+      if (it == file_index.end()) {
+        it = file_index.emplace(f->fd.GetNumber(), files.size()).first;
+        files.push_back({f, fp.GetHitFileLevel(),
+                         IsFilterSkipped(static_cast<int>(fp.GetHitFileLevel()),
+                                         fp.IsHitFileLastInLevel()),
+                         {}});
+      }
+      files[it->second].keys.push_back(ikey);
+    }
+  }
+
+  for (const auto& f : files) {
+    if (f.keys.size() < 2) {
+      continue;
+    }
+    table_cache_->PrepareMultiGet(
+        read_options, *internal_comparator(), f.file->fd, f.keys,
+        cfd_->internal_stats()->GetFileReadHist(f.level), f.skip_filters,
+        static_cast<int>(f.level));
+  }
+}
+
 bool Version::IsFilterSkipped(int level, bool is_file_last_in_level) {
   // Reaching the bottom level implies misses at all upper levels, so we'll
   // skip checking the filters when we predict a hit.
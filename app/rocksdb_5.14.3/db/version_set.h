@@ -565,6 +565,13 @@ class Version {
            bool* key_exists = nullptr, SequenceNumber* seq = nullptr,
            ReadCallback* callback = nullptr, bool* is_blob = nullptr);
 
+  // Prepare the Get() of each of the internal keys "keys": the keys are
+  // grouped by the files that may hold them, and the table reader of each
+  // file reads what those keys need in one batch.
+  //
+  // REQUIRES: lock is not held
+  void PrepareMultiGet(const ReadOptions&, const std::vector<Slice>& keys);
+
   // Loads some stats information from files. Call without mutex held. It needs
   // to be called before applying the version to the version set.
   void PrepareApply(const MutableCFOptions& mutable_cf_options,
@@ -0,0 +1,1096 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Samsung Electronics Co., Ltd. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/*
+ * RocksDB Env storing the files of the DB directory as objects of a KV SSD,
+ * without blobfs. Everything lives in the KV_KEYSPACE_IODATA keyspace:
+ *
+ *   "RKMF" + file name                    -> struct kv_file_meta (id, size)
+ *   "RKDB" + id (be64) + block no (be32)  -> kKvBlockSize bytes of the file
+ *
+ * The 4 byte prefixes are what the device iterator filters on, so
+ * GetChildren() lists the files by iterating the "RKMF" keys. A file is a
+ * key range of fixed size blocks, the last one stored padded to
+ * KV_VALUE_LENGTH_ALIGNMENT_UNIT; the file size in the metadata tells the
+ * real end. Block I/O goes through kv_store_async()/kv_retrieve_async(), so
+ * the JSON configuration must set up CQ threads for the device.
+ */
+
+#include "rocksdb/env.h"
+#include <endian.h>
+#include <errno.h>
+#include <string.h>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+#include "kv_apis.h"
+
+namespace rocksdb
+{
+
+namespace
+{
+
+const uint32_t kKvMetaPrefix = 0x524B4D46;	/* "RKMF" */
+const uint32_t kKvDataPrefix = 0x524B4442;	/* "RKDB" */
+const uint32_t kKvPrefixMask = 0xFFFFFFFF;
+const uint32_t kKvPrefixLen = 4;
+const uint32_t kKvDataKeyLen = 16;
+const uint64_t kKvBlockSize = 128 * 1024;
+/* full blocks a writer keeps in flight before it waits for them */
+const uint32_t kKvMaxInflightBlocks = 16;
+
+struct kv_file_meta {
+	uint64_t id;
+	uint64_t size;
+};
+
+static uint32_t
+kv_value_align(uint64_t len)
+{
+	return (len + KV_VALUE_LENGTH_ALIGNMENT_UNIT - 1) & ~((uint64_t)KV_VALUE_LENGTH_ALIGNMENT_UNIT - 1);
+}
+
+static Status
+KvIOError(const std::string &name, const char *op, int rc)
+{
+	char buf[64];
+
+	snprintf(buf, sizeof(buf), "%s failed: 0x%x", op, rc);
+	return Status::IOError(name, buf);
+}
+
+/* A set of async KV commands on data blocks. The kv_pairs, keys and retrieve
+ * buffers belong to the batch and outlive the completions.
+ */
+class KvIoBatch
+{
+	struct KvIo {
+		kv_pair kv;
+		char key[kKvDataKeyLen];
+		char *buf;
+		bool done;
+	};
+
+	uint64_t mHandle;
+	std::vector<KvIo *> mIos;
+	std::mutex mMutex;
+	std::condition_variable mCond;
+	uint32_t mPending;
+	int mError;
+
+	static void Done(kv_pair *kv, unsigned int result, unsigned int status)
+	{
+		KvIoBatch *batch = (KvIoBatch *)kv->param.private_data;
+		std::lock_guard<std::mutex> guard(batch->mMutex);
+
+		(void)result;
+		/* kv is the first member of its KvIo */
+		((KvIo *)kv)->done = true;
+		if (status != KV_SUCCESS && batch->mError == KV_SUCCESS) {
+			batch->mError = status;
+		}
+		batch->mPending--;
+		batch->mCond.notify_all();
+	}
+
+	KvIo *Prepare(uint64_t id, uint32_t block, char *buf, uint32_t offset, uint32_t length)
+	{
+		KvIo *io = new KvIo();
+		uint32_t be_prefix = htobe32(kKvDataPrefix);
+		uint64_t be_id = htobe64(id);
+		uint32_t be_block = htobe32(block);
+
+		memcpy(io->key, &be_prefix, kKvPrefixLen);
+		memcpy(io->key + kKvPrefixLen, &be_id, sizeof(be_id));
+		memcpy(io->key + kKvPrefixLen + sizeof(be_id), &be_block, sizeof(be_block));
+		io->buf = NULL;
+		io->done = false;
+		io->kv.keyspace_id = KV_KEYSPACE_IODATA;
+		io->kv.key.key = io->key;
+		io->kv.key.length = kKvDataKeyLen;
+		io->kv.value.value = buf;
+		io->kv.value.length = length;
+		io->kv.value.offset = offset;
+		io->kv.param.async_cb = reinterpret_cast<void (*)()>(&KvIoBatch::Done);
+		io->kv.param.private_data = this;
+		return io;
+	}
+
+	int Submit(KvIo *io, int (*fn)(uint64_t, kv_pair *))
+	{
+		int rc;
+
+		{
+			std::lock_guard<std::mutex> guard(mMutex);
+			mIos.push_back(io);
+			mPending++;
+		}
+		rc = fn(mHandle, &io->kv);
+		if (rc != KV_SUCCESS) {
+			std::lock_guard<std::mutex> guard(mMutex);
+			io->done = true;
+			mPending--;
+			if (mError == KV_SUCCESS) {
+				mError = rc;
+			}
+		}
+		return rc;
+	}
+
+	/* frees the completed commands, mMutex held */
+	void Reap()
+	{
+		size_t n = 0;
+
+		for (KvIo *io : mIos) {
+			if (io->done) {
+				free(io->buf);
+				delete io;
+			} else {
+				mIos[n++] = io;
+			}
+		}
+		mIos.resize(n);
+	}
+
+public:
+	KvIoBatch(uint64_t handle) : mHandle(handle), mPending(0), mError(KV_SUCCESS) {}
+	~KvIoBatch()
+	{
+		Wait();
+		Reap();
+	}
+
+	/* the SDK copies buf at submission, it may be reused on return */
+	int Store(uint64_t id, uint32_t block, const char *buf, uint32_t length)
+	{
+		KvIo *io = Prepare(id, block, (char *)buf, 0, length);
+
+		io->kv.param.io_option.store_option = KV_STORE_DEFAULT;
+		return Submit(io, kv_store_async);
+	}
+
+	/* reads length bytes at offset of a block, the value offset aligned down
+	 * to KV_ALIGNMENT_UNIT, and returns where they land once Wait() succeeds
+	 */
+	char *Retrieve(uint64_t id, uint32_t block, uint32_t offset, uint32_t length)
+	{
+		uint32_t aligned = offset & ~(KV_ALIGNMENT_UNIT - 1);
+		uint32_t io_length = kv_value_align(offset + length - aligned);
+		char *buf = (char *)malloc(io_length);
+		KvIo *io;
+
+		if (buf == NULL) {
+			std::lock_guard<std::mutex> guard(mMutex);
+			mError = KV_ERR_HEAP_ALLOC_FAILURE;
+			return NULL;
+		}
+		io = Prepare(id, block, buf, aligned, io_length);
+		io->buf = buf;
+		io->kv.param.io_option.retrieve_option = KV_RETRIEVE_DEFAULT;
+		if (Submit(io, kv_retrieve_async) != KV_SUCCESS) {
+			return NULL;
+		}
+		return buf + (offset - aligned);
+	}
+
+	int Delete(uint64_t id, uint32_t block)
+	{
+		KvIo *io = Prepare(id, block, NULL, 0, 0);
+
+		io->kv.param.io_option.delete_option = KV_DELETE_DEFAULT;
+		return Submit(io, kv_delete_async);
+	}
+
+	/* waits until fewer than max commands are in flight */
+	void Throttle(uint32_t max)
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+
+		mCond.wait(lock, [this, max] { return mPending < max; });
+		Reap();
+	}
+
+	/* waits for every command, returns the first error since the last Wait().
+	 * Buffers returned by Retrieve() stay valid until the batch is destroyed.
+	 */
+	int Wait()
+	{
+		std::unique_lock<std::mutex> lock(mMutex);
+		int rc;
+
+		mCond.wait(lock, [this] { return mPending == 0; });
+		rc = mError;
+		mError = KV_SUCCESS;
+		return rc;
+	}
+};
+
+/* The files of the DB directory, loaded from the "RKMF" keys at startup. A
+ * file keeps its id for life, renames only move the metadata key.
+ */
+class KvssdFs
+{
+	uint64_t mHandle;
+	std::mutex mMutex;
+	std::map<std::string, kv_file_meta> mFiles;
+	uint64_t mNextId;
+
+	static std::string MetaKey(const std::string &name)
+	{
+		uint32_t be_prefix = htobe32(kKvMetaPrefix);
+
+		return std::string((const char *)&be_prefix, kKvPrefixLen) + name;
+	}
+
+	int StoreMeta(const std::string &name, const kv_file_meta &meta)
+	{
+		std::string key = MetaKey(name);
+		kv_file_meta value = meta;
+		kv_pair kv;
+
+		memset(&kv, 0, sizeof(kv));
+		kv.keyspace_id = KV_KEYSPACE_IODATA;
+		kv.key.key = (void *)key.data();
+		kv.key.length = key.length();
+		kv.value.value = &value;
+		kv.value.length = sizeof(value);
+		kv.param.io_option.store_option = KV_STORE_DEFAULT;
+		return kv_store(mHandle, &kv);
+	}
+
+	int RetrieveMeta(const std::string &name, kv_file_meta *meta)
+	{
+		std::string key = MetaKey(name);
+		kv_pair kv;
+
+		memset(&kv, 0, sizeof(kv));
+		kv.keyspace_id = KV_KEYSPACE_IODATA;
+		kv.key.key = (void *)key.data();
+		kv.key.length = key.length();
+		kv.value.value = meta;
+		kv.value.length = sizeof(*meta);
+		kv.param.io_option.retrieve_option = KV_RETRIEVE_DEFAULT;
+		return kv_retrieve(mHandle, &kv);
+	}
+
+	int DeleteMeta(const std::string &name)
+	{
+		std::string key = MetaKey(name);
+		kv_pair kv;
+		int rc;
+
+		memset(&kv, 0, sizeof(kv));
+		kv.keyspace_id = KV_KEYSPACE_IODATA;
+		kv.key.key = (void *)key.data();
+		kv.key.length = key.length();
+		kv.param.io_option.delete_option = KV_DELETE_DEFAULT;
+		rc = kv_delete(mHandle, &kv);
+		return rc == KV_ERR_NOT_EXIST_KEY ? KV_SUCCESS : rc;
+	}
+
+	/* mMutex held */
+	bool IdInUse(uint64_t id)
+	{
+		for (auto &f : mFiles) {
+			if (f.second.id == id) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	/* drops the blocks of a file id no name refers to anymore */
+	int DropBlocks(const kv_file_meta &meta)
+	{
+		KvIoBatch batch(mHandle);
+		uint64_t nr_blocks = (meta.size + kKvBlockSize - 1) / kKvBlockSize;
+		int rc;
+
+		for (uint64_t block = 0; block < nr_blocks; block++) {
+			batch.Throttle(kKvMaxInflightBlocks);
+			batch.Delete(meta.id, block);
+		}
+		rc = batch.Wait();
+		return rc == KV_ERR_NOT_EXIST_KEY ? KV_SUCCESS : rc;
+	}
+
+public:
+	KvssdFs(uint64_t handle) : mHandle(handle), mNextId(1) {}
+
+	uint64_t Handle(void)
+	{
+		return mHandle;
+	}
+
+	/* lists the file names on the device with the key iterator */
+	int List(std::vector<std::string> *names)
+	{
+		uint32_t be_prefix = htobe32(kKvMetaPrefix);
+		uint32_t prefix;
+		kv_key_iterator *it;
+		const kv_key *key;
+		uint32_t iterator;
+		int rc;
+
+		/* the device matches the prefix against the first key bytes as stored */
+		memcpy(&prefix, &be_prefix, kKvPrefixLen);
+		iterator = kv_iterate_open(mHandle, KV_KEYSPACE_IODATA, kKvPrefixMask,
+					   prefix, KV_KEY_ITERATE);
+		if (iterator == KV_INVALID_ITERATE_HANDLE || iterator > KV_MAX_ITERATE_HANDLE) {
+			return KV_ERR_ITERATE_NO_AVAILABLE_HANDLE;
+		}
+		rc = kv_key_iterator_open(mHandle, iterator, 0, &it);
+		if (rc == KV_SUCCESS) {
+			while ((rc = kv_iterate_next(it, &key)) == KV_SUCCESS) {
+				if (key->length > kKvPrefixLen) {
+					names->push_back(std::string((const char *)key->key + kKvPrefixLen,
+								     key->length - kKvPrefixLen));
+				}
+			}
+			if (rc == KV_ERR_ITERATE_READ_EOF) {
+				rc = KV_SUCCESS;
+			}
+			kv_key_iterator_close(it);
+		}
+		kv_iterate_close(mHandle, iterator);
+		return rc;
+	}
+
+	int Load(void)
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		std::vector<std::string> names;
+		kv_file_meta meta;
+		int rc;
+
+		rc = List(&names);
+		if (rc != KV_SUCCESS) {
+			return rc;
+		}
+		for (auto &name : names) {
+			rc = RetrieveMeta(name, &meta);
+			if (rc == KV_ERR_NOT_EXIST_KEY) {
+				continue;
+			} else if (rc != KV_SUCCESS) {
+				return rc;
+			}
+			mFiles[name] = meta;
+			if (meta.id >= mNextId) {
+				mNextId = meta.id + 1;
+			}
+		}
+		return KV_SUCCESS;
+	}
+
+	bool Lookup(const std::string &name, kv_file_meta *meta)
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		auto f = mFiles.find(name);
+
+		if (f == mFiles.end()) {
+			return false;
+		}
+		*meta = f->second;
+		return true;
+	}
+
+	/* creates the file, or truncates it to a new id if it exists */
+	int Create(const std::string &name, kv_file_meta *meta)
+	{
+		kv_file_meta old;
+		bool drop = false;
+		int rc;
+
+		{
+			std::lock_guard<std::mutex> guard(mMutex);
+			auto f = mFiles.find(name);
+
+			meta->id = mNextId++;
+			meta->size = 0;
+			rc = StoreMeta(name, *meta);
+			if (rc != KV_SUCCESS) {
+				return rc;
+			}
+			if (f != mFiles.end()) {
+				old = f->second;
+				f->second = *meta;
+				drop = !IdInUse(old.id);
+			} else {
+				mFiles[name] = *meta;
+			}
+		}
+		return drop ? DropBlocks(old) : KV_SUCCESS;
+	}
+
+	int SetSize(uint64_t id, uint64_t size)
+	{
+		std::lock_guard<std::mutex> guard(mMutex);
+		int rc = KV_SUCCESS;
+
+		/* every name the id lives under, the file may be renamed while open */
+		for (auto &f : mFiles) {
+			if (f.second.id == id && f.second.size != size) {
+				f.second.size = size;
+				rc = StoreMeta(f.first, f.second);
+				if (rc != KV_SUCCESS) {
+					break;
+				}
+			}
+		}
+		return rc;
+	}
+
+	int Delete(const std::string &name)
+	{
+		kv_file_meta meta;
+		bool drop;
+		int rc;
+
+		{
+			std::lock_guard<std::mutex> guard(mMutex);
+			auto f = mFiles.find(name);
+
+			if (f == mFiles.end()) {
+				return KV_ERR_NOT_EXIST_KEY;
+			}
+			rc = DeleteMeta(name);
+			if (rc != KV_SUCCESS) {
+				return rc;
+			}
+			meta = f->second;
+			mFiles.erase(f);
+			drop = !IdInUse(meta.id);
+		}
+		return drop ? DropBlocks(meta) : KV_SUCCESS;
+	}
+
+	/* The target metadata is stored before the source one is deleted. A crash
+	 * in between leaves two names on one id, whose blocks are dropped with
+	 * the last of them.
+	 */
+	int Rename(const std::string &src, const std::string &target)
+	{
+		kv_file_meta meta, old;
+		bool drop = false;
+		int rc;
+
+		{
+			std::lock_guard<std::mutex> guard(mMutex);
+			auto s = mFiles.find(src);
+
+			if (s == mFiles.end()) {
+				return KV_ERR_NOT_EXIST_KEY;
+			}
+			meta = s->second;
+			rc = StoreMeta(target, meta);
+			if (rc != KV_SUCCESS) {
+				return rc;
+			}
+			rc = DeleteMeta(src);
+			if (rc != KV_SUCCESS) {
+				return rc;
+			}
+			mFiles.erase(s);
+
+			auto t = mFiles.find(target);
+			if (t != mFiles.end()) {
+				old = t->second;
+				t->second = meta;
+				drop = !IdInUse(old.id);
+			} else {
+				mFiles[target] = meta;
+			}
+		}
+		return drop ? DropBlocks(old) : KV_SUCCESS;
+	}
+};
+
+/* Reads the requests of reqs into their scratch buffers, every block of every
+ * request in one batch of kv_retrieve_async().
+ */
+static void
+KvReadFile(KvssdFs *fs, const std::string &name, const kv_file_meta &meta,
+	   ReadRequest *reqs, size_t num_reqs)
+{
+	struct KvCopy {
+		size_t req;
+		char *dst;
+		const char *src;
+		uint32_t length;
+	};
+	KvIoBatch batch(fs->Handle());
+	std::vector<KvCopy> copies;
+	int rc;
+
+	for (size_t i = 0; i < num_reqs; i++) {
+		ReadRequest &req = reqs[i];
+		uint64_t offset = req.offset;
+		uint64_t end = std::min<uint64_t>(req.offset + req.len, meta.size);
+		char *dst = req.scratch;
+
+		req.status = Status::OK();
+		req.result = Slice(req.scratch, offset < end ? end - offset : 0);
+		while (offset < end) {
+			uint32_t block = offset / kKvBlockSize;
+			uint32_t in_block = offset % kKvBlockSize;
+			uint32_t length = std::min<uint64_t>(kKvBlockSize - in_block, end - offset);
+			const char *src = batch.Retrieve(meta.id, block, in_block, length);
+
+			if (src == NULL) {
+				req.status = KvIOError(name, "kv_retrieve_async", KV_ERR_IO);
+				break;
+			}
+			copies.push_back({i, dst, src, length});
+			dst += length;
+			offset += length;
+		}
+	}
+
+	rc = batch.Wait();
+	if (rc != KV_SUCCESS) {
+		for (size_t i = 0; i < num_reqs; i++) {
+			reqs[i].status = KvIOError(name, "kv_retrieve_async", rc);
+		}
+		return;
+	}
+	for (auto &c : copies) {
+		if (reqs[c.req].status.ok()) {
+			memcpy(c.dst, c.src, c.length);
+		}
+	}
+}
+
+class KvssdSequentialFile : public SequentialFile
+{
+	KvssdFs *mFs;
+	std::string mName;
+	kv_file_meta mMeta;
+	uint64_t mOffset;
+
+public:
+	KvssdSequentialFile(KvssdFs *fs, const std::string &name, const kv_file_meta &meta)
+		: mFs(fs), mName(name), mMeta(meta), mOffset(0) {}
+	~KvssdSequentialFile() {}
+
+	virtual Status Read(size_t n, Slice *result, char *scratch) override
+	{
+		ReadRequest req;
+
+		/* a file read while it is written, like the MANIFEST, grows */
+		mFs->Lookup(mName, &mMeta);
+		req.offset = mOffset;
+		req.len = n;
+		req.scratch = scratch;
+		KvReadFile(mFs, mName, mMeta, &req, 1);
+		if (req.status.ok()) {
+			*result = req.result;
+			mOffset += result->size();
+		}
+		return req.status;
+	}
+	virtual Status Skip(uint64_t n) override
+	{
+		mOffset += n;
+		return Status::OK();
+	}
+	virtual Status InvalidateCache(__attribute__((unused)) size_t offset,
+				       __attribute__((unused)) size_t length) override
+	{
+		return Status::OK();
+	}
+};
+
+class KvssdRandomAccessFile : public RandomAccessFile
+{
+	KvssdFs *mFs;
+	std::string mName;
+	kv_file_meta mMeta;
+
+public:
+	KvssdRandomAccessFile(KvssdFs *fs, const std::string &name, const kv_file_meta &meta)
+		: mFs(fs), mName(name), mMeta(meta) {}
+	~KvssdRandomAccessFile() {}
+
+	virtual Status Read(uint64_t offset, size_t n, Slice *result, char *scratch) const override
+	{
+		ReadRequest req;
+
+		req.offset = offset;
+		req.len = n;
+		req.scratch = scratch;
+		KvReadFile(mFs, mName, mMeta, &req, 1);
+		*result = req.result;
+		return req.status;
+	}
+	virtual Status MultiRead(ReadRequest *reqs, size_t num_reqs) override
+	{
+		KvReadFile(mFs, mName, mMeta, reqs, num_reqs);
+		return Status::OK();
+	}
+	virtual Status InvalidateCache(__attribute__((unused)) size_t offset,
+				       __attribute__((unused)) size_t length) override
+	{
+		return Status::OK();
+	}
+};
+
+/* Appends fill the block at the tail of the file, which is stored with
+ * kv_store_async() once full. Sync() stores the partial tail block, waits
+ * for the blocks in flight and then records the new size.
+ */
+class KvssdWritableFile : public WritableFile
+{
+	KvssdFs *mFs;
+	std::string mName;
+	uint64_t mId;
+	uint64_t mSize;
+	uint32_t mTailBlock;
+	std::string mTail;
+	bool mTailDirty;
+	KvIoBatch mBatch;
+
+public:
+	KvssdWritableFile(KvssdFs *fs, const std::string &name, const kv_file_meta &meta)
+		: mFs(fs), mName(name), mId(meta.id), mSize(0), mTailBlock(0),
+		  mTailDirty(false), mBatch(fs->Handle())
+	{
+		mTail.reserve(kKvBlockSize);
+	}
+	~KvssdWritableFile()
+	{
+		Close();
+	}
+
+	virtual Status Append(const Slice &data) override
+	{
+		const char *p = data.data();
+		size_t left = data.size();
+		int rc;
+
+		while (left > 0) {
+			size_t n = std::min<size_t>(kKvBlockSize - mTail.size(), left);
+
+			mTail.append(p, n);
+			mTailDirty = true;
+			mSize += n;
+			p += n;
+			left -= n;
+			if (mTail.size() < kKvBlockSize) {
+				break;
+			}
+			mBatch.Throttle(kKvMaxInflightBlocks);
+			rc = mBatch.Store(mId, mTailBlock, mTail.data(), kKvBlockSize);
+			if (rc != KV_SUCCESS) {
+				return KvIOError(mName, "kv_store_async", rc);
+			}
+			mTailBlock++;
+			mTail.clear();
+			mTailDirty = false;
+		}
+		return Status::OK();
+	}
+	virtual Status Truncate(uint64_t size) override
+	{
+		uint64_t tail_start = (uint64_t)mTailBlock * kKvBlockSize;
+
+		if (size == mSize) {
+			return Status::OK();
+		}
+		if (size < tail_start || size > mSize) {
+			return Status::NotSupported("KvssdEnv truncates in the tail block only");
+		}
+		mTail.resize(size - tail_start);
+		mTailDirty = true;
+		mSize = size;
+		return Status::OK();
+	}
+	virtual Status Close() override
+	{
+		return Sync();
+	}
+	virtual Status Flush() override
+	{
+		return Status::OK();
+	}
+	virtual Status Sync() override
+	{
+		int rc;
+
+		if (mTailDirty) {
+			std::string padded(mTail);
+
+			padded.resize(kv_value_align(padded.size()));
+			rc = mBatch.Store(mId, mTailBlock, padded.data(), padded.size());
+			if (rc != KV_SUCCESS) {
+				return KvIOError(mName, "kv_store_async", rc);
+			}
+			mTailDirty = false;
+		}
+		rc = mBatch.Wait();
+		if (rc != KV_SUCCESS) {
+			return KvIOError(mName, "kv_store_async", rc);
+		}
+		rc = mFs->SetSize(mId, mSize);
+		if (rc != KV_SUCCESS) {
+			return KvIOError(mName, "kv_store", rc);
+		}
+		return Status::OK();
+	}
+	virtual uint64_t GetFileSize() override
+	{
+		return mSize;
+	}
+};
+
+class KvssdDirectory : public Directory
+{
+public:
+	KvssdDirectory() {}
+	~KvssdDirectory() {}
+	Status Fsync() override
+	{
+		return Status::OK();
+	}
+};
+
+class KvssdFileLock : public FileLock
+{
+public:
+	std::string mName;
+
+	KvssdFileLock(const std::string &name) : mName(name) {}
+};
+
+} // namespace
+
+class KvssdEnv : public EnvWrapper
+{
+private:
+	std::string mDirectory;
+	KvssdFs *mFs;
+	std::mutex mLockMutex;
+	std::set<std::string> mLocked;
+
+	bool InDirectory(const std::string &fname)
+	{
+		return fname.compare(0, mDirectory.length(), mDirectory) == 0;
+	}
+
+	/* the file name relative to the DB directory, without leading '/' */
+	std::string KvssdName(const std::string &fname)
+	{
+		std::string::size_type pos = fname.find_first_not_of('/', mDirectory.length());
+
+		return pos == std::string::npos ? std::string() : fname.substr(pos);
+	}
+
+	Status NotFound(const std::string &name)
+	{
+		/* Myrocks checks errno for ENOENT */
+		errno = ENOENT;
+		return Status::IOError(name, strerror(errno));
+	}
+
+public:
+	KvssdEnv(Env *base_env, const std::string &dir, uint64_t handle)
+		: EnvWrapper(base_env), mDirectory(dir), mFs(new KvssdFs(handle)) {}
+
+	virtual ~KvssdEnv()
+	{
+		delete mFs;
+		kv_sdk_finalize();
+	}
+
+	int Load(void)
+	{
+		return mFs->Load();
+	}
+
+	virtual Status NewSequentialFile(const std::string &fname,
+					 unique_ptr<SequentialFile> *result,
+					 const EnvOptions &options) override
+	{
+		if (InDirectory(fname)) {
+			std::string name = KvssdName(fname);
+			kv_file_meta meta;
+
+			if (!mFs->Lookup(name, &meta)) {
+				return NotFound(name);
+			}
+			result->reset(new KvssdSequentialFile(mFs, name, meta));
+			return Status::OK();
+		}
+		return EnvWrapper::NewSequentialFile(fname, result, options);
+	}
+
+	virtual Status NewRandomAccessFile(const std::string &fname,
+					   unique_ptr<RandomAccessFile> *result,
+					   const EnvOptions &options) override
+	{
+		if (InDirectory(fname)) {
+			std::string name = KvssdName(fname);
+			kv_file_meta meta;
+
+			if (!mFs->Lookup(name, &meta)) {
+				return NotFound(name);
+			}
+			result->reset(new KvssdRandomAccessFile(mFs, name, meta));
+			return Status::OK();
+		}
+		return EnvWrapper::NewRandomAccessFile(fname, result, options);
+	}
+
+	virtual Status NewWritableFile(const std::string &fname,
+				       unique_ptr<WritableFile> *result,
+				       const EnvOptions &options) override
+	{
+		if (InDirectory(fname)) {
+			std::string name = KvssdName(fname);
+			kv_file_meta meta;
+			int rc;
+
+			if (name.length() + kKvPrefixLen > KV_MAX_KEY_LEN) {
+				return Status::InvalidArgument(name, "file name too long for a key");
+			}
+			rc = mFs->Create(name, &meta);
+			if (rc != KV_SUCCESS) {
+				return KvIOError(name, "kv_store", rc);
+			}
+			result->reset(new KvssdWritableFile(mFs, name, meta));
+			return Status::OK();
+		}
+		return EnvWrapper::NewWritableFile(fname, result, options);
+	}
+
+	virtual Status ReuseWritableFile(const std::string &fname,
+					 const std::string &old_fname,
+					 unique_ptr<WritableFile> *result,
+					 const EnvOptions &options) override
+	{
+		if (InDirectory(fname)) {
+			/* rename, then recreate */
+			return Env::ReuseWritableFile(fname, old_fname, result, options);
+		}
+		return EnvWrapper::ReuseWritableFile(fname, old_fname, result, options);
+	}
+
+	virtual Status NewDirectory(const std::string &name,
+				    unique_ptr<Directory> *result) override
+	{
+		if (InDirectory(name)) {
+			result->reset(new KvssdDirectory());
+			return Status::OK();
+		}
+		return EnvWrapper::NewDirectory(name, result);
+	}
+
+	virtual Status FileExists(const std::string &fname) override
+	{
+		kv_file_meta meta;
+
+		if (InDirectory(fname) && mFs->Lookup(KvssdName(fname), &meta)) {
+			return Status::OK();
+		}
+		return EnvWrapper::FileExists(fname);
+	}
+
+	virtual Status GetFileSize(const std::string &fname, uint64_t *size) override
+	{
+		kv_file_meta meta;
+
+		if (InDirectory(fname) && mFs->Lookup(KvssdName(fname), &meta)) {
+			*size = meta.size;
+			return Status::OK();
+		}
+		return EnvWrapper::GetFileSize(fname, size);
+	}
+
+	virtual Status GetFileModificationTime(const std::string &fname,
+					       uint64_t *file_mtime) override
+	{
+		kv_file_meta meta;
+
+		if (InDirectory(fname) && mFs->Lookup(KvssdName(fname), &meta)) {
+			*file_mtime = 0;
+			return Status::OK();
+		}
+		return EnvWrapper::GetFileModificationTime(fname, file_mtime);
+	}
+
+	virtual Status DeleteFile(const std::string &fname) override
+	{
+		if (InDirectory(fname)) {
+			std::string name = KvssdName(fname);
+			int rc;
+
+			rc = mFs->Delete(name);
+			if (rc == KV_SUCCESS) {
+				return Status::OK();
+			} else if (rc != KV_ERR_NOT_EXIST_KEY) {
+				return KvIOError(name, "kv_delete", rc);
+			}
+		}
+		return EnvWrapper::DeleteFile(fname);
+	}
+
+	virtual Status RenameFile(const std::string &src, const std::string &t) override
+	{
+		if (InDirectory(src) && InDirectory(t)) {
+			std::string src_name = KvssdName(src);
+			std::string target_name = KvssdName(t);
+			int rc;
+
+			if (target_name.length() + kKvPrefixLen > KV_MAX_KEY_LEN) {
+				return Status::InvalidArgument(target_name, "file name too long for a key");
+			}
+			rc = mFs->Rename(src_name, target_name);
+			if (rc == KV_SUCCESS) {
+				return Status::OK();
+			} else if (rc != KV_ERR_NOT_EXIST_KEY) {
+				return KvIOError(src_name, "kv_store", rc);
+			}
+		}
+		return EnvWrapper::RenameFile(src, t);
+	}
+
+	virtual Status LinkFile(__attribute__((unused)) const std::string &src,
+				__attribute__((unused)) const std::string &t) override
+	{
+		return Status::NotSupported("KvssdEnv does not support LinkFile");
+	}
+
+	virtual Status LockFile(const std::string &fname, FileLock **lock) override
+	{
+		std::lock_guard<std::mutex> guard(mLockMutex);
+
+		if (!mLocked.insert(fname).second) {
+			errno = ENOLCK;
+			return Status::IOError("lock " + fname, "already held by process");
+		}
+		*lock = new KvssdFileLock(fname);
+		return Status::OK();
+	}
+
+	virtual Status UnlockFile(FileLock *lock) override
+	{
+		KvssdFileLock *l = (KvssdFileLock *)lock;
+		std::lock_guard<std::mutex> guard(mLockMutex);
+
+		mLocked.erase(l->mName);
+		delete l;
+		return Status::OK();
+	}
+
+	virtual Status GetChildren(const std::string &dir,
+				   std::vector<std::string> *result) override
+	{
+		if (InDirectory(dir)) {
+			std::string dir_name = KvssdName(dir);
+			std::set<std::string> dir_and_file_set;
+			std::vector<std::string> names;
+			std::string::size_type pos;
+			int rc;
+
+			if (!dir_name.empty() && dir_name.back() != '/') {
+				dir_name += '/';
+			}
+			rc = mFs->List(&names);
+			if (rc != KV_SUCCESS) {
+				return KvIOError(dir, "kv_iterate", rc);
+			}
+			for (auto &name : names) {
+				if (name.compare(0, dir_name.length(), dir_name)) {
+					continue;
+				}
+				pos = name.find('/', dir_name.length());
+				dir_and_file_set.insert(name.substr(dir_name.length(), pos - dir_name.length()));
+			}
+
+			for (auto &s : dir_and_file_set) {
+				result->push_back(s);
+			}
+
+			result->push_back(".");
+			result->push_back("..");
+
+			return Status::OK();
+		}
+		return EnvWrapper::GetChildren(dir, result);
+	}
+};
+
+Env *NewKvssdEnv(Env *base_env, const std::string &dir, const std::string &conf)
+{
+	kv_sdk sdk_opt;
+	KvssdEnv *kvssd_env;
+	int rc;
+
+	memset(&sdk_opt, 0, sizeof(kv_sdk));
+	rc = kv_sdk_load_option(&sdk_opt, const_cast<char *>(conf.c_str()));
+	if (rc != KV_SUCCESS) {
+		fprintf(stderr, "Error while loading JSON configuration.\n");
+		return NULL;
+	}
+	if (sdk_opt.ssd_type != KV_TYPE_SSD) {
+		fprintf(stderr, "KvssdEnv needs a KV SSD (ssd_type 0).\n");
+		return NULL;
+	}
+	/* KvIoBatch waits for completions reaped by CQ threads or the CQ reactor */
+	if (sdk_opt.dd_options[0].num_cq_threads == 0 && strlen(sdk_opt.dd_options[0].cq_core_list) == 0 &&
+	    strlen(sdk_opt.cq_reactor_core_list) == 0) {
+		fprintf(stderr, "KvssdEnv needs CQ threads (cq_thread_mask, cq_core_list or cq_reactor_core_list).\n");
+		return NULL;
+	}
+	rc = kv_sdk_init(KV_SDK_INIT_FROM_STR, &sdk_opt);
+	if (rc != KV_SUCCESS) {
+		fprintf(stderr, "Error while doing sdk init.\n");
+		return NULL;
+	}
+
+	/* the first device holds the DB */
+	kvssd_env = new KvssdEnv(base_env, dir, sdk_opt.dev_handle[0]);
+	rc = kvssd_env->Load();
+	if (rc != KV_SUCCESS) {
+		fprintf(stderr, "Error while listing the files on the KV SSD: 0x%x\n", rc);
+		delete kvssd_env;
+		return NULL;
+	}
+	return kvssd_env;
+}
+
+} // namespace rocksdb
@@ -0,0 +1,114 @@
+/*-
+ *   BSD LICENSE
+ *
+ *   Copyright (c) 2018 Samsung Electronics Co., Ltd.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Samsung Electronics Co., Ltd. nor the names of its
+ *       contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+// Needs a KV SSD: set KVSSD_TEST_CONF to the SDK JSON configuration to run.
+
+#include <stdlib.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "rocksdb/env.h"
+#include "util/testharness.h"
+
+namespace rocksdb {
+
+class EnvKvssdTest : public testing::Test {
+ public:
+  const char* conf_;
+  const std::string dbname_;
+  const EnvOptions soptions_;
+
+  EnvKvssdTest()
+      : conf_(getenv("KVSSD_TEST_CONF")), dbname_("/kvssd_env_test") {}
+
+  Env* OpenEnv() {
+    return NewKvssdEnv(Env::Default(), dbname_, conf_);
+  }
+};
+
+TEST_F(EnvKvssdTest, WriteCloseReopenList) {
+  if (conf_ == nullptr) {
+    fprintf(stderr, "KVSSD_TEST_CONF not set, skipped\n");
+    return;
+  }
+  // spans more than one block, the last one partial
+  std::string data(300 * 1024 + 17, 'k');
+  for (size_t i = 0; i < data.size(); i++) {
+    data[i] = static_cast<char>('a' + i % 26);
+  }
+  const std::string fname = dbname_ + "/000001.sst";
+
+  std::unique_ptr<Env> env(OpenEnv());
+  ASSERT_TRUE(env != nullptr);
+  env->DeleteFile(fname);
+  unique_ptr<WritableFile> writable_file;
+  ASSERT_OK(env->NewWritableFile(fname, &writable_file, soptions_));
+  ASSERT_OK(writable_file->Append(data));
+  ASSERT_OK(writable_file->Close());
+  writable_file.reset();
+  env.reset();
+
+  // a new Env finds the file only through the key iterator
+  env.reset(OpenEnv());
+  ASSERT_TRUE(env != nullptr);
+  std::vector<std::string> children;
+  ASSERT_OK(env->GetChildren(dbname_, &children));
+  ASSERT_TRUE(std::find(children.begin(), children.end(), "000001.sst") !=
+              children.end());
+  uint64_t size;
+  ASSERT_OK(env->GetFileSize(fname, &size));
+  ASSERT_EQ(data.size(), size);
+
+  unique_ptr<RandomAccessFile> file;
+  ASSERT_OK(env->NewRandomAccessFile(fname, &file, soptions_));
+  std::string scratch(data.size(), '\0');
+  Slice result;
+  ASSERT_OK(file->Read(0, data.size(), &result, &scratch[0]));
+  ASSERT_EQ(data, result.ToString());
+  file.reset();
+
+  ASSERT_OK(env->DeleteFile(fname));
+  children.clear();
+  ASSERT_OK(env->GetChildren(dbname_, &children));
+  ASSERT_TRUE(std::find(children.begin(), children.end(), "000001.sst") ==
+              children.end());
+}
+
+}  // namespace rocksdb
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -32,9 +32,13 @@
  */
 
 #include "rocksdb/env.h"
+#include "rocksdb/rate_limiter.h"
+#include "util/aligned_buffer.h"
 #include <set>
 #include <iostream>
+#include <mutex>
 #include <stdexcept>
+#include <vector>
 #include "kv_apis.h"
 
 extern "C" {
@@ -83,6 +87,111 @@ private:
 
 thread_local SpdkThreadCtx g_sync_args;
 
+/*
+ * Pinned, page aligned buffers for blobfs direct I/O. blobfs reads into and writes
+ *  from these buffers directly instead of bouncing through its own DMA memory.
+ *  In direct I/O mode they back RocksDB's AlignedBuffers, so its direct reads and
+ *  writes need no copy; other unpinned buffers are bounced through a pooled one.
+ *  Freed buffers are kept per power of two size class, up to 4MB, until Release().
+ */
+class SpdkBufferPool
+{
+	static const size_t kMinShift = 12;
+	static const size_t kMaxShift = 22;
+	static const size_t kMaxCached = 64;
+
+	std::mutex mMutex;
+	std::vector<void *> mFree[kMaxShift - kMinShift + 1];
+	bool mReleased = false;
+
+	static size_t SizeClass(size_t size)
+	{
+		size_t shift = kMinShift;
+
+		while (shift < kMaxShift && (static_cast<size_t>(1) << shift) < size) {
+			shift++;
+		}
+		return shift - kMinShift;
+	}
+
+public:
+	void *Allocate(size_t size)
+	{
+		void *buf = NULL;
+
+		if (size > (static_cast<size_t>(1) << kMaxShift)) {
+			return spdk_malloc(size, kDefaultPageSize, NULL, SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+		}
+
+		size_t cls = SizeClass(size);
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			if (mReleased) {
+				return NULL;
+			}
+			if (!mFree[cls].empty()) {
+				buf = mFree[cls].back();
+				mFree[cls].pop_back();
+			}
+		}
+		if (buf == NULL) {
+			buf = spdk_malloc(static_cast<size_t>(1) << (cls + kMinShift), kDefaultPageSize, NULL,
+					  SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+		}
+		return buf;
+	}
+
+	void Free(void *buf, size_t size)
+	{
+		if (buf == NULL) {
+			return;
+		}
+		if (size <= (static_cast<size_t>(1) << kMaxShift)) {
+			size_t cls = SizeClass(size);
+			std::lock_guard<std::mutex> lock(mMutex);
+			/* A buffer returned after Release() is freed instead of cached again */
+			if (!mReleased && mFree[cls].size() < kMaxCached) {
+				mFree[cls].push_back(buf);
+				return;
+			}
+		}
+		spdk_free(buf);
+	}
+
+	/* Free the cached buffers, before SPDK shuts down; the pool hands out no more */
+	void Release(void)
+	{
+		std::lock_guard<std::mutex> lock(mMutex);
+		mReleased = true;
+		for (auto &list : mFree) {
+			for (void *buf : list) {
+				spdk_free(buf);
+			}
+			list.clear();
+		}
+	}
+};
+
+static SpdkBufferPool g_buffer_pool;
+
+static void *aligned_buffer_allocate(size_t size, size_t alignment)
+{
+	if (kDefaultPageSize % alignment != 0) {
+		return NULL;
+	}
+	return g_buffer_pool.Allocate(size);
+}
+
+static void aligned_buffer_free(void *buf, size_t size)
+{
+	g_buffer_pool.Free(buf, size);
+}
+
+static const AlignedBufferAllocator g_aligned_buffer_allocator = {
+	aligned_buffer_allocate,
+	aligned_buffer_free,
+};
+
 static uint32_t get_core_id_index(uint32_t index) {
 	uint32_t lcore = spdk_env_get_first_core();
 	uint32_t i;
@@ -99,13 +208,62 @@ static uint32_t get_core_id_index(uint32_t index) {
 	return lcore;
 }
 
+/*
+ * Background (flush and compaction) threads get their blobfs channels, and so their
+ *  reactor cores and qpairs, from the last g_bg_io_cores cores. Foreground threads use
+ *  the other cores. Compaction I/O is also paced by g_bg_rate_limiter.
+ */
+static uint32_t g_bg_io_cores = 0;
+static std::shared_ptr<RateLimiter> g_bg_rate_limiter;
+
+/* IO_LOW on compaction threads, IO_HIGH on flush threads, IO_TOTAL on foreground threads */
+static thread_local Env::IOPriority g_thread_io_pri = Env::IO_TOTAL;
+
+void SpdkSetBackgroundIO(uint32_t nr_cores, int64_t compaction_bytes_per_sec)
+{
+	g_bg_io_cores = nr_cores;
+	if (compaction_bytes_per_sec > 0) {
+		g_bg_rate_limiter.reset(NewGenericRateLimiter(compaction_bytes_per_sec, 100 * 1000, 10,
+					RateLimiter::Mode::kAllIo));
+	} else {
+		g_bg_rate_limiter.reset();
+	}
+}
+
+static uint32_t get_channel_core_index(void)
+{
+	uint32_t nr_cores = spdk_env_get_core_count();
+	uint32_t cpu = sched_getcpu();
+
+	if (g_bg_io_cores == 0 || g_bg_io_cores >= nr_cores) {
+		return cpu % nr_cores;
+	}
+	if (g_thread_io_pri == Env::IO_TOTAL) {
+		return cpu % (nr_cores - g_bg_io_cores);
+	}
+	return nr_cores - g_bg_io_cores + cpu % g_bg_io_cores;
+}
+
+static void
+throttle_compaction_io(size_t bytes, RateLimiter::OpType op_type)
+{
+	std::shared_ptr<RateLimiter> limiter = g_bg_rate_limiter;
+
+	if (g_thread_io_pri != Env::IO_LOW || !limiter) {
+		return;
+	}
+	while (bytes > 0) {
+		bytes -= limiter->RequestToken(bytes, 0, Env::IO_LOW, nullptr, op_type);
+	}
+}
+
 static void
 set_channel()
 {
 	struct spdk_thread *thread;
 
 	if (g_fs != NULL && g_sync_args.channel == NULL) {
-		int channel_id = get_core_id_index(sched_getcpu() % spdk_env_get_core_count());
+		int channel_id = get_core_id_index(get_channel_core_index());
 		thread = spdk_thread_create("spdK_rocksdb", NULL);
 		spdk_set_thread(thread);
 		g_sync_args.channel = spdk_fs_alloc_thread_ctx_sync(g_fs, channel_id);
@@ -196,6 +354,7 @@ SpdkSequentialFile::Read(size_t n, Slice *result, char *scratch)
 	int64_t ret;
 
 	set_channel();
+	throttle_compaction_io(n, RateLimiter::OpType::kRead);
 	ret = spdk_file_read(mFile, g_sync_args.channel, scratch, mOffset, n);
 	if (ret >= 0) {
 		mOffset += ret;
@@ -229,6 +388,8 @@ public:
 	virtual ~SpdkRandomAccessFile();
 
 	virtual Status Read(uint64_t offset, size_t n, Slice *result, char *scratch) const override;
+	virtual Status MultiRead(ReadRequest *reqs, size_t num_reqs) override;
+	virtual void Hint(AccessPattern pattern) override;
 	virtual Status InvalidateCache(size_t offset, size_t length) override;
 };
 
@@ -244,7 +405,31 @@ SpdkRandomAccessFile::Read(uint64_t offset, size_t n, Slice *result, char *scrat
 	int64_t rc;
 
 	set_channel();
-	rc = spdk_file_read(mFile, g_sync_args.channel, scratch, offset, n);
+	throttle_compaction_io(n, RateLimiter::OpType::kRead);
+	if ((spdk_file_get_direct_io(mFile) & BLOBFS_DIRECT_READ) &&
+	    (offset % kDefaultPageSize || n % kDefaultPageSize ||
+	     reinterpret_cast<uintptr_t>(scratch) % kDefaultPageSize ||
+	     spdk_vtophys(scratch, NULL) == SPDK_VTOPHYS_ERROR)) {
+		/* Bounce through a pooled buffer rather than a fresh blobfs one; RocksDB's own
+		 * direct read buffers come from the pool and take the copy-free path below */
+		uint64_t aligned_offset = offset - (offset % kDefaultPageSize);
+		uint64_t head = offset - aligned_offset;
+		size_t aligned_n = (head + n + kDefaultPageSize - 1) / kDefaultPageSize * kDefaultPageSize;
+		char *buf = static_cast<char *>(g_buffer_pool.Allocate(aligned_n));
+
+		if (buf != NULL) {
+			rc = spdk_file_read(mFile, g_sync_args.channel, buf, aligned_offset, aligned_n);
+			if (rc >= 0) {
+				rc = rc > (int64_t)head ? std::min((uint64_t)rc - head, (uint64_t)n) : 0;
+				memcpy(scratch, buf + head, rc);
+			}
+			g_buffer_pool.Free(buf, aligned_n);
+		} else {
+			rc = spdk_file_read(mFile, g_sync_args.channel, scratch, offset, n);
+		}
+	} else {
+		rc = spdk_file_read(mFile, g_sync_args.channel, scratch, offset, n);
+	}
 	if (rc >= 0) {
 		*result = Slice(scratch, n);
 		return Status::OK();
@@ -254,6 +439,53 @@ SpdkRandomAccessFile::Read(uint64_t offset, size_t n, Slice *result, char *scrat
 	}
 }
 
+Status
+SpdkRandomAccessFile::MultiRead(ReadRequest *reqs, size_t num_reqs)
+{
+	std::vector<struct spdk_file_read_vec> vecs(num_reqs);
+
+	for (size_t i = 0; i < num_reqs; i++) {
+		vecs[i].payload = reqs[i].scratch;
+		vecs[i].offset = reqs[i].offset;
+		vecs[i].length = reqs[i].len;
+	}
+
+	set_channel();
+	for (size_t i = 0; i < num_reqs; i++) {
+		throttle_compaction_io(reqs[i].len, RateLimiter::OpType::kRead);
+	}
+	spdk_file_read_multi(mFile, g_sync_args.channel, vecs.data(), num_reqs);
+
+	for (size_t i = 0; i < num_reqs; i++) {
+		if (vecs[i].rc >= 0) {
+			reqs[i].result = Slice(reqs[i].scratch, vecs[i].rc);
+			reqs[i].status = Status::OK();
+		} else {
+			reqs[i].result = Slice(reqs[i].scratch, 0);
+			reqs[i].status = Status::IOError(spdk_file_get_name(mFile), strerror(-vecs[i].rc));
+		}
+	}
+	return Status::OK();
+}
+
+void
+SpdkRandomAccessFile::Hint(AccessPattern pattern)
+{
+	switch (pattern) {
+	case RANDOM:
+	case DONTNEED:
+		spdk_file_set_readahead_hint(mFile, SPDK_FILE_READAHEAD_RANDOM);
+		break;
+	case SEQUENTIAL:
+	case WILLNEED:
+		spdk_file_set_readahead_hint(mFile, SPDK_FILE_READAHEAD_SEQUENTIAL);
+		break;
+	default:
+		spdk_file_set_readahead_hint(mFile, SPDK_FILE_READAHEAD_NORMAL);
+		break;
+	}
+}
+
 Status
 SpdkRandomAccessFile::InvalidateCache(__attribute__((unused)) size_t offset,
 				      __attribute__((unused)) size_t length)
@@ -397,7 +629,24 @@ SpdkWritableFile::Append(const Slice &data)
 	int64_t rc;
 
 	set_channel();
-	rc = spdk_file_write(mFile, g_sync_args.channel, (void *)data.data(), mSize, data.size());
+	throttle_compaction_io(data.size(), RateLimiter::OpType::kWrite);
+	if ((spdk_file_get_direct_io(mFile) & BLOBFS_DIRECT_WRITE) &&
+	    mSize % kDefaultPageSize == 0 && data.size() % kDefaultPageSize == 0 &&
+	    (reinterpret_cast<uintptr_t>(data.data()) % kDefaultPageSize ||
+	     spdk_vtophys(const_cast<char *>(data.data()), NULL) == SPDK_VTOPHYS_ERROR)) {
+		/* Bounce whole pages through a pooled buffer rather than a fresh blobfs one */
+		char *buf = static_cast<char *>(g_buffer_pool.Allocate(data.size()));
+
+		if (buf != NULL) {
+			memcpy(buf, data.data(), data.size());
+			rc = spdk_file_write(mFile, g_sync_args.channel, buf, mSize, data.size());
+			g_buffer_pool.Free(buf, data.size());
+		} else {
+			rc = spdk_file_write(mFile, g_sync_args.channel, (void *)data.data(), mSize, data.size());
+		}
+	} else {
+		rc = spdk_file_write(mFile, g_sync_args.channel, (void *)data.data(), mSize, data.size());
+	}
 	if (rc >= 0) {
 		mSize += data.size();
 		return Status::OK();
@@ -430,6 +679,33 @@ struct thread_opt{
 	char* config_path;
 };
 
+/* A background job, tagged with the I/O priority of the pool that runs it */
+struct SpdkBGWork {
+	void (*function)(void *arg);
+	void *arg;
+	void (*unschedFunction)(void *arg);
+	Env::Priority pri;
+};
+
+static void
+SpdkBGWorkRun(void *arg)
+{
+	std::unique_ptr<SpdkBGWork> work(static_cast<SpdkBGWork *>(arg));
+
+	g_thread_io_pri = work->pri == Env::HIGH ? Env::IO_HIGH : Env::IO_LOW;
+	work->function(work->arg);
+}
+
+static void
+SpdkBGWorkUnschedule(void *arg)
+{
+	std::unique_ptr<SpdkBGWork> work(static_cast<SpdkBGWork *>(arg));
+
+	if (work->unschedFunction != nullptr) {
+		work->unschedFunction(work->arg);
+	}
+}
+
 class SpdkEnv : public EnvWrapper
 {
 private:
@@ -451,6 +727,14 @@ public:
 
 	virtual ~SpdkEnv();
 
+	virtual void Schedule(void (*function)(void *arg), void *arg, Priority pri = LOW,
+			      void *tag = nullptr, void (*unschedFunction)(void *arg) = nullptr) override
+	{
+		SpdkBGWork *work = new SpdkBGWork{function, arg, unschedFunction, pri};
+
+		EnvWrapper::Schedule(&SpdkBGWorkRun, work, pri, tag, &SpdkBGWorkUnschedule);
+	}
+
 	virtual Status NewSequentialFile(const std::string &fname,
 					 unique_ptr<SequentialFile> *result,
 					 const EnvOptions &options) override
@@ -468,6 +752,7 @@ public:
 				spdk_file_set_prefetch_size(file, mPrefetchSize);
 				spdk_file_set_prefetch_threshold(file, mPrefetchThreshold);
 				spdk_file_set_direct_io(file, mBlobfsDirectIO);
+				spdk_file_set_readahead_hint(file, SPDK_FILE_READAHEAD_SEQUENTIAL);
 				result->reset(new SpdkSequentialFile(file));
 				return Status::OK();
 			} else {
@@ -693,7 +978,7 @@ void SpdkInitializeThread(void)
 	struct spdk_thread *thread;
 
 	if (g_fs != NULL) {
-		int channel_id = get_core_id_index(sched_getcpu() % spdk_env_get_core_count());
+		int channel_id = get_core_id_index(get_channel_core_index());
 		thread = spdk_thread_create("spdk_rocksdb", NULL);
 		spdk_set_thread(thread);
 		g_sync_args.channel = spdk_fs_alloc_thread_ctx_sync(g_fs, channel_id);
@@ -847,6 +1132,10 @@ SpdkEnv::SpdkEnv(Env *base_env, const std::string &dir, const std::string &conf,
 	
 	if (!g_sync_args.channel)
 		SpdkInitializeThread();
+
+	if (mBlobfsDirectIO != BLOBFS_BUFFERED_IO) {
+		SetAlignedBufferAllocator(&g_aligned_buffer_allocator);
+	}
 }
 
 SpdkEnv::~SpdkEnv()
@@ -870,6 +1159,9 @@ SpdkEnv::~SpdkEnv()
 		}
 	}
 
+	/* AlignedBuffers still alive are freed with spdk_free() */
+	SetAlignedBufferAllocator(NULL);
+	g_buffer_pool.Release();
 	__send_request(spdk_rocksdb_shutdown, (void*)g_fs);
 	pthread_join(mSpdkTid, NULL);
 }
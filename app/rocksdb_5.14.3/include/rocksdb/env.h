@@ -18,6 +18,7 @@
 #define STORAGE_ROCKSDB_INCLUDE_ENV_H_
 
 #include <stdint.h>
+#include <cassert>
 #include <cstdarg>
 #include <functional>
 #include <limits>
@@ -537,6 +538,26 @@ class SequentialFile {
 };
 
 // A file abstraction for randomly reading the contents of a file.
+// A read of a batch passed to RandomAccessFile::MultiRead()
+struct ReadRequest {
+  // File offset in bytes
+  uint64_t offset;
+
+  // Length to read in bytes
+  size_t len;
+
+  // A buffer that MultiRead() can optionally place data in. It can
+  // ignore this and allocate its own buffer
+  char* scratch;
+
+  // Output parameter set by MultiRead() to point to the data buffer, and
+  // the number of valid bytes
+  Slice result;
+
+  // Status of read
+  Status status;
+};
+
 class RandomAccessFile {
  public:
 
@@ -556,6 +577,21 @@ class RandomAccessFile {
   virtual Status Read(uint64_t offset, size_t n, Slice* result,
                       char* scratch) const = 0;
 
+  // Read a bunch of blocks as described by reqs. The blocks can
+  // optionally be read in parallel. This is a synchronous call, i.e it
+  // should return after all reads have completed. The reads will be
+  // non-overlapping. If the function return Status is not ok, status of
+  // individual requests will be ignored and return status will be assumed
+  // for all read requests.
+  virtual Status MultiRead(ReadRequest* reqs, size_t num_reqs) {
+    assert(reqs != nullptr);
+    for (size_t i = 0; i < num_reqs; ++i) {
+      ReadRequest& req = reqs[i];
+      req.status = Read(req.offset, req.len, &req.result, req.scratch);
+    }
+    return Status::OK();
+  }
+
   // Readahead the file starting from offset by n bytes for caching.
   virtual Status Prefetch(uint64_t /*offset*/, size_t /*n*/) {
     return Status::OK();
@@ -1252,6 +1288,18 @@ Env* NewSpdkEnv(Env* base_env, const std::string& fsname, const std::string& con
 // Initializes a thread for SpdkEnv processing.
 void SpdkInitializeThread(void);
 
+// Moves the blobfs I/O of flush and compaction threads to the last nr_cores
+// SPDK cores and their qpairs, away from foreground reads, and limits
+// compaction I/O to compaction_bytes_per_sec (0 = unlimited). Call before
+// NewSpdkEnv().
+void SpdkSetBackgroundIO(uint32_t nr_cores, int64_t compaction_bytes_per_sec);
+
+// Returns a new environment that stores the files under fsname as objects of
+// the first KV SSD of the JSON configuration confname, without blobfs.
+// Returns nullptr if the configuration is not for a KV SSD. The device
+// needs CQ threads for the async block I/O.
+Env* NewKvssdEnv(Env* base_env, const std::string& fsname, const std::string& confname);
+
 }  // namespace rocksdb
 
 #endif  // STORAGE_ROCKSDB_INCLUDE_ENV_H_
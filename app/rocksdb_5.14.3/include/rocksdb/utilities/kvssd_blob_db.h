@@ -0,0 +1,67 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+#ifndef ROCKSDB_LITE
+
+#include <string>
+
+#include "rocksdb/utilities/stackable_db.h"
+#include "rocksdb/db.h"
+
+namespace rocksdb {
+
+struct KvssdBlobOptions {
+  // Values of at least this size are stored on the KV SSD, smaller ones stay
+  // in the LSM. Values larger than the device value limit (2MB) always stay
+  // in the LSM.
+  uint64_t min_blob_size = 16 * 1024;
+
+  // KV SSD handle, 0 = the first device of kv_get_device_handles(). The
+  // uNVMe SDK has to be initialized for a KV SSD before Open().
+  uint64_t device_handle = 0;
+};
+
+// Database keeping large values of the default column family on a KV SSD.
+//
+// BEHAVIOUR:
+// A value of at least min_blob_size is stored as a KV object ("value blob")
+// with kv_store_async(); the LSM only carries its handle. Compaction moves
+// the handles, not the values, so a large value is written to flash once.
+// Get/MultiGet/iterators fetch the blobs with kv_retrieve_async(), all
+// blobs of a MultiGet in one batch.
+// Overwriting or deleting a key leaves its old blob on the device for the
+// snapshots and iterators that may still read it; a write reads the old
+// values of its keys to find them. GarbageCollect() deletes the blobs no key
+// refers to once no snapshot taken before they were replaced is live, and
+// those left by a crash between the blob store and the LSM write.
+//
+// CONSTRAINTS:
+// Only the default column family is separated. Merge and DeleteRange are not
+// supported on it. Take snapshots through this API, so GarbageCollect()
+// knows them; an iterator without a snapshot takes one for its lifetime.
+//
+// !!!WARNING!!!:
+// The LSM values of the default column family carry a type byte, so always
+// open the db with this API.
+class KvssdBlobDB : public StackableDB {
+ public:
+  static Status Open(const Options& options,
+                     const KvssdBlobOptions& blob_options,
+                     const std::string& dbname, KvssdBlobDB** dbptr);
+
+  // Deletes the value blobs of the db no key or live snapshot refers to
+  virtual Status GarbageCollect() = 0;
+
+ protected:
+  explicit KvssdBlobDB(DB* db) : StackableDB(db) {}
+};
+
+// Destroys the db and deletes all its value blobs from the KV SSD
+Status DestroyKvssdBlobDB(const std::string& dbname, const Options& options,
+                          const KvssdBlobOptions& blob_options);
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
@@ -62,6 +62,7 @@ LIB_SOURCES =                                                   \
   env/env_hdfs.cc                                               \
   env/env_posix.cc                                              \
   env/env_spdk.cc                      							\
+  env/env_kvssd.cc                                              \
   env/io_posix.cc                                               \
   env/mock_env.cc                                               \
   memtable/alloc_tracker.cc                                     \
@@ -178,6 +179,7 @@ LIB_SOURCES =                                                   \
   utilities/env_mirror.cc                                       \
   utilities/env_timed.cc                                        \
   utilities/geodb/geodb_impl.cc                                 \
+  utilities/kvssd_blob_db/kvssd_blob_db_impl.cc                 \
   utilities/leveldb_options/leveldb_options.cc                  \
   utilities/lua/rocks_lua_compaction_filter.cc                  \
   utilities/memory/memory_util.cc                               \
@@ -309,6 +311,7 @@ MAIN_SOURCES =                                                          \
   db/write_callback_test.cc                                             \
   db/write_controller_test.cc                                           \
   env/env_basic_test.cc                                                 \
+  env/env_kvssd_test.cc                                                 \
   env/env_test.cc                                                       \
   env/mock_env_test.cc                                                  \
   memtable/inlineskiplist_test.cc                                       \
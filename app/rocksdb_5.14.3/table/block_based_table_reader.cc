@@ -2149,6 +2149,144 @@ Status BlockBasedTable::Get(const ReadOptions& read_options, const Slice& key,
   return s;
 }
 
+void BlockBasedTable::PrepareMultiGet(const ReadOptions& read_options,
+                                      const std::vector<Slice>& keys,
+                                      bool skip_filters) {
+  Cache* block_cache = rep_->table_options.block_cache.get();
+  // Blocks are handed to Get() through the uncompressed block cache
+  if (block_cache == nullptr ||
+      rep_->table_options.block_cache_compressed != nullptr ||
+      !read_options.fill_cache || read_options.read_tier == kBlockCacheTier ||
+      keys.size() < 2) {
+    return;
+  }
+
+  CachableEntry<FilterBlockReader> filter_entry;
+  if (!skip_filters) {
+    filter_entry = GetFilter(/*prefetch_buffer*/ nullptr, /*no_io*/ false,
+                             /*get_context*/ nullptr);
+  }
+  FilterBlockReader* filter = filter_entry.value;
+
+  BlockIter iiter_on_stack;
+  auto iiter = NewIndexIterator(read_options, &iiter_on_stack);
+  std::unique_ptr<InternalIterator> iiter_unique_ptr;
+  if (iiter != &iiter_on_stack) {
+    iiter_unique_ptr.reset(iiter);
+  }
+
+  // The first data block of every key that may be in the file and whose block
+  // is not cached yet
+  std::vector<BlockHandle> handles;
+  char cache_key[kMaxCacheKeyPrefixSize + kMaxVarint64Length];
+  for (const auto& key : keys) {
+    if (!FullFilterKeyMayMatch(read_options, filter, key, false)) {
+      continue;
+    }
+    iiter->Seek(key);
+    if (!iiter->Valid()) {
+      continue;
+    }
+    BlockHandle handle;
+    Slice input = iiter->value();
+    if (!handle.DecodeFrom(&input).ok()) {
+      continue;
+    }
+    if (filter != nullptr && filter->IsBlockBased() &&
+        !filter->KeyMayMatch(ExtractUserKey(key), handle.offset(), false)) {
+      continue;
+    }
+    bool duplicate = false;
+    for (const auto& h : handles) {
+      if (h.offset() == handle.offset()) {
+        duplicate = true;
+        break;
+      }
+    }
+    if (duplicate) {
+      continue;
+    }
+    Slice ckey = GetCacheKey(rep_->cache_key_prefix,
+                             rep_->cache_key_prefix_size, handle, cache_key);
+    Cache::Handle* cache_handle = block_cache->Lookup(ckey);
+    if (cache_handle != nullptr) {
+      block_cache->Release(cache_handle);
+      continue;
+    }
+    handles.push_back(handle);
+  }
+
+  if (!rep_->filter_entry.IsSet()) {
+    filter_entry.Release(block_cache);
+  }
+
+  // A single block is left to Get(), which reads it the regular way
+  if (handles.size() < 2) {
+    return;
+  }
+
+  std::vector<ReadRequest> reqs(handles.size());
+  std::vector<std::unique_ptr<char[]>> bufs(handles.size());
+  for (size_t i = 0; i < handles.size(); i++) {
+    size_t len = static_cast<size_t>(handles[i].size()) + kBlockTrailerSize;
+    bufs[i].reset(new char[len]);
+    reqs[i].offset = handles[i].offset();
+    reqs[i].len = len;
+    reqs[i].scratch = bufs[i].get();
+  }
+
+  Status s;
+  {
+    StopWatch sw(rep_->ioptions.env, rep_->ioptions.statistics,
+                 READ_BLOCK_GET_MICROS);
+    PERF_TIMER_GUARD(block_read_time);
+    s = rep_->file->MultiRead(reqs.data(), reqs.size());
+  }
+  if (!s.ok()) {
+    // Get() reads the blocks again and reports the error
+    return;
+  }
+
+  Slice compression_dict;
+  if (rep_->compression_dict_block) {
+    compression_dict = rep_->compression_dict_block->data;
+  }
+  for (size_t i = 0; i < handles.size(); i++) {
+    PERF_COUNTER_ADD(block_read_count, 1);
+    PERF_COUNTER_ADD(block_read_byte, reqs[i].len);
+    if (!reqs[i].status.ok()) {
+      continue;
+    }
+
+    BlockContents contents;
+    BlockFetcher block_fetcher(
+        rep_->file.get(), nullptr /* prefetch buffer */, rep_->footer,
+        read_options, handles[i], &contents, rep_->ioptions,
+        rep_->blocks_maybe_compressed, compression_dict,
+        rep_->persistent_cache_options);
+    if (!block_fetcher.ParseBlockContents(reqs[i].result).ok()) {
+      continue;
+    }
+
+    Slice ckey = GetCacheKey(rep_->cache_key_prefix,
+                             rep_->cache_key_prefix_size, handles[i],
+                             cache_key);
+    CachableEntry<Block> block_entry;
+    s = PutDataBlockToCache(
+        ckey, Slice(), block_cache, nullptr, read_options, rep_->ioptions,
+        &block_entry,
+        new Block(std::move(contents), rep_->global_seqno,
+                  rep_->table_options.read_amp_bytes_per_bit,
+                  rep_->ioptions.statistics),
+        rep_->table_options.format_version, compression_dict,
+        rep_->table_options.read_amp_bytes_per_bit, false /* is_index */,
+        Cache::Priority::LOW, nullptr /* get_context */);
+    // Drop the reference, a block that the cache did not take is freed here
+    block_entry.Release(block_cache);
+    delete block_entry.value;
+  }
+}
+
 Status BlockBasedTable::Prefetch(const Slice* const begin,
                                  const Slice* const end) {
   auto& comparator = rep_->internal_comparator;
@@ -110,6 +110,12 @@ class BlockBasedTable : public TableReader {
   Status Get(const ReadOptions& readOptions, const Slice& key,
              GetContext* get_context, bool skip_filters = false) override;
 
+  // Read the data blocks of the keys that are not in the block cache with
+  // one RandomAccessFileReader::MultiRead() and insert them into the cache.
+  void PrepareMultiGet(const ReadOptions& read_options,
+                       const std::vector<Slice>& keys,
+                       bool skip_filters = false) override;
+
   // Pre-fetch the disk blocks that correspond to the key range specified by
   // (kbegin, kend). The call will return error status in the event of
   // IO or iteration error.
@@ -237,4 +237,40 @@ Status BlockFetcher::ReadBlockContents() {
   return status_;
 }
 
+Status BlockFetcher::ParseBlockContents(const Slice& raw_block) {
+  block_size_ = static_cast<size_t>(handle_.size());
+  if (raw_block.size() != block_size_ + kBlockTrailerSize) {
+    return Status::Corruption("truncated block read from " +
+                              file_->file_name() + " offset " +
+                              ToString(handle_.offset()) + ", expected " +
+                              ToString(block_size_ + kBlockTrailerSize) +
+                              " bytes, got " + ToString(raw_block.size()));
+  }
+
+  slice_ = raw_block;
+  CheckBlockChecksum();
+  if (!status_.ok()) {
+    return status_;
+  }
+
+  PERF_TIMER_GUARD(block_decompress_time);
+
+  compression_type =
+      static_cast<rocksdb::CompressionType>(slice_.data()[block_size_]);
+
+  if (do_uncompress_ && compression_type != kNoCompression) {
+    status_ = UncompressBlockContents(slice_.data(), block_size_, contents_,
+                                      footer_.version(), compression_dict_,
+                                      ioptions_);
+  } else {
+    // The caller keeps the raw buffer, so the block gets its own copy
+    heap_buf_.reset(new char[block_size_]);
+    memcpy(heap_buf_.get(), slice_.data(), block_size_);
+    *contents_ = BlockContents(std::move(heap_buf_), block_size_, true,
+                               compression_type);
+  }
+
+  return status_;
+}
+
 }  // namespace rocksdb
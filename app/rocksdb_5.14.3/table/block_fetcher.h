@@ -38,6 +38,9 @@ class BlockFetcher {
         compression_dict_(compression_dict),
         cache_options_(cache_options) {}
   Status ReadBlockContents();
+  // Like ReadBlockContents(), for a block and trailer that were already read
+  // from the file, e.g. by RandomAccessFileReader::MultiRead()
+  Status ParseBlockContents(const Slice& raw_block);
 
  private:
   static const uint32_t kDefaultStackBufferSize = 5000;
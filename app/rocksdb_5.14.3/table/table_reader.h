@@ -9,6 +9,7 @@
 
 #pragma once
 #include <memory>
+#include <vector>
 #include "table/internal_iterator.h"
 
 namespace rocksdb {
@@ -81,6 +82,14 @@ class TableReader {
   virtual Status Get(const ReadOptions& readOptions, const Slice& key,
                      GetContext* get_context, bool skip_filters = false) = 0;
 
+  // Prepare the Get() of each of the given internal keys, e.g. by reading
+  // the blocks they need in one batch. Called by MultiGet() before the keys
+  // are looked up one by one.
+  // skip_filters: same as for Get()
+  virtual void PrepareMultiGet(const ReadOptions& /*read_options*/,
+                               const std::vector<Slice>& /*keys*/,
+                               bool /*skip_filters*/ = false) {}
+
   // Prefetch data corresponding to a give range of keys
   // Typically this functionality is required for table implementations that
   // persists the data on a non volatile storage medium like disk/SSD
@@ -51,6 +51,7 @@
 #include "rocksdb/rate_limiter.h"
 #include "rocksdb/slice.h"
 #include "rocksdb/slice_transform.h"
+#include "rocksdb/utilities/kvssd_blob_db.h"
 #include "rocksdb/utilities/object_registry.h"
 #include "rocksdb/utilities/optimistic_transaction_db.h"
 #include "rocksdb/utilities/options_util.h"
@@ -710,6 +711,14 @@ DEFINE_uint64(blob_db_bytes_per_sync, 0, "Bytes to sync blob file at.");
 DEFINE_uint64(blob_db_file_size, 256 * 1024 * 1024,
               "Target size of each blob file.");
 
+DEFINE_bool(use_kvssd_blob_db, false,
+            "Open a KvssdBlobDB instance, which stores large values on the "
+            "KV SSD of --mpdk and only their handles in the LSM tree.");
+
+DEFINE_uint64(kvssd_blob_min_size, 16 * 1024,
+              "Smallest value KvssdBlobDB stores on the KV SSD. Smaller "
+              "values are inlined with the key in the LSM tree.");
+
 #endif  // ROCKSDB_LITE
 
 DEFINE_bool(report_bg_io_stats, false,
@@ -797,7 +806,7 @@ static bool ValidateTableCacheNumshardbits(const char* flagname,
 }
 DEFINE_int32(table_cache_numshardbits, 4, "");
 
-DEFINE_string(mpdk, "", "Name of MPDK json configuration file");
+DEFINE_string(mpdk, "", "Name of MPDK json configuration file, a KV SSD configuration stores the DB as KV objects");
 DEFINE_string(spdk_bdev, "", "Name of SPDK blockdev to load");
 DEFINE_uint64(spdk_cache_size, 4096, "Size of SPDK filesystem cache (in MB)");
 DEFINE_bool(use_retain_cache, false, "flag to retain blobfs readcache");
@@ -805,6 +814,10 @@ DEFINE_bool(use_prefetch_ctl, false, "flag to control prefetch size");
 DEFINE_int32(prefetch_threshold, 128 * 1024, "blobfs prefetch(readahead) threshold");
 DEFINE_bool(use_blobfs_direct_read, false, "flag to use blobfs direct read");
 DEFINE_bool(use_blobfs_direct_write, false, "flag to use blobfs direct write");
+DEFINE_uint64(spdk_background_io_cores, 0, "Number of SPDK cores (and qpairs) dedicated to"
+              " flush and compaction I/O, 0 = shared with foreground I/O");
+DEFINE_int64(spdk_compaction_io_rate, 0, "Compaction I/O rate limit in bytes/sec on SPDK"
+             " blobfs, 0 = unlimited");
 DEFINE_bool(use_manual_schedule_io, false, "If this flag sets, threads of generating KV workloads"
             " are scheduled in order from core 0. Otherwise, scheduled by kernel automatically");
 
@@ -2251,6 +2264,9 @@ class Benchmark {
       if (use_blob_db_) {
         blob_db::DestroyBlobDB(FLAGS_db, options, blob_db::BlobDBOptions());
       }
+      if (FLAGS_use_kvssd_blob_db) {
+        DestroyKvssdBlobDB(FLAGS_db, options, KvssdBlobOptions());
+      }
 #endif  // !ROCKSDB_LITE
       DestroyDB(FLAGS_db, options);
       if (!FLAGS_wal_dir.empty()) {
@@ -3478,6 +3494,14 @@ void VerifyDBFromDB(std::string& truth_db_name) {
       if (s.ok()) {
         db->db = ptr;
       }
+    } else if (FLAGS_use_kvssd_blob_db) {
+      KvssdBlobOptions kvssd_blob_options;
+      kvssd_blob_options.min_blob_size = FLAGS_kvssd_blob_min_size;
+      KvssdBlobDB* ptr = nullptr;
+      s = KvssdBlobDB::Open(options, kvssd_blob_options, db_name, &ptr);
+      if (s.ok()) {
+        db->db = ptr;
+      }
     } else if (FLAGS_use_blob_db) {
       blob_db::BlobDBOptions blob_db_options;
       blob_db_options.enable_garbage_collection = FLAGS_blob_db_enable_gc;
@@ -5462,16 +5486,25 @@ int db_bench_tool(int argc, char** argv) {
 
     kv_sdk_load_option(&sdk_opt, config_json_path);
 
-    int prefetch_size = 0;
-    if(FLAGS_use_prefetch_ctl){
-      prefetch_size = FLAGS_block_size;
-      fprintf(stderr, "set prefetch_size = %d\n",prefetch_size);
-    }
-    FLAGS_env = rocksdb::NewSpdkEnv(rocksdb::Env::Default(), FLAGS_db, FLAGS_mpdk, FLAGS_spdk_bdev, FLAGS_spdk_cache_size, FLAGS_use_retain_cache, prefetch_size, FLAGS_prefetch_threshold, FLAGS_use_blobfs_direct_read, FLAGS_use_blobfs_direct_write);
-    if (FLAGS_env == NULL) {
-      fprintf(stderr, "Could not load SPDK blobfs - check that SPDK mkfs was run "
-                      "against block device %s.\n", FLAGS_spdk_bdev.c_str());
-      exit(1);
+    if (sdk_opt.ssd_type == KV_TYPE_SSD) {
+      FLAGS_env = rocksdb::NewKvssdEnv(rocksdb::Env::Default(), FLAGS_db, FLAGS_mpdk);
+      if (FLAGS_env == NULL) {
+        fprintf(stderr, "Could not open the KV SSD of %s.\n", FLAGS_mpdk.c_str());
+        exit(1);
+      }
+    } else {
+      int prefetch_size = 0;
+      if(FLAGS_use_prefetch_ctl){
+        prefetch_size = FLAGS_block_size;
+        fprintf(stderr, "set prefetch_size = %d\n",prefetch_size);
+      }
+      rocksdb::SpdkSetBackgroundIO(FLAGS_spdk_background_io_cores, FLAGS_spdk_compaction_io_rate);
+      FLAGS_env = rocksdb::NewSpdkEnv(rocksdb::Env::Default(), FLAGS_db, FLAGS_mpdk, FLAGS_spdk_bdev, FLAGS_spdk_cache_size, FLAGS_use_retain_cache, prefetch_size, FLAGS_prefetch_threshold, FLAGS_use_blobfs_direct_read, FLAGS_use_blobfs_direct_write);
+      if (FLAGS_env == NULL) {
+        fprintf(stderr, "Could not load SPDK blobfs - check that SPDK mkfs was run "
+                        "against block device %s.\n", FLAGS_spdk_bdev.c_str());
+        exit(1);
+      }
     }
   }
 
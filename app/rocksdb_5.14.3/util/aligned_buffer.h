@@ -9,6 +9,7 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include "port/port.h"
 
 namespace rocksdb {
@@ -25,12 +26,47 @@ inline size_t Roundup(size_t x, size_t y) {
 
 inline size_t Rounddown(size_t x, size_t y) { return (x / y) * y; }
 
+// Memory for AlignedBuffer, e.g. pinned memory an Env transfers to and from
+// without a copy. Allocate returns nullptr when it cannot serve the request,
+// and the buffer then comes from the heap.
+struct AlignedBufferAllocator {
+  void* (*Allocate)(size_t size, size_t alignment);
+  void (*Free)(void* buf, size_t size);
+};
+
+inline std::atomic<const AlignedBufferAllocator*>& AlignedBufferAllocatorSlot() {
+  static std::atomic<const AlignedBufferAllocator*> allocator(nullptr);
+  return allocator;
+}
+
+// Buffers allocated from now on come from allocator, or from the heap again
+// with nullptr. Buffers already allocated are still returned to the allocator
+// they came from, which therefore has to outlive them.
+inline void SetAlignedBufferAllocator(const AlignedBufferAllocator* allocator) {
+  AlignedBufferAllocatorSlot().store(allocator, std::memory_order_release);
+}
+
 // This class is to manage an aligned user
 // allocated buffer for direct I/O purposes
 // though can be used for any purpose.
 class AlignedBuffer {
+  struct Deleter {
+    void (*free_)(void* buf, size_t size);
+    size_t size_;
+
+    Deleter() : free_(nullptr), size_(0) {}
+
+    void operator()(char* buf) const {
+      if (free_ != nullptr) {
+        free_(buf, size_);
+      } else {
+        delete[] buf;
+      }
+    }
+  };
+
   size_t alignment_;
-  std::unique_ptr<char[]> buf_;
+  std::unique_ptr<char[], Deleter> buf_;
   size_t capacity_;
   size_t cursize_;
   char* bufstart_;
@@ -108,10 +144,25 @@ public:
     }
 
     size_t new_capacity = Roundup(requested_capacity, alignment_);
-    char* new_buf = new char[new_capacity + alignment_];
-    char* new_bufstart = reinterpret_cast<char*>(
-        (reinterpret_cast<uintptr_t>(new_buf) + (alignment_ - 1)) &
-        ~static_cast<uintptr_t>(alignment_ - 1));
+    const AlignedBufferAllocator* allocator =
+        AlignedBufferAllocatorSlot().load(std::memory_order_acquire);
+    Deleter deleter;
+    char* new_buf = nullptr;
+    char* new_bufstart;
+
+    if (allocator != nullptr) {
+      new_buf = static_cast<char*>(allocator->Allocate(new_capacity, alignment_));
+    }
+    if (new_buf != nullptr) {
+      deleter.free_ = allocator->Free;
+      deleter.size_ = new_capacity;
+      new_bufstart = new_buf;
+    } else {
+      new_buf = new char[new_capacity + alignment_];
+      new_bufstart = reinterpret_cast<char*>(
+          (reinterpret_cast<uintptr_t>(new_buf) + (alignment_ - 1)) &
+          ~static_cast<uintptr_t>(alignment_ - 1));
+    }
 
     if (copy_data) {
       memcpy(new_bufstart, bufstart_, cursize_);
@@ -121,7 +172,7 @@ public:
 
     bufstart_ = new_bufstart;
     capacity_ = new_capacity;
-    buf_.reset(new_buf);
+    buf_ = std::unique_ptr<char[], Deleter>(new_buf, deleter);
   }
   // Used for write
   // Returns the number of bytes appended
@@ -148,6 +148,34 @@ Status RandomAccessFileReader::Read(uint64_t offset, size_t n, Slice* result,
   return s;
 }
 
+Status RandomAccessFileReader::MultiRead(ReadRequest* reqs,
+                                         size_t num_reqs) const {
+  // Direct and rate limited reads go through the aligned and chunked Read()
+  if (use_direct_io() || (for_compaction_ && rate_limiter_ != nullptr)) {
+    for (size_t i = 0; i < num_reqs; ++i) {
+      reqs[i].status =
+          Read(reqs[i].offset, reqs[i].len, &reqs[i].result, reqs[i].scratch);
+    }
+    return Status::OK();
+  }
+
+  Status s;
+  uint64_t elapsed = 0;
+  {
+    StopWatch sw(env_, stats_, hist_type_,
+                 (stats_ != nullptr) ? &elapsed : nullptr);
+    IOSTATS_TIMER_GUARD(read_nanos);
+    s = file_->MultiRead(reqs, num_reqs);
+    for (size_t i = 0; s.ok() && i < num_reqs; ++i) {
+      IOSTATS_ADD_IF_POSITIVE(bytes_read, reqs[i].result.size());
+    }
+  }
+  if (stats_ != nullptr && file_read_hist_ != nullptr) {
+    file_read_hist_->Add(elapsed);
+  }
+  return s;
+}
+
 Status WritableFileWriter::Append(const Slice& data) {
   const char* src = data.data();
   size_t left = data.size();
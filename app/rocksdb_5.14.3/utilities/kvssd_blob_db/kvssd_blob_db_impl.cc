@@ -0,0 +1,753 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+#ifndef ROCKSDB_LITE
+
+#include "utilities/kvssd_blob_db/kvssd_blob_db_impl.h"
+
+#include <endian.h>
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <set>
+#include <unordered_set>
+
+#include "db/write_batch_internal.h"
+#include "kv_apis.h"
+#include "rocksdb/env.h"
+#include "util/coding.h"
+#include "util/hash.h"
+
+namespace rocksdb {
+
+namespace {
+
+// blobs RunBlobIo() submits at once, bounded by the queue depth the SDK
+// takes without back-pressure
+const size_t kMaxBlobIoBatch = 256;
+
+// death of a blob whose LSM write is in progress, see dead_blobs_
+const uint64_t kDeathPending = ~0ULL;
+
+struct BlobIoWaiter {
+  std::mutex mutex;
+  std::condition_variable cond;
+  uint32_t pending = 0;
+};
+
+struct BlobIoCtx {
+  kv_pair kv;  // first member, the completion gets its address
+  char key[KvssdBlobDBImpl::kBlobKeyLength];
+  unsigned int status;
+};
+
+void BlobIoDone(kv_pair* kv, unsigned int /*result*/, unsigned int status) {
+  BlobIoCtx* ctx = reinterpret_cast<BlobIoCtx*>(kv);
+  BlobIoWaiter* waiter = static_cast<BlobIoWaiter*>(kv->param.private_data);
+  std::lock_guard<std::mutex> guard(waiter->mutex);
+
+  ctx->status = status;
+  if (--waiter->pending == 0) {
+    waiter->cond.notify_all();
+  }
+}
+
+uint32_t BlobValueLength(uint32_t size) {
+  return (size + KV_VALUE_LENGTH_ALIGNMENT_UNIT - 1) &
+         ~(KV_VALUE_LENGTH_ALIGNMENT_UNIT - 1);
+}
+
+Status BlobStatus(unsigned int rc) {
+  char buf[64];
+
+  if (rc == KV_SUCCESS) {
+    return Status::OK();
+  } else if (rc == KV_ERR_NOT_EXIST_KEY) {
+    return Status::NotFound("KvssdBlobDB: value blob deleted");
+  }
+  snprintf(buf, sizeof(buf), "0x%x", rc);
+  return Status::IOError("KvssdBlobDB: value blob I/O failed", buf);
+}
+
+std::string EncodeBlobHandle(uint32_t size, uint64_t version) {
+  std::string handle;
+
+  handle.push_back(KvssdBlobDBImpl::kBlobValue);
+  PutFixed32(&handle, size);
+  PutFixed64(&handle, version);
+  return handle;
+}
+
+bool DecodeBlobHandle(const Slice& lsm_value, uint32_t* size,
+                      uint64_t* version) {
+  if (lsm_value.size() != KvssdBlobDBImpl::kBlobHandleLength ||
+      lsm_value[0] != KvssdBlobDBImpl::kBlobValue) {
+    return false;
+  }
+  *size = DecodeFixed32(lsm_value.data() + 1);
+  *version = DecodeFixed64(lsm_value.data() + 5);
+  return true;
+}
+
+// Submits the n blobs of ios at once and waits for all of them
+void RunBlobIoBatch(uint64_t handle, uint32_t be_prefix,
+                    KvssdBlobDBImpl::BlobOp op, KvssdBlobDBImpl::BlobIo* ios,
+                    size_t n, BlobIoCtx* ctxs) {
+  BlobIoWaiter waiter;
+  int rc;
+
+  for (size_t i = 0; i < n; i++) {
+    KvssdBlobDBImpl::BlobIo& io = ios[i];
+    BlobIoCtx& ctx = ctxs[i];
+    uint64_t be_version = htobe64(io.version);
+
+    memset(&ctx.kv, 0, sizeof(ctx.kv));
+    memcpy(ctx.key, &be_prefix, sizeof(be_prefix));
+    memcpy(ctx.key + sizeof(be_prefix), &be_version, sizeof(be_version));
+    ctx.kv.keyspace_id = KV_KEYSPACE_IODATA;
+    ctx.kv.key.key = ctx.key;
+    ctx.kv.key.length = KvssdBlobDBImpl::kBlobKeyLength;
+    ctx.kv.param.async_cb = reinterpret_cast<void (*)()>(&BlobIoDone);
+    ctx.kv.param.private_data = &waiter;
+    if (op != KvssdBlobDBImpl::kBlobDelete) {
+      ctx.kv.value.value = io.buf;
+      ctx.kv.value.length = BlobValueLength(io.size);
+    }
+    {
+      std::lock_guard<std::mutex> guard(waiter.mutex);
+      waiter.pending++;
+    }
+    switch (op) {
+      case KvssdBlobDBImpl::kBlobStore:
+        ctx.kv.param.io_option.store_option = KV_STORE_IDEMPOTENT;
+        rc = kv_store_async(handle, &ctx.kv);
+        break;
+      case KvssdBlobDBImpl::kBlobRetrieve:
+        ctx.kv.param.io_option.retrieve_option = KV_RETRIEVE_DEFAULT;
+        rc = kv_retrieve_async(handle, &ctx.kv);
+        break;
+      default:
+        ctx.kv.param.io_option.delete_option = KV_DELETE_DEFAULT;
+        rc = kv_delete_async(handle, &ctx.kv);
+        break;
+    }
+    if (rc != KV_SUCCESS) {
+      std::lock_guard<std::mutex> guard(waiter.mutex);
+      waiter.pending--;
+      ctx.status = rc;
+    }
+  }
+
+  std::unique_lock<std::mutex> lock(waiter.mutex);
+  waiter.cond.wait(lock, [&waiter] { return waiter.pending == 0; });
+  for (size_t i = 0; i < n; i++) {
+    ios[i].status = BlobStatus(ctxs[i].status);
+  }
+}
+
+}  // namespace
+
+KvssdBlobDBImpl::KvssdBlobDBImpl(DB* db, const KvssdBlobOptions& blob_options,
+                                 uint64_t handle, uint32_t key_prefix)
+    : KvssdBlobDB(db),
+      min_blob_size_(std::max<uint64_t>(blob_options.min_blob_size, 1)),
+      max_blob_size_(KV_MAX_IO_VALUE_LEN),
+      handle_(handle),
+      key_prefix_(key_prefix),
+      // Versions only grow while the clock moves forward, so they do not
+      // repeat across reopenings. Blobs are stored idempotent: a repeated
+      // version fails the write instead of overwriting a live blob.
+      next_version_(db->GetEnv()->NowMicros() << 8) {}
+
+Status KvssdBlobDBImpl::GetDeviceHandle(const KvssdBlobOptions& blob_options,
+                                        uint64_t* handle) {
+  uint64_t handles[NR_MAX_SSD];
+  int nr_device = 0;
+
+  if (blob_options.device_handle != 0) {
+    *handle = blob_options.device_handle;
+    return Status::OK();
+  }
+  if (kv_get_device_handles(&nr_device, handles) != KV_SUCCESS ||
+      nr_device == 0) {
+    return Status::InvalidArgument(
+        "KvssdBlobDB: no KV SSD, initialize the uNVMe SDK first");
+  }
+  *handle = handles[0];
+  return Status::OK();
+}
+
+uint32_t KvssdBlobDBImpl::BlobKeyPrefix(const std::string& dbname) {
+  return 0x52420000 | (Hash(dbname.data(), dbname.size(), 0) & 0xFFFF);
+}
+
+Status KvssdBlobDBImpl::ListBlobs(uint64_t handle, uint32_t key_prefix,
+                                  std::vector<uint64_t>* versions) {
+  uint32_t be_prefix = htobe32(key_prefix);
+  uint32_t prefix;
+  kv_key_iterator* it;
+  const kv_key* key;
+  uint32_t iterator;
+  uint64_t be_version;
+  int rc;
+
+  // the device matches the prefix against the first key bytes as stored
+  memcpy(&prefix, &be_prefix, sizeof(prefix));
+  iterator = kv_iterate_open(handle, KV_KEYSPACE_IODATA, 0xFFFFFFFF, prefix,
+                             KV_KEY_ITERATE);
+  if (iterator == KV_INVALID_ITERATE_HANDLE ||
+      iterator > KV_MAX_ITERATE_HANDLE) {
+    return BlobStatus(KV_ERR_ITERATE_NO_AVAILABLE_HANDLE);
+  }
+  rc = kv_key_iterator_open(handle, iterator, 0, &it);
+  if (rc == KV_SUCCESS) {
+    while ((rc = kv_iterate_next(it, &key)) == KV_SUCCESS) {
+      if (key->length == kBlobKeyLength) {
+        memcpy(&be_version, static_cast<const char*>(key->key) + 4,
+               sizeof(be_version));
+        versions->push_back(be64toh(be_version));
+      }
+    }
+    if (rc == KV_ERR_ITERATE_READ_EOF) {
+      rc = KV_SUCCESS;
+    }
+    kv_key_iterator_close(it);
+  }
+  kv_iterate_close(handle, iterator);
+  return BlobStatus(rc);
+}
+
+void KvssdBlobDBImpl::RunBlobIo(uint64_t handle, uint32_t key_prefix,
+                                BlobOp op, std::vector<BlobIo>* ios) {
+  std::vector<BlobIoCtx> ctxs(std::min(kMaxBlobIoBatch, ios->size()));
+  uint32_t be_prefix = htobe32(key_prefix);
+
+  for (size_t start = 0; start < ios->size(); start += kMaxBlobIoBatch) {
+    size_t n = std::min(kMaxBlobIoBatch, ios->size() - start);
+    RunBlobIoBatch(handle, be_prefix, op, &(*ios)[start], n, &ctxs[0]);
+  }
+}
+
+Status KvssdBlobDBImpl::DeleteBlobs(uint64_t handle, uint32_t key_prefix,
+                                    const std::vector<uint64_t>& versions) {
+  std::vector<BlobIo> ios(versions.size());
+  Status s;
+
+  for (size_t i = 0; i < versions.size(); i++) {
+    ios[i].version = versions[i];
+  }
+  RunBlobIo(handle, key_prefix, kBlobDelete, &ios);
+  for (auto& io : ios) {
+    if (!io.status.ok() && !io.status.IsNotFound() && s.ok()) {
+      s = io.status;
+    }
+  }
+  return s;
+}
+
+Status KvssdBlobDBImpl::DecodeValue(const Slice& lsm_value,
+                                    std::string* value) {
+  std::vector<BlobIo> ios(1);
+
+  if (!lsm_value.empty() && lsm_value[0] == kInlineValue) {
+    value->assign(lsm_value.data() + 1, lsm_value.size() - 1);
+    return Status::OK();
+  }
+  if (!DecodeBlobHandle(lsm_value, &ios[0].size, &ios[0].version)) {
+    return Status::Corruption("KvssdBlobDB: bad value type");
+  }
+  value->resize(BlobValueLength(ios[0].size));
+  ios[0].buf = &(*value)[0];
+  RunBlobIo(handle_, key_prefix_, kBlobRetrieve, &ios);
+  value->resize(ios[0].size);
+  return ios[0].status;
+}
+
+Status KvssdBlobDBImpl::Put(const WriteOptions& options,
+                            ColumnFamilyHandle* column_family,
+                            const Slice& key, const Slice& val) {
+  WriteBatch batch;
+  batch.Put(column_family, key, val);
+  return Write(options, &batch);
+}
+
+Status KvssdBlobDBImpl::Get(const ReadOptions& options,
+                            ColumnFamilyHandle* column_family,
+                            const Slice& key, PinnableSlice* value) {
+  if (column_family->GetID() != 0) {
+    return db_->Get(options, column_family, key, value);
+  }
+  PinnableSlice lsm_value;
+  Status st = db_->Get(options, column_family, key, &lsm_value);
+  if (!st.ok()) {
+    return st;
+  }
+  st = DecodeValue(lsm_value, value->GetSelf());
+  if (st.ok()) {
+    value->PinSelf();
+  }
+  return st;
+}
+
+std::vector<Status> KvssdBlobDBImpl::MultiGet(
+    const ReadOptions& options,
+    const std::vector<ColumnFamilyHandle*>& column_family,
+    const std::vector<Slice>& keys, std::vector<std::string>* values) {
+  auto statuses = db_->MultiGet(options, column_family, keys, values);
+  std::vector<BlobIo> ios;
+  std::vector<size_t> index;
+
+  for (size_t i = 0; i < keys.size(); ++i) {
+    std::string& value = (*values)[i];
+    BlobIo io;
+
+    if (!statuses[i].ok() || column_family[i]->GetID() != 0) {
+      continue;
+    }
+    if (!value.empty() && value[0] == kInlineValue) {
+      value.erase(0, 1);
+    } else if (DecodeBlobHandle(value, &io.size, &io.version)) {
+      ios.push_back(io);
+      index.push_back(i);
+    } else {
+      statuses[i] = Status::Corruption("KvssdBlobDB: bad value type");
+    }
+  }
+  if (ios.empty()) {
+    return statuses;
+  }
+
+  // all the blobs in one batch
+  std::vector<std::string> bufs(ios.size());
+  for (size_t j = 0; j < ios.size(); j++) {
+    bufs[j].resize(BlobValueLength(ios[j].size));
+    ios[j].buf = &bufs[j][0];
+  }
+  RunBlobIo(handle_, key_prefix_, kBlobRetrieve, &ios);
+  for (size_t j = 0; j < ios.size(); j++) {
+    statuses[index[j]] = ios[j].status;
+    bufs[j].resize(ios[j].size);
+    (*values)[index[j]].swap(bufs[j]);
+  }
+  return statuses;
+}
+
+bool KvssdBlobDBImpl::KeyMayExist(const ReadOptions& options,
+                                  ColumnFamilyHandle* column_family,
+                                  const Slice& key, std::string* value,
+                                  bool* value_found) {
+  bool ret = db_->KeyMayExist(options, column_family, key, value, value_found);
+  if (column_family->GetID() != 0) {
+    return ret;
+  }
+  if (ret && value != nullptr && value_found != nullptr && *value_found) {
+    if (!value->empty() && (*value)[0] == kInlineValue) {
+      value->erase(0, 1);
+    } else {
+      // the value is on the device
+      *value_found = false;
+    }
+  }
+  return ret;
+}
+
+Status KvssdBlobDBImpl::Delete(const WriteOptions& options,
+                               ColumnFamilyHandle* column_family,
+                               const Slice& key) {
+  WriteBatch batch;
+  batch.Delete(column_family, key);
+  return Write(options, &batch);
+}
+
+Status KvssdBlobDBImpl::SingleDelete(const WriteOptions& options,
+                                     ColumnFamilyHandle* column_family,
+                                     const Slice& key) {
+  WriteBatch batch;
+  batch.SingleDelete(column_family, key);
+  return Write(options, &batch);
+}
+
+Status KvssdBlobDBImpl::Merge(const WriteOptions& options,
+                              ColumnFamilyHandle* column_family,
+                              const Slice& key, const Slice& value) {
+  WriteBatch batch;
+  batch.Merge(column_family, key, value);
+  return Write(options, &batch);
+}
+
+// The blobs of the batch are stored before the batch goes to the LSM. The
+// blobs the batch replaces stay for the snapshots and iterators that may
+// still read them; they are recorded in dead_blobs_ for GarbageCollect().
+// The key locks keep the writers of a key, and the read of the blob it
+// points to, in order.
+Status KvssdBlobDBImpl::Write(const WriteOptions& opts, WriteBatch* updates) {
+  class KeyCollector : public WriteBatch::Handler {
+   public:
+    std::set<std::string> keys;
+    virtual Status PutCF(uint32_t column_family_id, const Slice& key,
+                         const Slice& /*value*/) override {
+      return Add(column_family_id, key);
+    }
+    virtual Status DeleteCF(uint32_t column_family_id,
+                            const Slice& key) override {
+      return Add(column_family_id, key);
+    }
+    virtual Status SingleDeleteCF(uint32_t column_family_id,
+                                  const Slice& key) override {
+      return Add(column_family_id, key);
+    }
+    virtual Status MergeCF(uint32_t column_family_id, const Slice& /*key*/,
+                           const Slice& /*value*/) override {
+      if (column_family_id == 0) {
+        return Status::NotSupported("KvssdBlobDB: Merge of default column family");
+      }
+      return Status::OK();
+    }
+    virtual Status DeleteRangeCF(uint32_t column_family_id,
+                                 const Slice& /*begin_key*/,
+                                 const Slice& /*end_key*/) override {
+      if (column_family_id == 0) {
+        return Status::NotSupported("KvssdBlobDB: DeleteRange of default column family");
+      }
+      return Status::OK();
+    }
+    virtual void LogData(const Slice& /*blob*/) override {}
+
+   private:
+    Status Add(uint32_t column_family_id, const Slice& key) {
+      if (column_family_id == 0) {
+        keys.insert(key.ToString());
+      }
+      return Status::OK();
+    }
+  };
+  class Handler : public WriteBatch::Handler {
+   public:
+    explicit Handler(KvssdBlobDBImpl* db) : db_(db) {}
+    WriteBatch updates_blob;
+    std::vector<BlobIo> stores;
+    // blobs of the batch a later update of the batch replaces
+    std::vector<uint64_t> superseded;
+    virtual Status PutCF(uint32_t column_family_id, const Slice& key,
+                         const Slice& value) override {
+      std::string lsm_value;
+      if (column_family_id != 0) {
+        return WriteBatchInternal::Put(&updates_blob, column_family_id, key,
+                                       value);
+      }
+      Supersede(key);
+      if (db_->IsBlobValue(value)) {
+        BlobIo io;
+        io.version = db_->next_version_++;
+        io.size = static_cast<uint32_t>(value.size());
+        if (BlobValueLength(io.size) != io.size) {
+          values_.emplace_back(value.data(), value.size());
+          values_.back().resize(BlobValueLength(io.size));
+          io.buf = &values_.back()[0];
+        } else {
+          io.buf = const_cast<char*>(value.data());
+        }
+        stores.push_back(io);
+        written_[key.ToString()] = io.version;
+        lsm_value = EncodeBlobHandle(io.size, io.version);
+      } else {
+        lsm_value.reserve(1 + value.size());
+        lsm_value.push_back(kInlineValue);
+        lsm_value.append(value.data(), value.size());
+      }
+      return WriteBatchInternal::Put(&updates_blob, column_family_id, key,
+                                     lsm_value);
+    }
+    virtual Status DeleteCF(uint32_t column_family_id,
+                            const Slice& key) override {
+      if (column_family_id == 0) {
+        Supersede(key);
+      }
+      return WriteBatchInternal::Delete(&updates_blob, column_family_id, key);
+    }
+    virtual Status SingleDeleteCF(uint32_t column_family_id,
+                                  const Slice& key) override {
+      if (column_family_id == 0) {
+        Supersede(key);
+      }
+      return WriteBatchInternal::SingleDelete(&updates_blob, column_family_id,
+                                              key);
+    }
+    virtual Status MergeCF(uint32_t column_family_id, const Slice& key,
+                           const Slice& value) override {
+      return WriteBatchInternal::Merge(&updates_blob, column_family_id, key,
+                                       value);
+    }
+    virtual Status DeleteRangeCF(uint32_t column_family_id,
+                                 const Slice& begin_key,
+                                 const Slice& end_key) override {
+      return WriteBatchInternal::DeleteRange(&updates_blob, column_family_id,
+                                             begin_key, end_key);
+    }
+    virtual void LogData(const Slice& blob) override {
+      updates_blob.PutLogData(blob);
+    }
+
+   private:
+    void Supersede(const Slice& key) {
+      auto w = written_.find(key.ToString());
+      if (w != written_.end()) {
+        superseded.push_back(w->second);
+        written_.erase(w);
+      }
+    }
+
+    KvssdBlobDBImpl* db_;
+    // padded copies of the values not a multiple of 4 bytes long
+    std::deque<std::string> values_;
+    std::map<std::string, uint64_t> written_;
+  };
+
+  KeyCollector collector;
+  Status s = updates->Iterate(&collector);
+  if (!s.ok()) {
+    return s;
+  }
+
+  std::set<size_t> locks;
+  for (auto& key : collector.keys) {
+    locks.insert(Hash(key.data(), key.size(), 0) % kNumKeyLocks);
+  }
+  for (auto l : locks) {
+    key_locks_[l].lock();
+  }
+
+  // versions are taken with the key locks held, GarbageCollect() relies on it
+  Handler handler(this);
+  std::vector<uint64_t> dead;
+  std::vector<uint64_t> garbage;
+  s = updates->Iterate(&handler);
+  if (s.ok()) {
+    for (auto& key : collector.keys) {
+      std::string old_value;
+      uint32_t size;
+      uint64_t version;
+      if (db_->Get(ReadOptions(), key, &old_value).ok() &&
+          DecodeBlobHandle(old_value, &size, &version)) {
+        dead.push_back(version);
+      }
+    }
+  }
+  if (!dead.empty()) {
+    // recorded before the LSM write, GarbageCollect() may see it done
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    for (auto v : dead) {
+      dead_blobs_[v] = kDeathPending;
+    }
+  }
+  if (s.ok() && !handler.stores.empty()) {
+    RunBlobIo(handle_, key_prefix_, kBlobStore, &handler.stores);
+    for (auto& io : handler.stores) {
+      if (!io.status.ok()) {
+        s = io.status;
+        break;
+      }
+    }
+  }
+  if (s.ok()) {
+    s = db_->Write(opts, &handler.updates_blob);
+  }
+  if (!dead.empty()) {
+    // snapshots stamped above it see the batch
+    uint64_t death = next_version_++;
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    for (auto v : dead) {
+      if (s.ok()) {
+        dead_blobs_[v] = death;
+      } else {
+        dead_blobs_.erase(v);
+      }
+    }
+  }
+  if (s.ok()) {
+    // the batch becomes visible at once, no read sees these
+    garbage = handler.superseded;
+  } else {
+    // nothing refers to the blobs of the batch
+    for (auto& io : handler.stores) {
+      garbage.push_back(io.version);
+    }
+  }
+  // a blob left behind is GarbageCollect()'s
+  DeleteBlobs(handle_, key_prefix_, garbage);
+
+  for (auto l = locks.rbegin(); l != locks.rend(); ++l) {
+    key_locks_[*l].unlock();
+  }
+  return s;
+}
+
+std::shared_ptr<const Snapshot> KvssdBlobDBImpl::IteratorSnapshot(
+    ReadOptions* opts) {
+  if (opts->snapshot != nullptr) {
+    return nullptr;
+  }
+  opts->snapshot = GetSnapshot();
+  return std::shared_ptr<const Snapshot>(
+      opts->snapshot, [this](const Snapshot* snapshot) {
+        ReleaseSnapshot(snapshot);
+      });
+}
+
+Iterator* KvssdBlobDBImpl::NewIterator(const ReadOptions& opts,
+                                       ColumnFamilyHandle* column_family) {
+  if (column_family->GetID() != 0) {
+    return db_->NewIterator(opts, column_family);
+  }
+  ReadOptions read_options(opts);
+  auto snapshot = IteratorSnapshot(&read_options);
+  Iterator* iter = db_->NewIterator(read_options, column_family);
+  return new KvssdBlobIterator(this, iter, snapshot);
+}
+
+Status KvssdBlobDBImpl::NewIterators(
+    const ReadOptions& options,
+    const std::vector<ColumnFamilyHandle*>& column_families,
+    std::vector<Iterator*>* iterators) {
+  ReadOptions read_options(options);
+  std::shared_ptr<const Snapshot> snapshot;
+  for (auto cf : column_families) {
+    if (cf->GetID() == 0) {
+      snapshot = IteratorSnapshot(&read_options);
+      break;
+    }
+  }
+  Status s = db_->NewIterators(read_options, column_families, iterators);
+  if (!s.ok()) {
+    return s;
+  }
+  for (size_t i = 0; i < column_families.size(); i++) {
+    if (column_families[i]->GetID() == 0) {
+      (*iterators)[i] = new KvssdBlobIterator(this, (*iterators)[i], snapshot);
+    }
+  }
+  return s;
+}
+
+// Stamps the snapshot with the version counter: deaths below the stamp
+// happened before the snapshot was taken.
+const Snapshot* KvssdBlobDBImpl::GetSnapshot() {
+  std::lock_guard<std::mutex> guard(snapshot_mutex_);
+  uint64_t stamp = next_version_.load();
+  const Snapshot* snapshot = db_->GetSnapshot();
+
+  if (snapshot != nullptr) {
+    snapshots_[snapshot] = stamp;
+  }
+  return snapshot;
+}
+
+void KvssdBlobDBImpl::ReleaseSnapshot(const Snapshot* snapshot) {
+  {
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    snapshots_.erase(snapshot);
+  }
+  db_->ReleaseSnapshot(snapshot);
+}
+
+// Deletes the blobs below the version watermark the LSM does not refer to,
+// except those that died after the oldest live snapshot was taken.
+// Writers take their versions holding key locks, so passing every key lock
+// once after reading the watermark waits out the writers of the versions
+// below it: their blobs are in the LSM by then, or deleted. A blob dead in
+// the scan died before any snapshot registered after it, so only the
+// snapshots registered when dead_blobs_ is read may still refer to it.
+Status KvssdBlobDBImpl::GarbageCollect() {
+  std::lock_guard<std::mutex> gc_guard(gc_mutex_);
+  std::vector<uint64_t> versions;
+  std::vector<uint64_t> garbage;
+  std::unordered_set<uint64_t> live;
+  uint64_t watermark = next_version_.load();
+  uint32_t size;
+  uint64_t version;
+
+  for (auto& l : key_locks_) {
+    std::lock_guard<std::mutex> guard(l);
+  }
+
+  Status s = ListBlobs(handle_, key_prefix_, &versions);
+  if (!s.ok()) {
+    return s;
+  }
+  std::unique_ptr<Iterator> iter(
+      db_->NewIterator(ReadOptions(), DefaultColumnFamily()));
+  for (iter->SeekToFirst(); iter->Valid(); iter->Next()) {
+    if (DecodeBlobHandle(iter->value(), &size, &version)) {
+      live.insert(version);
+    }
+  }
+  s = iter->status();
+  if (!s.ok()) {
+    return s;
+  }
+  {
+    std::lock_guard<std::mutex> guard(snapshot_mutex_);
+    uint64_t oldest = kDeathPending;
+
+    for (auto& snapshot : snapshots_) {
+      oldest = std::min(oldest, snapshot.second);
+    }
+    for (auto v : versions) {
+      if (v >= watermark || live.find(v) != live.end()) {
+        continue;
+      }
+      // a blob not in dead_blobs_ was never in the LSM, or died before the
+      // db was opened
+      auto dead = dead_blobs_.find(v);
+      if (dead != dead_blobs_.end()) {
+        if (dead->second >= oldest) {
+          continue;
+        }
+        dead_blobs_.erase(dead);
+      }
+      garbage.push_back(v);
+    }
+  }
+  return DeleteBlobs(handle_, key_prefix_, garbage);
+}
+
+Status KvssdBlobDB::Open(const Options& options,
+                         const KvssdBlobOptions& blob_options,
+                         const std::string& dbname, KvssdBlobDB** dbptr) {
+  uint64_t handle;
+  DB* db;
+
+  *dbptr = nullptr;
+  Status s = KvssdBlobDBImpl::GetDeviceHandle(blob_options, &handle);
+  if (!s.ok()) {
+    return s;
+  }
+  s = DB::Open(options, dbname, &db);
+  if (s.ok()) {
+    *dbptr = new KvssdBlobDBImpl(db, blob_options, handle,
+                                 KvssdBlobDBImpl::BlobKeyPrefix(dbname));
+  }
+  return s;
+}
+
+Status DestroyKvssdBlobDB(const std::string& dbname, const Options& options,
+                          const KvssdBlobOptions& blob_options) {
+  std::vector<uint64_t> versions;
+  uint64_t handle;
+  uint32_t key_prefix = KvssdBlobDBImpl::BlobKeyPrefix(dbname);
+
+  Status s = KvssdBlobDBImpl::GetDeviceHandle(blob_options, &handle);
+  if (s.ok()) {
+    s = KvssdBlobDBImpl::ListBlobs(handle, key_prefix, &versions);
+  }
+  if (s.ok()) {
+    s = KvssdBlobDBImpl::DeleteBlobs(handle, key_prefix, versions);
+  }
+  Status destroy = DestroyDB(dbname, options);
+  return s.ok() ? destroy : s;
+}
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
@@ -0,0 +1,205 @@
+//  Copyright (c) 2011-present, Facebook, Inc.  All rights reserved.
+//  This source code is licensed under both the GPLv2 (found in the
+//  COPYING file in the root directory) and Apache 2.0 License
+//  (found in the LICENSE.Apache file in the root directory).
+
+#pragma once
+
+#ifndef ROCKSDB_LITE
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "rocksdb/db.h"
+#include "rocksdb/iterator.h"
+#include "rocksdb/utilities/kvssd_blob_db.h"
+
+namespace rocksdb {
+
+// LSM value of the default column family: a type byte followed by the value
+// (kInlineValue) or by the handle of a value blob (kBlobValue):
+//   value size (fixed32) + blob version (fixed64)
+// A blob is the KV object
+//   blob key prefix (be32) + version (be64) -> value padded to 4 bytes
+// The key prefix ("RB" + 16 bits of the db name hash) keeps the blobs of the
+// dbs sharing a device apart and is what the device iterator filters on.
+class KvssdBlobDBImpl : public KvssdBlobDB {
+ public:
+  static const char kInlineValue = 0;
+  static const char kBlobValue = 1;
+  static const size_t kBlobHandleLength = 1 + 4 + 8;
+  static const size_t kBlobKeyLength = 4 + 8;
+  // writers of a key and GarbageCollect() serialize on these
+  static const size_t kNumKeyLocks = 64;
+
+  enum BlobOp { kBlobStore, kBlobRetrieve, kBlobDelete };
+
+  // A value blob read or written by RunBlobIo()
+  struct BlobIo {
+    uint64_t version;
+    uint32_t size;
+    // store: value to write, retrieve: buffer of at least size rounded up
+    // to 4 bytes
+    char* buf;
+    Status status;
+  };
+
+  KvssdBlobDBImpl(DB* db, const KvssdBlobOptions& blob_options,
+                  uint64_t handle, uint32_t key_prefix);
+
+  virtual ~KvssdBlobDBImpl() {}
+
+  static Status GetDeviceHandle(const KvssdBlobOptions& blob_options,
+                                uint64_t* handle);
+
+  static uint32_t BlobKeyPrefix(const std::string& dbname);
+
+  // Lists the versions of the blobs with the key prefix with the device
+  // iterator
+  static Status ListBlobs(uint64_t handle, uint32_t key_prefix,
+                          std::vector<uint64_t>* versions);
+
+  // Submits a kv_store_async/kv_retrieve_async/kv_delete_async per blob and
+  // waits for all of them, kMaxBlobIoBatch blobs at a time
+  static void RunBlobIo(uint64_t handle, uint32_t key_prefix, BlobOp op,
+                        std::vector<BlobIo>* ios);
+
+  static Status DeleteBlobs(uint64_t handle, uint32_t key_prefix,
+                            const std::vector<uint64_t>& versions);
+
+  using StackableDB::Put;
+  virtual Status Put(const WriteOptions& options,
+                     ColumnFamilyHandle* column_family, const Slice& key,
+                     const Slice& val) override;
+
+  using StackableDB::Get;
+  virtual Status Get(const ReadOptions& options,
+                     ColumnFamilyHandle* column_family, const Slice& key,
+                     PinnableSlice* value) override;
+
+  using StackableDB::MultiGet;
+  virtual std::vector<Status> MultiGet(
+      const ReadOptions& options,
+      const std::vector<ColumnFamilyHandle*>& column_family,
+      const std::vector<Slice>& keys,
+      std::vector<std::string>* values) override;
+
+  using StackableDB::KeyMayExist;
+  virtual bool KeyMayExist(const ReadOptions& options,
+                           ColumnFamilyHandle* column_family, const Slice& key,
+                           std::string* value,
+                           bool* value_found = nullptr) override;
+
+  using StackableDB::Delete;
+  virtual Status Delete(const WriteOptions& options,
+                        ColumnFamilyHandle* column_family,
+                        const Slice& key) override;
+
+  using StackableDB::SingleDelete;
+  virtual Status SingleDelete(const WriteOptions& options,
+                              ColumnFamilyHandle* column_family,
+                              const Slice& key) override;
+
+  using StackableDB::Merge;
+  virtual Status Merge(const WriteOptions& options,
+                       ColumnFamilyHandle* column_family, const Slice& key,
+                       const Slice& value) override;
+
+  virtual Status Write(const WriteOptions& opts, WriteBatch* updates) override;
+
+  using StackableDB::NewIterator;
+  virtual Iterator* NewIterator(const ReadOptions& opts,
+                                ColumnFamilyHandle* column_family) override;
+
+  virtual Status NewIterators(
+      const ReadOptions& options,
+      const std::vector<ColumnFamilyHandle*>& column_families,
+      std::vector<Iterator*>* iterators) override;
+
+  virtual const Snapshot* GetSnapshot() override;
+
+  virtual void ReleaseSnapshot(const Snapshot* snapshot) override;
+
+  virtual Status GarbageCollect() override;
+
+  // Turns an LSM value of the default column family into the user value
+  Status DecodeValue(const Slice& lsm_value, std::string* value);
+
+ private:
+  bool IsBlobValue(const Slice& value) const {
+    return value.size() >= min_blob_size_ && value.size() <= max_blob_size_;
+  }
+
+  // A snapshot for an iterator read without one, released with the iterator
+  std::shared_ptr<const Snapshot> IteratorSnapshot(ReadOptions* opts);
+
+  uint64_t min_blob_size_;
+  uint64_t max_blob_size_;
+  uint64_t handle_;
+  uint32_t key_prefix_;
+  std::atomic<uint64_t> next_version_;
+  std::mutex key_locks_[kNumKeyLocks];
+  std::mutex gc_mutex_;
+  // Guards snapshots_ and dead_blobs_. A snapshot is stamped with
+  // next_version_ when taken; a blob the LSM stopped referring to with the
+  // version taken after that write, ~0 while it is in progress. Snapshots
+  // stamped at or below the death of a blob may still read it.
+  std::mutex snapshot_mutex_;
+  std::map<const Snapshot*, uint64_t> snapshots_;
+  std::map<uint64_t, uint64_t> dead_blobs_;
+};
+
+class KvssdBlobIterator : public Iterator {
+ public:
+  KvssdBlobIterator(KvssdBlobDBImpl* db, Iterator* iter,
+                    std::shared_ptr<const Snapshot> snapshot = nullptr)
+      : db_(db), iter_(iter), snapshot_(snapshot) {
+    assert(iter_);
+  }
+
+  ~KvssdBlobIterator() { delete iter_; }
+
+  bool Valid() const override { return iter_->Valid(); }
+
+  void SeekToFirst() override { iter_->SeekToFirst(); }
+
+  void SeekToLast() override { iter_->SeekToLast(); }
+
+  void Seek(const Slice& target) override { iter_->Seek(target); }
+
+  void SeekForPrev(const Slice& target) override { iter_->SeekForPrev(target); }
+
+  void Next() override { iter_->Next(); }
+
+  void Prev() override { iter_->Prev(); }
+
+  Slice key() const override { return iter_->key(); }
+
+  // The blob is fetched when the value is asked for, so key-only scans do
+  // not read the device
+  Slice value() const override {
+    status_ = db_->DecodeValue(iter_->value(), &value_);
+    return value_;
+  }
+
+  Status status() const override {
+    if (!status_.ok()) {
+      return status_;
+    }
+    return iter_->status();
+  }
+
+ private:
+  KvssdBlobDBImpl* db_;
+  Iterator* iter_;
+  // keeps the blobs the iterator reads from GarbageCollect()
+  std::shared_ptr<const Snapshot> snapshot_;
+  mutable std::string value_;
+  mutable Status status_;
+};
+
+}  // namespace rocksdb
+#endif  // ROCKSDB_LITE
@@ -51,10 +51,10 @@ static void _kv_io_complete(void *arg, const struct spdk_nvme_cpl *completion) {
 
         io_sequence = (nvme_cmd_sequence_t *)arg;
 
-        io_sequence->status = completion->status.sc;
+        io_sequence->status = kv_nvme_cpl_status(completion);
         io_sequence->result = completion->cdw0;
 
-        io_sequence->is_completed = 1;
+        kv_nvme_complete_sequence(io_sequence);
 
         KVNVME_DEBUG("Status of the I/O: %d, Result of the I/O: %d", io_sequence->status, io_sequence->result);
 
@@ -69,7 +69,7 @@ static void _kv_async_io_complete(void *arg, const struct spdk_nvme_cpl *complet
 
         kv = (kv_pair *)arg;
 
-        status = completion->status.sc;
+        status = kv_nvme_cpl_status(completion);
         result = completion->cdw0;
 
 	if(kv->param.async_cb) {
@@ -87,7 +87,7 @@ static void _kv_retrieve_async_io_complete(void *arg, const struct spdk_nvme_cpl
 
         kv = (kv_pair *)arg;
 
-        status = completion->status.sc;
+        status = kv_nvme_cpl_status(completion);
         result = completion->cdw0;
 
         KVNVME_DEBUG("Status of the Async I/O: %d, Result of the Async I/O: %d, kv->key.key: %s", status, result, (char *)kv->key.key);
@@ -119,7 +119,7 @@ static void _kv_store_async_io_complete(void *arg, const struct spdk_nvme_cpl *c
 
         kv = (kv_pair *)arg;
 
-        status = completion->status.sc;
+        status = kv_nvme_cpl_status(completion);
         result = completion->cdw0;
 
         KVNVME_DEBUG("Status of the Async I/O: %d, Result of the Async I/O: %d, kv->key.key: %s", status, result, (char *)kv->key.key);
@@ -143,7 +143,7 @@ static void _kv_iterate_read_async_cb(void *arg, const struct spdk_nvme_cpl *com
 
         it = (kv_iterate*)arg;
 
-        status = completion->status.sc;
+        status = kv_nvme_cpl_status(completion);
         result = completion->cdw0;
 
         KVNVME_DEBUG("Status of the Async I/O: %d, Result of the Async I/O: %d", status, result);
@@ -200,20 +200,22 @@ int _kv_nvme_store(kv_nvme_t *nvme, kv_pair *kv, int qid, uint8_t is_store) {
 		LEAVE();
 		return KV_ERR_INVALID_OPTION;
 	}
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_store(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, kv->value.value, kv->value.length, kv->value.offset, _kv_io_complete, &io_sequence, 0, kv->param.io_option.store_option, is_store);
 
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Store on the KV Type SSD");
                 LEAVE();
                 return ret;
         }
 
-        while(!io_sequence.is_completed) {
-                spdk_nvme_qpair_process_completions(qpair, 0);
-        }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 
 	if(io_sequence.status == KV_SUCCESS){
 		kv->value.actual_value_size = kv->value.length;
@@ -249,12 +251,16 @@ int _kv_nvme_store_async(kv_nvme_t *nvme, kv_pair *kv, int qid) {
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_store(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, kv->value.value, kv->value.length, kv->value.offset, _kv_store_async_io_complete, (void *)kv, 0, kv->param.io_option.store_option, true);
         if(ret) {
 //              KVNVME_ERR("Error in Performing Store on the KV Type SSD");
         }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
         LEAVE();
         return ret;
 }
@@ -291,7 +297,11 @@ int _kv_nvme_retrieve(kv_nvme_t *nvme, kv_pair *kv, int qid) {
         }
 
         //calling retrieve as get_value_size
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
 	/*
         if(kv->param.io_option.retrieve_option & KV_RETRIEVE_VALUE_SIZE){
                 kv->value.length = 0;
@@ -301,16 +311,14 @@ int _kv_nvme_retrieve(kv_nvme_t *nvme, kv_pair *kv, int qid) {
         ret = spdk_nvme_kv_cmd_retrieve(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, kv->value.value, kv->value.length, kv->value.offset, _kv_io_complete, &io_sequence, 0, kv->param.io_option.retrieve_option);
 
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Retrieve on the KV Type SSD");
                 LEAVE();
                 return ret;
         }
 
-        while(!io_sequence.is_completed) {
-                spdk_nvme_qpair_process_completions(qpair, 0);
-        }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -357,13 +365,17 @@ int _kv_nvme_retrieve_async(kv_nvme_t *nvme, kv_pair *kv, int qid) {
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_retrieve(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, kv->value.value, kv->value.length, kv->value.offset, _kv_retrieve_async_io_complete, (void *)kv, 0, kv->param.io_option.retrieve_option);
 
         if(ret) {
 //              KVNVME_ERR("Error in Performing Retrieve on the KV Type SSD");
         }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
         LEAVE();
         return ret;
 }
@@ -394,20 +406,22 @@ int _kv_nvme_delete(kv_nvme_t *nvme, const kv_pair *kv, int qid) {
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_delete(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, kv->value.length, kv->value.offset, _kv_io_complete, &io_sequence, 0, kv->param.io_option.delete_option);
 
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Key Delete on the KV Type SSD");
                 LEAVE();
                 return ret;
         }
 
-        while(!io_sequence.is_completed) {
-                spdk_nvme_qpair_process_completions(qpair, 0);
-        }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
         LEAVE();
@@ -439,13 +453,17 @@ int _kv_nvme_delete_async(kv_nvme_t *nvme, const kv_pair *kv, int qid) {
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_delete(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, kv->value.length, kv->value.offset, _kv_async_io_complete, (void *)kv, 0, kv->param.io_option.delete_option);
 
         if(ret) {
                 //KVNVME_ERR("Error in Performing Key Delete on the KV Type SSD: ret=%d\n",ret);
         }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
         LEAVE();
         return ret;
 }
@@ -545,19 +563,21 @@ int _kv_nvme_exist(kv_nvme_t* nvme, const kv_pair* kv, int qid) {
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_exist(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, _kv_io_complete, &io_sequence, 0, kv->param.io_option.exist_option);
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Key Exist on the KV Type SSD");
                 LEAVE();
                 return ret;
         }
 
-        while(!io_sequence.is_completed) {
-                spdk_nvme_qpair_process_completions(qpair, 0);
-        }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 
         //KVNVME_ERR("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -591,12 +611,16 @@ int _kv_nvme_exist_async(kv_nvme_t* nvme, const kv_pair* kv, int qid){
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_exist(nvme->ns, qpair, kv->keyspace_id, kv->key.key, kv->key.length, _kv_async_io_complete, (void*)kv, 0, kv->param.io_option.exist_option);
         if(ret) {
                 //KVNVME_ERR("Error in Performing Key Exist on the KV Type SSD");
         }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
 	LEAVE();
 	return ret;
 }
@@ -644,10 +668,14 @@ uint32_t _kv_nvme_iterate_open(kv_nvme_t *nvme, const uint8_t keyspace_id, const
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_iterate_open(nvme->ns, qpair, keyspace_id, bitmask, prefix, _kv_io_complete, &io_sequence, 0, (KV_ITERATE_REQUEST_OPEN | (it_type_base<<iterate_type)));
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Key Iterate on the KV Type SSD\n");
                 LEAVE();
                 return ret;
@@ -658,18 +686,8 @@ uint32_t _kv_nvme_iterate_open(kv_nvme_t *nvme, const uint8_t keyspace_id, const
 #endif
 
 
-	int queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync){
-		while(!io_sequence.is_completed) {
-			spdk_nvme_qpair_process_completions(qpair, 0);
-		}
-	}
-	else{
-		while(!io_sequence.is_completed) {
-			usleep(1);
-		}
-	}
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -701,27 +719,21 @@ int _kv_nvme_iterate_close(kv_nvme_t *nvme, const uint8_t iterator, int qid){
                 return ret;
         }
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_iterate_close(nvme->ns, qpair, iterator, _kv_io_complete, &io_sequence, 0, KV_ITERATE_REQUEST_CLOSE);
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Key Iterate on the KV Type SSD");
                 LEAVE();
                 return ret;
         }
 
-	int queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync){
-		while(!io_sequence.is_completed) {
-			spdk_nvme_qpair_process_completions(qpair, 0);
-		}
-	}
-	else{
-		while(!io_sequence.is_completed) {
-			usleep(1);
-		}
-	}
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -786,19 +798,21 @@ int _kv_nvme_iterate_read(kv_nvme_t* nvme, kv_iterate* it, int qid){
 	io_sequence.result = (it->kv.key.length<<24) | (it->kv.value.length);
 #else
 
-	pthread_spin_lock(&qpair->sq_lock);
+	if(kv_qpair_sq_lock(qpair)) {
+		KVNVME_ERR("I/O Queue is acquired by another thread");
+		LEAVE();
+		return KV_ERR_DD_QPAIR_OWNED;
+	}
 	ret = spdk_nvme_kv_cmd_iterate_read(nvme->ns, qpair, it->iterator, it->kv.value.value, it->kv.value.length, it->kv.value.offset, _kv_io_complete, &io_sequence, 0, it->kv.param.io_option.iterate_read_option);
 	if(ret) {
-		pthread_spin_unlock(&qpair->sq_lock);
+		kv_qpair_sq_unlock(qpair);
 		KVNVME_ERR("Error in Performing Key Iterate on the KV Type SSD");
 		LEAVE();
 		return ret;
 	}
 
-	while(!io_sequence.is_completed) {
-		spdk_nvme_qpair_process_completions(qpair, 0);
-	}
-	pthread_spin_unlock(&qpair->sq_lock);
+	kv_qpair_sq_unlock(qpair);
+	kv_nvme_wait_for_completion(nvme, qid, &io_sequence);
 #endif
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
@@ -887,12 +901,16 @@ int _kv_nvme_iterate_read_async(kv_nvme_t *nvme, kv_iterate* it, int qid){
 	_kv_iterate_read_async_cb(it, &cpl);
 	ret = KV_SUCCESS;
 #else
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_kv_cmd_iterate_read(nvme->ns, qpair, it->iterator, it->kv.value.value, it->kv.value.length, it->kv.value.offset, _kv_iterate_read_async_cb, (void *)it, 0, it->kv.param.io_option.iterate_read_option);
         if(ret) {
                 //KVNVME_ERR("Error in Performing Retrieve on the KV Type SSD");
         }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
 #endif
         LEAVE();
         return ret;
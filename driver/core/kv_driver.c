@@ -42,6 +42,9 @@ extern int32_t lba_nvme_process_cq_thread(void *arg);
 extern int32_t kv_nvme_process_all_cqs_thread(void *arg);
 extern int32_t kv_nvme_process_cq_thread(void *arg);
 
+extern int kv_nvme_reactor_add_device(kv_nvme_t *nvme);
+extern void kv_nvme_reactor_remove_device(kv_nvme_t *nvme);
+
 static int g_kvdd_ref_count = 0;
 static TAILQ_HEAD(, kv_nvme) g_nvme_devices = TAILQ_HEAD_INITIALIZER(g_nvme_devices);
 static pthread_mutex_t g_init_mutex = PTHREAD_MUTEX_INITIALIZER;
@@ -70,6 +73,15 @@ static bool probe_cb(void *cb_ctx, const struct spdk_nvme_transport_id *trid, st
                 opts->io_queue_requests = DEFAULT_IO_QUEUE_DEPTH;
         }
 
+        if(nvme->options && (nvme->options->high_prio_mask || nvme->options->low_prio_mask)) {
+                /* SPDK falls back to round robin if the controller does not support WRR */
+                opts->arb_mechanism = SPDK_NVME_CC_AMS_WRR;
+                opts->arbitration_burst = 3;
+                opts->high_priority_weight = KV_NVME_WRR_HIGH_WEIGHT - 1;
+                opts->medium_priority_weight = KV_NVME_WRR_MEDIUM_WEIGHT - 1;
+                opts->low_priority_weight = KV_NVME_WRR_LOW_WEIGHT - 1;
+        }
+
         KVNVME_DEBUG("I/O Queue Depth: %d", opts->io_queue_size-1);
 
         LEAVE();
@@ -88,6 +100,7 @@ static void attach_cb(void *cb_ctx, const struct spdk_nvme_transport_id *trid, s
 
         nvme->ctrlr = ctrlr;
         nvme->num_io_queues = opts->num_io_queues;
+        nvme->wrr_enabled = (opts->arb_mechanism == SPDK_NVME_CC_AMS_WRR);
         TAILQ_INSERT_TAIL(&g_nvme_devices, nvme, tailq);
 
         LEAVE();
@@ -274,7 +287,7 @@ int kv_env_fini(void) {
 }
 
 int kv_nvme_io_queue_type(uint64_t handle, int core_id) {
-        int ret = KV_ERR_DD_INVALID_PARAM;
+        int ret = KV_ERR_DD_INVALID_PARAM, qid;
         kv_nvme_t *nvme = NULL;
 
         ENTER();
@@ -305,12 +318,20 @@ int kv_nvme_io_queue_type(uint64_t handle, int core_id) {
                 return ret;
         }
 
-        if(nvme->io_queue_type[core_id] == SYNC_IO_QUEUE) {
+        qid = kv_nvme_get_qid(nvme, core_id);
+        if(qid < 0) {
+                KVNVME_ERR("There is no Valid I/O Queue for the passed CPU Core ID");
+
+                LEAVE();
+                return ret;
+        }
+
+        if(nvme->io_queue_type[qid] == SYNC_IO_QUEUE) {
                 KVNVME_DEBUG("I/O Queue Type is Sync");
 
                 LEAVE();
                 return SYNC_IO_QUEUE;
-        } else if(nvme->io_queue_type[core_id] == ASYNC_IO_QUEUE) {
+        } else if(nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) {
                 KVNVME_DEBUG("I/O Queue Type is Async");
 
                 LEAVE();
@@ -362,14 +383,419 @@ int _check_ssd_type(unsigned int ssd_type) {
   return ret;
 }
 
-int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_type) {
-        int ret = KV_ERR_DD_INVALID_PARAM, num_ns = 0;
-        unsigned long long cpu_id = 0, queue_id = 0, cpu_core_mask = 0, sync_mask = 0, num_async_queues = 0, num_cq_threads = 0, cq_thread_mask = 0;
+static void _kv_nvme_init_overflow(kv_nvme_t *nvme, int qid) {
+        kv_nvme_overflow_t *overflow = &nvme->overflow[qid];
+        int32_t depth = nvme->options->overflow_depth;
+        kv_nvme_overflow_io_t *ios;
+        unsigned int prio;
+
+        pthread_spin_init(&overflow->lock, 0);
+        memset(overflow->rings, 0, sizeof(overflow->rings));
+        overflow->count = 0;
+        overflow->depth = 0;
+
+        if(depth < 0) {
+                return;
+        }
+        if(depth == 0) {
+                depth = nvme->options->queue_depth - 1;
+        }
+
+        /* any class may take the whole depth, so each ring gets all of it */
+        ios = calloc((size_t)depth * KV_IO_PRIO_MAX, sizeof(kv_nvme_overflow_io_t));
+        if(!ios) {
+                KVNVME_WARN("Could not Allocate the Overflow Queue for the CPU Core ID: %d, Async I/Os return KV_ERR_QUEUE_FULL when the SQ is full", qid);
+                return;
+        }
+        for(prio = 0; prio < KV_IO_PRIO_MAX; prio++) {
+                overflow->rings[prio].ios = ios + (size_t)prio * depth;
+        }
+        overflow->depth = depth;
+}
+
+static void _kv_nvme_free_overflow(kv_nvme_t *nvme) {
+        unsigned int queue_id;
+
+        if(!nvme->overflow) {
+                return;
+        }
+
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                free(nvme->overflow[queue_id].rings[0].ios);
+        }
+        free(nvme->overflow);
+        nvme->overflow = NULL;
+}
+
+/*
+ * Size the I/O Queue pool and map the CPUs of the device onto it. Every CPU gets its
+ * own I/O Queue while the controller has enough of them. Otherwise the Sync and Async
+ * CPUs split the I/O Queues in proportion to their number and share them round robin.
+ */
+static int _kv_nvme_init_queue_map(kv_nvme_t *nvme, const cpu_set_t *io_cpus, const cpu_set_t *sync_cpus) {
+        unsigned int nr_io_cpus = 0, nr_sync_cpus = 0, nr_async_cpus = 0;
+        unsigned int max_queues = nvme->num_io_queues, nr_sync_queues, nr_async_queues;
+        unsigned int nr_sync_mapped = 0, nr_async_mapped = 0, queue_id;
+        int cpu, last_cpu = 0;
+
+        for(cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if(CPU_ISSET(cpu, io_cpus)) {
+                        nr_io_cpus++;
+                        nr_sync_cpus += CPU_ISSET(cpu, sync_cpus) ? 1 : 0;
+                        last_cpu = cpu;
+                }
+        }
+        nr_async_cpus = nr_io_cpus - nr_sync_cpus;
+
+        if(nvme->options->num_io_queues && nvme->options->num_io_queues < max_queues) {
+                max_queues = nvme->options->num_io_queues;
+        }
+
+        if(nr_io_cpus <= max_queues) {
+                nr_sync_queues = nr_sync_cpus;
+                nr_async_queues = nr_async_cpus;
+        } else if(!nr_async_cpus) {
+                nr_sync_queues = max_queues;
+                nr_async_queues = 0;
+        } else if(!nr_sync_cpus) {
+                nr_sync_queues = 0;
+                nr_async_queues = max_queues;
+        } else if(max_queues >= 2) {
+                nr_sync_queues = spdk_min(spdk_max(max_queues * nr_sync_cpus / nr_io_cpus, 1), max_queues - 1);
+                nr_async_queues = max_queues - nr_sync_queues;
+        } else {
+                KVNVME_ERR("Sync and Async CPUs need at least 2 I/O Queues, the controller provides %u", max_queues);
+                return KV_ERR_DD_NO_AVAILABLE_QUEUE;
+        }
+
+        nvme->nr_qpairs = nr_sync_queues + nr_async_queues;
+        nvme->nr_cpus = last_cpu + 1;
+        nvme->cpu_to_qid = malloc(nvme->nr_cpus * sizeof(int));
+        nvme->qid_to_cpu = calloc(nvme->nr_qpairs, sizeof(unsigned int));
+        nvme->io_queue_type = calloc(nvme->nr_qpairs, sizeof(unsigned int));
+
+        if(!nvme->cpu_to_qid || !nvme->qid_to_cpu || !nvme->io_queue_type) {
+                return KV_ERR_DD_NO_AVAILABLE_RESOURCE;
+        }
+
+        for(cpu = 0; cpu < (int)nvme->nr_cpus; cpu++) {
+                nvme->cpu_to_qid[cpu] = -1;
+                if(!CPU_ISSET(cpu, io_cpus)) {
+                        continue;
+                }
+
+                if(CPU_ISSET(cpu, sync_cpus)) {
+                        queue_id = nr_sync_mapped++ % nr_sync_queues;
+                        if(nr_sync_mapped <= nr_sync_queues) {
+                                nvme->qid_to_cpu[queue_id] = cpu;
+                                nvme->io_queue_type[queue_id] = SYNC_IO_QUEUE;
+                        }
+                } else {
+                        queue_id = nr_sync_queues + nr_async_mapped++ % nr_async_queues;
+                        if(nr_async_mapped <= nr_async_queues) {
+                                nvme->qid_to_cpu[queue_id] = cpu;
+                                nvme->io_queue_type[queue_id] = ASYNC_IO_QUEUE;
+                        }
+                }
+                nvme->cpu_to_qid[cpu] = queue_id;
+        }
+
+        if(nr_io_cpus > nvme->nr_qpairs) {
+                KVNVME_WARN("%u CPUs share %u I/O Queues (%u Sync, %u Async)", nr_io_cpus, nvme->nr_qpairs, nr_sync_queues, nr_async_queues);
+        }
+        KVNVME_DEBUG("%u I/O Queues (%u Sync, %u Async) for %u CPUs", nvme->nr_qpairs, nr_sync_queues, nr_async_queues, nr_io_cpus);
+
+        return KV_SUCCESS;
+}
+
+static void _kv_nvme_free_queue_map(kv_nvme_t *nvme) {
+        free(nvme->cpu_to_qid);
+        free(nvme->qid_to_cpu);
+        free(nvme->io_queue_type);
+        free(nvme->async_qid);
+        nvme->cpu_to_qid = NULL;
+        nvme->qid_to_cpu = NULL;
+        nvme->io_queue_type = NULL;
+        nvme->async_qid = NULL;
+        nvme->nr_cpus = 0;
+}
+
+static struct spdk_nvme_qpair *_kv_nvme_alloc_qpair(kv_nvme_t *nvme, unsigned int queue_id) {
+        struct spdk_nvme_io_qpair_opts opts;
+        unsigned int cpu = nvme->qid_to_cpu[queue_id];
+
+        if(!nvme->wrr_enabled) {
+                return spdk_nvme_ctrlr_alloc_io_qpair(nvme->ctrlr, NULL, 0);
+        }
+
+        spdk_nvme_ctrlr_get_default_io_qpair_opts(nvme->ctrlr, &opts, sizeof(opts));
+        if(cpu < MAX_CPU_CORES && (nvme->options->high_prio_mask & (1ULL << cpu))) {
+                opts.qprio = SPDK_NVME_QPRIO_HIGH;
+        } else if(cpu < MAX_CPU_CORES && (nvme->options->low_prio_mask & (1ULL << cpu))) {
+                opts.qprio = SPDK_NVME_QPRIO_LOW;
+        } else {
+                opts.qprio = SPDK_NVME_QPRIO_MEDIUM;
+        }
+
+        return spdk_nvme_ctrlr_alloc_io_qpair(nvme->ctrlr, &opts, sizeof(opts));
+}
+
+static void _kv_nvme_init_qos(kv_nvme_t *nvme) {
+        kv_nvme_io_options *opts = nvme->options;
+        kv_nvme_qos_t *qos = &nvme->qos;
+        uint64_t now = spdk_get_ticks();
+        unsigned int prio;
+
+        memset(qos, 0, sizeof(kv_nvme_qos_t));
+
+        for(prio = 0; prio < KV_IO_PRIO_MAX; prio++) {
+                kv_nvme_qos_class_t *class = &qos->classes[prio];
+
+                pthread_spin_init(&class->lock, 0);
+                class->iops_rate = opts->prio_iops_limit[prio];
+                class->bps_rate = opts->prio_bps_limit[prio];
+                class->io_burst = spdk_max(class->iops_rate * KV_NVME_QOS_BURST_MS / 1000, 1);
+                class->byte_burst = spdk_max(class->bps_rate * KV_NVME_QOS_BURST_MS / 1000, 1);
+                class->io_tokens = class->io_burst;
+                class->byte_tokens = class->byte_burst;
+                class->io_tick = class->byte_tick = now;
+
+                if(class->iops_rate || class->bps_rate) {
+                        qos->enabled = true;
+                        KVNVME_DEBUG("I/O Priority %u limited to %lu IOPS, %lu Bytes/s", prio, class->iops_rate, class->bps_rate);
+                }
+        }
+
+        qos->yield_ticks = (uint64_t)opts->low_prio_yield_us * spdk_get_ticks_hz() / 1000000ULL;
+        if(qos->yield_ticks) {
+                qos->enabled = true;
+        }
+
+        if((opts->high_prio_mask || opts->low_prio_mask) && !nvme->wrr_enabled) {
+                KVNVME_WARN("Weighted round robin arbitration is not enabled on the controller, I/O Queue priorities are ignored");
+        }
+}
+
+static void _kv_nvme_request_reset(kv_nvme_t *nvme) {
+        __atomic_store_n(&nvme->reset_pending, 1, __ATOMIC_RELEASE);
+}
+
+static void _kv_nvme_abort_complete(void *arg, const struct spdk_nvme_cpl *cpl) {
+        kv_nvme_t *nvme = (kv_nvme_t *)arg;
+
+        /* the reset in progress completes the Abort itself, its outcome no longer matters */
+        if(nvme->resetting) {
+                return;
+        }
+
+        if(spdk_nvme_cpl_is_error(cpl)) {
+                KVNVME_ERR("Abort of a timed out command failed, sct=0x%x sc=0x%x, resetting the controller", cpl->status.sct, cpl->status.sc);
+                _kv_nvme_request_reset(nvme);
+        } else {
+                /*
+                 * cdw0 bit 0 is set when the command was not aborted. It may have completed
+                 * meanwhile, or the device ignores the Abort; the command is checked again
+                 * once its completion had time to be reaped.
+                 */
+                if(cpl->cdw0 & 0x1) {
+                        KVNVME_WARN("Abort of a timed out command was not performed, cdw0=0x%x", cpl->cdw0);
+                }
+                __atomic_store_n(&nvme->abort_check_tick, spdk_get_ticks() + nvme->abort_grace_ticks, __ATOMIC_RELEASE);
+        }
+
+        __atomic_sub_fetch(&nvme->nr_pending_aborts, 1, __ATOMIC_RELAXED);
+}
+
+static void _kv_nvme_timeout_cb(void *cb_arg, struct spdk_nvme_ctrlr *ctrlr, struct spdk_nvme_qpair *qpair, uint16_t cid) {
+        kv_nvme_t *nvme = (kv_nvme_t *)cb_arg;
+        int ret;
+
+        if(!qpair) {
+                if(nvme->nr_pending_aborts) {
+                        KVNVME_ERR("Admin command cid %u timed out with Aborts pending, resetting the controller", cid);
+                        _kv_nvme_request_reset(nvme);
+                } else {
+                        KVNVME_WARN("Admin command cid %u timed out", cid);
+                }
+                return;
+        }
+
+        KVNVME_ERR("I/O command cid %u on qpair %u timed out, aborting", cid, qpair->id);
+
+        __atomic_add_fetch(&nvme->nr_pending_aborts, 1, __ATOMIC_RELAXED);
+        ret = spdk_nvme_ctrlr_cmd_abort(ctrlr, qpair, cid, _kv_nvme_abort_complete, nvme);
+        if(ret) {
+                KVNVME_ERR("Could not submit Abort for cid %u on qpair %u, ret = %d, resetting the controller", cid, qpair->id, ret);
+                __atomic_sub_fetch(&nvme->nr_pending_aborts, 1, __ATOMIC_RELAXED);
+                _kv_nvme_request_reset(nvme);
+        }
+}
+
+/*
+ * Take the CQ and SQ locks of every shared I/O Queue, so nothing submits or reaps while
+ * the controller is reset. Completion callbacks submit with a CQ lock held, so the locks
+ * are only tried and all of them are dropped again if one is busy. Qpairs acquired by a
+ * thread are not locked; their owner sees -ENXIO while the reset runs.
+ */
+static bool _kv_nvme_quiesce_qpairs(kv_nvme_t *nvme, bool *locked) {
+        struct spdk_nvme_qpair *qpair;
+        unsigned int queue_id, i;
+
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                qpair = nvme->qpairs[queue_id];
+                locked[queue_id] = false;
+                if(!qpair || __atomic_load_n(&qpair->owner, __ATOMIC_ACQUIRE) != 0) {
+                        continue;
+                }
+                if(pthread_spin_trylock(&qpair->cq_lock)) {
+                        break;
+                }
+                if(pthread_spin_trylock(&qpair->sq_lock)) {
+                        pthread_spin_unlock(&qpair->cq_lock);
+                        break;
+                }
+                locked[queue_id] = true;
+        }
+
+        if(queue_id == nvme->nr_qpairs) {
+                return true;
+        }
+
+        for(i = 0; i < queue_id; i++) {
+                if(locked[i]) {
+                        pthread_spin_unlock(&nvme->qpairs[i]->sq_lock);
+                        pthread_spin_unlock(&nvme->qpairs[i]->cq_lock);
+                }
+        }
+        return false;
+}
+
+static void _kv_nvme_resume_qpairs(kv_nvme_t *nvme, const bool *locked) {
+        unsigned int queue_id;
+
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                if(locked[queue_id]) {
+                        pthread_spin_unlock(&nvme->qpairs[queue_id]->sq_lock);
+                        pthread_spin_unlock(&nvme->qpairs[queue_id]->cq_lock);
+                }
+        }
+}
+
+/*
+ * Escalate timed out commands the device did not abort. A controller reset completes
+ * every outstanding command with ABORTED_BY_REQUEST on the next poll of its qpair, so
+ * sync waiters get KV_ERR_DD_IO_TIMEOUT instead of spinning forever.
+ */
+void kv_nvme_recover(kv_nvme_t *nvme) {
+        uint64_t check_tick;
+        unsigned int queue_id;
+        bool *locked;
+        int ret;
+
+        if(nvme->nr_pending_aborts) {
+                spdk_nvme_ctrlr_process_admin_completions(nvme->ctrlr);
+        }
+
+        check_tick = __atomic_load_n(&nvme->abort_check_tick, __ATOMIC_ACQUIRE);
+        if(!nvme->reset_pending && (!check_tick || spdk_get_ticks() < check_tick)) {
+                return;
+        }
+
+        locked = calloc(nvme->nr_qpairs, sizeof(bool));
+        if(!locked) {
+                return;
+        }
+        if(!_kv_nvme_quiesce_qpairs(nvme, locked)) {
+                /* retried on the next poll */
+                free(locked);
+                return;
+        }
+
+        if(!nvme->reset_pending && __atomic_compare_exchange_n(&nvme->abort_check_tick, &check_tick, 0, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                        if(locked[queue_id] && spdk_nvme_qpair_has_timed_out_reqs(nvme->qpairs[queue_id])) {
+                                KVNVME_ERR("Timed out command on qpair %u was not aborted, resetting the controller", nvme->qpairs[queue_id]->id);
+                                _kv_nvme_request_reset(nvme);
+                                break;
+                        }
+                }
+        }
+
+        if(__atomic_exchange_n(&nvme->reset_pending, 0, __ATOMIC_ACQ_REL)) {
+                nvme->resetting = true;
+                ret = spdk_nvme_ctrlr_reset(nvme->ctrlr);
+                __atomic_store_n(&nvme->nr_pending_aborts, 0, __ATOMIC_RELAXED);
+                __atomic_store_n(&nvme->abort_check_tick, 0, __ATOMIC_RELAXED);
+                nvme->resetting = false;
+                if(ret) {
+                        KVNVME_ERR("Controller reset failed, ret = %d", ret);
+                }
+        }
+
+        _kv_nvme_resume_qpairs(nvme, locked);
+        free(locked);
+}
+
+/*
+ * Arm per command timeouts. The controller-wide SPDK timeout is registered with the
+ * shortest configured value and each qpair gets the per opcode values on top of it.
+ */
+static void _kv_nvme_init_timeouts(kv_nvme_t *nvme, unsigned int ssd_type) {
+        kv_nvme_io_options *opts = nvme->options;
+        const struct {
+                uint8_t opc;
+                uint32_t timeout_ms;
+        } kv_timeouts[] = {
+                { SPDK_NVME_OPC_KV_STORE, opts->store_timeout_ms },
+                { SPDK_NVME_OPC_KV_APPEND, opts->store_timeout_ms },
+                { SPDK_NVME_OPC_KV_RETRIEVE, opts->retrieve_timeout_ms },
+                { SPDK_NVME_OPC_KV_DELETE, opts->delete_timeout_ms },
+                { SPDK_NVME_OPC_KV_EXIST, opts->exist_timeout_ms },
+                { SPDK_NVME_OPC_KV_ITERATE_REQUEST, opts->iterate_timeout_ms },
+                { SPDK_NVME_OPC_KV_ITERATE_READ, opts->iterate_timeout_ms },
+        }, lba_timeouts[] = {
+                { SPDK_NVME_OPC_WRITE, opts->store_timeout_ms },
+                { SPDK_NVME_OPC_READ, opts->retrieve_timeout_ms },
+                { SPDK_NVME_OPC_DATASET_MANAGEMENT, opts->delete_timeout_ms },
+        };
+        const typeof(kv_timeouts[0]) *timeouts = (ssd_type == LBA_TYPE_SSD) ? lba_timeouts : kv_timeouts;
+        unsigned int nr_timeouts = (ssd_type == LBA_TYPE_SSD) ? SPDK_COUNTOF(lba_timeouts) : SPDK_COUNTOF(kv_timeouts);
+        uint32_t min_timeout_ms = UINT32_MAX;
+        unsigned int i, queue_id;
+
+        for(i = 0; i < nr_timeouts; i++) {
+                if(timeouts[i].timeout_ms) {
+                        min_timeout_ms = spdk_min(min_timeout_ms, timeouts[i].timeout_ms);
+                }
+        }
+        if(min_timeout_ms == UINT32_MAX) {
+                return;
+        }
+
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                if(!nvme->qpairs[queue_id]) {
+                        continue;
+                }
+                for(i = 0; i < nr_timeouts; i++) {
+                        if(spdk_nvme_qpair_set_opc_timeout(nvme->qpairs[queue_id], timeouts[i].opc, (uint64_t)timeouts[i].timeout_ms * 1000ULL)) {
+                                KVNVME_WARN("Could not set the command timeouts on the I/O Queue %u", queue_id);
+                                break;
+                        }
+                }
+        }
+
+        nvme->abort_grace_ticks = (uint64_t)min_timeout_ms * spdk_get_ticks_hz() / 1000ULL;
+        spdk_nvme_ctrlr_register_timeout_callback(nvme->ctrlr, (uint64_t)min_timeout_ms * 1000ULL, _kv_nvme_timeout_cb, nvme);
+        KVNVME_DEBUG("Command timeouts armed, shortest timeout %u ms", min_timeout_ms);
+}
+
+/*
+ * Allocate the handle of the device at a BDF, ready to be probed
+ */
+static int _kv_nvme_alloc(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_type, kv_nvme_t **nvme_out) {
+        int ret = KV_ERR_DD_INVALID_PARAM;
         kv_nvme_t *nvme = NULL;
-        unsigned long long def_core_mask = 1, def_sync_mask = 1, def_num_cq_threads = 1;
         char kv_nvme_traddr[SPDK_NVMF_TRADDR_MAX_LEN];
-        unsigned int thread_id = 0, cq_threads_cores[MAX_CPU_CORES] = {0};
-        unsigned int *queues_per_thread = NULL;
 
         ENTER();
         if (bdf == NULL || options == NULL ) {
@@ -419,24 +845,25 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
         strncpy(nvme->traddr, kv_nvme_traddr, SPDK_NVMF_TRADDR_MAX_LEN);
 
 	nvme->options->queue_depth++;
-        ret = spdk_nvme_probe(&nvme->trid, nvme, probe_cb, attach_cb, NULL);
-
-        if(ret) {
-                KVNVME_ERR("SPDK NVMe Probe failed, ret = %d", ret);
-                free(nvme);
+        *nvme_out = nvme;
 
-                LEAVE();
-		ret = (ret == -ENODEV ? KV_ERR_DD_NO_DEVICE : ret);
-                return ret;
-        }
+        LEAVE();
+        return KV_SUCCESS;
+}
 
-        if(!nvme->ctrlr) {
-                KVNVME_ERR("Cannot Use the Requested Device %s", bdf);
-                free(nvme);
+/*
+ * Set up a device whose controller is attached: Namespace, I/O Queues, Device Operations
+ * and CQ threads. The device handle is freed on failure.
+ */
+static int _kv_nvme_init_attached(kv_nvme_t *nvme, kv_nvme_io_options *options, unsigned int ssd_type) {
+        int ret = KV_ERR_DD_INVALID_PARAM, num_ns = 0;
+        unsigned long long cpu_id = 0, queue_id = 0, num_async_queues = 0, num_cq_threads = 0;
+        unsigned long long def_num_cq_threads = 1;
+        cpu_set_t io_cpus, sync_cpus, cq_cpus;
+        unsigned int thread_id = 0, cq_threads_cores[MAX_CPU_CORES] = {0};
+        unsigned int *queues_per_thread = NULL;
 
-                LEAVE();
-                return KV_ERR_DD_NO_DEVICE;
-        }
+        ENTER();
 
         num_ns = spdk_nvme_ctrlr_get_num_ns(nvme->ctrlr);
 
@@ -456,32 +883,32 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
         KVNVME_DEBUG("core_mask: 0x%llx, sync_mask: 0x%llx, num_cq_threads: 0x%llx, cq_thread_mask: 0x%llx",
                         (long long unsigned int) options->core_mask, (long long unsigned int) options->sync_mask,
                         (long long unsigned int) options->num_cq_threads, (long long unsigned int) options->cq_thread_mask);
+        KVNVME_DEBUG("core_list: %s, sync_core_list: %s, cq_core_list: %s", options->core_list, options->sync_core_list, options->cq_core_list);
 
-        if(options && options->core_mask) {
-                cpu_core_mask = options->core_mask;
-                sync_mask = options->sync_mask;
-        } else {
-                cpu_core_mask = def_core_mask;
-                sync_mask = def_sync_mask;
+        kv_nvme_get_io_cpus(options, &io_cpus, &sync_cpus, &cq_cpus);
+        if(!CPU_COUNT(&io_cpus)) {
+                CPU_SET(0, &io_cpus);
+                CPU_ZERO(&sync_cpus);
+                CPU_SET(0, &sync_cpus);
         }
 
-        nvme->qpairs = calloc(MAX_CPU_CORES, sizeof(struct spdk_nvme_qpair *));
+        ret = _kv_nvme_init_queue_map(nvme, &io_cpus, &sync_cpus);
 
-        if(!nvme->qpairs) {
-                KVNVME_ERR("Could not Allocate the I/O Queues Holder");
-                ret = spdk_nvme_detach(nvme->ctrlr);
+        if(ret) {
+                KVNVME_ERR("Could not Map the CPUs to I/O Queues");
+                _kv_nvme_free_queue_map(nvme);
+                spdk_nvme_detach(nvme->ctrlr);
                 free(nvme);
 
                 LEAVE();
                 return ret;
         }
 
-        nvme->async_qpairs = calloc(MAX_CPU_CORES, sizeof(struct spdk_nvme_qpair *));
-
-        if(!nvme->async_qpairs) {
-                KVNVME_ERR("Could not Allocate the Async I/O Queues Holder");
-                free(nvme->qpairs);
+        nvme->qpairs = calloc(nvme->nr_qpairs, sizeof(struct spdk_nvme_qpair *));
 
+        if(!nvme->qpairs) {
+                KVNVME_ERR("Could not Allocate the I/O Queues Holder");
+                _kv_nvme_free_queue_map(nvme);
                 ret = spdk_nvme_detach(nvme->ctrlr);
                 free(nvme);
 
@@ -489,11 +916,14 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 return ret;
         }
 
-        nvme->io_queue_type = calloc(MAX_CPU_CORES, sizeof(unsigned int));
-
-        if(!nvme->io_queue_type) {
-                KVNVME_ERR("Could not Allocate the Sync Mask for the I/O Queues");
+        nvme->async_qpairs = calloc(nvme->nr_qpairs, sizeof(struct spdk_nvme_qpair *));
+        nvme->async_qid = calloc(nvme->nr_qpairs, sizeof(unsigned int));
+        nvme->overflow = calloc(nvme->nr_qpairs, sizeof(kv_nvme_overflow_t));
 
+        if(!nvme->async_qpairs || !nvme->async_qid || !nvme->overflow) {
+                KVNVME_ERR("Could not Allocate the Async I/O Queues Holder");
+                _kv_nvme_free_overflow(nvme);
+                _kv_nvme_free_queue_map(nvme);
                 free(nvme->async_qpairs);
                 free(nvme->qpairs);
 
@@ -504,19 +934,13 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 return ret;
         }
 
-        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                nvme->qpairs[queue_id] = _kv_nvme_alloc_qpair(nvme, queue_id);
 
-                if(cpu_core_mask & (1ULL << queue_id)) {
-			//No Queue option
-                        nvme->qpairs[queue_id] = spdk_nvme_ctrlr_alloc_io_qpair(nvme->ctrlr, NULL, 0);
-                } else {
-                        nvme->qpairs[queue_id] = NULL;
-                }
-
-                if(!nvme->qpairs[queue_id] && (cpu_core_mask & (1ULL << queue_id))) {
+                if(!nvme->qpairs[queue_id]) {
                         unsigned int tmp_queue_id;
 
-                        KVNVME_ERR("Could not Allocate the I/O Queue for the CPU Core ID: %llu", queue_id);
+                        KVNVME_ERR("Could not Allocate the I/O Queue %llu for the CPU Core ID: %u", queue_id, nvme->qid_to_cpu[queue_id]);
 
                         for(tmp_queue_id = 0; tmp_queue_id < queue_id; tmp_queue_id++) {
                                 if(nvme->qpairs[tmp_queue_id]) {
@@ -524,7 +948,8 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                                 }
                         }
 
-                        free(nvme->io_queue_type);
+                        _kv_nvme_free_overflow(nvme);
+                        _kv_nvme_free_queue_map(nvme);
                         free(nvme->async_qpairs);
                         free(nvme->qpairs);
 
@@ -533,14 +958,16 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                         LEAVE();
                         return ret;
-                } else if (nvme->qpairs[queue_id] && (cpu_core_mask & (1ULL << queue_id))) {
-                        KVNVME_DEBUG("Successfully Created I/O Queue for the CPU Core ID: %llu with Address: 0x%llx", queue_id, (unsigned long long)nvme->qpairs[queue_id]);
-                        if(sync_mask & (1ULL << queue_id)) {
-                                nvme->io_queue_type[queue_id] = SYNC_IO_QUEUE;
-                        } else {
-                                nvme->io_queue_type[queue_id] = ASYNC_IO_QUEUE;
+                } else {
+                        KVNVME_DEBUG("Successfully Created I/O Queue %llu for the CPU Core ID: %u with Address: 0x%llx", queue_id, nvme->qid_to_cpu[queue_id], (unsigned long long)nvme->qpairs[queue_id]);
+                        /* Every qpair serves sync and async I/Os, so the CQ threads reap them all */
+                        nvme->async_qid[num_async_queues] = queue_id;
+                        nvme->async_qpairs[num_async_queues++] = nvme->qpairs[queue_id];
+
+                        _kv_nvme_init_overflow(nvme, queue_id);
 
-                                nvme->async_qpairs[num_async_queues++] = nvme->qpairs[queue_id];
+                        if(nvme->options->submit_batch > 1) {
+                                spdk_nvme_qpair_set_submit_batch(nvme->qpairs[queue_id], spdk_min(nvme->options->submit_batch, nvme->options->queue_depth - 1));
                         }
                 }
         }
@@ -559,6 +986,7 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 nvme->dev_ops.write_async = _lba_nvme_write_async;
                 nvme->dev_ops.read_async = _lba_nvme_read_async;
                 nvme->dev_ops.delete_async = _lba_nvme_delete_async;
+                nvme->dev_ops.write_zeroes_async = _lba_nvme_write_zeroes_async;
                 nvme->dev_ops.format = _lba_nvme_format;
                 nvme->dev_ops.get_used_size = _lba_nvme_get_used_size;
                 nvme->dev_ops.exist = NULL;
@@ -578,6 +1006,7 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 nvme->dev_ops.write_async = _kv_nvme_store_async;
                 nvme->dev_ops.read_async = _kv_nvme_retrieve_async;
                 nvme->dev_ops.delete_async = _kv_nvme_delete_async;
+                nvme->dev_ops.write_zeroes_async = NULL;
                 nvme->dev_ops.format = _kv_nvme_format;
                 nvme->dev_ops.get_used_size = _kv_nvme_get_used_size;
                 nvme->dev_ops.exist = _kv_nvme_exist;
@@ -591,13 +1020,14 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
         } else {
                 KVNVME_ERR("Invalid SSD Type. Did not Register any Device Operations. De-Initializing the Device");
 
-                for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                         if(nvme->qpairs[queue_id]) {
                                 spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                         }
                 }
 
-                free(nvme->io_queue_type);
+                _kv_nvme_free_overflow(nvme);
+                _kv_nvme_free_queue_map(nvme);
                 free(nvme->async_qpairs);
                 free(nvme->qpairs);
 
@@ -608,9 +1038,32 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 return ret;
         }
 
-        if(options && options->num_cq_threads) {
+        _kv_nvme_init_timeouts(nvme, ssd_type);
+        _kv_nvme_init_qos(nvme);
+
+        if(kv_nvme_reactor_add_device(nvme) == KV_SUCCESS) {
+                KVNVME_DEBUG("I/O Queues of the device are reaped by the completion reactor");
+                nvme->in_reactor = true;
+                nvme->num_cq_threads = 0;
+
+                LEAVE();
+                return 0;
+        }
+
+        if(options && options->cq_core_list[0] != '\0') {
+                num_cq_threads = CPU_COUNT(&cq_cpus);
+        } else if(options && options->num_cq_threads) {
                 num_cq_threads = options->num_cq_threads;
-                cq_thread_mask = options->cq_thread_mask;
+        } else {
+                CPU_ZERO(&cq_cpus);
+        }
+
+        if(num_cq_threads > MAX_CPU_CORES) {
+                KVNVME_WARN("No. of CQ Threads is limited to %d", MAX_CPU_CORES);
+                num_cq_threads = MAX_CPU_CORES;
+        }
+
+        if(num_cq_threads) {
 
                 KVNVME_DEBUG("No. of CQ Threads : %llu, No. of Async I/O Queues: %llu", num_cq_threads, num_async_queues);
 
@@ -619,13 +1072,14 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                         KVNVME_ERR("No. of CQ Threads cannot be more than the No. of Async I/O Queues");
 
 
-                        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                                 if(nvme->qpairs[queue_id]) {
                                         spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                                 }
                         }
 
-                        free(nvme->io_queue_type);
+                        _kv_nvme_free_overflow(nvme);
+                        _kv_nvme_free_queue_map(nvme);
                         free(nvme->async_qpairs);
                         free(nvme->qpairs);
 
@@ -648,16 +1102,16 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 unsigned int last_cpu_id = 0;
                 process_cq_thread_arg_t *cq_thread_args = calloc(1, sizeof(process_cq_thread_arg_t));
 
-                if(cq_thread_mask) {
-                        for(cpu_id = 0; cpu_id < MAX_CPU_CORES; cpu_id++) {
-                                if(cq_thread_mask & (1ULL << cpu_id)) {
+                if(CPU_COUNT(&cq_cpus)) {
+                        for(cpu_id = 0; cpu_id < CPU_SETSIZE; cpu_id++) {
+                                if(CPU_ISSET(cpu_id, &cq_cpus)) {
                                         last_cpu_id = cpu_id;
                                 }
                         }
                 } else {
 /*
-                        for(cpu_id = 0; cpu_id < MAX_CPU_CORES; cpu_id++) {
-                                if(cpu_core_mask & (1ULL << cpu_id)) {
+                        for(cpu_id = 0; cpu_id < CPU_SETSIZE; cpu_id++) {
+                                if(CPU_ISSET(cpu_id, &io_cpus)) {
                                         last_cpu_id = cpu_id;
                                 }
                         }
@@ -669,12 +1123,13 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                 cq_thread_args->nvme = nvme;
                 cq_thread_args->cpu_id = last_cpu_id;
+                cq_thread_args->num_async_qpairs = num_async_queues;
 
 		if(ssd_type == KV_TYPE_SSD){
                 	ret = pthread_create(&nvme->process_all_cqs_thread, NULL, (void *)&kv_nvme_process_all_cqs_thread, cq_thread_args);
 		}
 		else{
-			if(cq_thread_mask != 0){
+			if(CPU_COUNT(&cq_cpus)){
 				ret = pthread_create(&nvme->process_all_cqs_thread, NULL, (void *)&lba_nvme_process_all_cqs_thread, cq_thread_args);
 			}
 			else{
@@ -688,13 +1143,14 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                         free(cq_thread_args);
 
-                        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                                 if(nvme->qpairs[queue_id]) {
                                         spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                                 }
                         }
 
-                        free(nvme->io_queue_type);
+                        _kv_nvme_free_overflow(nvme);
+                        _kv_nvme_free_queue_map(nvme);
                         free(nvme->async_qpairs);
                         free(nvme->qpairs);
 
@@ -711,8 +1167,8 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 unsigned int num_cpu_cores = 0;
                 process_cq_thread_arg_t **cq_thread_args = NULL;
 
-                for(cpu_id = 0; cpu_id < MAX_CPU_CORES; cpu_id++) {
-                        if(cq_thread_mask & (1ULL << cpu_id)) {
+                for(cpu_id = 0; cpu_id < CPU_SETSIZE && num_cpu_cores < MAX_CPU_CORES; cpu_id++) {
+                        if(CPU_ISSET(cpu_id, &cq_cpus)) {
                                 cq_threads_cores[num_cpu_cores++] = cpu_id;
                         }
                 }
@@ -722,13 +1178,14 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 if(!cq_thread_args) {
                         KVNVME_ERR("Could not Allocate the Arguments for the CQ Processing Threads");
 
-                        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                                 if(nvme->qpairs[queue_id]) {
                                         spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                                 }
                         }
 
-                        free(nvme->io_queue_type);
+                        _kv_nvme_free_overflow(nvme);
+                        _kv_nvme_free_queue_map(nvme);
                         free(nvme->async_qpairs);
                         free(nvme->qpairs);
 
@@ -746,13 +1203,14 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                         free(cq_thread_args);
 
-                        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                                 if(nvme->qpairs[queue_id]) {
                                         spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                                 }
                         }
 
-                        free(nvme->io_queue_type);
+                        _kv_nvme_free_overflow(nvme);
+                        _kv_nvme_free_queue_map(nvme);
                         free(nvme->async_qpairs);
                         free(nvme->qpairs);
 
@@ -786,11 +1244,13 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                                 free(queues_per_thread);
 
-                                for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                                for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                                         if(nvme->qpairs[queue_id]) {
                                                 spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                                         }
+                                }
 
+                                for(queue_id = 0; queue_id < num_cq_threads; queue_id++) {
                                         if(cq_thread_args[queue_id]) {
                                                 free(cq_thread_args[queue_id]);
                                         }
@@ -798,7 +1258,8 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                                 free(cq_thread_args);
 
-                                free(nvme->io_queue_type);
+                                _kv_nvme_free_overflow(nvme);
+                                _kv_nvme_free_queue_map(nvme);
                                 free(nvme->async_qpairs);
                                 free(nvme->qpairs);
 
@@ -821,7 +1282,7 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                         	ret = pthread_create(&nvme->process_cq_thread[thread_id], NULL, (void *)&kv_nvme_process_cq_thread, cq_thread_args[thread_id]);
 			}
 			else{
-				if(cq_thread_mask != 0){
+				if(CPU_COUNT(&cq_cpus)){
 					ret = pthread_create(&nvme->process_cq_thread[thread_id], NULL, (void *)&lba_nvme_process_cq_thread, cq_thread_args[thread_id]);
 				}
 				else{
@@ -834,11 +1295,13 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                                 free(queues_per_thread);
 
-                                for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+                                for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                                         if(nvme->qpairs[queue_id]) {
                                                 spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                                         }
+                                }
 
+                                for(queue_id = 0; queue_id < num_cq_threads; queue_id++) {
                                         if(cq_thread_args[queue_id]) {
                                                 free(cq_thread_args[queue_id]);
                                         }
@@ -846,7 +1309,8 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
 
                                 free(cq_thread_args);
 
-                                free(nvme->io_queue_type);
+                                _kv_nvme_free_overflow(nvme);
+                                _kv_nvme_free_queue_map(nvme);
                                 free(nvme->async_qpairs);
                                 free(nvme->qpairs);
 
@@ -868,6 +1332,184 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
         return 0;
 }
 
+int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_type) {
+        int ret = KV_ERR_DD_INVALID_PARAM;
+        kv_nvme_t *nvme = NULL;
+
+        ENTER();
+
+        ret = _kv_nvme_alloc(bdf, options, ssd_type, &nvme);
+        if(ret) {
+                LEAVE();
+                return ret;
+        }
+
+        ret = spdk_nvme_probe(&nvme->trid, nvme, probe_cb, attach_cb, NULL);
+
+        if(ret) {
+                KVNVME_ERR("SPDK NVMe Probe failed, ret = %d", ret);
+                free(nvme);
+
+                LEAVE();
+		ret = (ret == -ENODEV ? KV_ERR_DD_NO_DEVICE : ret);
+                return ret;
+        }
+
+        if(!nvme->ctrlr) {
+                KVNVME_ERR("Cannot Use the Requested Device %s", bdf);
+                free(nvme);
+
+                LEAVE();
+                return KV_ERR_DD_NO_DEVICE;
+        }
+
+
+        ret = _kv_nvme_init_attached(nvme, options, ssd_type);
+
+        LEAVE();
+        return ret;
+}
+
+/**
+ * @brief Initialization state of one device in kv_nvme_init_devices()
+ */
+typedef struct kv_nvme_init_ctx {
+	/** KV NVMe Device, NULL once its initialization failed */
+	kv_nvme_t *nvme;
+	/** I/O Options of the device */
+	kv_nvme_io_options *options;
+	/** LBA Type SSD (0) or KV Type SSD (1) */
+	unsigned int ssd_type;
+	/** Async probe of the controller, NULL once attached or failed */
+	struct spdk_nvme_probe_ctx *probe_ctx;
+	/** Thread setting up the device once its controller is attached */
+	pthread_t thread;
+	bool thread_started;
+	/** Ticks at which the initialization started, the controller got attached, and the device got set up */
+	uint64_t start_tick;
+	uint64_t attach_tick;
+	uint64_t done_tick;
+	/** Result of the initialization */
+	int ret;
+} kv_nvme_init_ctx_t;
+
+static void *_kv_nvme_init_attached_thread(void *arg) {
+        kv_nvme_init_ctx_t *ctx = (kv_nvme_init_ctx_t *)arg;
+
+        ctx->ret = _kv_nvme_init_attached(ctx->nvme, ctx->options, ctx->ssd_type);
+        ctx->done_tick = spdk_get_ticks();
+
+        return NULL;
+}
+
+int kv_nvme_init_devices(unsigned int nr_devices, const char **bdfs, kv_nvme_io_options *options, unsigned int ssd_type, int *results) {
+        kv_nvme_init_ctx_t *ctxs = NULL;
+        unsigned int i = 0, nr_probing = 0;
+        uint64_t ticks_hz = spdk_get_ticks_hz();
+        int ret = KV_SUCCESS, rc = 0;
+
+        ENTER();
+
+        if(!nr_devices || !bdfs || !options) {
+                KVNVME_ERR("Use invalid parameter to initialize the KV NVMe Devices");
+
+                LEAVE();
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        ctxs = calloc(nr_devices, sizeof(kv_nvme_init_ctx_t));
+        if(!ctxs) {
+                KVNVME_ERR("Could not allocate memory for the Device Initialization Contexts");
+
+                LEAVE();
+                return KV_ERR_DD_NO_AVAILABLE_RESOURCE;
+        }
+
+        /* Every controller gets its own probe context, so their init state machines advance side by side */
+        for(i = 0; i < nr_devices; i++) {
+                ctxs[i].options = &options[i];
+                ctxs[i].ssd_type = ssd_type;
+                ctxs[i].start_tick = spdk_get_ticks();
+
+                ctxs[i].ret = _kv_nvme_alloc(bdfs[i], &options[i], ssd_type, &ctxs[i].nvme);
+                if(ctxs[i].ret) {
+                        ctxs[i].nvme = NULL;
+                        continue;
+                }
+
+                ctxs[i].probe_ctx = spdk_nvme_probe_async(&ctxs[i].nvme->trid, ctxs[i].nvme, probe_cb, attach_cb, NULL);
+                if(!ctxs[i].probe_ctx) {
+                        KVNVME_ERR("SPDK NVMe Probe of %s failed, errno = %d", bdfs[i], errno);
+                        free(ctxs[i].nvme);
+                        ctxs[i].nvme = NULL;
+                        ctxs[i].ret = KV_ERR_DD_NO_DEVICE;
+                        continue;
+                }
+
+                nr_probing++;
+        }
+
+        /* A device is set up on a thread of its own as soon as its controller is attached */
+        while(nr_probing) {
+                for(i = 0; i < nr_devices; i++) {
+                        if(!ctxs[i].probe_ctx) {
+                                continue;
+                        }
+
+                        rc = spdk_nvme_probe_poll_async(ctxs[i].probe_ctx);
+                        if(rc == -EAGAIN) {
+                                continue;
+                        }
+
+                        /* The probe context is freed by SPDK once the probe is over */
+                        ctxs[i].probe_ctx = NULL;
+                        ctxs[i].attach_tick = spdk_get_ticks();
+                        nr_probing--;
+
+                        if(rc || !ctxs[i].nvme->ctrlr) {
+                                KVNVME_ERR("Cannot Use the Requested Device %s", bdfs[i]);
+                                free(ctxs[i].nvme);
+                                ctxs[i].nvme = NULL;
+                                ctxs[i].ret = KV_ERR_DD_NO_DEVICE;
+                                continue;
+                        }
+
+                        if(pthread_create(&ctxs[i].thread, NULL, _kv_nvme_init_attached_thread, &ctxs[i])) {
+                                KVNVME_WARN("Could not create the Initialization Thread of %s, setting it up in place", bdfs[i]);
+                                _kv_nvme_init_attached_thread(&ctxs[i]);
+                        } else {
+                                ctxs[i].thread_started = true;
+                        }
+                }
+        }
+
+        for(i = 0; i < nr_devices; i++) {
+                if(ctxs[i].thread_started) {
+                        pthread_join(ctxs[i].thread, NULL);
+                }
+
+                if(ctxs[i].ret == KV_SUCCESS) {
+                        KVNVME_INFO("Device %s initialized in %lu ms (controller attached in %lu ms)", bdfs[i],
+                                        (ctxs[i].done_tick - ctxs[i].start_tick) * 1000 / ticks_hz,
+                                        (ctxs[i].attach_tick - ctxs[i].start_tick) * 1000 / ticks_hz);
+                } else {
+                        KVNVME_ERR("Device %s initialization failed, ret = %d", bdfs[i], ctxs[i].ret);
+                        if(ret == KV_SUCCESS) {
+                                ret = ctxs[i].ret;
+                        }
+                }
+
+                if(results) {
+                        results[i] = ctxs[i].ret;
+                }
+        }
+
+        free(ctxs);
+
+        LEAVE();
+        return ret;
+}
+
 uint64_t kv_nvme_open(const char *bdf) {
         uint64_t handle = 0;
         kv_nvme_t *nvme = NULL;
@@ -943,6 +1585,10 @@ int kv_nvme_finalize(char *bdf) {
                 return KV_ERR_DD_NO_DEVICE;
         }
 
+        if(nvme->in_reactor) {
+                kv_nvme_reactor_remove_device(nvme);
+        }
+
         if(nvme->num_cq_threads == 1) {
                 nvme->stop_process_all_cqs = 1;
         } else {
@@ -951,6 +1597,13 @@ int kv_nvme_finalize(char *bdf) {
                 }
         }
 
+        /* CQ threads sleeping in event mode see the stop flag once woken up */
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                if(nvme->qpairs[queue_id]) {
+                        kv_qpair_cq_event_notify(nvme->qpairs[queue_id]);
+                }
+        }
+
         if(nvme->num_cq_threads == 1) {
                 pthread_join(nvme->process_all_cqs_thread, NULL);
         } else {
@@ -959,13 +1612,14 @@ int kv_nvme_finalize(char *bdf) {
                 }
         }
 
-        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
                 if(nvme->qpairs[queue_id]) {
                         spdk_nvme_ctrlr_free_io_qpair(nvme->qpairs[queue_id]);
                 }
         }
 
-        free(nvme->io_queue_type);
+        _kv_nvme_free_overflow(nvme);
+        _kv_nvme_free_queue_map(nvme);
         free(nvme->async_qpairs);
         free(nvme->qpairs);
         free(nvme->options);
@@ -993,52 +1647,143 @@ int kv_nvme_is_dd_initialized(){
 }
 
 
-void kv_nvme_process_completion(uint64_t handle){
+int kv_nvme_flush_submissions(uint64_t handle, int qid){
         kv_nvme_t *nvme = (kv_nvme_t*)handle;
         struct spdk_nvme_qpair *qpair = NULL;
-        unsigned int queue_is_async = 0;
-        unsigned int queue_id = 0;
 
         if (nvme == NULL) {
-          KVNVME_ERR("Invalid handle passed");
-          return;
+                KVNVME_ERR("Invalid handle passed");
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+        if (qid < 0 || (qid = kv_nvme_get_qid(nvme, qid)) < 0) {
+                KVNVME_ERR("Invalid queue id %d", qid);
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        qpair = nvme->qpairs[qid];
+        if(!qpair) {
+                KVNVME_ERR("No Matching I/O Queue found for the Passed CPU Core ID");
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                return KV_ERR_DD_QPAIR_OWNED;
         }
-        for(queue_id = 0; queue_id < MAX_CPU_CORES; queue_id++) {
+        spdk_nvme_qpair_flush_submissions(qpair);
+        kv_qpair_sq_unlock(qpair);
+
+        return KV_SUCCESS;
+}
+
+int kv_nvme_acquire_qpair(uint64_t handle, int *qid){
+        kv_nvme_t *nvme = (kv_nvme_t*)handle;
+        struct spdk_nvme_qpair *qpair = NULL;
+        pthread_t self = pthread_self();
+        pthread_t unowned;
+        int queue_id, wanted_qid = -1;
+
+        if (nvme == NULL || qid == NULL) {
+                KVNVME_ERR("Invalid parameters passed");
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        if(*qid >= 0) {
+                wanted_qid = kv_nvme_get_qid(nvme, *qid);
+                if(wanted_qid < 0) {
+                        KVNVME_ERR("No I/O Queue for the CPU Core ID %d", *qid);
+                        return KV_ERR_DD_INVALID_PARAM;
+                }
+        }
+
+        for(queue_id = 0; queue_id < (int)nvme->nr_qpairs; queue_id++) {
+                if(wanted_qid >= 0 && queue_id != wanted_qid) {
+                        continue;
+                }
+
                 qpair = nvme->qpairs[queue_id];
-                queue_is_async = ((nvme->io_queue_type[queue_id] == ASYNC_IO_QUEUE) ? 1 : 0);
+                if(!qpair || (*qid < 0 && nvme->io_queue_type[queue_id] != ASYNC_IO_QUEUE)) {
+                        continue;
+                }
 
-                if(qpair && queue_is_async) {
-                        pthread_spin_lock(&qpair->cq_lock);
-                        spdk_nvme_qpair_process_completions(qpair, 0);
-                        pthread_spin_unlock(&qpair->cq_lock);
+                unowned = 0;
+                if(__atomic_compare_exchange_n(&qpair->owner, &unowned, self, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                        break;
                 }
+                qpair = NULL;
+        }
+
+        if(!qpair) {
+                KVNVME_ERR("No I/O Queue available to acquire");
+                return (*qid >= 0) ? KV_ERR_DD_QPAIR_OWNED : KV_ERR_DD_NO_AVAILABLE_QUEUE;
+        }
+
+        /* Wait out threads that took the locks before the owner was published */
+        pthread_spin_lock(&qpair->sq_lock);
+        pthread_spin_unlock(&qpair->sq_lock);
+        pthread_spin_lock(&qpair->cq_lock);
+        pthread_spin_unlock(&qpair->cq_lock);
+
+        /* Callers address I/O Queues by CPU Core ID, any CPU mapped to the I/O Queue will do */
+        *qid = nvme->qid_to_cpu[queue_id];
+        KVNVME_DEBUG("I/O Queue %d acquired by thread 0x%lx", queue_id, (unsigned long)self);
+
+        return KV_SUCCESS;
+}
 
-                queue_is_async = 0;
+int kv_nvme_release_qpair(uint64_t handle, int qid){
+        kv_nvme_t *nvme = (kv_nvme_t*)handle;
+        struct spdk_nvme_qpair *qpair = NULL;
+
+        if (nvme == NULL || qid < 0 || (qid = kv_nvme_get_qid(nvme, qid)) < 0) {
+                KVNVME_ERR("Invalid parameters passed");
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        qpair = nvme->qpairs[qid];
+        if(!qpair || !kv_qpair_is_owner(qpair)) {
+                KVNVME_ERR("I/O Queue %d is not acquired by this thread", qid);
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        /* Outstanding I/Os are completed by the CQ threads once the qpair is shared again */
+        spdk_nvme_qpair_flush_submissions(qpair);
+        __atomic_store_n(&qpair->owner, 0, __ATOMIC_RELEASE);
+        kv_qpair_cq_event_notify(qpair);
+
+        return KV_SUCCESS;
+}
+
+void kv_nvme_process_completion(uint64_t handle){
+        kv_nvme_t *nvme = (kv_nvme_t*)handle;
+        unsigned int queue_id = 0;
+
+        if (nvme == NULL) {
+          KVNVME_ERR("Invalid handle passed");
+          return;
+        }
+        for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                if(nvme->qpairs[queue_id]) {
+                        kv_nvme_poll_qpair(nvme, queue_id);
+                }
         }
 }
 
 void kv_nvme_process_completion_queue(uint64_t handle, uint32_t queue_id){
         kv_nvme_t *nvme = (kv_nvme_t*)handle;
         struct spdk_nvme_qpair *qpair = NULL;
-        unsigned int queue_is_async = 0;
   if (nvme == NULL) {
     KVNVME_ERR("Invalid handle passed");
     return;
   }
-  if(queue_id >= MAX_CPU_CORES) {
-    int qid = sched_getcpu();
-    if(qid >= 0) {
-      queue_id = qid;
-    } else {
-      KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-      queue_id = 0;
-    }
+  /* queue_id is a CPU Core ID, out of range values stand for the current CPU */
+  int qid = kv_nvme_get_qid(nvme, (queue_id >= nvme->nr_cpus) ? -1 : (int)queue_id);
+  if(qid < 0) {
+    return;
   }
+  queue_id = qid;
 	qpair = nvme->qpairs[queue_id];
-	queue_is_async = ((nvme->io_queue_type[queue_id] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(qpair && queue_is_async) {
-		pthread_spin_lock(&qpair->cq_lock);
-		spdk_nvme_qpair_process_completions(qpair, 0);
-		pthread_spin_unlock(&qpair->cq_lock);
+	if(qpair) {
+		kv_nvme_poll_qpair(nvme, queue_id);
 	}
 }
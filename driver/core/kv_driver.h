@@ -52,6 +52,18 @@
 
 #define	TRANSPORT_ID_STRING		"trtype:PCIe traddr:"
 
+#define	KV_NVME_QOS_BURST_MS		10 // Token bucket depth, in ms worth of the rate limit
+
+#define	KV_NVME_WRR_HIGH_WEIGHT		16 // Commands fetched per WRR round from high priority I/O Queues
+#define	KV_NVME_WRR_MEDIUM_WEIGHT	4
+#define	KV_NVME_WRR_LOW_WEIGHT		1
+
+#define	KV_REACTOR_REBALANCE_MS		100 // Interval of the reactor's load rebalancing
+#define	KV_REACTOR_MAX_IDLE_US		64 // Longest sleep of an idle reactor poller
+
+#define	KV_CQ_EVENT_RATE_MS		100 // Window over which a CQ thread measures its completion rate
+#define	KV_CQ_EVENT_MAX_SLEEP_MS	100 // Longest sleep of a CQ thread without a submission
+
 typedef struct kv_nvme kv_nvme_t;
 
 /**
@@ -70,6 +82,8 @@ typedef struct nvme_dev_operations {
 	int (*delete)(kv_nvme_t *nvme, const kv_pair *kv, int core_id);
 	/** Pointer to the NVMe Delete Async Function */
 	int (*delete_async)(kv_nvme_t *nvme, const kv_pair *kv, int core_id);
+	/** Pointer to the NVMe Write Zeroes Async Function */
+	int (*write_zeroes_async)(kv_nvme_t *nvme, const kv_pair *kv, int core_id);
 	/** Pointer to the NVMe Format Function */
 	int (*format)(kv_nvme_t *nvme, int ses);
 	/** Pointer to the NVMe Get Used Size Function */
@@ -88,6 +102,93 @@ typedef struct nvme_dev_operations {
 	int (*iterate_read_async)(kv_nvme_t *nvme, kv_iterate* iterate, int core_id);
 } nvme_dev_operations_t;
 
+/**
+ * @brief Async I/O Operations which can wait in the Overflow Queue
+ */
+enum kv_nvme_overflow_opcode {
+	KV_NVME_OVERFLOW_WRITE,
+	KV_NVME_OVERFLOW_READ,
+	KV_NVME_OVERFLOW_DELETE,
+	KV_NVME_OVERFLOW_EXIST,
+	KV_NVME_OVERFLOW_ITERATE_READ,
+	KV_NVME_OVERFLOW_WRITE_ZEROES,
+};
+
+/**
+ * @brief Async I/O waiting in the Overflow Queue
+ */
+typedef struct kv_nvme_overflow_io {
+	/** Async I/O Operation (enum kv_nvme_overflow_opcode) */
+	uint8_t opcode;
+	/** kv_pair or kv_iterate of the Async I/O */
+	void *arg;
+} kv_nvme_overflow_io_t;
+
+/**
+ * @brief FIFO of the Async I/Os of one priority class waiting in the Overflow Queue
+ */
+typedef struct kv_nvme_overflow_ring {
+	/** Ring of pending Async I/Os */
+	kv_nvme_overflow_io_t *ios;
+	/** Index of the oldest pending Async I/O */
+	uint32_t head;
+	/** Number of pending Async I/Os */
+	uint32_t count;
+} kv_nvme_overflow_ring_t;
+
+/**
+ * @brief Software Overflow Queue of an Async I/O Qpair
+ *        Async I/Os which do not fit in the SQ or are throttled by their priority class
+ *        are parked here and resubmitted from the completion path as slots free up.
+ *        Each class has a FIFO of its own, so a throttled class does not hold back the others.
+ */
+typedef struct kv_nvme_overflow {
+	/** Protects the rings, taken before sq_lock */
+	pthread_spinlock_t lock;
+	/** Pending Async I/Os indexed by enum kv_io_priority */
+	kv_nvme_overflow_ring_t rings[KV_IO_PRIO_MAX];
+	/** Number of Async I/Os the rings hold together, 0 if disabled */
+	uint32_t depth;
+	/** Number of pending Async I/Os in all rings */
+	uint32_t count;
+} kv_nvme_overflow_t;
+
+/**
+ * @brief Token buckets of one I/O priority class
+ *        Buckets may go negative so a large I/O is never stuck behind a small burst size,
+ *        the debt delays the following I/Os instead.
+ */
+typedef struct kv_nvme_qos_class {
+	/** Protects the buckets, I/Os of a class are throttled across all qpairs */
+	pthread_spinlock_t lock;
+	/** I/O and byte rate limits per second, 0 = unlimited */
+	uint64_t iops_rate;
+	uint64_t bps_rate;
+	/** Bucket depths */
+	int64_t io_burst;
+	int64_t byte_burst;
+	/** Available tokens */
+	int64_t io_tokens;
+	int64_t byte_tokens;
+	/** Tick up to which tokens were credited */
+	uint64_t io_tick;
+	uint64_t byte_tick;
+} kv_nvme_qos_class_t;
+
+/**
+ * @brief I/O QoS state of a device
+ */
+typedef struct kv_nvme_qos {
+	/** Set if any rate limit or low priority yielding is configured */
+	bool enabled;
+	/** Token buckets indexed by enum kv_io_priority */
+	kv_nvme_qos_class_t classes[KV_IO_PRIO_MAX];
+	/** Low priority I/Os are held back within this many ticks of a high priority submission, 0 = never */
+	uint64_t yield_ticks;
+	/** Tick of the latest high priority submission */
+	uint64_t last_high_tick;
+} kv_nvme_qos_t;
+
 /**
  * @brief KV NVMe Device
  */
@@ -96,8 +197,16 @@ typedef struct kv_nvme {
 	struct spdk_nvme_ctrlr *ctrlr;
 	/** SPDK NVMe Namespace */
 	struct spdk_nvme_ns *ns;
-	/** SPDK NVMe IO Queue Pairs */
+	/** SPDK NVMe IO Queue Pairs, the I/O Queue pool indexed by qid */
 	struct spdk_nvme_qpair **qpairs;
+	/** Number of I/O Queues in the pool */
+	unsigned int nr_qpairs;
+	/** I/O Queue (qid) used by each CPU Core ID, -1 if the CPU does no I/O on the device */
+	int *cpu_to_qid;
+	/** Number of entries in cpu_to_qid */
+	unsigned int nr_cpus;
+	/** First CPU Core ID mapped to each I/O Queue, reported back to the API callers */
+	unsigned int *qid_to_cpu;
 	/** SPDK Transport ID */
 	struct spdk_nvme_transport_id trid;
 	/** Transport ID of the NVMe Device */
@@ -114,12 +223,32 @@ typedef struct kv_nvme {
 	pthread_t process_all_cqs_thread;
 	/** Stop the Processing of Completions for all CQs */
 	unsigned int stop_process_all_cqs;
-	/** I/O Queue Type (Sync or Async) */
+	/** Preferred I/O Queue Type (Sync or Async) per qid, every qpair serves both */
 	unsigned int *io_queue_type;
 	/** Number of CQ Processing Threads */
 	unsigned int num_cq_threads;
-	/** SPDK NVMe IO Queue Pairs */
+	/** SPDK NVMe IO Queue Pairs reaped by the CQ Processing Threads */
 	struct spdk_nvme_qpair **async_qpairs;
+	/** qid of each entry in async_qpairs */
+	unsigned int *async_qid;
+	/** Software Overflow Queue per qid */
+	kv_nvme_overflow_t *overflow;
+	/** Number of Aborts issued for timed out commands and not completed yet */
+	unsigned int nr_pending_aborts;
+	/** Tick after which timed out commands still outstanding are taken as ignoring their Abort, 0 if none */
+	uint64_t abort_check_tick;
+	/** Grace period left to an Abort before its command is checked again, in ticks */
+	uint64_t abort_grace_ticks;
+	/** Set when an Abort failed or was ignored and the controller has to be reset */
+	unsigned int reset_pending;
+	/** Set while the controller is reset, Abort completions are flushed then */
+	bool resetting;
+	/** Priority class rate limiting */
+	kv_nvme_qos_t qos;
+	/** Set if the controller runs weighted round robin arbitration */
+	bool wrr_enabled;
+	/** Set if the qpairs are reaped by the shared completion reactor instead of CQ threads of its own */
+	bool in_reactor;
 	/** Stop the Processing of Completions for CQ */
 	unsigned int stop_process_cq[MAX_CPU_CORES];
 	/** Thread to Process the Completions of Individual CQs */
@@ -146,20 +275,243 @@ typedef struct process_cq_thread_arg {
 	unsigned int thread_id;
 	/** CPU Core ID */
 	unsigned int cpu_id;
+	/** Stop flag of the thread, checked again before it sleeps */
+	unsigned int *stop;
+	/** epoll instance over the eventfds of the thread's qpairs, -1 if the thread always polls */
+	int epoll_fd;
+	/** Completions per rate window below which the thread sleeps while its qpairs are idle */
+	uint64_t event_threshold;
+	/** Completions reaped in the current rate window */
+	uint64_t nr_completions;
+	/** Tick at which the current rate window ends */
+	uint64_t next_rate_tick;
+	/** Set while the completion rate is below event_threshold */
+	bool event_mode;
 } process_cq_thread_arg_t;
 
+/**
+ * @brief Qpair polled by a completion reactor poller
+ */
+typedef struct kv_reactor_qpair {
+	/** KV NVMe Device of the qpair */
+	kv_nvme_t *nvme;
+	/** qid of the qpair in the device */
+	int qid;
+	/** Completions reaped in the current rebalance period */
+	uint64_t nr_completions;
+} kv_reactor_qpair_t;
+
+/**
+ * @brief Completion reactor poller thread, polling qpairs of any device
+ */
+typedef struct kv_reactor_poller {
+	/** Poller thread */
+	pthread_t thread;
+	/** CPU Core ID the thread is pinned to */
+	unsigned int cpu_id;
+	/** Protects qpairs, held by the thread for a polling pass */
+	pthread_spinlock_t lock;
+	/** Qpairs polled by this thread */
+	kv_reactor_qpair_t *qpairs;
+	/** Number of entries in qpairs, and its capacity */
+	unsigned int nr_qpairs;
+	unsigned int max_qpairs;
+	/** Stop the poller thread */
+	unsigned int stop;
+} kv_reactor_poller_t;
+
 /**
  * @brief I/O or Admin Command Sequence
  */
 typedef struct nvme_cmd_sequence {
 	/** Status of the I/O or Admin command*/
-	uint8_t status;
+	uint16_t status;
 	/** Result of the I/O or Admin command (CDW0 Command Specific) */
 	uint32_t result;
 	/** I/O or Admin command Completion State*/
 	unsigned int is_completed;
 } nvme_cmd_sequence_t;
 
+/*
+ * A qpair acquired by kv_nvme_acquire_qpair() is submitted to and polled by its
+ * owner thread only, without sq_lock/cq_lock. Other threads still take the lock
+ * and re-check the owner under it, as acquire passes through both locks once
+ * after publishing the owner.
+ */
+static inline bool kv_qpair_is_owner(struct spdk_nvme_qpair *qpair) {
+	return __atomic_load_n(&qpair->owner, __ATOMIC_RELAXED) == pthread_self();
+}
+
+static inline int kv_qpair_sq_lock(struct spdk_nvme_qpair *qpair) {
+	if(kv_qpair_is_owner(qpair)) {
+		return KV_SUCCESS;
+	}
+
+	pthread_spin_lock(&qpair->sq_lock);
+	if(spdk_unlikely(__atomic_load_n(&qpair->owner, __ATOMIC_ACQUIRE) != 0)) {
+		pthread_spin_unlock(&qpair->sq_lock);
+		return KV_ERR_DD_QPAIR_OWNED;
+	}
+	return KV_SUCCESS;
+}
+
+/*
+ * Wake the CQ thread sleeping on the qpair, if any. The thread arms the qpair before
+ * it checks the qpair is idle, and a submitter makes its request visible before it
+ * checks the arm, so either the thread sees the request or the submitter sees the arm.
+ */
+static inline void kv_qpair_cq_event_notify(struct spdk_nvme_qpair *qpair) {
+	uint64_t wakeup = 1;
+
+	if(spdk_likely(qpair->cq_event_fd < 0)) {
+		return;
+	}
+
+	__atomic_thread_fence(__ATOMIC_SEQ_CST);
+	if(__atomic_load_n(&qpair->cq_event_armed, __ATOMIC_RELAXED) &&
+			__atomic_exchange_n(&qpair->cq_event_armed, 0, __ATOMIC_SEQ_CST)) {
+		if(write(qpair->cq_event_fd, &wakeup, sizeof(wakeup)) < 0) {
+			KVNVME_WARN("Could not wake the CQ thread of qpair %u", qpair->id);
+		}
+	}
+}
+
+static inline void kv_qpair_sq_unlock(struct spdk_nvme_qpair *qpair) {
+	if(!kv_qpair_is_owner(qpair)) {
+		pthread_spin_unlock(&qpair->sq_lock);
+		kv_qpair_cq_event_notify(qpair);
+	}
+}
+
+static inline int kv_qpair_cq_lock(struct spdk_nvme_qpair *qpair) {
+	if(kv_qpair_is_owner(qpair)) {
+		return KV_SUCCESS;
+	}
+
+	pthread_spin_lock(&qpair->cq_lock);
+	if(spdk_unlikely(__atomic_load_n(&qpair->owner, __ATOMIC_ACQUIRE) != 0)) {
+		pthread_spin_unlock(&qpair->cq_lock);
+		return KV_ERR_DD_QPAIR_OWNED;
+	}
+	return KV_SUCCESS;
+}
+
+static inline void kv_qpair_cq_unlock(struct spdk_nvme_qpair *qpair) {
+	if(!kv_qpair_is_owner(qpair)) {
+		pthread_spin_unlock(&qpair->cq_lock);
+	}
+}
+
+/*
+ * Submissions deferred by the submit batch are pushed out on every poll, so an
+ * application that never calls kv_nvme_flush_submissions() still makes progress.
+ * trylock keeps the CQ thread from spinning behind a submitter; it retries on the next poll.
+ */
+static inline void kv_qpair_poll_flush(kv_nvme_t *nvme, struct spdk_nvme_qpair *qpair){
+        if(nvme->options->submit_batch <= 1 || !qpair->num_unflushed) {
+                return;
+        }
+
+        if(kv_qpair_is_owner(qpair)) {
+                spdk_nvme_qpair_flush_submissions(qpair);
+                return;
+        }
+
+        if(pthread_spin_trylock(&qpair->sq_lock) == 0) {
+                if(__atomic_load_n(&qpair->owner, __ATOMIC_ACQUIRE) == 0) {
+                        spdk_nvme_qpair_flush_submissions(qpair);
+                }
+                pthread_spin_unlock(&qpair->sq_lock);
+        }
+}
+
+extern void kv_nvme_overflow_drain(kv_nvme_t *nvme, int qid);
+extern void kv_nvme_recover(kv_nvme_t *nvme);
+
+extern void kv_nvme_cq_event_init(process_cq_thread_arg_t *pcq_arg, unsigned int *stop);
+extern void kv_nvme_cq_event_idle(process_cq_thread_arg_t *pcq_arg, int32_t nr_completions);
+extern void kv_nvme_cq_event_fini(process_cq_thread_arg_t *pcq_arg);
+
+/*
+ * Reap completions of a qpair, refill its SQ from the Overflow Queue
+ * with the slots just freed, then push out whatever the submit batch holds back.
+ * Returns the number of completions reaped.
+ */
+static inline int32_t kv_nvme_poll_qpair(kv_nvme_t *nvme, int qid){
+        struct spdk_nvme_qpair *qpair = nvme->qpairs[qid];
+        int32_t nr_completions = 0;
+
+        if(kv_qpair_cq_lock(qpair) == KV_SUCCESS) {
+                nr_completions = spdk_nvme_qpair_process_completions(qpair, 0);
+                kv_qpair_cq_unlock(qpair);
+
+                if(nvme->overflow[qid].count) {
+                        kv_nvme_overflow_drain(nvme, qid);
+                }
+        }
+
+        if(spdk_unlikely(nvme->nr_pending_aborts || nvme->abort_check_tick || nvme->reset_pending)) {
+                kv_nvme_recover(nvme);
+        }
+
+        kv_qpair_poll_flush(nvme, qpair);
+
+        return (nr_completions > 0) ? nr_completions : 0;
+}
+
+/*
+ * Completion status reported to the callers. Commands aborted after exceeding their
+ * timeout come back as ABORTED_BY_REQUEST, which KV SSDs do not use otherwise.
+ */
+static inline unsigned int kv_nvme_cpl_status(const struct spdk_nvme_cpl *cpl){
+        if(spdk_unlikely(cpl->status.sct == SPDK_NVME_SCT_GENERIC && cpl->status.sc == SPDK_NVME_SC_ABORTED_BY_REQUEST)) {
+                return KV_ERR_DD_IO_TIMEOUT;
+        }
+        return cpl->status.sc;
+}
+
+/*
+ * Mark a sync command completed, the waiter may be another thread than the one reaping it
+ */
+static inline void kv_nvme_complete_sequence(nvme_cmd_sequence_t *cmd_sequence){
+        __atomic_store_n(&cmd_sequence->is_completed, 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Wait for a sync command submitted on a qpair, with its SQ lock released. The waiter
+ * reaps the qpair itself, so async completions sharing the qpair are delivered in the
+ * same pass; a CQ thread or another waiter holding the CQ may complete it as well.
+ */
+static inline void kv_nvme_wait_for_completion(kv_nvme_t *nvme, int qid, nvme_cmd_sequence_t *io_sequence){
+        while(!__atomic_load_n(&io_sequence->is_completed, __ATOMIC_ACQUIRE)) {
+                if(kv_nvme_poll_qpair(nvme, qid) == 0 && spdk_unlikely(spdk_nvme_ctrlr_is_failed(nvme->ctrlr))) {
+                        /* the reset after an ignored Abort failed, a failed controller completes nothing */
+                        io_sequence->status = KV_ERR_DD_IO_TIMEOUT;
+                        break;
+                }
+        }
+}
+
+/*
+ * Map a CPU Core ID passed through the API to the qid of its I/O Queue. A negative
+ * CPU Core ID stands for the CPU the calling thread runs on. Returns -1 if the
+ * device has no I/O Queue for the CPU.
+ */
+static inline int kv_nvme_get_qid(kv_nvme_t *nvme, int core_id){
+        if(core_id < 0) {
+                core_id = sched_getcpu();
+                if(core_id < 0) {
+                        KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
+                        core_id = 0;
+                }
+        }
+
+        if((unsigned int)core_id >= nvme->nr_cpus) {
+                return -1;
+        }
+        return nvme->cpu_to_qid[core_id];
+}
+
 static inline unsigned int min(unsigned int a, unsigned int b) {
 	return (a < b) ? a : b;
 }
@@ -484,6 +484,7 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 nvme->dev_ops.write_async = _lba_nvme_write_async;
                 nvme->dev_ops.read_async = _lba_nvme_read_async;
                 nvme->dev_ops.delete_async = _lba_nvme_delete_async;
+                nvme->dev_ops.write_zeroes_async = _lba_nvme_write_zeroes_async;
                 nvme->dev_ops.format = _lba_nvme_format;
                 nvme->dev_ops.get_used_size = _lba_nvme_get_used_size;
                 nvme->dev_ops.exist = NULL;
@@ -503,6 +504,7 @@ int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_
                 nvme->dev_ops.write_async = _kv_nvme_store_async;
                 nvme->dev_ops.read_async = _kv_nvme_retrieve_async;
                 nvme->dev_ops.delete_async = _kv_nvme_delete_async;
+                nvme->dev_ops.write_zeroes_async = NULL;
                 nvme->dev_ops.format = _kv_nvme_format;
                 nvme->dev_ops.get_used_size = _kv_nvme_get_used_size;
                 nvme->dev_ops.exist = _kv_nvme_exist;
@@ -81,7 +81,7 @@ static void admin_complete(void *arg, const struct spdk_nvme_cpl *completion) {
 	admin_sequence->status = completion->status.sc;
 	admin_sequence->result = completion->cdw0;
 
-	admin_sequence->is_completed = 1;
+	kv_nvme_complete_sequence(admin_sequence);
 
 	KVNVME_DEBUG("Status of the Admin command: %d, Result of the Admin command: %d", admin_sequence->status, admin_sequence->result);
 
@@ -98,7 +98,7 @@ static void io_complete(void *arg, const struct spdk_nvme_cpl *completion) {
 	io_sequence->status = completion->status.sc;
 	io_sequence->result = completion->cdw0;
 
-	io_sequence->is_completed = 1;
+	kv_nvme_complete_sequence(io_sequence);
 
 	KVNVME_DEBUG("Status of the I/O: %d, Result of the I/O: %d", io_sequence->status, io_sequence->result);
 
@@ -140,12 +140,8 @@ kv_nvme_cpl_t *kv_nvme_submit_raw_cmd(uint64_t handle, kv_nvme_cmd_t cmd, void *
 		ret = spdk_nvme_ctrlr_cmd_admin_raw(nvme->ctrlr, &spdk_cmd, buf, buf_len, admin_complete, &cmd_sequence);
 	} else if(IO_CMD_TYPE == type) {
 
-		qid = sched_getcpu();
-		if(qid < 0 ) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-		qpair = nvme->qpairs[qid];
+		qid = kv_nvme_get_qid(nvme, -1);
+		qpair = (qid < 0) ? NULL : nvme->qpairs[qid];
 
 		if(!qpair) {
 			KVNVME_ERR("No Matching I/O Queue found for the Passed CPU Core ID");
@@ -156,7 +152,16 @@ kv_nvme_cpl_t *kv_nvme_submit_raw_cmd(uint64_t handle, kv_nvme_cmd_t cmd, void *
 			return NULL;
 		}
 
+		if(kv_qpair_sq_lock(qpair)) {
+			KVNVME_ERR("I/O Queue is acquired by another thread");
+
+			free(cpl);
+
+			LEAVE();
+			return NULL;
+		}
 		ret = spdk_nvme_ctrlr_cmd_io_raw(nvme->ctrlr, qpair, &spdk_cmd, buf, buf_len, io_complete, &cmd_sequence);
+		kv_qpair_sq_unlock(qpair);
 	} else {
 		KVNVME_ERR("Invalid Command Type: %d", type);
 
@@ -175,28 +180,12 @@ kv_nvme_cpl_t *kv_nvme_submit_raw_cmd(uint64_t handle, kv_nvme_cmd_t cmd, void *
 		return NULL;
 	}
 
-	while(!cmd_sequence.is_completed) {
-		if(ADMIN_CMD_TYPE == type) {
+	if(ADMIN_CMD_TYPE == type) {
+		while(!cmd_sequence.is_completed) {
 			spdk_nvme_ctrlr_process_admin_completions(nvme->ctrlr);
-		} else if((IO_CMD_TYPE == type)) {
-			if(qpair) {
-				spdk_nvme_qpair_process_completions(qpair, 0);
-			} else {
-				KVNVME_ERR("Invalid I/O Queue to Process Completions");
-
-				free(cpl);
-
-				LEAVE();
-				return NULL;
-			}
-		} else {
-			KVNVME_ERR("Invalid Command Type: %d", type);
-
-			free(cpl);
-
-			LEAVE();
-			return NULL;
 		}
+	} else {
+		kv_nvme_wait_for_completion(nvme, qid, &cmd_sequence);
 	}
 
 	KVNVME_DEBUG("Result of the Raw command: %d, Status of the Raw command: %d", cmd_sequence.result, cmd_sequence.status);
@@ -208,9 +197,141 @@ kv_nvme_cpl_t *kv_nvme_submit_raw_cmd(uint64_t handle, kv_nvme_cmd_t cmd, void *
 	return cpl;
 }
 
+/*
+ * Credit the tokens accumulated since *last_tick. Only whole tokens are credited and
+ * the leftover time stays in the bucket, so low rates are not rounded down to zero.
+ */
+static void _kv_nvme_qos_refill(uint64_t rate, int64_t burst, int64_t *tokens, uint64_t *last_tick, uint64_t now) {
+	uint64_t hz = spdk_get_ticks_hz();
+	uint64_t elapsed = now - *last_tick;
+	int64_t new_tokens;
+
+	if(!rate || *tokens >= burst) {
+		*last_tick = now;
+		return;
+	}
+
+	new_tokens = (int64_t)((double)spdk_min(elapsed, hz) * rate / hz);
+	if(!new_tokens) {
+		return;
+	}
+
+	*tokens += new_tokens;
+	if(*tokens >= burst || elapsed >= hz) {
+		*tokens = spdk_min(*tokens, burst);
+		*last_tick = now;
+	} else {
+		*last_tick += (uint64_t)((double)new_tokens * hz / rate);
+	}
+}
+
+/* Ticks until a bucket which is out of tokens holds a positive balance again */
+static uint64_t _kv_nvme_qos_refill_ticks(uint64_t rate, int64_t tokens, uint64_t last_tick, uint64_t now) {
+	uint64_t hz = spdk_get_ticks_hz();
+	uint64_t ticks = (uint64_t)((double)(1 - tokens) * hz / rate) + 1;
+	uint64_t elapsed = now - last_tick;
+
+	return (ticks > elapsed) ? ticks - elapsed : 1;
+}
+
+/*
+ * Admit an I/O of the given priority class, taking its tokens. Returns false when the
+ * class is over its rate limit, or when it is low priority and high priority I/O is active;
+ * *wait_ticks is then set to the time after which admission may succeed, if not NULL.
+ */
+static bool _kv_nvme_qos_admit(kv_nvme_t *nvme, uint8_t prio, uint32_t bytes, uint64_t *wait_ticks) {
+	kv_nvme_qos_t *qos = &nvme->qos;
+	kv_nvme_qos_class_t *class;
+	uint64_t now, last_high_tick, wait = 0;
+	bool admitted = true;
+
+	if(spdk_likely(!qos->enabled)) {
+		return true;
+	}
+
+	if(prio >= KV_IO_PRIO_MAX) {
+		prio = KV_IO_PRIO_NORMAL;
+	}
+
+	now = spdk_get_ticks();
+	if(prio == KV_IO_PRIO_HIGH) {
+		__atomic_store_n(&qos->last_high_tick, now, __ATOMIC_RELAXED);
+	} else if(prio == KV_IO_PRIO_LOW && qos->yield_ticks) {
+		last_high_tick = __atomic_load_n(&qos->last_high_tick, __ATOMIC_RELAXED);
+		if(now - last_high_tick < qos->yield_ticks) {
+			if(wait_ticks) {
+				*wait_ticks = last_high_tick + qos->yield_ticks - now;
+			}
+			return false;
+		}
+	}
+
+	class = &qos->classes[prio];
+	if(!class->iops_rate && !class->bps_rate) {
+		return true;
+	}
+
+	pthread_spin_lock(&class->lock);
+	_kv_nvme_qos_refill(class->iops_rate, class->io_burst, &class->io_tokens, &class->io_tick, now);
+	_kv_nvme_qos_refill(class->bps_rate, class->byte_burst, &class->byte_tokens, &class->byte_tick, now);
+
+	if(class->iops_rate && class->io_tokens <= 0) {
+		admitted = false;
+		wait = _kv_nvme_qos_refill_ticks(class->iops_rate, class->io_tokens, class->io_tick, now);
+	}
+	if(class->bps_rate && class->byte_tokens <= 0) {
+		admitted = false;
+		wait = spdk_max(wait, _kv_nvme_qos_refill_ticks(class->bps_rate, class->byte_tokens, class->byte_tick, now));
+	}
+	if(admitted) {
+		class->io_tokens -= (class->iops_rate ? 1 : 0);
+		class->byte_tokens -= (class->bps_rate ? bytes : 0);
+	}
+	pthread_spin_unlock(&class->lock);
+
+	if(!admitted && wait_ticks) {
+		*wait_ticks = wait;
+	}
+	return admitted;
+}
+
+/* Give back the tokens of an admitted I/O which could not be submitted */
+static void _kv_nvme_qos_refund(kv_nvme_t *nvme, uint8_t prio, uint32_t bytes) {
+	kv_nvme_qos_class_t *class;
+
+	if(spdk_likely(!nvme->qos.enabled)) {
+		return;
+	}
+
+	class = &nvme->qos.classes[(prio < KV_IO_PRIO_MAX) ? prio : KV_IO_PRIO_NORMAL];
+	if(!class->iops_rate && !class->bps_rate) {
+		return;
+	}
+
+	pthread_spin_lock(&class->lock);
+	class->io_tokens += (class->iops_rate ? 1 : 0);
+	class->byte_tokens += (class->bps_rate ? bytes : 0);
+	pthread_spin_unlock(&class->lock);
+}
+
+/*
+ * Sync I/Os have nowhere to be parked, so the submitting thread sleeps until its class
+ * is refilled or the high priority window closes, then tries again.
+ */
+static void _kv_nvme_qos_wait(kv_nvme_t *nvme, uint8_t prio, uint32_t bytes) {
+	uint64_t wait_ticks, wait_ns;
+	struct timespec ts;
+
+	while(!_kv_nvme_qos_admit(nvme, prio, bytes, &wait_ticks)) {
+		wait_ns = wait_ticks * 1000000000ULL / spdk_get_ticks_hz();
+		ts.tv_sec = wait_ns / 1000000000ULL;
+		ts.tv_nsec = spdk_max(wait_ns % 1000000000ULL, 1000ULL);
+		nanosleep(&ts, NULL);
+	}
+}
+
 int kv_nvme_append(uint64_t handle, int qid, kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_async = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -223,27 +344,15 @@ int kv_nvme_append(uint64_t handle, int qid, kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_async = ((nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_async) {
-		KVNVME_ERR("I/O Queue supports only Async, and Append command doesn't support Async");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
+	_kv_nvme_qos_wait(nvme, kv->param.io_priority, kv->value.length);
 	uint8_t is_store = 0;
 	ret = nvme->dev_ops.write(nvme, kv, qid, is_store);
 
@@ -253,7 +362,6 @@ int kv_nvme_append(uint64_t handle, int qid, kv_pair *kv) {
 
 int kv_nvme_write(uint64_t handle, int qid, kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_async = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -266,27 +374,15 @@ int kv_nvme_write(uint64_t handle, int qid, kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_async = ((nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_async) {
-		//KVNVME_ERR("I/O Queue supports only Async, Please do Async Write");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
+	_kv_nvme_qos_wait(nvme, kv->param.io_priority, kv->value.length);
 	uint8_t is_store = 1;
 	ret = nvme->dev_ops.write(nvme, kv, qid, is_store);
 
@@ -295,9 +391,214 @@ int kv_nvme_write(uint64_t handle, int qid, kv_pair *kv) {
 }
 
 
+#define KV_NVME_OVERFLOW_DRAIN_BATCH	(32)
+
+static int _kv_nvme_dispatch_async(kv_nvme_t *nvme, int qid, uint8_t opcode, void *arg) {
+	switch(opcode) {
+		case KV_NVME_OVERFLOW_WRITE:
+			return nvme->dev_ops.write_async(nvme, (kv_pair *)arg, qid);
+		case KV_NVME_OVERFLOW_READ:
+			return nvme->dev_ops.read_async(nvme, (kv_pair *)arg, qid);
+		case KV_NVME_OVERFLOW_DELETE:
+			if(nvme->dev_ops.delete_async) {
+				return nvme->dev_ops.delete_async(nvme, (const kv_pair *)arg, qid);
+			}
+			break;
+		case KV_NVME_OVERFLOW_EXIST:
+			if(nvme->dev_ops.exist_async) {
+				return nvme->dev_ops.exist_async(nvme, (const kv_pair *)arg, qid);
+			}
+			break;
+		case KV_NVME_OVERFLOW_ITERATE_READ:
+			return nvme->dev_ops.iterate_read_async(nvme, (kv_iterate *)arg, qid);
+		case KV_NVME_OVERFLOW_WRITE_ZEROES:
+			if(nvme->dev_ops.write_zeroes_async) {
+				return nvme->dev_ops.write_zeroes_async(nvme, (const kv_pair *)arg, qid);
+			}
+			break;
+		default:
+			break;
+	}
+
+	KVNVME_ERR("This function is not supported by the Device");
+	return KV_ERR_DD_UNSUPPORTED_CMD;
+}
+
+/*
+ * Fail an Async I/O which could not be resubmitted from the Overflow Queue
+ * through its own callback, as the submitter has already returned success.
+ */
+static void _kv_nvme_overflow_fail(kv_nvme_overflow_io_t *io, int status) {
+	if(io->opcode == KV_NVME_OVERFLOW_ITERATE_READ) {
+		kv_iterate *it = (kv_iterate *)io->arg;
+
+		if(it->kv.param.async_cb) {
+			it->kv.param.async_cb((kv_pair *)it, 0, status);
+		}
+	} else {
+		kv_pair *kv = (kv_pair *)io->arg;
+
+		if(kv->param.async_cb) {
+			kv->param.async_cb(kv, 0, status);
+		}
+	}
+}
+
+/* Priority class and transferred bytes of an Async I/O, for rate limiting */
+static void _kv_nvme_async_qos(uint8_t opcode, void *arg, uint8_t *prio, uint32_t *bytes) {
+	if(opcode == KV_NVME_OVERFLOW_ITERATE_READ) {
+		kv_iterate *it = (kv_iterate *)arg;
+
+		*prio = it->kv.param.io_priority;
+		*bytes = it->kv.value.length;
+	} else {
+		kv_pair *kv = (kv_pair *)arg;
+
+		*prio = kv->param.io_priority;
+		*bytes = (opcode == KV_NVME_OVERFLOW_WRITE || opcode == KV_NVME_OVERFLOW_READ) ? kv->value.length : 0;
+	}
+
+	if(*prio >= KV_IO_PRIO_MAX) {
+		*prio = KV_IO_PRIO_NORMAL;
+	}
+}
+
+/*
+ * Admit and submit an Async I/O. -ENOMEM is returned when the SQ has no free slot,
+ * -EBUSY when the I/O is throttled by its priority class; either way it gets parked.
+ */
+static int _kv_nvme_admit_and_dispatch(kv_nvme_t *nvme, int qid, uint8_t opcode, void *arg, uint8_t prio, uint32_t bytes) {
+	int ret;
+
+	if(spdk_unlikely(nvme->qos.enabled) && !_kv_nvme_qos_admit(nvme, prio, bytes, NULL)) {
+		return -EBUSY;
+	}
+
+	ret = _kv_nvme_dispatch_async(nvme, qid, opcode, arg);
+	if(spdk_unlikely(ret == -ENOMEM)) {
+		_kv_nvme_qos_refund(nvme, prio, bytes);
+	}
+
+	return ret;
+}
+
+/* Order in which the Overflow Queue rings are drained */
+static const uint8_t kv_nvme_overflow_order[KV_IO_PRIO_MAX] = {
+	KV_IO_PRIO_HIGH,
+	KV_IO_PRIO_NORMAL,
+	KV_IO_PRIO_LOW,
+};
+
+/* Whether I/Os of the class or of a higher one are parked, so a new I/O has to queue behind them */
+static bool _kv_nvme_overflow_blocked(kv_nvme_overflow_t *overflow, uint8_t prio) {
+	unsigned int i;
+
+	for(i = 0; i < KV_IO_PRIO_MAX; i++) {
+		if(overflow->rings[kv_nvme_overflow_order[i]].count) {
+			return true;
+		}
+		if(kv_nvme_overflow_order[i] == prio) {
+			break;
+		}
+	}
+	return false;
+}
+
+/*
+ * Submit an Async I/O, parking it in the Overflow Queue of the qpair when the SQ
+ * has no free slot or its priority class is throttled. I/Os of the same or a higher
+ * class already parked go first, so each class stays FIFO and lower classes never
+ * overtake higher ones. KV_ERR_QUEUE_FULL is returned once the Overflow Queue is full too.
+ */
+static int _kv_nvme_submit_async(kv_nvme_t *nvme, int qid, uint8_t opcode, void *arg) {
+	kv_nvme_overflow_t *overflow = &nvme->overflow[qid];
+	kv_nvme_overflow_ring_t *ring;
+	uint8_t prio;
+	uint32_t bytes;
+	int ret;
+
+	_kv_nvme_async_qos(opcode, arg, &prio, &bytes);
+
+	if(spdk_likely(!overflow->count) || !_kv_nvme_overflow_blocked(overflow, prio)) {
+		ret = _kv_nvme_admit_and_dispatch(nvme, qid, opcode, arg, prio, bytes);
+		if(spdk_likely(ret != -ENOMEM && ret != -EBUSY)) {
+			return ret;
+		}
+	}
+
+	if(!overflow->depth) {
+		return KV_ERR_QUEUE_FULL;
+	}
+
+	pthread_spin_lock(&overflow->lock);
+	if(overflow->count == overflow->depth) {
+		pthread_spin_unlock(&overflow->lock);
+		return KV_ERR_QUEUE_FULL;
+	}
+	ring = &overflow->rings[prio];
+	kv_nvme_overflow_io_t *io = &ring->ios[(ring->head + ring->count) % overflow->depth];
+	io->opcode = opcode;
+	io->arg = arg;
+	ring->count++;
+	overflow->count++;
+	pthread_spin_unlock(&overflow->lock);
+
+	/* a throttled I/O parked on an idle qpair submits nothing that would wake the CQ thread */
+	kv_qpair_cq_event_notify(nvme->qpairs[qid]);
+
+	return KV_SUCCESS;
+}
+
+/*
+ * Resubmit parked Async I/Os, higher classes first. A throttled class is skipped so it
+ * does not hold back the classes after it; a full SQ stops the drain.
+ */
+void kv_nvme_overflow_drain(kv_nvme_t *nvme, int qid) {
+	kv_nvme_overflow_t *overflow = &nvme->overflow[qid];
+	kv_nvme_overflow_io_t failed[KV_NVME_OVERFLOW_DRAIN_BATCH];
+	int failed_status[KV_NVME_OVERFLOW_DRAIN_BATCH];
+	unsigned int nr_failed = 0, nr_drained = 0, i;
+	uint8_t prio;
+	uint32_t bytes;
+	int ret = 0;
+
+	if(pthread_spin_trylock(&overflow->lock)) {
+		return;
+	}
+
+	for(i = 0; i < KV_IO_PRIO_MAX && ret != -ENOMEM; i++) {
+		kv_nvme_overflow_ring_t *ring = &overflow->rings[kv_nvme_overflow_order[i]];
+
+		while(ring->count && nr_drained < KV_NVME_OVERFLOW_DRAIN_BATCH) {
+			kv_nvme_overflow_io_t *io = &ring->ios[ring->head];
+
+			_kv_nvme_async_qos(io->opcode, io->arg, &prio, &bytes);
+			ret = _kv_nvme_admit_and_dispatch(nvme, qid, io->opcode, io->arg, prio, bytes);
+			if(ret == -ENOMEM || ret == -EBUSY) {
+				break;
+			}
+			if(ret) {
+				failed_status[nr_failed] = ret;
+				failed[nr_failed++] = *io;
+			}
+
+			ring->head = (ring->head + 1) % overflow->depth;
+			ring->count--;
+			overflow->count--;
+			nr_drained++;
+		}
+	}
+	pthread_spin_unlock(&overflow->lock);
+
+	/* Callbacks may submit again, so they run without the Overflow Queue lock */
+	for(i = 0; i < nr_failed; i++) {
+		KVNVME_ERR("Could not resubmit the Async I/O from the Overflow Queue, ret = %d", failed_status[i]);
+		_kv_nvme_overflow_fail(&failed[i], failed_status[i]);
+	}
+}
+
 int kv_nvme_write_async(uint64_t handle, int qid, kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_sync = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -310,28 +611,15 @@ int kv_nvme_write_async(uint64_t handle, int qid, kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync) {
-		//KVNVME_ERR("I/O Queue supports only Sync, Please do Sync Write");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
-	ret = nvme->dev_ops.write_async(nvme, kv, qid);
+	ret = _kv_nvme_submit_async(nvme, qid, KV_NVME_OVERFLOW_WRITE, kv);
 
 	LEAVE();
 	return ret;
@@ -339,7 +627,6 @@ int kv_nvme_write_async(uint64_t handle, int qid, kv_pair *kv) {
 
 int kv_nvme_read(uint64_t handle, int qid, kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_async = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -352,27 +639,15 @@ int kv_nvme_read(uint64_t handle, int qid, kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_async = ((nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_async) {
-		//KVNVME_ERR("I/O Queue supports only Async, Please do Async Read");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
+	_kv_nvme_qos_wait(nvme, kv->param.io_priority, kv->value.length);
 	ret = nvme->dev_ops.read(nvme, kv, qid);
 
 	LEAVE();
@@ -381,7 +656,6 @@ int kv_nvme_read(uint64_t handle, int qid, kv_pair *kv) {
 
 int kv_nvme_read_async(uint64_t handle, int qid, kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_sync = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -394,28 +668,15 @@ int kv_nvme_read_async(uint64_t handle, int qid, kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync) {
-		//KVNVME_ERR("I/O Queue supports only Sync, Please do Sync Read");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
-	ret = nvme->dev_ops.read_async(nvme, kv, qid);
+	ret = _kv_nvme_submit_async(nvme, qid, KV_NVME_OVERFLOW_READ, kv);
 
 	LEAVE();
 	return ret;
@@ -423,7 +684,6 @@ int kv_nvme_read_async(uint64_t handle, int qid, kv_pair *kv) {
 
 int kv_nvme_delete(uint64_t handle, int qid, const kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_async = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -436,28 +696,16 @@ int kv_nvme_delete(uint64_t handle, int qid, const kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_async = ((nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_async) {
-		//KVNVME_ERR("I/O Queue supports only Async, Please do Async Delete");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
 	if(nvme->dev_ops.delete) {
+		_kv_nvme_qos_wait(nvme, kv->param.io_priority, 0);
 		ret = nvme->dev_ops.delete(nvme, kv, qid);
 	} else {
 		KVNVME_ERR("This function is not supported by the Device");
@@ -471,7 +719,6 @@ int kv_nvme_delete(uint64_t handle, int qid, const kv_pair *kv) {
 
 int kv_nvme_delete_async(uint64_t handle, int qid, const kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_sync = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -484,29 +731,16 @@ int kv_nvme_delete_async(uint64_t handle, int qid, const kv_pair *kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync) {
-		//KVNVME_ERR("I/O Queue supports only Sync, Please do Sync Delete");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
 	if(nvme->dev_ops.delete_async) {
-		ret = nvme->dev_ops.delete_async(nvme, kv, qid);
+		ret = _kv_nvme_submit_async(nvme, qid, KV_NVME_OVERFLOW_DELETE, (void *)kv);
 	} else {
 		KVNVME_ERR("This function is not supported by the Device");
 
@@ -517,9 +751,8 @@ int kv_nvme_delete_async(uint64_t handle, int qid, const kv_pair *kv) {
 	return ret;
 }
 
-int kv_nvme_exist(uint64_t handle, int qid, const kv_pair* kv) {
+int kv_nvme_write_zeroes_async(uint64_t handle, int qid, const kv_pair *kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_async = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -532,28 +765,50 @@ int kv_nvme_exist(uint64_t handle, int qid, const kv_pair* kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
+		LEAVE();
+		return ret;
 	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
 
-	queue_is_async = ((nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_async) {
-		//KVNVME_ERR("I/O Queue supports only Async, Please do Async Delete");
+	if(nvme->dev_ops.write_zeroes_async) {
+		ret = _kv_nvme_submit_async(nvme, qid, KV_NVME_OVERFLOW_WRITE_ZEROES, (void *)kv);
+	} else {
+		KVNVME_ERR("This function is not supported by the Device");
 
+		ret = KV_ERR_DD_UNSUPPORTED_CMD;
+	}
+
+	LEAVE();
+	return ret;
+}
+
+int kv_nvme_exist(uint64_t handle, int qid, const kv_pair* kv) {
+	int ret = KV_ERR_DD_INVALID_PARAM;
+	kv_nvme_t *nvme = NULL;
+
+	ENTER();
+
+	if(!handle) {
+		KVNVME_ERR("Invalid handle passed");
+
+		LEAVE();
+		return ret;
+	}
+
+	nvme = (kv_nvme_t *)handle;
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
 	if(nvme->dev_ops.exist) {
+		_kv_nvme_qos_wait(nvme, kv->param.io_priority, 0);
 		ret = nvme->dev_ops.exist(nvme, kv, qid);
 	} else {
 		KVNVME_ERR("This function is not supported by the Device");
@@ -567,7 +822,6 @@ int kv_nvme_exist(uint64_t handle, int qid, const kv_pair* kv) {
 
 int kv_nvme_exist_async(uint64_t handle, int qid, const kv_pair* kv) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_sync = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -580,29 +834,16 @@ int kv_nvme_exist_async(uint64_t handle, int qid, const kv_pair* kv) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync) {
-		//KVNVME_ERR("I/O Queue supports only Async, Please do Async Delete");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
 	if(nvme->dev_ops.exist_async) {
-		ret = nvme->dev_ops.exist_async(nvme, kv, qid);
+		ret = _kv_nvme_submit_async(nvme, qid, KV_NVME_OVERFLOW_EXIST, (void *)kv);
 	} else {
 		KVNVME_ERR("This function is not supported by the Device");
 
@@ -640,10 +881,11 @@ uint32_t kv_nvme_iterate_open(uint64_t handle, uint8_t keyspace_id, uint32_t bit
 
 	nvme = (kv_nvme_t *)handle;
 
-	qid = sched_getcpu();
+	qid = kv_nvme_get_qid(nvme, -1);
 	if(qid < 0) {
-		KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-		qid = 0;
+		KVNVME_ERR("No Matching I/O Queue found for the current CPU Core ID");
+		LEAVE();
+		return ret;
 	}
  
         /* Convert bitmask and bit_pattern endian to big endian when cpu is little endian  */
@@ -651,6 +893,9 @@ uint32_t kv_nvme_iterate_open(uint64_t handle, uint8_t keyspace_id, uint32_t bit
 	prefix = htobe32(prefix);
 	if(nvme->dev_ops.iterate_open) {
 		iterator = nvme->dev_ops.iterate_open(nvme, keyspace_id, bitmask, prefix, iterate_type, qid);
+		if(iterator == (uint32_t)-ENOMEM) {
+			iterator = KV_ERR_QUEUE_FULL;
+		}
 		LEAVE();
 		return iterator;
 	} else {
@@ -678,14 +923,18 @@ int kv_nvme_iterate_close(uint64_t handle, const uint8_t iterator){
 
 	nvme = (kv_nvme_t *)handle;
 
-	qid = sched_getcpu();
+	qid = kv_nvme_get_qid(nvme, -1);
 	if(qid < 0) {
-		KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-		qid = 0;
+		KVNVME_ERR("No Matching I/O Queue found for the current CPU Core ID");
+		LEAVE();
+		return ret;
 	}
 
 	if(nvme->dev_ops.iterate_close) {
 		ret = nvme->dev_ops.iterate_close(nvme, iterator, qid);
+		if(ret == -ENOMEM) {
+			ret = KV_ERR_QUEUE_FULL;
+		}
 	} else {
 		KVNVME_ERR("This function is not supported by the Device");
 
@@ -698,7 +947,6 @@ int kv_nvme_iterate_close(uint64_t handle, const uint8_t iterator){
 
 int kv_nvme_iterate_read(uint64_t handle, int qid, kv_iterate* it){
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_async = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -711,27 +959,15 @@ int kv_nvme_iterate_read(uint64_t handle, int qid, kv_iterate* it){
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_async = ((nvme->io_queue_type[qid] == ASYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_async) {
-		//KVNVME_ERR("I/O Queue supports only Async, Please do Async Read");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
+	_kv_nvme_qos_wait(nvme, it->kv.param.io_priority, it->kv.value.length);
 	ret = nvme->dev_ops.iterate_read(nvme, it, qid);
 
 	LEAVE();
@@ -740,7 +976,6 @@ int kv_nvme_iterate_read(uint64_t handle, int qid, kv_iterate* it){
 
 int kv_nvme_iterate_read_async(uint64_t handle, int qid, kv_iterate* it) {
 	int ret = KV_ERR_DD_INVALID_PARAM;
-	unsigned int queue_is_sync = 0;
 	kv_nvme_t *nvme = NULL;
 
 	ENTER();
@@ -753,28 +988,15 @@ int kv_nvme_iterate_read_async(uint64_t handle, int qid, kv_iterate* it) {
 	}
 
 	nvme = (kv_nvme_t *)handle;
-	if(qid < 0){
-		qid = sched_getcpu();
-		if(qid < 0) {
-			KVNVME_WARN("Could not get the CPU Core ID, Using Default 0");
-			qid = 0;
-		}
-	}
-  if(qid >= MAX_CPU_CORES || !nvme->io_queue_type[qid]) {
-    KVNVME_ERR("Invalid qid: %d passed", qid);
-    LEAVE();
-    return ret;
-  }
-
-	queue_is_sync = ((nvme->io_queue_type[qid] == SYNC_IO_QUEUE) ? 1 : 0);
-	if(queue_is_sync) {
-		//KVNVME_ERR("I/O Queue supports only Sync, Please do Sync Read");
-
+	int core_id = qid;
+	qid = kv_nvme_get_qid(nvme, core_id);
+	if(qid < 0) {
+		KVNVME_ERR("Invalid qid: %d passed", core_id);
 		LEAVE();
-		return KV_ERR_DD_INVALID_QUEUE_TYPE;
+		return ret;
 	}
 
-	ret = nvme->dev_ops.iterate_read_async(nvme, it, qid);
+	ret = _kv_nvme_submit_async(nvme, qid, KV_NVME_OVERFLOW_ITERATE_READ, it);
 
 	LEAVE();
 	return ret;
@@ -1008,6 +1230,25 @@ uint64_t kv_nvme_get_num_sectors(uint64_t handle) {
 	return num_sectors;
 }
 
+bool kv_nvme_write_zeroes_supported(uint64_t handle) {
+	bool supported = false;
+	ENTER();
+
+	if(!handle){
+		KVNVME_ERR("Invalid handle passed");
+		LEAVE();
+		return supported;
+	}
+
+	kv_nvme_t *nvme = (kv_nvme_t *)handle;
+
+	supported = nvme->dev_ops.write_zeroes_async &&
+		    (spdk_nvme_ns_get_flags(nvme->ns) & SPDK_NVME_NS_WRITE_ZEROES_SUPPORTED);
+
+	LEAVE();
+	return supported;
+}
+
 uint16_t kv_nvme_get_io_queue_size(uint64_t handle) {
 	uint16_t queue_size = 0;
 
@@ -1044,7 +1285,8 @@ static uint16_t _kv_qd_operation(uint64_t handle, int qid, int qd_op){
 	}
 
 	kv_nvme_t* nvme = (kv_nvme_t *)handle;
-	struct spdk_nvme_qpair* qpair = nvme->qpairs[qid];
+	qid = kv_nvme_get_qid(nvme, qid);
+	struct spdk_nvme_qpair* qpair = (qid < 0) ? NULL : nvme->qpairs[qid];
 	if(!qpair) {
 		KVNVME_ERR("No Matching I/O Queue found for the Passed CPU Core ID");
 		LEAVE();
@@ -1052,7 +1294,10 @@ static uint16_t _kv_qd_operation(uint64_t handle, int qid, int qd_op){
 	}
 
 
-	pthread_spin_lock(&qpair->sq_lock);
+	if(kv_qpair_sq_lock(qpair)) {
+		LEAVE();
+		return qpair->current_qd;
+	}
 	switch(qd_op){
 		case INCREASE:
 			current_qd = ++qpair->current_qd;
@@ -1065,7 +1310,7 @@ static uint16_t _kv_qd_operation(uint64_t handle, int qid, int qd_op){
 			current_qd = qpair->current_qd;
 			break;
 	}
-	pthread_spin_unlock(&qpair->sq_lock);
+	kv_qpair_sq_unlock(qpair);
 
 	LEAVE();
 	return current_qd;
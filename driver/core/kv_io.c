@@ -32,12 +32,15 @@
  */
 
 #include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include "kv_driver.h"
 #include "kv_cmd.h"
 #include "lba_cmd.h"
+#include "spdk/thread.h"
 
 int32_t kv_nvme_process_all_cqs_thread(void *arg) {
-        unsigned int cpu_id = 0;
+        unsigned int cpu_id = 0, queue_id = 0;
         cpu_set_t cpuset;
         process_cq_thread_arg_t *pcq_arg = (process_cq_thread_arg_t *)arg;
         kv_nvme_t *nvme = (kv_nvme_t *)pcq_arg->nvme;
@@ -51,11 +54,19 @@ int32_t kv_nvme_process_all_cqs_thread(void *arg) {
 
         sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
 
+        kv_nvme_cq_event_init(pcq_arg, &nvme->stop_process_all_cqs);
+
         while(!nvme->stop_process_all_cqs) {
-                kv_nvme_process_completion((uint64_t)nvme);
-		usleep(1);
+                int32_t nr_completions = 0;
+                for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                        if(nvme->qpairs[queue_id]) {
+                                nr_completions += kv_nvme_poll_qpair(nvme, queue_id);
+                        }
+                }
+                kv_nvme_cq_event_idle(pcq_arg, nr_completions);
         }
 
+        kv_nvme_cq_event_fini(pcq_arg);
         free(arg);
 
         LEAVE();
@@ -63,7 +74,6 @@ int32_t kv_nvme_process_all_cqs_thread(void *arg) {
 }
 
 int32_t kv_nvme_process_cq_thread(void *arg) {
-	struct spdk_nvme_qpair *qpair = NULL;
         unsigned int queue_id = 0;
         cpu_set_t cpuset;
         process_cq_thread_arg_t *pcq_arg = (process_cq_thread_arg_t *)arg;
@@ -75,20 +85,514 @@ int32_t kv_nvme_process_cq_thread(void *arg) {
 
         sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
 
+        kv_nvme_cq_event_init(pcq_arg, &pcq_arg->nvme->stop_process_cq[pcq_arg->thread_id]);
+
         while(!pcq_arg->nvme->stop_process_cq[pcq_arg->thread_id]) {
+                int32_t nr_completions = 0;
                 for(queue_id = pcq_arg->async_qpair_start_index; queue_id < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); queue_id++)
                 {
-			qpair = pcq_arg->nvme->async_qpairs[queue_id];
-			pthread_spin_lock(&qpair->cq_lock);
-			spdk_nvme_qpair_process_completions(qpair, 0);
-			pthread_spin_unlock(&qpair->cq_lock);
+			nr_completions += kv_nvme_poll_qpair(pcq_arg->nvme, pcq_arg->nvme->async_qid[queue_id]);
                 }
-		usleep(1);
+		kv_nvme_cq_event_idle(pcq_arg, nr_completions);
         }
 
+        kv_nvme_cq_event_fini(pcq_arg);
         free(arg);
 
         LEAVE();
         return 0;
 }
 
+/*
+ * Event mode of the CQ threads. The controller's CQs run without interrupts, so a
+ * CQ thread keeps polling while any of its qpairs has a request in flight. Once they
+ * are all idle and the thread completed fewer than cq_event_iops I/Os per second over
+ * the last window, it sleeps on the eventfds of its qpairs until a submitter arms it.
+ */
+#define KV_CQ_EVENT_MAX_EVENTS 16
+
+void kv_nvme_cq_event_init(process_cq_thread_arg_t *pcq_arg, unsigned int *stop) {
+        kv_nvme_t *nvme = pcq_arg->nvme;
+        struct spdk_nvme_qpair *qpair = NULL;
+        struct epoll_event event;
+        unsigned int index = 0, qid = 0;
+        int event_fd = -1;
+
+        pcq_arg->stop = stop;
+        pcq_arg->epoll_fd = -1;
+        pcq_arg->event_mode = false;
+
+        if(!nvme->options->cq_event_iops) {
+                return;
+        }
+
+        pcq_arg->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if(pcq_arg->epoll_fd < 0) {
+                KVNVME_WARN("Could not create the epoll instance of CQ thread %u, polling only", pcq_arg->thread_id);
+                return;
+        }
+
+        for(index = pcq_arg->async_qpair_start_index; index < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); index++) {
+                qid = nvme->async_qid[index];
+                qpair = nvme->qpairs[qid];
+
+                event_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+                if(event_fd < 0) {
+                        break;
+                }
+
+                memset(&event, 0, sizeof(event));
+                event.events = EPOLLIN;
+                event.data.u32 = qid;
+                if(epoll_ctl(pcq_arg->epoll_fd, EPOLL_CTL_ADD, event_fd, &event)) {
+                        close(event_fd);
+                        event_fd = -1;
+                        break;
+                }
+
+                __atomic_store_n(&qpair->cq_event_fd, event_fd, __ATOMIC_RELEASE);
+        }
+
+        if(event_fd < 0) {
+                KVNVME_WARN("Could not set up the eventfds of CQ thread %u, polling only", pcq_arg->thread_id);
+                kv_nvme_cq_event_fini(pcq_arg);
+                return;
+        }
+
+        pcq_arg->event_threshold = spdk_max((uint64_t)nvme->options->cq_event_iops * KV_CQ_EVENT_RATE_MS / 1000, 1);
+        pcq_arg->nr_completions = 0;
+        pcq_arg->next_rate_tick = spdk_get_ticks() + KV_CQ_EVENT_RATE_MS * spdk_get_ticks_hz() / 1000;
+        pcq_arg->event_mode = true;
+
+        KVNVME_DEBUG("CQ thread %u sleeps while idle below %u IOPS", pcq_arg->thread_id, nvme->options->cq_event_iops);
+}
+
+void kv_nvme_cq_event_fini(process_cq_thread_arg_t *pcq_arg) {
+        kv_nvme_t *nvme = pcq_arg->nvme;
+        struct spdk_nvme_qpair *qpair = NULL;
+        unsigned int index = 0;
+        int event_fd = -1;
+
+        if(pcq_arg->epoll_fd < 0) {
+                return;
+        }
+
+        for(index = pcq_arg->async_qpair_start_index; index < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); index++) {
+                qpair = nvme->qpairs[nvme->async_qid[index]];
+                event_fd = qpair->cq_event_fd;
+                if(event_fd >= 0) {
+                        __atomic_store_n(&qpair->cq_event_fd, -1, __ATOMIC_RELEASE);
+                        close(event_fd);
+                }
+        }
+
+        close(pcq_arg->epoll_fd);
+        pcq_arg->epoll_fd = -1;
+        pcq_arg->event_mode = false;
+}
+
+/*
+ * A qpair acquired by an application thread is reaped by its owner, so it does not
+ * keep the CQ thread awake. I/Os parked in an Overflow Queue do, as only the poll
+ * resubmits them.
+ */
+static bool _kv_nvme_cq_event_busy(process_cq_thread_arg_t *pcq_arg) {
+        kv_nvme_t *nvme = pcq_arg->nvme;
+        struct spdk_nvme_qpair *qpair = NULL;
+        unsigned int index = 0;
+
+        if(__atomic_load_n(pcq_arg->stop, __ATOMIC_RELAXED) || nvme->nr_pending_aborts || nvme->abort_check_tick || nvme->reset_pending) {
+                return true;
+        }
+
+        for(index = pcq_arg->async_qpair_start_index; index < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); index++) {
+                qpair = nvme->qpairs[nvme->async_qid[index]];
+                if(__atomic_load_n(&qpair->owner, __ATOMIC_ACQUIRE) == 0 && spdk_nvme_qpair_get_num_active_reqs(qpair)) {
+                        return true;
+                }
+                if(__atomic_load_n(&nvme->overflow[nvme->async_qid[index]].count, __ATOMIC_RELAXED)) {
+                        return true;
+                }
+        }
+
+        return false;
+}
+
+/*
+ * Called by a CQ thread after every polling pass, with the completions it reaped.
+ */
+void kv_nvme_cq_event_idle(process_cq_thread_arg_t *pcq_arg, int32_t nr_completions) {
+        kv_nvme_t *nvme = pcq_arg->nvme;
+        struct epoll_event events[KV_CQ_EVENT_MAX_EVENTS];
+        unsigned int index = 0;
+        uint64_t now = 0, value = 0;
+        int nr_events = 0, i = 0;
+
+        if(pcq_arg->epoll_fd < 0) {
+                usleep(1);
+                return;
+        }
+
+        pcq_arg->nr_completions += nr_completions;
+        now = spdk_get_ticks();
+        if(now >= pcq_arg->next_rate_tick) {
+                bool event_mode = (pcq_arg->nr_completions < pcq_arg->event_threshold);
+                if(event_mode != pcq_arg->event_mode) {
+                        KVNVME_DEBUG("CQ thread %u switches to %s mode at %lu completions per %u ms", pcq_arg->thread_id,
+                                        event_mode ? "event" : "polling", pcq_arg->nr_completions, KV_CQ_EVENT_RATE_MS);
+                }
+                pcq_arg->event_mode = event_mode;
+                pcq_arg->nr_completions = 0;
+                pcq_arg->next_rate_tick = now + KV_CQ_EVENT_RATE_MS * spdk_get_ticks_hz() / 1000;
+        }
+
+        if(!pcq_arg->event_mode || nr_completions) {
+                usleep(1);
+                return;
+        }
+
+        for(index = pcq_arg->async_qpair_start_index; index < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); index++) {
+                __atomic_store_n(&nvme->qpairs[nvme->async_qid[index]]->cq_event_armed, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        if(_kv_nvme_cq_event_busy(pcq_arg)) {
+                usleep(1);
+        } else {
+                nr_events = epoll_wait(pcq_arg->epoll_fd, events, KV_CQ_EVENT_MAX_EVENTS, KV_CQ_EVENT_MAX_SLEEP_MS);
+                for(i = 0; i < nr_events; i++) {
+                        if(read(nvme->qpairs[events[i].data.u32]->cq_event_fd, &value, sizeof(value)) < 0) {
+                                KVNVME_DEBUG("Spurious wakeup of CQ thread %u", pcq_arg->thread_id);
+                        }
+                }
+        }
+
+        for(index = pcq_arg->async_qpair_start_index; index < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); index++) {
+                __atomic_store_n(&nvme->qpairs[nvme->async_qid[index]]->cq_event_armed, 0, __ATOMIC_RELAXED);
+        }
+}
+
+
+/*
+ * Shared completion reactor. Instead of CQ threads of every device, a set of poller
+ * threads reaps the qpairs of all the devices registered with it. A qpair belongs to
+ * one poller at a time: it is placed on the poller with the fewest qpairs, and moved
+ * from the busiest to the idlest poller when their completion loads drift apart.
+ */
+static struct {
+        /** Poller threads, one per CPU */
+        kv_reactor_poller_t *pollers;
+        unsigned int nr_pollers;
+        /** Serializes starting, stopping, device registration and rebalancing */
+        pthread_mutex_t lock;
+        /** Rebalance period, and tick of the next rebalance */
+        uint64_t rebalance_ticks;
+        uint64_t next_rebalance_tick;
+} g_reactor = {
+        .lock = PTHREAD_MUTEX_INITIALIZER,
+};
+
+/* Caller holds poller->lock */
+static int _kv_reactor_poller_add(kv_reactor_poller_t *poller, kv_nvme_t *nvme, int qid, uint64_t nr_completions) {
+        kv_reactor_qpair_t *qpairs;
+        unsigned int max_qpairs;
+
+        if(poller->nr_qpairs == poller->max_qpairs) {
+                max_qpairs = poller->max_qpairs ? poller->max_qpairs * 2 : 16;
+                qpairs = realloc(poller->qpairs, max_qpairs * sizeof(kv_reactor_qpair_t));
+                if(!qpairs) {
+                        return KV_ERR_DD_NO_AVAILABLE_RESOURCE;
+                }
+                poller->qpairs = qpairs;
+                poller->max_qpairs = max_qpairs;
+        }
+
+        poller->qpairs[poller->nr_qpairs].nvme = nvme;
+        poller->qpairs[poller->nr_qpairs].qid = qid;
+        poller->qpairs[poller->nr_qpairs].nr_completions = nr_completions;
+        poller->nr_qpairs++;
+
+        return KV_SUCCESS;
+}
+
+/*
+ * Move one qpair from the busiest poller to the idlest one when the busiest reaped
+ * over twice as many completions. The qpair moved is the busiest one that does not
+ * overshoot, i.e. carries at most half of the difference. Loads decay by half every
+ * period so the placement follows the recent load.
+ */
+static void _kv_reactor_rebalance(void) {
+        kv_reactor_poller_t *poller, *busiest = NULL, *idlest = NULL;
+        uint64_t load, max_load = 0, min_load = UINT64_MAX, best = 0;
+        unsigned int i, j, victim = 0;
+
+        if(pthread_mutex_trylock(&g_reactor.lock)) {
+                return;
+        }
+
+        for(i = 0; i < g_reactor.nr_pollers; i++) {
+                poller = &g_reactor.pollers[i];
+                load = 0;
+
+                pthread_spin_lock(&poller->lock);
+                for(j = 0; j < poller->nr_qpairs; j++) {
+                        load += poller->qpairs[j].nr_completions;
+                }
+                pthread_spin_unlock(&poller->lock);
+
+                if(!busiest || load > max_load) {
+                        busiest = poller;
+                        max_load = load;
+                }
+                if(!idlest || load < min_load) {
+                        idlest = poller;
+                        min_load = load;
+                }
+        }
+
+        if(busiest && busiest != idlest && max_load > 2 * min_load) {
+                kv_reactor_poller_t *first = (busiest < idlest) ? busiest : idlest;
+                kv_reactor_poller_t *second = (busiest < idlest) ? idlest : busiest;
+
+                pthread_spin_lock(&first->lock);
+                pthread_spin_lock(&second->lock);
+
+                for(j = 0; busiest->nr_qpairs > 1 && j < busiest->nr_qpairs; j++) {
+                        load = busiest->qpairs[j].nr_completions;
+                        if(load > best && load <= (max_load - min_load) / 2) {
+                                best = load;
+                                victim = j;
+                        }
+                }
+
+                if(best && _kv_reactor_poller_add(idlest, busiest->qpairs[victim].nvme, busiest->qpairs[victim].qid, best) == KV_SUCCESS) {
+                        KVNVME_DEBUG("Reactor moved qid %d from CPU %u to CPU %u", busiest->qpairs[victim].qid, busiest->cpu_id, idlest->cpu_id);
+                        busiest->qpairs[victim] = busiest->qpairs[--busiest->nr_qpairs];
+                }
+
+                pthread_spin_unlock(&second->lock);
+                pthread_spin_unlock(&first->lock);
+        }
+
+        for(i = 0; i < g_reactor.nr_pollers; i++) {
+                poller = &g_reactor.pollers[i];
+
+                pthread_spin_lock(&poller->lock);
+                for(j = 0; j < poller->nr_qpairs; j++) {
+                        poller->qpairs[j].nr_completions /= 2;
+                }
+                pthread_spin_unlock(&poller->lock);
+        }
+
+        pthread_mutex_unlock(&g_reactor.lock);
+}
+
+int32_t kv_reactor_poller_thread(void *arg) {
+        kv_reactor_poller_t *poller = (kv_reactor_poller_t *)arg;
+        kv_reactor_qpair_t *entry;
+        bool rebalancer = (poller == &g_reactor.pollers[0]);
+        unsigned int i, idle_us = 0;
+        uint64_t reaped;
+        int32_t nr_completions;
+        cpu_set_t cpuset;
+
+        ENTER();
+        if (get_has_spdk_app_thread()) {
+            check_fini_spdk_threadlib_init();
+            spdk_set_thread(spdk_thread_create("kv_reactor", NULL));
+        }
+
+        CPU_ZERO(&cpuset);
+        CPU_SET(poller->cpu_id, &cpuset);
+
+        sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
+
+        while(!poller->stop) {
+                reaped = 0;
+
+                pthread_spin_lock(&poller->lock);
+                for(i = 0; i < poller->nr_qpairs; i++) {
+                        entry = &poller->qpairs[i];
+                        nr_completions = kv_nvme_poll_qpair(entry->nvme, entry->qid);
+                        entry->nr_completions += nr_completions;
+                        reaped += nr_completions;
+                }
+                pthread_spin_unlock(&poller->lock);
+
+                if(rebalancer && g_reactor.nr_pollers > 1 && spdk_get_ticks() >= g_reactor.next_rebalance_tick) {
+                        _kv_reactor_rebalance();
+                        g_reactor.next_rebalance_tick = spdk_get_ticks() + g_reactor.rebalance_ticks;
+                }
+
+                /* Idle pollers back off, so the CPU spent polling follows the load rather than the number of qpairs */
+                if(reaped) {
+                        idle_us = 0;
+                } else {
+                        idle_us = idle_us ? min(idle_us * 2, KV_REACTOR_MAX_IDLE_US) : 1;
+                        usleep(idle_us);
+                }
+        }
+
+        LEAVE();
+        return 0;
+}
+
+int kv_nvme_reactor_start(const cpu_set_t *cpus) {
+        kv_reactor_poller_t *pollers;
+        unsigned int cpu, nr_pollers = 0, i;
+        int ret = KV_SUCCESS;
+
+        ENTER();
+
+        if(!cpus || !CPU_COUNT(cpus)) {
+                KVNVME_ERR("Invalid CPUs passed for the completion reactor");
+                LEAVE();
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        pthread_mutex_lock(&g_reactor.lock);
+        if(g_reactor.nr_pollers) {
+                KVNVME_ERR("Completion reactor is already running");
+                pthread_mutex_unlock(&g_reactor.lock);
+                LEAVE();
+                return KV_ERR_DD_INVALID_PARAM;
+        }
+
+        pollers = calloc(CPU_COUNT(cpus), sizeof(kv_reactor_poller_t));
+        if(!pollers) {
+                pthread_mutex_unlock(&g_reactor.lock);
+                LEAVE();
+                return KV_ERR_DD_NO_AVAILABLE_RESOURCE;
+        }
+
+        g_reactor.pollers = pollers;
+        g_reactor.rebalance_ticks = spdk_get_ticks_hz() * KV_REACTOR_REBALANCE_MS / 1000;
+        g_reactor.next_rebalance_tick = spdk_get_ticks() + g_reactor.rebalance_ticks;
+
+        for(cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+                if(!CPU_ISSET(cpu, cpus)) {
+                        continue;
+                }
+
+                pollers[nr_pollers].cpu_id = cpu;
+                pthread_spin_init(&pollers[nr_pollers].lock, 0);
+
+                ret = pthread_create(&pollers[nr_pollers].thread, NULL, (void *)&kv_reactor_poller_thread, &pollers[nr_pollers]);
+                if(ret) {
+                        KVNVME_ERR("Could not create the completion reactor poller for the CPU Core ID: %u", cpu);
+                        pthread_spin_destroy(&pollers[nr_pollers].lock);
+                        break;
+                }
+                pthread_setname_np(pollers[nr_pollers].thread, "kv_reactor");
+                nr_pollers++;
+        }
+
+        if(ret) {
+                for(i = 0; i < nr_pollers; i++) {
+                        pollers[i].stop = 1;
+                        pthread_join(pollers[i].thread, NULL);
+                        pthread_spin_destroy(&pollers[i].lock);
+                }
+                free(pollers);
+                g_reactor.pollers = NULL;
+
+                pthread_mutex_unlock(&g_reactor.lock);
+                LEAVE();
+                return KV_ERR_DD_NO_AVAILABLE_RESOURCE;
+        }
+
+        g_reactor.nr_pollers = nr_pollers;
+        pthread_mutex_unlock(&g_reactor.lock);
+
+        KVNVME_DEBUG("Completion reactor started with %u pollers", nr_pollers);
+
+        LEAVE();
+        return KV_SUCCESS;
+}
+
+int kv_nvme_reactor_stop(void) {
+        kv_reactor_poller_t *poller;
+        unsigned int i;
+
+        ENTER();
+
+        pthread_mutex_lock(&g_reactor.lock);
+        for(i = 0; i < g_reactor.nr_pollers; i++) {
+                poller = &g_reactor.pollers[i];
+
+                poller->stop = 1;
+                pthread_join(poller->thread, NULL);
+
+                if(poller->nr_qpairs) {
+                        KVNVME_WARN("Completion reactor stopped with %u qpairs registered on the CPU Core ID: %u", poller->nr_qpairs, poller->cpu_id);
+                }
+                free(poller->qpairs);
+                pthread_spin_destroy(&poller->lock);
+        }
+
+        free(g_reactor.pollers);
+        g_reactor.pollers = NULL;
+        g_reactor.nr_pollers = 0;
+        pthread_mutex_unlock(&g_reactor.lock);
+
+        LEAVE();
+        return KV_SUCCESS;
+}
+
+void kv_nvme_reactor_remove_device(kv_nvme_t *nvme) {
+        kv_reactor_poller_t *poller;
+        unsigned int i, j, nr_qpairs;
+
+        pthread_mutex_lock(&g_reactor.lock);
+        for(i = 0; i < g_reactor.nr_pollers; i++) {
+                poller = &g_reactor.pollers[i];
+
+                pthread_spin_lock(&poller->lock);
+                for(j = 0, nr_qpairs = 0; j < poller->nr_qpairs; j++) {
+                        if(poller->qpairs[j].nvme != nvme) {
+                                poller->qpairs[nr_qpairs++] = poller->qpairs[j];
+                        }
+                }
+                poller->nr_qpairs = nr_qpairs;
+                pthread_spin_unlock(&poller->lock);
+        }
+        pthread_mutex_unlock(&g_reactor.lock);
+}
+
+/*
+ * Hand the qpairs of a device over to the completion reactor, if it is running.
+ * Returns KV_SUCCESS if the device needs no CQ threads of its own.
+ */
+int kv_nvme_reactor_add_device(kv_nvme_t *nvme) {
+        kv_reactor_poller_t *poller, *target;
+        unsigned int qid, i;
+        int ret = KV_SUCCESS;
+
+        pthread_mutex_lock(&g_reactor.lock);
+        if(!g_reactor.nr_pollers) {
+                pthread_mutex_unlock(&g_reactor.lock);
+                return KV_ERR_DD_NO_AVAILABLE_RESOURCE;
+        }
+
+        for(qid = 0; qid < nvme->nr_qpairs && ret == KV_SUCCESS; qid++) {
+                target = &g_reactor.pollers[0];
+                for(i = 1; i < g_reactor.nr_pollers; i++) {
+                        poller = &g_reactor.pollers[i];
+                        if(poller->nr_qpairs < target->nr_qpairs) {
+                                target = poller;
+                        }
+                }
+
+                pthread_spin_lock(&target->lock);
+                ret = _kv_reactor_poller_add(target, nvme, qid, 0);
+                pthread_spin_unlock(&target->lock);
+        }
+        pthread_mutex_unlock(&g_reactor.lock);
+
+        if(ret) {
+                KVNVME_WARN("Could not register the I/O Queues with the completion reactor, Creating CQ threads of the device");
+                kv_nvme_reactor_remove_device(nvme);
+        }
+
+        return ret;
+}
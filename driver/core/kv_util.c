@@ -95,6 +95,149 @@ void kv_free(void *ptr) {
 	spdk_dma_free(ptr);
 }
 
+int kv_mem_register(void *addr, unsigned long long size) {
+	int rc = spdk_mem_register(addr, size);
+	if(rc) {
+		KVNVME_ERR("Could not register memory %p of size: %lld bytes (rc=%d)", addr, size, rc);
+		return KV_ERR_DD_INVALID_PARAM;
+	}
+	return KV_SUCCESS;
+}
+
+bool kv_iommu_is_enabled(void) {
+	return spdk_iommu_is_enabled();
+}
+
+int kv_mem_unregister(void *addr, unsigned long long size) {
+	int rc = spdk_mem_unregister(addr, size);
+	if(rc) {
+		KVNVME_ERR("Could not unregister memory %p of size: %lld bytes (rc=%d)", addr, size, rc);
+		return KV_ERR_DD_INVALID_PARAM;
+	}
+	return KV_SUCCESS;
+}
+
+int kv_cpu_list_parse(const char *cpu_list, cpu_set_t *cpus) {
+	const char *p = cpu_list;
+	char *end = NULL;
+	unsigned long first, last, cpu;
+
+	CPU_ZERO(cpus);
+	if(!cpu_list) {
+		return KV_ERR_DD_INVALID_PARAM;
+	}
+
+	while(*p) {
+		while(*p == ' ' || *p == ',') {
+			p++;
+		}
+		if(!*p) {
+			break;
+		}
+
+		first = strtoul(p, &end, 10);
+		if(end == p) {
+			goto invalid;
+		}
+		last = first;
+		p = end;
+		if(*p == '-') {
+			p++;
+			last = strtoul(p, &end, 10);
+			if(end == p || last < first) {
+				goto invalid;
+			}
+			p = end;
+		}
+		if(last >= CPU_SETSIZE) {
+			goto invalid;
+		}
+		for(cpu = first; cpu <= last; cpu++) {
+			CPU_SET(cpu, cpus);
+		}
+		if(*p && *p != ',' && *p != ' ') {
+			goto invalid;
+		}
+	}
+
+	return KV_SUCCESS;
+
+invalid:
+	KVNVME_ERR("Invalid CPU list: %s", cpu_list);
+	CPU_ZERO(cpus);
+	return KV_ERR_DD_INVALID_PARAM;
+}
+
+int kv_cpu_list_format(const cpu_set_t *cpus, char *buf, size_t len) {
+	size_t off = 0;
+	int cpu, first = -1, n;
+
+	if(!buf || !len) {
+		return KV_ERR_DD_INVALID_PARAM;
+	}
+	buf[0] = '\0';
+
+	for(cpu = 0; cpu <= CPU_SETSIZE; cpu++) {
+		if(cpu < CPU_SETSIZE && CPU_ISSET(cpu, cpus)) {
+			if(first < 0) {
+				first = cpu;
+			}
+			continue;
+		}
+		if(first < 0) {
+			continue;
+		}
+
+		if(first == cpu - 1) {
+			n = snprintf(buf + off, len - off, "%s%d", off ? "," : "", first);
+		} else {
+			n = snprintf(buf + off, len - off, "%s%d-%d", off ? "," : "", first, cpu - 1);
+		}
+		if(n < 0 || (size_t)n >= len - off) {
+			return KV_ERR_DD_INVALID_PARAM;
+		}
+		off += n;
+		first = -1;
+	}
+
+	return KV_SUCCESS;
+}
+
+static void _kv_cpu_mask_to_set(uint64_t mask, cpu_set_t *cpus) {
+	int cpu;
+
+	CPU_ZERO(cpus);
+	for(cpu = 0; cpu < MAX_CPU_CORES; cpu++) {
+		if(mask & (1ULL << cpu)) {
+			CPU_SET(cpu, cpus);
+		}
+	}
+}
+
+void kv_nvme_get_io_cpus(const kv_nvme_io_options *options, cpu_set_t *io_cpus, cpu_set_t *sync_cpus, cpu_set_t *cq_cpus) {
+	if(io_cpus) {
+		if(options->core_list[0] == '\0' || kv_cpu_list_parse(options->core_list, io_cpus) != KV_SUCCESS) {
+			_kv_cpu_mask_to_set(options->core_mask, io_cpus);
+		}
+	}
+
+	/* A core list replaces the masks as a whole, as set core_mask does for sync_mask */
+	if(sync_cpus) {
+		if(options->core_list[0] != '\0') {
+			if(options->sync_core_list[0] == '\0' || kv_cpu_list_parse(options->sync_core_list, sync_cpus) != KV_SUCCESS) {
+				CPU_ZERO(sync_cpus);
+			}
+		} else {
+			_kv_cpu_mask_to_set(options->sync_mask, sync_cpus);
+		}
+	}
+
+	if(cq_cpus) {
+		if(options->cq_core_list[0] == '\0' || kv_cpu_list_parse(options->cq_core_list, cq_cpus) != KV_SUCCESS) {
+			_kv_cpu_mask_to_set(options->cq_thread_mask, cq_cpus);
+		}
+	}
+}
 
 void kv_nvme_sdk_info(void){
         fprintf(stderr, "KV SDK info: buildtime=%s, hash=%s, os=%s, kernel=%s, processor=%s dpdk_version=%s spdk_version=%s\n",
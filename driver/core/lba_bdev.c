@@ -68,6 +68,7 @@ struct nvme_ctrlr {
 struct nvme_bdev {
 	struct spdk_bdev	disk;
 	struct nvme_ctrlr	*nvme_ctrlr;
+	bool			write_zeroes;
 
 	TAILQ_ENTRY(nvme_bdev)	link;
 };
@@ -81,6 +82,11 @@ struct nvme_bdev_io {
 	kv_pair		kv;
 	struct iovec	*iov;
 	int 		direction;
+
+	/* write zeroes range still to be submitted, in commands of at most 64K blocks */
+	int		qid;
+	uint64_t	zeroes_offset;
+	uint64_t	zeroes_remaining;
 };
 
 enum data_direction {
@@ -145,8 +151,10 @@ static int bdev_nvme_flush(struct nvme_bdev *nbdev, struct nvme_bdev_io *bio,
 	return 0;
 }
 
-static bool bdev_nvme_io_type_supported(void __attribute__((__unused__)) *ctx, enum spdk_bdev_io_type io_type)
+static bool bdev_nvme_io_type_supported(void *ctx, enum spdk_bdev_io_type io_type)
 {
+	struct nvme_bdev *nbdev = ctx;
+
 	switch (io_type) {
 	case SPDK_BDEV_IO_TYPE_READ:
 	case SPDK_BDEV_IO_TYPE_WRITE:
@@ -155,6 +163,10 @@ static bool bdev_nvme_io_type_supported(void __attribute__((__unused__)) *ctx, e
 	case SPDK_BDEV_IO_TYPE_UNMAP:
 		return true;
 
+	/* Otherwise the bdev layer writes a zero buffer */
+	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
+		return nbdev->write_zeroes;
+
 	default:
 		return false;
 	}
@@ -224,6 +236,11 @@ static int bdev_nvme_unmap(struct nvme_bdev *nbdev, struct spdk_io_channel *ch,
                 uint64_t offset_blocks,
                 uint64_t num_blocks);
 
+static int bdev_nvme_write_zeroes(struct nvme_bdev *nbdev, struct spdk_io_channel *ch,
+		struct nvme_bdev_io *bio,
+		uint64_t offset_blocks,
+		uint64_t num_blocks);
+
 static void bdev_nvme_get_buf_cb(struct spdk_io_channel *ch, struct spdk_bdev_io *bdev_io,
 			bool success)
 {
@@ -269,7 +286,7 @@ static int _bdev_nvme_submit_request(struct spdk_io_channel *ch, struct spdk_bde
 					bdev_io->u.bdev.offset_blocks);
 
 	case SPDK_BDEV_IO_TYPE_WRITE_ZEROES:
-		return bdev_nvme_unmap((struct nvme_bdev *)bdev_io->bdev->ctxt,
+		return bdev_nvme_write_zeroes((struct nvme_bdev *)bdev_io->bdev->ctxt,
 				       ch,
 				       (struct nvme_bdev_io *)bdev_io->driver_ctx,
 				       bdev_io->u.bdev.offset_blocks,
@@ -335,6 +352,7 @@ static void nvme_ctrlr_create_bdevs(struct nvme_ctrlr *nvme_ctrlr) {
 	bdev->disk.write_cache = 0;
 	bdev->disk.blocklen = kv_nvme_get_sector_size(handle);
 	bdev->disk.blockcnt = kv_nvme_get_num_sectors(handle);
+	bdev->write_zeroes = kv_nvme_write_zeroes_supported(handle);
 	bdev->disk.ctxt = bdev;
 	bdev->disk.fn_table = &nvmelib_fn_table;
 	bdev->disk.module = &bdev_mpdk_if;
@@ -474,6 +492,77 @@ static int bdev_nvme_unmap(struct nvme_bdev *bdev, struct spdk_io_channel *ch,
 	return rc;
 }
 
+/* Submit the next command of a write zeroes request, the key holds its first block */
+static int bdev_nvme_write_zeroes_next(struct nvme_bdev *bdev, struct nvme_bdev_io *bio)
+{
+	uint64_t num_blocks = spdk_min(bio->zeroes_remaining, KV_NVME_WRITE_ZEROES_MAX_BLOCKS);
+
+	*(uint64_t*)(bio->kv.key.key) = bio->zeroes_offset;
+	bio->kv.value.length = num_blocks;
+
+	bio->zeroes_offset += num_blocks;
+	bio->zeroes_remaining -= num_blocks;
+
+	return kv_nvme_write_zeroes_async(bdev->nvme_ctrlr->handle, bio->qid, &bio->kv);
+}
+
+static void bdev_nvme_write_zeroes_done(void *ref, unsigned int sct, unsigned int sc)
+{
+	struct nvme_bdev_io *bio = ((kv_pair *)ref)->param.private_data;
+	struct spdk_bdev_io *bdev_io = spdk_bdev_io_from_ctx(bio);
+	int rc;
+
+	if (sct == 0 && sc == 0 && bio->zeroes_remaining) {
+		rc = bdev_nvme_write_zeroes_next((struct nvme_bdev *)bdev_io->bdev->ctxt, bio);
+		if (rc == 0) {
+			return;
+		}
+		SPDK_ERRLOG("write zeroes failed: rc = %d\n", rc);
+		spdk_free(bio->kv.key.key);
+		spdk_bdev_io_complete(bdev_io, SPDK_BDEV_IO_STATUS_FAILED);
+		return;
+	}
+
+	spdk_free(bio->kv.key.key);
+	spdk_bdev_io_complete_nvme_status(bdev_io, 0, sct, sc);
+}
+
+static int bdev_nvme_write_zeroes(struct nvme_bdev *bdev, struct spdk_io_channel *ch,
+		struct nvme_bdev_io *bio,
+		uint64_t offset_blocks,
+		uint64_t num_blocks)
+{
+	int rc = 0;
+	uint32_t key_length = 16;
+
+	bio->kv.key.key = spdk_dma_zmalloc(key_length, 0, NULL);
+	if(!bio->kv.key.key) {
+		SPDK_ERRLOG("Memory not available for Key\n");
+		return -ENOMEM;
+	}
+	bio->kv.key.length = key_length;
+
+	bio->kv.value.value = NULL;
+	bio->kv.param.async_cb = bdev_nvme_write_zeroes_done;
+	bio->kv.param.private_data = bio;
+
+	bio->qid = ch->channel_id;
+	if(bio->qid < 0) {
+		SPDK_WARNLOG("Could not get the CPU Core ID, Using Default 0");
+		bio->qid = 0;
+	}
+	bio->zeroes_offset = offset_blocks;
+	bio->zeroes_remaining = num_blocks;
+
+	rc = bdev_nvme_write_zeroes_next(bdev, bio);
+
+	if (rc != 0) {
+		spdk_free(bio->kv.key.key);
+	}
+
+	return rc;
+}
+
 static void
 bdev_nvme_get_spdk_running_config(FILE *fp)
 {
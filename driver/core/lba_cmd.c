@@ -41,10 +41,10 @@ static void _lba_io_complete(void *arg, const struct spdk_nvme_cpl *completion)
 
         io_sequence = (nvme_cmd_sequence_t *)arg;
 
-        io_sequence->status = completion->status.sc;
+        io_sequence->status = kv_nvme_cpl_status(completion);
         io_sequence->result = completion->cdw0;
 
-        io_sequence->is_completed = 1;
+        kv_nvme_complete_sequence(io_sequence);
 
         KVNVME_DEBUG("Status of the I/O: %d, Result of the I/O: %d", io_sequence->status, io_sequence->result);
 
@@ -59,7 +59,7 @@ static void _lba_async_io_complete(void *arg, const struct spdk_nvme_cpl *comple
 
         kv = (kv_pair *)arg;
 
-        status = completion->status.sc;
+        status = kv_nvme_cpl_status(completion);
         result = completion->status.sct;
 
         KVNVME_DEBUG("Status of the Async I/O: %d, Result of the Async I/O: %d, kv->key.key: %s", status, result, (char *)kv->key.key);
@@ -106,20 +106,22 @@ int _lba_nvme_write(kv_nvme_t *nvme, kv_pair *kv, int core_id, uint8_t is_store)
         KVNVME_DEBUG("Complete Key ID: %s, Dissected Key ID: %s, LBA Offset: 0x%llx", key_id, sub_key_id, (unsigned long long)lba);
 
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_ns_cmd_write(nvme->ns, qpair, buffer, lba, (kv->value.length / nvme->sector_size), _lba_io_complete, &io_sequence, 0);
 
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Write on the LBA Type SSD");
                 LEAVE();
                 return ret;
         }
 
-        while(!io_sequence.is_completed) {
-                spdk_nvme_qpair_process_completions(qpair, 0);
-        }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, core_id, &io_sequence);
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -159,9 +161,13 @@ int _lba_nvme_write_async(kv_nvme_t *nvme, kv_pair *kv, int core_id) {
 
         KVNVME_DEBUG("Complete Key ID: %s, Dissected Key ID: %s, LBA Offset: 0x%llx", key_id, sub_key_id, (unsigned long long)lba);
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_ns_cmd_write(nvme->ns, qpair, buffer, lba, (kv->value.length / nvme->sector_size), _lba_async_io_complete, (void *)kv, 0);
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
         LEAVE();
         return ret;
 }
@@ -199,20 +205,22 @@ int _lba_nvme_read(kv_nvme_t *nvme, kv_pair* kv, int core_id) {
 
         KVNVME_DEBUG("Complete Key ID: %s, Dissected Key ID: %s, LBA Offset: 0x%llx", key_id, sub_key_id, (unsigned long long)lba);
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_ns_cmd_read(nvme->ns, qpair, buffer, lba, (kv->value.length / nvme->sector_size), _lba_io_complete, &io_sequence, 0);
 
         if(ret) {
-                pthread_spin_unlock(&qpair->sq_lock);
+                kv_qpair_sq_unlock(qpair);
                 KVNVME_ERR("Error in Performing Read on the LBA Type SSD");
                 LEAVE();
                 return ret;
         }
 
-        while(!io_sequence.is_completed) {
-                spdk_nvme_qpair_process_completions(qpair, 0);
-        }
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
+        kv_nvme_wait_for_completion(nvme, core_id, &io_sequence);
 
         KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -253,9 +261,13 @@ int _lba_nvme_read_async(kv_nvme_t *nvme, kv_pair *kv, int core_id) {
 
         KVNVME_DEBUG("Complete Key ID: %s, Dissected Key ID: %s, LBA Offset: 0x%llx", key_id, sub_key_id, (unsigned long long)lba);
 
-        pthread_spin_lock(&qpair->sq_lock);
+        if(kv_qpair_sq_lock(qpair)) {
+                KVNVME_ERR("I/O Queue is acquired by another thread");
+                LEAVE();
+                return KV_ERR_DD_QPAIR_OWNED;
+        }
         ret = spdk_nvme_ns_cmd_read(nvme->ns, qpair, buffer, lba, (kv->value.length / nvme->sector_size), _lba_async_io_complete, (void *)kv, 0);
-        pthread_spin_unlock(&qpair->sq_lock);
+        kv_qpair_sq_unlock(qpair);
 
         LEAVE();
         return ret;
@@ -297,20 +309,22 @@ int _lba_nvme_delete(kv_nvme_t *nvme, const kv_pair *kv, int core_id) {
 
 	KVNVME_DEBUG("Complete Key ID: %s, Dissected Key ID: %s, LBA Offset: 0x%llx", key_id, sub_key_id, (unsigned long long)lba);
 
-	pthread_spin_lock(&qpair->sq_lock);
+	if(kv_qpair_sq_lock(qpair)) {
+		KVNVME_ERR("I/O Queue is acquired by another thread");
+		LEAVE();
+		return KV_ERR_DD_QPAIR_OWNED;
+	}
 	ret = spdk_nvme_ns_cmd_dataset_management(nvme->ns, qpair, SPDK_NVME_DSM_ATTR_DEALLOCATE, &dsm_range, 1, _lba_io_complete, &io_sequence);
 
 	if(ret) {
-		pthread_spin_unlock(&qpair->sq_lock);
+		kv_qpair_sq_unlock(qpair);
 		KVNVME_ERR("Error in Performing Deallocate on the LBA Type SSD");
 		LEAVE();
 		return ret;
 	}
 
-	while(!io_sequence.is_completed) {
-		spdk_nvme_qpair_process_completions(qpair, 0);
-	}
-	pthread_spin_unlock(&qpair->sq_lock);
+	kv_qpair_sq_unlock(qpair);
+	kv_nvme_wait_for_completion(nvme, core_id, &io_sequence);
 
 	KVNVME_DEBUG("Result of the I/O: %d, Status of the I/O: %d", io_sequence.result, io_sequence.status);
 
@@ -381,9 +395,60 @@ int _lba_nvme_delete_async(kv_nvme_t *nvme, const kv_pair *kv, int core_id) {
 
 	KVNVME_DEBUG("Complete Key ID: %s, Dissected Key ID: %s, LBA Offset: 0x%llx", key_id, sub_key_id, (unsigned long long)offset_blocks);
 
-	pthread_spin_lock(&qpair->sq_lock);
+	if(kv_qpair_sq_lock(qpair)) {
+		KVNVME_ERR("I/O Queue is acquired by another thread");
+		LEAVE();
+		return KV_ERR_DD_QPAIR_OWNED;
+	}
 	ret = spdk_nvme_ns_cmd_dataset_management(nvme->ns, qpair, SPDK_NVME_DSM_ATTR_DEALLOCATE, dsm_ranges, num_ranges, _lba_async_io_complete, (void *)kv);
-	pthread_spin_unlock(&qpair->sq_lock);
+	kv_qpair_sq_unlock(qpair);
+
+	LEAVE();
+	return ret;
+}
+
+/*
+ * The key carries the first block and value.length the number of blocks, as
+ * for _lba_nvme_delete_async. One command covers at most 64K blocks.
+ */
+int _lba_nvme_write_zeroes_async(kv_nvme_t *nvme, const kv_pair *kv, int core_id) {
+	int ret = KV_ERR_DD_INVALID_PARAM;
+	struct spdk_nvme_qpair *qpair = NULL;
+	uint64_t offset_blocks, num_blocks;
+
+	ENTER();
+
+	if(!kv || !kv->key.key) {
+		KVNVME_ERR("Invalid Parameters passed");
+
+		LEAVE();
+		return ret;
+	}
+
+	qpair = nvme->qpairs[core_id];
+
+	if(!qpair) {
+		KVNVME_ERR("No Matching I/O Queue found for the Passed CPU Core ID");
+		LEAVE();
+		return ret;
+	}
+
+	offset_blocks = *(uint64_t*)kv->key.key;
+	num_blocks = kv->value.length;
+
+	if(num_blocks == 0 || num_blocks > KV_NVME_WRITE_ZEROES_MAX_BLOCKS) {
+		KVNVME_ERR("Write zeroes request for %" PRIu64 " blocks is out of range", num_blocks);
+		LEAVE();
+		return -EINVAL;
+	}
+
+	if(kv_qpair_sq_lock(qpair)) {
+		KVNVME_ERR("I/O Queue is acquired by another thread");
+		LEAVE();
+		return KV_ERR_DD_QPAIR_OWNED;
+	}
+	ret = spdk_nvme_ns_cmd_write_zeroes(nvme->ns, qpair, offset_blocks, (uint32_t)num_blocks, _lba_async_io_complete, (void *)kv, 0);
+	kv_qpair_sq_unlock(qpair);
 
 	LEAVE();
 	return ret;
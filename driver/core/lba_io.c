@@ -38,7 +38,7 @@
 #include "spdk/thread.h"
 
 int32_t lba_nvme_process_all_cqs_thread(void *arg) {
-        unsigned int cpu_id = 0;
+        unsigned int cpu_id = 0, queue_id = 0;
         cpu_set_t cpuset;
         process_cq_thread_arg_t *pcq_arg = (process_cq_thread_arg_t *)arg;
         kv_nvme_t *nvme = (kv_nvme_t *)pcq_arg->nvme;
@@ -57,10 +57,18 @@ int32_t lba_nvme_process_all_cqs_thread(void *arg) {
 
         sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
 
+        kv_nvme_cq_event_init(pcq_arg, &nvme->stop_process_all_cqs);
+
         while(!nvme->stop_process_all_cqs) {
-                kv_nvme_process_completion((uint64_t)nvme);
-		usleep(1);
+                int32_t nr_completions = 0;
+                for(queue_id = 0; queue_id < nvme->nr_qpairs; queue_id++) {
+                        if(nvme->qpairs[queue_id]) {
+                                nr_completions += kv_nvme_poll_qpair(nvme, queue_id);
+                        }
+                }
+                kv_nvme_cq_event_idle(pcq_arg, nr_completions);
         }
+        kv_nvme_cq_event_fini(pcq_arg);
         free(arg);
 
         LEAVE();
@@ -68,7 +76,6 @@ int32_t lba_nvme_process_all_cqs_thread(void *arg) {
 }
 
 int32_t lba_nvme_process_cq_thread(void *arg) {
-        struct spdk_nvme_qpair *qpair = NULL;
         unsigned int queue_id = 0;
         cpu_set_t cpuset;
         process_cq_thread_arg_t *pcq_arg = (process_cq_thread_arg_t *)arg;
@@ -86,17 +93,18 @@ int32_t lba_nvme_process_cq_thread(void *arg) {
 
         sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
 
+        kv_nvme_cq_event_init(pcq_arg, &pcq_arg->nvme->stop_process_cq[pcq_arg->thread_id]);
+
         while(!pcq_arg->nvme->stop_process_cq[pcq_arg->thread_id]) {
+                int32_t nr_completions = 0;
                 for(queue_id = pcq_arg->async_qpair_start_index; queue_id < (pcq_arg->async_qpair_start_index + pcq_arg->num_async_qpairs); queue_id++)
                 {
-			qpair = pcq_arg->nvme->async_qpairs[queue_id];
-			pthread_spin_lock(&qpair->cq_lock);
-			spdk_nvme_qpair_process_completions(qpair, 0);
-			pthread_spin_unlock(&qpair->cq_lock);
+			nr_completions += kv_nvme_poll_qpair(pcq_arg->nvme, pcq_arg->nvme->async_qid[queue_id]);
                 }
-		usleep(1);
+		kv_nvme_cq_event_idle(pcq_arg, nr_completions);
         }
 
+        kv_nvme_cq_event_fini(pcq_arg);
         free(arg);
 
         LEAVE();
@@ -107,6 +107,15 @@ typedef void (*spdk_bs_op_complete)(void *cb_arg, int bserrno);
 typedef void (*spdk_bs_op_with_handle_complete)(void *cb_arg, struct spdk_blob_store *bs,
 		int bserrno);
 
+/**
+ * Blobstore initialization progress callback.
+ *
+ * \param cb_arg Callback argument.
+ * \param done Bytes of the device cleared so far.
+ * \param total Bytes of the device to clear.
+ */
+typedef void (*spdk_bs_init_progress_fn)(void *cb_arg, uint64_t done, uint64_t total);
+
 /**
  * Blob operation completion callback.
  *
@@ -225,6 +234,12 @@ struct spdk_bs_opts {
 
 	/** Argument passed to iter_cb_fn for each blob. */
 	void *iter_cb_arg;
+
+	/** Called by spdk_bs_init() as it clears the device, NULL for none. */
+	spdk_bs_init_progress_fn init_progress_fn;
+
+	/** Argument passed to init_progress_fn. */
+	void *init_progress_arg;
 };
 
 /**
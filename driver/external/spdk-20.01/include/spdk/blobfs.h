@@ -61,6 +61,13 @@ typedef struct spdk_file *spdk_fs_iter;
 
 struct spdk_blobfs_opts {
 	uint32_t	cluster_sz;
+
+	/** Pages reserved for file metadata, 0 for one per cluster */
+	uint32_t	num_md_pages;
+
+	/** Called while spdk_fs_init() clears the device, NULL for none */
+	spdk_bs_init_progress_fn	init_progress_fn;
+	void				*init_progress_arg;
 };
 
 struct spdk_file_stat {
@@ -369,6 +376,27 @@ int spdk_file_write(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 int64_t spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 		       void *payload, uint64_t offset, uint64_t length);
 
+struct spdk_file_read_vec {
+	void		*payload;	/* buffer which will store the obtained data */
+	uint64_t	offset;		/* beginning position to read */
+	uint64_t	length;		/* size in bytes of data to read */
+	int64_t		rc;		/* bytes read on success, negated errno on failure */
+};
+
+/**
+ * Read several ranges of the given file at once. The cache misses of all ranges are
+ * submitted before waiting, so they are served by the device concurrently.
+ *
+ * \param file File to read.
+ * \param ctx The thread context for this operation
+ * \param vecs Ranges to read, with the result of each range.
+ * \param count Number of ranges.
+ *
+ * \return 0 if every range was read, the first negated errno otherwise.
+ */
+int spdk_file_read_multi(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+			 struct spdk_file_read_vec *vecs, uint32_t count);
+
 /**
  * Set cache size for the blobstore filesystem.
  *
@@ -396,6 +424,21 @@ uint64_t spdk_fs_get_cache_size(void);
  */
 void spdk_file_set_priority(struct spdk_file *file, uint32_t priority);
 
+#define SPDK_FILE_READAHEAD_NORMAL	0 /* default, adaptive */
+#define SPDK_FILE_READAHEAD_RANDOM	1 /* readahead only once reads turn sequential */
+#define SPDK_FILE_READAHEAD_SEQUENTIAL	2 /* large readahead from the first read */
+
+/**
+ * Set the expected access pattern of the file, which drives its readahead.
+ *
+ * The hint belongs to the file and is shared by all its open handles.
+ *
+ * \param file File to set the hint.
+ * \param hint SPDK_FILE_READAHEAD_NORMAL, SPDK_FILE_READAHEAD_RANDOM or
+ * SPDK_FILE_READAHEAD_SEQUENTIAL.
+ */
+void spdk_file_set_readahead_hint(struct spdk_file *file, uint32_t hint);
+
 /**
  * Synchronize the data from the cache to the disk.
  *
@@ -76,6 +76,56 @@ void spdk_blobfs_bdev_create(const char *bdev_name, uint32_t cluster_sz,
 			     spdk_blobfs_bdev_op_complete cb_fn, void *cb_arg);
 
 #ifdef SPDK_CONFIG_FUSE
+/** Largest FUSE read or write request of a blobfs mount, in bytes */
+#define SPDK_BLOBFS_FUSE_MAX_IO_SIZE (1024 * 1024)
+
+/**
+ * FUSE options of a blobfs mount.
+ */
+struct spdk_blobfs_fuse_opts {
+	/** Dispatch FUSE requests from a pool of threads instead of one thread */
+	bool multithread;
+
+	/**
+	 * Largest write request in bytes, 0 for the FUSE default (128KiB), up to
+	 * SPDK_BLOBFS_FUSE_MAX_IO_SIZE. Above 128KiB needs Linux 4.20 and libfuse 3.6.
+	 */
+	uint32_t max_write;
+
+	/** Largest read request in bytes, 0 for the FUSE default, up to SPDK_BLOBFS_FUSE_MAX_IO_SIZE */
+	uint32_t max_read;
+
+	/** Bypass the page cache, reads and writes go straight to blobfs */
+	bool direct_io;
+
+	/** Move request and reply data through pipes with splice() */
+	bool splice;
+
+	/** Let the kernel cache writes and send them in large requests, ignored with direct_io */
+	bool writeback_cache;
+};
+
+/**
+ * Initialize FUSE options of a blobfs mount with the defaults: one thread,
+ * FUSE default request sizes, page cache, no splice, write-through.
+ *
+ * \param opts Options to initialize.
+ */
+void spdk_blobfs_fuse_opts_init(struct spdk_blobfs_fuse_opts *opts);
+
+/**
+ * Mount a blobfs on given device to a host path by FUSE, with FUSE options.
+ *
+ * \param bdev_name Name of block device.
+ * \param mountpoint Host path to mount blobfs.
+ * \param opts FUSE options, NULL for the defaults.
+ * \param cb_fn Called when mount operation is complete. fserrno is -EILSEQ if no blobfs exists.
+ * \param cb_arg Argument passed to function cb_fn.
+ */
+void spdk_blobfs_bdev_mount_ext(const char *bdev_name, const char *mountpoint,
+				const struct spdk_blobfs_fuse_opts *opts,
+				spdk_blobfs_bdev_op_complete cb_fn, void *cb_arg);
+
 /**
  * Mount a blobfs on given device to a host path by FUSE
  *
@@ -277,6 +277,65 @@ spdk_nvme_kv_cmd_iterate_close (struct spdk_nvme_ns *ns, struct spdk_nvme_qpair
  */
 uint16_t spdk_nvme_ns_get_max_io_queue_size(struct spdk_nvme_ns *ns);
 
+/**
+ * \brief Sets how many submissions are accumulated before the SQ doorbell is rung.
+ *
+ * \param qpair I/O queue pair allocated on a PCIe controller
+ * \param submit_batch number of submissions per doorbell write, 0 or 1 rings on every submission
+ *
+ * Submissions held back by the batch stay invisible to the controller until the
+ * threshold is reached or spdk_nvme_qpair_flush_submissions() is called.
+ */
+void spdk_nvme_qpair_set_submit_batch(struct spdk_nvme_qpair *qpair, uint16_t submit_batch);
+
+/**
+ * \brief Rings the SQ doorbell for all submissions held back by the submit batch.
+ *
+ * \param qpair I/O queue pair allocated on a PCIe controller
+ *
+ * The user must serialize this call with submissions on the same qpair.
+ */
+void spdk_nvme_qpair_flush_submissions(struct spdk_nvme_qpair *qpair);
+
+/**
+ * \brief Sets the timeout of one opcode on a qpair, overriding the controller-wide
+ *        value registered with spdk_nvme_ctrlr_register_timeout_callback().
+ *
+ * \param qpair I/O queue pair
+ * \param opc NVMe opcode of the command
+ * \param timeout_us timeout in microseconds, 0 never times out commands with this opcode
+ *
+ * \return 0 on success, -ENOMEM if the per opcode table cannot be allocated.
+ *
+ * The timeout callback registered on the controller is still the one invoked, so a
+ * callback must be registered for per opcode timeouts to take effect.
+ */
+int spdk_nvme_qpair_set_opc_timeout(struct spdk_nvme_qpair *qpair, uint8_t opc, uint64_t timeout_us);
+
+/**
+ * \brief Gets the number of requests of a qpair which are submitted, queued or
+ *        not completed yet.
+ *
+ * \param qpair I/O queue pair
+ *
+ * \return number of requests allocated from the qpair and not freed yet, 0 if the qpair is idle.
+ *
+ * The value is read without the qpair locks, so it is a snapshot only.
+ */
+uint32_t spdk_nvme_qpair_get_num_active_reqs(struct spdk_nvme_qpair *qpair);
+
+/**
+ * \brief Checks whether a qpair still has a command outstanding after its timeout
+ *        callback was invoked, e.g. because the device ignored the Abort for it.
+ *
+ * \param qpair I/O queue pair
+ *
+ * \return true if a timed out command has not completed yet.
+ *
+ * The caller must serialize this with submissions and completions on the qpair.
+ */
+bool spdk_nvme_qpair_has_timed_out_reqs(struct spdk_nvme_qpair *qpair);
+
 #ifdef __cplusplus
 }
 #endif
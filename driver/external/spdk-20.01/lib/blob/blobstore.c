@@ -3004,6 +3004,8 @@ spdk_bs_opts_init(struct spdk_bs_opts *opts)
 	memset(&opts->bstype, 0, sizeof(opts->bstype));
 	opts->iter_cb_fn = NULL;
 	opts->iter_cb_arg = NULL;
+	opts->init_progress_fn = NULL;
+	opts->init_progress_arg = NULL;
 }
 
 static int
@@ -4458,9 +4460,23 @@ spdk_bs_dump(struct spdk_bs_dev *dev, FILE *fp, spdk_bs_dump_print_xattr print_x
 
 /* START spdk_bs_init */
 
+/* The metadata region is cleared in chunks of this size, up to
+ * SPDK_BS_INIT_CLEAR_QD at a time. A device that has no native write zeroes
+ * gets zero buffers written one after the other per request, so a single
+ * request for a region of tens of GiB would take minutes.
+ */
+#define SPDK_BS_INIT_CLEAR_CHUNK_SZ	(256ULL * 1024 * 1024)
+#define SPDK_BS_INIT_CLEAR_QD		16
+
 struct spdk_bs_init_ctx {
 	struct spdk_blob_store		*bs;
 	struct spdk_bs_super_block	*super;
+
+	enum bs_clear_method		clear_method;
+	uint64_t			num_md_lba;
+	uint64_t			clear_lba;
+	spdk_bs_init_progress_fn	progress_fn;
+	void				*progress_arg;
 };
 
 static void
@@ -4474,17 +4490,90 @@ _spdk_bs_init_persist_super_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserr
 	spdk_bs_sequence_finish(seq, bserrno);
 }
 
+static void
+_spdk_bs_init_report_progress(struct spdk_bs_init_ctx *ctx, uint64_t done_lba)
+{
+	struct spdk_blob_store *bs = ctx->bs;
+
+	if (ctx->progress_fn) {
+		ctx->progress_fn(ctx->progress_arg, done_lba * bs->dev->blocklen,
+				 bs->dev->blockcnt * bs->dev->blocklen);
+	}
+}
+
 static void
 _spdk_bs_init_trim_cpl(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
 {
 	struct spdk_bs_init_ctx *ctx = cb_arg;
 
+	_spdk_bs_init_report_progress(ctx, ctx->bs->dev->blockcnt);
+
 	/* Write super block */
 	spdk_bs_sequence_write_dev(seq, ctx->super, _spdk_bs_page_to_lba(ctx->bs, 0),
 				   _spdk_bs_byte_to_lba(ctx->bs, sizeof(*ctx->super)),
 				   _spdk_bs_init_persist_super_cpl, ctx);
 }
 
+static void
+_spdk_bs_init_clear_data(spdk_bs_batch_t *batch, struct spdk_bs_init_ctx *ctx)
+{
+	uint64_t	num_md_lba = ctx->num_md_lba;
+
+	switch (ctx->clear_method) {
+	case BS_CLEAR_WITH_UNMAP:
+		/* Trim data clusters */
+		spdk_bs_batch_unmap_dev(batch, num_md_lba, ctx->bs->dev->blockcnt - num_md_lba);
+		break;
+	case BS_CLEAR_WITH_WRITE_ZEROES:
+		/* Write_zeroes to data clusters */
+		spdk_bs_batch_write_zeroes_dev(batch, num_md_lba, ctx->bs->dev->blockcnt - num_md_lba);
+		break;
+	case BS_CLEAR_WITH_NONE:
+	default:
+		break;
+	}
+}
+
+static void
+_spdk_bs_init_clear_md(spdk_bs_sequence_t *seq, void *cb_arg, int bserrno)
+{
+	struct spdk_bs_init_ctx *ctx = cb_arg;
+	spdk_bs_batch_t		*batch;
+	uint64_t		chunk_lba, lba_count;
+	uint32_t		i;
+
+	if (bserrno != 0) {
+		SPDK_ERRLOG("Failed to clear blobstore metadata or data region: %d\n", bserrno);
+		spdk_free(ctx->super);
+		free(ctx);
+		spdk_bs_sequence_finish(seq, bserrno);
+		return;
+	}
+
+	_spdk_bs_init_report_progress(ctx, ctx->clear_lba);
+
+	if (ctx->clear_lba == ctx->num_md_lba) {
+		_spdk_bs_init_trim_cpl(seq, ctx, 0);
+		return;
+	}
+
+	batch = spdk_bs_sequence_to_batch(seq, _spdk_bs_init_clear_md, ctx);
+
+	/* The data region is cleared alongside the first metadata chunks */
+	if (ctx->clear_lba == 0) {
+		_spdk_bs_init_clear_data(batch, ctx);
+	}
+
+	/* Clear metadata space */
+	chunk_lba = _spdk_bs_byte_to_lba(ctx->bs, SPDK_BS_INIT_CLEAR_CHUNK_SZ);
+	for (i = 0; i < SPDK_BS_INIT_CLEAR_QD && ctx->clear_lba < ctx->num_md_lba; i++) {
+		lba_count = spdk_min(chunk_lba, ctx->num_md_lba - ctx->clear_lba);
+		spdk_bs_batch_write_zeroes_dev(batch, ctx->clear_lba, lba_count);
+		ctx->clear_lba += lba_count;
+	}
+	spdk_bs_batch_close(batch);
+}
+
 void
 spdk_bs_init(struct spdk_bs_dev *dev, struct spdk_bs_opts *o,
 	     spdk_bs_op_with_handle_complete cb_fn, void *cb_arg)
@@ -4493,7 +4582,6 @@ spdk_bs_init(struct spdk_bs_dev *dev, struct spdk_bs_opts *o,
 	struct spdk_blob_store	*bs;
 	struct spdk_bs_cpl	cpl;
 	spdk_bs_sequence_t	*seq;
-	spdk_bs_batch_t		*batch;
 	uint64_t		num_md_lba;
 	uint64_t		num_md_pages;
 	uint64_t		num_md_clusters;
@@ -4660,26 +4748,13 @@ spdk_bs_init(struct spdk_bs_dev *dev, struct spdk_bs_opts *o,
 		return;
 	}
 
-	batch = spdk_bs_sequence_to_batch(seq, _spdk_bs_init_trim_cpl, ctx);
-
-	/* Clear metadata space */
-	spdk_bs_batch_write_zeroes_dev(batch, 0, num_md_lba);
+	ctx->clear_method = opts.clear_method;
+	ctx->num_md_lba = num_md_lba;
+	ctx->clear_lba = 0;
+	ctx->progress_fn = opts.init_progress_fn;
+	ctx->progress_arg = opts.init_progress_arg;
 
-	switch (opts.clear_method) {
-	case BS_CLEAR_WITH_UNMAP:
-		/* Trim data clusters */
-		spdk_bs_batch_unmap_dev(batch, num_md_lba, ctx->bs->dev->blockcnt - num_md_lba);
-		break;
-	case BS_CLEAR_WITH_WRITE_ZEROES:
-		/* Write_zeroes to data clusters */
-		spdk_bs_batch_write_zeroes_dev(batch, num_md_lba, ctx->bs->dev->blockcnt - num_md_lba);
-		break;
-	case BS_CLEAR_WITH_NONE:
-	default:
-		break;
-	}
-
-	spdk_bs_batch_close(batch);
+	_spdk_bs_init_clear_md(seq, ctx, 0);
 }
 
 /* END spdk_bs_init */
@@ -58,10 +58,27 @@
 
 static uint64_t g_fs_cache_size = BLOBFS_DEFAULT_CACHE_SIZE;
 static struct spdk_mempool *g_cache_pool;
-static TAILQ_HEAD(, spdk_file) g_caches;
 static int g_fs_count = 0;
 static pthread_mutex_t g_cache_init_lock = PTHREAD_MUTEX_INITIALIZER;
-static pthread_spinlock_t g_caches_lock;
+
+/*
+ * Cached buffers of all files are reclaimed one by one with CLOCK. The buffers are spread
+ *  over shards, each with its own lock and ring, so that allocations on different threads
+ *  do not serialize on one lock. A hit gives a buffer CACHE_CLOCK_REF_LOW or
+ *  CACHE_CLOCK_REF_HIGH (SPDK_FILE_PRIORITY_HIGH files) sweeps before it can be evicted.
+ */
+#define CACHE_CLOCK_SHARDS	16
+#define CACHE_CLOCK_REF_LOW	1
+#define CACHE_CLOCK_REF_HIGH	3
+
+struct cache_clock_shard {
+	pthread_spinlock_t			lock;
+	uint32_t				count;
+	TAILQ_HEAD(, cache_buffer)		ring;
+} __attribute__((aligned(64)));
+
+static struct cache_clock_shard g_cache_clock[CACHE_CLOCK_SHARDS];
+static uint32_t g_cache_clock_hand;
 
 #define BLOBFS_ALIGN_FLOOR(val, align) (typeof(val))((val) & (~((typeof(val))((align) - 1))))
 #define BLOBFS_ALIGN_CEIL(val, align) BLOBFS_ALIGN_FLOOR(((val) + ((typeof(val)) (align) - 1)), align)
@@ -70,6 +87,15 @@ static pthread_spinlock_t g_caches_lock;
 #define MIN_READAHEAD_THRESHOLD (4 * 1024)
 #define MAX_READAHEAD_THRESHOLD MAX_READAHEAD_SIZE
 
+/*
+ * The readahead window of a file is resized once READAHEAD_ADAPT_SAMPLES prefetched buffers
+ *  were either read (hit) or freed unread (wasted): halved above 1/4 waste, doubled
+ *  above 7/8 hits, up to the prefetch size of the file.
+ */
+#define READAHEAD_ADAPT_SAMPLES	16
+/* Consecutive reads at the same distance before the stride is prefetched */
+#define READAHEAD_STRIDE_HITS	2
+
 #define TRACE_GROUP_BLOBFS	0x7
 #define TRACE_BLOBFS_XATTR_START	SPDK_TPOINT_ID(TRACE_GROUP_BLOBFS, 0x0)
 #define TRACE_BLOBFS_XATTR_END		SPDK_TPOINT_ID(TRACE_GROUP_BLOBFS, 0x1)
@@ -112,9 +138,44 @@ SPDK_TRACE_REGISTER_FN(blobfs_trace, "blobfs", TRACE_GROUP_BLOBFS)
 					"file:    ");
 }
 
+static void
+cache_clock_insert(struct spdk_file *file, struct cache_buffer *cache_buffer)
+{
+	struct cache_clock_shard *shard;
+
+	cache_buffer->file = file;
+	cache_buffer->referenced = CACHE_CLOCK_REF_LOW;
+	cache_buffer->clock_shard = (((uintptr_t)file >> 6) ^
+				     (cache_buffer->offset >> g_fs_cache_buffer_shift)) % CACHE_CLOCK_SHARDS;
+
+	shard = &g_cache_clock[cache_buffer->clock_shard];
+	pthread_spin_lock(&shard->lock);
+	TAILQ_INSERT_TAIL(&shard->ring, cache_buffer, clock_tailq);
+	shard->count++;
+	cache_buffer->on_clock = true;
+	pthread_spin_unlock(&shard->lock);
+}
+
+static void cache_readahead_wasted(struct cache_buffer *cache_buffer);
+
 void
 spdk_cache_buffer_free(struct cache_buffer *cache_buffer)
 {
+	struct cache_clock_shard *shard;
+
+	if (cache_buffer->readahead) {
+		cache_readahead_wasted(cache_buffer);
+	}
+
+	if (cache_buffer->on_clock) {
+		shard = &g_cache_clock[cache_buffer->clock_shard];
+		pthread_spin_lock(&shard->lock);
+		TAILQ_REMOVE(&shard->ring, cache_buffer, clock_tailq);
+		shard->count--;
+		cache_buffer->on_clock = false;
+		pthread_spin_unlock(&shard->lock);
+	}
+
 	spdk_mempool_put(g_cache_pool, cache_buffer->buf);
 	free(cache_buffer);
 }
@@ -145,9 +206,15 @@ struct spdk_file {
 	uint32_t		direct_io;
 	uint32_t		prefetch_size;
 	uint32_t		prefetch_threshold;
+	uint32_t		readahead_hint;
+	uint32_t		readahead_window;
+	uint32_t		readahead_hits;
+	uint32_t		readahead_wasted;
+	uint64_t		last_read_offset;
+	int64_t			read_stride;
+	uint32_t		read_stride_hits;
 	TAILQ_HEAD(open_requests_head, spdk_fs_request) open_requests;
 	TAILQ_HEAD(sync_requests_head, spdk_fs_request) sync_requests;
-	TAILQ_ENTRY(spdk_file)	cache_tailq;
 };
 
 struct spdk_deleted_file {
@@ -215,6 +282,7 @@ struct spdk_fs_cb_args {
 		struct {
 			struct spdk_io_channel	*channel;
 			void		*pin_buf;
+			bool		user_buf;	/* pin_buf is the caller buffer */
 			int		is_read;
 			off_t		offset;
 			size_t		length;
@@ -277,6 +345,9 @@ void
 spdk_fs_opts_init(struct spdk_blobfs_opts *opts)
 {
 	opts->cluster_sz = SPDK_BLOBFS_DEFAULT_OPTS_CLUSTER_SZ;
+	opts->num_md_pages = 0;
+	opts->init_progress_fn = NULL;
+	opts->init_progress_arg = NULL;
 }
 
 static void
@@ -294,8 +365,11 @@ __initialize_cache(void)
 			    "increase the memory and try again\n");
 		assert(false);
 	}
-	TAILQ_INIT(&g_caches);
-	pthread_spin_init(&g_caches_lock, 0);
+	for (uint32_t i = 0; i < CACHE_CLOCK_SHARDS; i++) {
+		pthread_spin_init(&g_cache_clock[i].lock, 0);
+		g_cache_clock[i].count = 0;
+		TAILQ_INIT(&g_cache_clock[i].ring);
+	}
 }
 
 static void
@@ -642,6 +716,11 @@ spdk_fs_init(struct spdk_bs_dev *dev, struct spdk_blobfs_opts *opt,
 	snprintf(opts.bstype.bstype, sizeof(opts.bstype.bstype), SPDK_BLOBFS_SIGNATURE);
 	if (opt) {
 		opts.cluster_sz = opt->cluster_sz;
+		if (opt->num_md_pages != 0) {
+			opts.num_md_pages = opt->num_md_pages;
+		}
+		opts.init_progress_fn = opt->init_progress_fn;
+		opts.init_progress_arg = opt->init_progress_arg;
 	}
 	spdk_bs_init(dev, &opts, init_cb, req);
 }
@@ -1272,6 +1351,8 @@ fs_open_blob_done(void *ctx, struct spdk_blob *blob, int bserrno)
 	f->direct_io = BLOBFS_BUFFERED_IO;
 	f->prefetch_size = CACHE_BUFFER_SIZE * 2;
 	f->prefetch_threshold = CACHE_READAHEAD_THRESHOLD;
+	f->readahead_hint = SPDK_FILE_READAHEAD_NORMAL;
+	f->readahead_window = CACHE_BUFFER_SIZE * 2;
 	while (!TAILQ_EMPTY(&f->open_requests)) {
 		req = TAILQ_FIRST(&f->open_requests);
 		args = &req->args;
@@ -1834,7 +1915,9 @@ __rw_done(void *ctx, int bserrno)
 	struct spdk_fs_request *req = ctx;
 	struct spdk_fs_cb_args *args = &req->args;
 
-	spdk_free(args->op.rw.pin_buf);
+	if (!args->op.rw.user_buf) {
+		spdk_free(args->op.rw.pin_buf);
+	}
 	args->fn.file_op(args->arg, bserrno);
 	free_fs_request(req);
 }
@@ -1879,7 +1962,9 @@ __read_done(void *ctx, int bserrno)
 	assert(req != NULL);
 	buf = (void *)((uintptr_t)args->op.rw.pin_buf + (args->op.rw.offset & (args->op.rw.blocklen - 1)));
 	if (args->op.rw.is_read) {
-		_copy_buf_to_iovs(args->iovs, args->iovcnt, buf, args->op.rw.length);
+		if (!args->op.rw.user_buf) {
+			_copy_buf_to_iovs(args->iovs, args->iovcnt, buf, args->op.rw.length);
+		}
 		__rw_done(req, 0);
 	} else {
 		_copy_iovs_to_buf(buf, args->op.rw.length, args->iovs, args->iovcnt);
@@ -1906,6 +1991,25 @@ __do_blob_read(void *ctx, int fserrno)
 			  __read_done, req);
 }
 
+static void
+__do_blob_write(void *ctx, int fserrno)
+{
+	struct spdk_fs_request *req = ctx;
+	struct spdk_fs_cb_args *args = &req->args;
+
+	if (fserrno) {
+		__rw_done(req, fserrno);
+		return;
+	}
+	if (!args->op.rw.user_buf) {
+		_copy_iovs_to_buf(args->op.rw.pin_buf, args->op.rw.length, args->iovs, args->iovcnt);
+	}
+	spdk_blob_io_write(args->file->blob, args->op.rw.channel,
+			   args->op.rw.pin_buf,
+			   args->op.rw.start_lba, args->op.rw.num_lba,
+			   __rw_done, req);
+}
+
 static void
 __get_page_parameters(struct spdk_file *file, uint64_t offset, uint64_t length,
 		      uint64_t *start_lba, uint32_t *lba_size, uint64_t *num_lba)
@@ -1930,6 +2034,36 @@ __is_lba_aligned(struct spdk_file *file, uint64_t offset, uint64_t length)
 	return false;
 }
 
+/*
+ * Whether the caller buffer can be the target of the blob I/O itself: a single
+ *  LBA aligned buffer in memory registered for DMA, e.g. from spdk_malloc().
+ */
+static bool
+__is_dma_buffer(struct spdk_file *file, struct iovec *iovs, uint32_t iovcnt,
+		uint64_t offset, uint64_t length)
+{
+	uint32_t lba_size = spdk_bs_get_io_unit_size(file->fs->bs);
+	uint8_t *buf, *end;
+	uint64_t size;
+
+	if (iovcnt != 1 || iovs[0].iov_len < length || !__is_lba_aligned(file, offset, length) ||
+	    ((uintptr_t)iovs[0].iov_base % lba_size) != 0) {
+		return false;
+	}
+
+	buf = iovs[0].iov_base;
+	end = buf + length;
+	while (buf < end) {
+		size = end - buf;
+		if (spdk_vtophys(buf, &size) == SPDK_VTOPHYS_ERROR || size == 0) {
+			return false;
+		}
+		buf += spdk_min(size, (uint64_t)(end - buf));
+	}
+
+	return true;
+}
+
 static void
 _fs_request_setup_iovs(struct spdk_fs_request *req, struct iovec *iovs, uint32_t iovcnt)
 {
@@ -1977,8 +2111,13 @@ __readvwritev(struct spdk_file *file, struct spdk_io_channel *_channel,
 
 	pin_buf_length = num_lba * lba_size;
 	args->op.rw.length = pin_buf_length;
-	args->op.rw.pin_buf = spdk_malloc(pin_buf_length, lba_size, NULL,
-					  SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	args->op.rw.user_buf = __is_dma_buffer(file, iovs, iovcnt, offset, length);
+	if (args->op.rw.user_buf) {
+		args->op.rw.pin_buf = iovs[0].iov_base;
+	} else {
+		args->op.rw.pin_buf = spdk_malloc(pin_buf_length, lba_size, NULL,
+						  SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_DMA);
+	}
 	if (args->op.rw.pin_buf == NULL) {
 		SPDK_DEBUGLOG(SPDK_LOG_BLOBFS, "Failed to allocate buf for: file=%s offset=%jx length=%jx\n",
 			      file->name, offset, length);
@@ -1991,13 +2130,12 @@ __readvwritev(struct spdk_file *file, struct spdk_io_channel *_channel,
 	args->op.rw.num_lba = num_lba;
 
 	if (!is_read && file->length < offset + length) {
-		spdk_file_truncate_async(file, offset + length, __do_blob_read, req);
+		/* Only writes of partial LBAs need the read-modify-write after the file is extended */
+		spdk_file_truncate_async(file, offset + length,
+					 __is_lba_aligned(file, offset, length) ? __do_blob_write : __do_blob_read,
+					 req);
 	} else if (!is_read && __is_lba_aligned(file, offset, length)) {
-		_copy_iovs_to_buf(args->op.rw.pin_buf, args->op.rw.length, args->iovs, args->iovcnt);
-		spdk_blob_io_write(args->file->blob, args->op.rw.channel,
-				   args->op.rw.pin_buf,
-				   args->op.rw.start_lba, args->op.rw.num_lba,
-				   __rw_done, req);
+		__do_blob_write(req, 0);
 	} else {
 		__do_blob_read(req, 0);
 	}
@@ -2198,67 +2336,87 @@ spdk_fs_get_cache_size(void)
 
 static void __file_flush(void *ctx);
 
-static void *
-alloc_cache_memory_buffer(struct spdk_file *context)
+enum cache_clock_pass {
+	CACHE_CLOCK_PASS_LOW,		/* low priority files that are not being written */
+	CACHE_CLOCK_PASS_READ,		/* files that are not being written */
+	CACHE_CLOCK_PASS_ANY,
+};
+
+/*
+ * Sweep one shard and evict the first clean buffer that has no reference left.
+ *  Buffer owners are only try-locked, as the caller may hold the lock of its own file.
+ */
+static bool
+cache_clock_evict(struct cache_clock_shard *shard, struct spdk_file *context,
+		  enum cache_clock_pass pass)
 {
+	struct cache_buffer *buf;
 	struct spdk_file *file;
-	void *buf;
+	uint32_t sweep;
 
-	buf = spdk_mempool_get(g_cache_pool);
-	if (buf != NULL) {
-		return buf;
-	}
+	pthread_spin_lock(&shard->lock);
+	sweep = shard->count * (CACHE_CLOCK_REF_HIGH + 1);
+	while (sweep-- > 0 && (buf = TAILQ_FIRST(&shard->ring)) != NULL) {
+		TAILQ_REMOVE(&shard->ring, buf, clock_tailq);
+		TAILQ_INSERT_TAIL(&shard->ring, buf, clock_tailq);
 
-	pthread_spin_lock(&g_caches_lock);
-	TAILQ_FOREACH(file, &g_caches, cache_tailq) {
-		if (!file->open_for_writing &&
-		    file->priority == SPDK_FILE_PRIORITY_LOW &&
-		    file != context) {
-			TAILQ_REMOVE(&g_caches, file, cache_tailq);
-			TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-			break;
+		file = buf->file;
+		if (file == context || buf->in_progress) {
+			continue;
 		}
-	}
-	pthread_spin_unlock(&g_caches_lock);
-	if (file != NULL) {
-		cache_free_buffers(file);
-		buf = spdk_mempool_get(g_cache_pool);
-		if (buf != NULL) {
-			return buf;
+		if ((pass < CACHE_CLOCK_PASS_ANY && file->open_for_writing) ||
+		    (pass < CACHE_CLOCK_PASS_READ && file->priority != SPDK_FILE_PRIORITY_LOW)) {
+			continue;
 		}
-	}
-
-	pthread_spin_lock(&g_caches_lock);
-	TAILQ_FOREACH(file, &g_caches, cache_tailq) {
-		if (!file->open_for_writing && file != context) {
-			TAILQ_REMOVE(&g_caches, file, cache_tailq);
-			TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-			break;
+		if (buf->referenced > 0) {
+			buf->referenced--;
+			continue;
 		}
-	}
-	pthread_spin_unlock(&g_caches_lock);
-	if (file != NULL) {
-		cache_free_buffers(file);
-		buf = spdk_mempool_get(g_cache_pool);
-		if (buf != NULL) {
-			return buf;
+		if (pthread_spin_trylock(&file->lock) != 0) {
+			continue;
+		}
+		if (buf->in_progress || buf->bytes_filled != buf->bytes_flushed || buf == file->last) {
+			pthread_spin_unlock(&file->lock);
+			continue;
 		}
+
+		TAILQ_REMOVE(&shard->ring, buf, clock_tailq);
+		shard->count--;
+		buf->on_clock = false;
+		pthread_spin_unlock(&shard->lock);
+
+		BLOBFS_TRACE(file, "evict offset=%jx\n", buf->offset);
+		spdk_tree_remove_buffer(file->tree, buf);
+		pthread_spin_unlock(&file->lock);
+		return true;
 	}
+	pthread_spin_unlock(&shard->lock);
 
-	pthread_spin_lock(&g_caches_lock);
-	TAILQ_FOREACH(file, &g_caches, cache_tailq) {
-		if (file != context) {
-			TAILQ_REMOVE(&g_caches, file, cache_tailq);
-			TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-			break;
-		}
+	return false;
+}
+
+static void *
+alloc_cache_memory_buffer(struct spdk_file *context)
+{
+	enum cache_clock_pass pass;
+	uint32_t start, i;
+	void *buf;
+
+	buf = spdk_mempool_get(g_cache_pool);
+	if (buf != NULL) {
+		return buf;
 	}
-	pthread_spin_unlock(&g_caches_lock);
-	if (file != NULL) {
-		cache_free_buffers(file);
-		buf = spdk_mempool_get(g_cache_pool);
-		if (buf != NULL) {
-			return buf;
+
+	start = __atomic_fetch_add(&g_cache_clock_hand, 1, __ATOMIC_RELAXED);
+	for (pass = CACHE_CLOCK_PASS_LOW; pass <= CACHE_CLOCK_PASS_ANY; pass++) {
+		for (i = 0; i < CACHE_CLOCK_SHARDS; i++) {
+			if (!cache_clock_evict(&g_cache_clock[(start + i) % CACHE_CLOCK_SHARDS], context, pass)) {
+				continue;
+			}
+			buf = spdk_mempool_get(g_cache_pool);
+			if (buf != NULL) {
+				return buf;
+			}
 		}
 	}
 
@@ -2298,12 +2456,8 @@ cache_insert_buffer(struct spdk_file *file, uint64_t offset)
 	buf->buf_size = CACHE_BUFFER_SIZE;
 	buf->offset = offset;
 
-	pthread_spin_lock(&g_caches_lock);
-	if (file->tree->present_mask == 0) {
-		TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-	}
 	file->tree = spdk_tree_insert_buffer(file->tree, buf);
-	pthread_spin_unlock(&g_caches_lock);
+	cache_clock_insert(file, buf);
 
 	return buf;
 }
@@ -2334,22 +2488,40 @@ __file_cache_finish_sync(void *ctx, int bserrno)
 {
 	struct spdk_file *file;
 	struct spdk_fs_request *sync_req = ctx;
+	struct spdk_fs_request *req, *tmp;
 	struct spdk_fs_cb_args *sync_args;
+	TAILQ_HEAD(, spdk_fs_request) done_requests;
 
 	sync_args = &sync_req->args;
 	file = sync_args->file;
+	TAILQ_INIT(&done_requests);
 	pthread_spin_lock(&file->lock);
 	file->length_xattr = sync_args->op.sync.length;
 	assert(sync_args->op.sync.offset <= file->length_flushed);
 	spdk_trace_record(TRACE_BLOBFS_XATTR_END, 0, sync_args->op.sync.offset,
 			  0, file->trace_arg_name);
 	BLOBFS_TRACE(file, "sync done offset=%jx\n", sync_args->op.sync.offset);
-	TAILQ_REMOVE(&file->sync_requests, sync_req, args.op.sync.tailq);
+	/*
+	 * Group commit: the length just written to the xattr also covers every other
+	 *  sync request up to it, so they complete without a metadata write of their own.
+	 */
+	TAILQ_FOREACH_SAFE(req, &file->sync_requests, args.op.sync.tailq, tmp) {
+		if (req->args.op.sync.offset <= sync_args->op.sync.length) {
+			TAILQ_REMOVE(&file->sync_requests, req, args.op.sync.tailq);
+			TAILQ_INSERT_TAIL(&done_requests, req, args.op.sync.tailq);
+		}
+	}
 	pthread_spin_unlock(&file->lock);
 
-	sync_args->fn.file_op(sync_args->arg, bserrno);
+	TAILQ_FOREACH(req, &done_requests, args.op.sync.tailq) {
+		req->args.fn.file_op(req->args.arg, bserrno);
+	}
 	pthread_spin_lock(&file->lock);
-	free_fs_request(sync_req);
+	while (!TAILQ_EMPTY(&done_requests)) {
+		req = TAILQ_FIRST(&done_requests);
+		TAILQ_REMOVE(&done_requests, req, args.op.sync.tailq);
+		free_fs_request(req);
+	}
 	pthread_spin_unlock(&file->lock);
 
 	__check_sync_reqs(file);
@@ -2362,13 +2534,21 @@ __check_sync_reqs(struct spdk_file *file)
 
 	pthread_spin_lock(&file->lock);
 
+	/* Only one xattr update per file is in flight, the others wait to be grouped with the next one */
+	TAILQ_FOREACH(sync_req, &file->sync_requests, args.op.sync.tailq) {
+		if (sync_req->args.op.sync.xattr_in_progress) {
+			pthread_spin_unlock(&file->lock);
+			return;
+		}
+	}
+
 	TAILQ_FOREACH(sync_req, &file->sync_requests, args.op.sync.tailq) {
 		if (sync_req->args.op.sync.offset <= file->length_flushed) {
 			break;
 		}
 	}
 
-	if (sync_req != NULL && !sync_req->args.op.sync.xattr_in_progress) {
+	if (sync_req != NULL) {
 		BLOBFS_TRACE(file, "set xattr length 0x%jx\n", file->length_flushed);
 		sync_req->args.op.sync.xattr_in_progress = true;
 		sync_req->args.op.sync.length = file->length_flushed;
@@ -2785,6 +2965,7 @@ check_readahead(struct spdk_file *file, uint64_t offset,
 	}
 
 	args->op.readahead.cache_buffer->in_progress = true;
+	args->op.readahead.cache_buffer->readahead = true;
 	if (file->length < (offset + CACHE_BUFFER_SIZE)) {
 		args->op.readahead.length = file->length & (CACHE_BUFFER_SIZE - 1);
 	} else {
@@ -2793,6 +2974,97 @@ check_readahead(struct spdk_file *file, uint64_t offset,
 	file->fs->send_request_mq(__readahead, req, channel->qid);
 }
 
+static void
+cache_readahead_wasted(struct cache_buffer *cache_buffer)
+{
+	cache_buffer->readahead = false;
+	if (cache_buffer->file != NULL) {
+		cache_buffer->file->readahead_wasted++;
+	}
+}
+
+static void
+file_readahead_adapt(struct spdk_file *file)
+{
+	uint32_t max_window, samples;
+
+	max_window = file->readahead_hint == SPDK_FILE_READAHEAD_SEQUENTIAL ?
+		     MAX_READAHEAD_SIZE : file->prefetch_size;
+	samples = file->readahead_hits + file->readahead_wasted;
+	if (samples >= READAHEAD_ADAPT_SAMPLES) {
+		if (file->readahead_wasted * 4 > samples) {
+			file->readahead_window /= 2;
+		} else if (file->readahead_hits * 8 >= samples * 7) {
+			file->readahead_window *= 2;
+		}
+		file->readahead_hits = 0;
+		file->readahead_wasted = 0;
+	}
+
+	file->readahead_window = spdk_max(file->readahead_window, CACHE_BUFFER_SIZE);
+	file->readahead_window = spdk_min(file->readahead_window, max_window);
+}
+
+/*
+ * Track the access pattern of the file and prefetch the window ahead of sequential
+ *  reads, or the next strides of reads that keep the same distance.
+ */
+static void
+file_readahead(struct spdk_file *file, uint64_t offset, uint64_t length,
+	       struct spdk_fs_channel *channel)
+{
+	int64_t stride, next;
+	uint32_t i;
+
+	stride = (int64_t)(offset - file->last_read_offset);
+	file->last_read_offset = offset;
+	if (offset == file->next_seq_offset) {
+		file->seq_byte_count += length;
+	} else {
+		file->seq_byte_count = length;
+		if (stride == file->read_stride) {
+			file->read_stride_hits++;
+		} else {
+			file->read_stride = stride;
+			file->read_stride_hits = 0;
+		}
+	}
+	file->next_seq_offset = offset + length;
+
+	if ((file->direct_io & BLOBFS_DIRECT_READ) != 0) {
+		return;
+	}
+
+	file_readahead_adapt(file);
+
+	/*
+	 * The hint is shared by every handle of the file, so a RANDOM hint only turns off
+	 *  speculative readahead: a reader that is detected as sequential still prefetches.
+	 */
+	if (file->readahead_hint == SPDK_FILE_READAHEAD_SEQUENTIAL ||
+	    file->seq_byte_count >= file->prefetch_threshold) {
+		for (i = 0; i < file->readahead_window; i += CACHE_BUFFER_SIZE) {
+			check_readahead(file, offset + i, channel);
+		}
+		return;
+	}
+
+	if (file->readahead_hint == SPDK_FILE_READAHEAD_RANDOM ||
+	    file->read_stride_hits < READAHEAD_STRIDE_HITS ||
+	    (uint64_t)llabs(file->read_stride) < CACHE_BUFFER_SIZE) {
+		return;
+	}
+
+	/* check_readahead() fills the buffer after the given offset */
+	for (i = 1; i <= file->readahead_window / CACHE_BUFFER_SIZE; i++) {
+		next = (int64_t)offset + file->read_stride * i;
+		if (next < (int64_t)CACHE_BUFFER_SIZE) {
+			break;
+		}
+		check_readahead(file, next - CACHE_BUFFER_SIZE, channel);
+	}
+}
+
 static int
 __file_read(struct spdk_file *file, void *payload, uint64_t offset, uint64_t length,
 	    struct spdk_fs_channel *channel)
@@ -2813,36 +3085,37 @@ __file_read(struct spdk_file *file, void *payload, uint64_t offset, uint64_t len
 	}
 	BLOBFS_TRACE(file, "read %p offset=%ju length=%ju\n", payload, offset, length);
 	memcpy(payload, &buf->buf[offset - buf->offset], length);
+	if (buf->readahead) {
+		buf->readahead = false;
+		file->readahead_hits++;
+	}
 	if (file->retain_cache == false && (offset + length) % CACHE_BUFFER_SIZE == 0) {
-		pthread_spin_lock(&g_caches_lock);
 		spdk_tree_remove_buffer(file->tree, buf);
-		if (file->tree->present_mask == 0) {
-			TAILQ_REMOVE(&g_caches, file, cache_tailq);
-		}
-		pthread_spin_unlock(&g_caches_lock);
+	} else {
+		buf->referenced = file->priority == SPDK_FILE_PRIORITY_HIGH ?
+				  CACHE_CLOCK_REF_HIGH : CACHE_CLOCK_REF_LOW;
 	}
 
 	sem_post(&channel->sem);
 	return 0;
 }
 
-int64_t
-spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
-	       void *payload, uint64_t offset, uint64_t length)
+/*
+ * Copy the cached part of a read and post the rest to the device, with the file locked.
+ *  The caller waits on the channel semaphore once per sub-read.
+ */
+static int64_t
+__file_read_submit(struct spdk_file *file, void *payload, uint64_t offset, uint64_t length,
+		   struct spdk_fs_channel *channel, uint32_t *sub_reads)
 {
-	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
 	uint64_t final_offset, final_length;
-	uint32_t sub_reads = 0;
 	int rc = 0;
 
-	pthread_spin_lock(&file->lock);
-
 	BLOBFS_TRACE_RW(file, "offset=%ju length=%ju\n", offset, length);
 
 	file->open_for_writing = false;
 
 	if (length == 0 || offset >= file->append_pos) {
-		pthread_spin_unlock(&file->lock);
 		return 0;
 	}
 
@@ -2850,16 +3123,7 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 		length = file->append_pos - offset;
 	}
 
-	if (offset != file->next_seq_offset) {
-		file->seq_byte_count = 0;
-	}
-	file->seq_byte_count += length;
-	file->next_seq_offset = offset + length;
-	if ((file->direct_io & BLOBFS_DIRECT_READ) == 0 && file->seq_byte_count >= file->prefetch_threshold) {
-		for (uint32_t i = 0; i < file->prefetch_size; i += CACHE_BUFFER_SIZE) {
-			check_readahead(file, offset + i, channel);
-		}
-	}
+	file_readahead(file, offset, length, channel);
 
 	final_length = 0;
 	final_offset = offset + length;
@@ -2869,7 +3133,7 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 			length = final_offset - offset;
 		}
 
-		sub_reads++;
+		(*sub_reads)++;
 		rc = __file_read(file, payload, offset, length, channel);
 		if (rc == 0) {
 			final_length += length;
@@ -2879,10 +3143,7 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 		payload += length;
 		offset += length;
 	}
-	pthread_spin_unlock(&file->lock);
-	while (sub_reads-- > 0) {
-		sem_wait(&channel->sem);
-	}
+
 	if (rc == 0) {
 		return final_length;
 	} else {
@@ -2890,14 +3151,57 @@ spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
 	}
 }
 
+int64_t
+spdk_file_read(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+	       void *payload, uint64_t offset, uint64_t length)
+{
+	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
+	uint32_t sub_reads = 0;
+	int64_t rc;
+
+	pthread_spin_lock(&file->lock);
+	rc = __file_read_submit(file, payload, offset, length, channel, &sub_reads);
+	pthread_spin_unlock(&file->lock);
+	while (sub_reads-- > 0) {
+		sem_wait(&channel->sem);
+	}
+
+	return rc;
+}
+
+int
+spdk_file_read_multi(struct spdk_file *file, struct spdk_fs_thread_ctx *ctx,
+		     struct spdk_file_read_vec *vecs, uint32_t count)
+{
+	struct spdk_fs_channel *channel = (struct spdk_fs_channel *)ctx;
+	uint32_t sub_reads = 0;
+	uint32_t i;
+	int rc = 0;
+
+	pthread_spin_lock(&file->lock);
+	for (i = 0; i < count; i++) {
+		vecs[i].rc = __file_read_submit(file, vecs[i].payload, vecs[i].offset, vecs[i].length,
+						channel, &sub_reads);
+		if (vecs[i].rc < 0 && rc == 0) {
+			rc = (int)vecs[i].rc;
+		}
+	}
+	pthread_spin_unlock(&file->lock);
+	while (sub_reads-- > 0) {
+		sem_wait(&channel->sem);
+	}
+
+	return rc;
+}
+
 static void
 _file_sync(struct spdk_file *file, struct spdk_fs_channel *channel,
 	   spdk_file_op_complete cb_fn, void *cb_arg)
 {
 	struct spdk_fs_request *sync_req;
-	struct spdk_fs_request *flush_req;
+	struct spdk_fs_request *flush_req = NULL;
 	struct spdk_fs_cb_args *sync_args;
-	struct spdk_fs_cb_args *flush_args;
+	struct cache_buffer *next;
 
 	BLOBFS_TRACE(file, "offset=%jx\n", file->append_pos);
 
@@ -2918,15 +3222,22 @@ _file_sync(struct spdk_file *file, struct spdk_fs_channel *channel,
 	}
 	sync_args = &sync_req->args;
 
-	flush_req = alloc_fs_request(channel);
-	if (!flush_req) {
-		SPDK_ERRLOG("Cannot allocate flush req for file=%s\n", file->name);
-		free_fs_request(sync_req);
-		pthread_spin_unlock(&file->lock);
-		cb_fn(cb_arg, -ENOMEM);
-		return;
+	/*
+	 * A flush in progress continues with the rest of the dirty buffers when it completes,
+	 *  so concurrent syncs of the same file share it instead of sending one each.
+	 */
+	next = spdk_tree_find_buffer(file->tree, file->length_flushed);
+	if (next == NULL || !next->in_progress || next->bytes_filled == next->bytes_flushed) {
+		flush_req = alloc_fs_request(channel);
+		if (!flush_req) {
+			SPDK_ERRLOG("Cannot allocate flush req for file=%s\n", file->name);
+			free_fs_request(sync_req);
+			pthread_spin_unlock(&file->lock);
+			cb_fn(cb_arg, -ENOMEM);
+			return;
+		}
+		flush_req->args.file = file;
 	}
-	flush_args = &flush_req->args;
 
 	sync_args->file = file;
 	sync_args->fn.file_op = cb_fn;
@@ -2936,8 +3247,9 @@ _file_sync(struct spdk_file *file, struct spdk_fs_channel *channel,
 	TAILQ_INSERT_TAIL(&file->sync_requests, sync_req, args.op.sync.tailq);
 	pthread_spin_unlock(&file->lock);
 
-	flush_args->file = file;
-	channel->send_request(__file_flush, flush_req);
+	if (flush_req != NULL) {
+		channel->send_request(__file_flush, flush_req);
+	}
 }
 
 int
@@ -2969,6 +3281,20 @@ spdk_file_set_priority(struct spdk_file *file, uint32_t priority)
 	file->priority = priority;
 }
 
+void
+spdk_file_set_readahead_hint(struct spdk_file *file, uint32_t hint)
+{
+	BLOBFS_TRACE(file, "readahead hint=%u\n", hint);
+	pthread_spin_lock(&file->lock);
+	if (hint == SPDK_FILE_READAHEAD_SEQUENTIAL && file->readahead_hint != hint) {
+		file->readahead_window = MAX_READAHEAD_SIZE;
+	}
+	file->readahead_hint = hint;
+	file->readahead_hits = 0;
+	file->readahead_wasted = 0;
+	pthread_spin_unlock(&file->lock);
+}
+
 /*
  * Close routines
  */
@@ -3102,21 +3428,12 @@ cache_free_buffers(struct spdk_file *file)
 {
 	BLOBFS_TRACE(file, "free=%s\n", file->name);
 	pthread_spin_lock(&file->lock);
-	pthread_spin_lock(&g_caches_lock);
 	if (file->tree->present_mask == 0) {
-		pthread_spin_unlock(&g_caches_lock);
 		pthread_spin_unlock(&file->lock);
 		return;
 	}
 	spdk_tree_free_buffers(file->tree);
-
-	TAILQ_REMOVE(&g_caches, file, cache_tailq);
-	/* If not freed, put it in the end of the queue */
-	if (file->tree->present_mask != 0) {
-		TAILQ_INSERT_TAIL(&g_caches, file, cache_tailq);
-	}
 	file->last = NULL;
-	pthread_spin_unlock(&g_caches_lock);
 	pthread_spin_unlock(&file->lock);
 }
 
@@ -34,6 +34,10 @@
 #ifndef SPDK_TREE_H_
 #define SPDK_TREE_H_
 
+#include "spdk/queue.h"
+
+struct spdk_file;
+
 struct cache_buffer {
 	uint8_t			*buf;
 	uint64_t		offset;
@@ -41,6 +45,14 @@ struct cache_buffer {
 	uint32_t		bytes_filled;
 	uint32_t		bytes_flushed;
 	bool			in_progress;
+	bool			readahead;	/* prefetched and not read yet */
+
+	/* CLOCK eviction state, protected by the lock of the clock shard */
+	struct spdk_file	*file;
+	uint8_t			referenced;
+	uint8_t			clock_shard;
+	bool			on_clock;
+	TAILQ_ENTRY(cache_buffer)	clock_tailq;
 };
 
 extern uint32_t g_fs_cache_buffer_shift;
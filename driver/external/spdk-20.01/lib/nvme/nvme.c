@@ -290,6 +290,7 @@ nvme_request_check_timeout(struct nvme_request *req, uint16_t cid,
 {
 	struct spdk_nvme_qpair *qpair = req->qpair;
 	struct spdk_nvme_ctrlr *ctrlr = qpair->ctrlr;
+	uint64_t timeout_ticks = active_proc->timeout_ticks;
 
 	assert(active_proc->timeout_cb_fn != NULL);
 
@@ -306,7 +307,11 @@ nvme_request_check_timeout(struct nvme_request *req, uint16_t cid,
 		return 0;
 	}
 
-	if (req->submit_tick + active_proc->timeout_ticks > now_tick) {
+	if (qpair->opc_timeout_ticks != NULL && qpair->opc_timeout_ticks[req->cmd.opc] != 0) {
+		timeout_ticks = qpair->opc_timeout_ticks[req->cmd.opc];
+	}
+
+	if (now_tick - req->submit_tick < timeout_ticks) {
 		return 1;
 	}
 
@@ -824,7 +824,10 @@ nvme_ctrlr_enable(struct spdk_nvme_ctrlr *ctrlr)
 		if (SPDK_NVME_CAP_AMS_WRR & ctrlr->cap.bits.ams) {
 			break;
 		}
-		return -EINVAL;
+		/* Fall back to round robin so WRR can be requested before CAP is known */
+		SPDK_WARNLOG("Weighted round robin arbitration is not supported, using round robin\n");
+		ctrlr->opts.arb_mechanism = SPDK_NVME_CC_AMS_RR;
+		break;
 	case SPDK_NVME_CC_AMS_VS:
 		if (SPDK_NVME_CAP_AMS_VS & ctrlr->cap.bits.ams) {
 			break;
@@ -416,6 +416,32 @@ struct spdk_nvme_qpair {
 	pthread_spinlock_t		sq_lock;
 	pthread_spinlock_t		cq_lock;
 	uint16_t 				current_qd; 
+
+	/* SQ doorbell is rung once every submit_batch submissions (0/1 = always) */
+	uint16_t			submit_batch;
+	uint16_t			num_unflushed;
+
+	/* Thread which acquired this qpair for lock-free use, 0 if shared */
+	pthread_t			owner;
+
+	/*
+	 * Per opcode timeout in ticks (0 = controller default, UINT64_MAX = never),
+	 *  NULL unless spdk_nvme_qpair_set_opc_timeout() was called. Outstanding
+	 *  requests are then scanned once every timeout_check_ticks.
+	 */
+	uint64_t			*opc_timeout_ticks;
+	uint64_t			timeout_check_ticks;
+	uint64_t			next_timeout_check_tick;
+
+	/* Requests taken from free_req and not freed yet, updated under req_lock */
+	uint32_t			num_active_reqs;
+
+	/*
+	 * eventfd signaled by submitters while cq_event_armed is set, so a completion
+	 *  poller can sleep on it while the qpair is idle. -1 if nobody sleeps on the qpair.
+	 */
+	int				cq_event_fd;
+	int				cq_event_armed;
 };
 
 struct spdk_nvme_ns {
@@ -916,6 +942,9 @@ int	nvme_fabric_ctrlr_discover(struct spdk_nvme_ctrlr *ctrlr,
 				   struct spdk_nvme_probe_ctx *probe_ctx);
 int	nvme_fabric_qpair_connect(struct spdk_nvme_qpair *qpair, uint32_t num_entries);
 
+void	nvme_pcie_qpair_flush_submissions(struct spdk_nvme_qpair *qpair);
+bool	nvme_pcie_qpair_has_timed_out_reqs(struct spdk_nvme_qpair *qpair);
+
 static inline struct nvme_request *
 nvme_allocate_request(struct spdk_nvme_qpair *qpair,
 		      const struct nvme_payload *payload, uint32_t payload_size,
@@ -938,6 +967,7 @@ nvme_allocate_request(struct spdk_nvme_qpair *qpair,
 	STAILQ_REMOVE_HEAD(&qpair->free_req, stailq);
 
 	if(!nvme_qpair_is_admin_queue(qpair)) {
+		__atomic_store_n(&qpair->num_active_reqs, qpair->num_active_reqs + 1, __ATOMIC_RELAXED);
 		pthread_spin_unlock(&qpair->req_lock);
 	}
 	/*
@@ -1035,6 +1065,7 @@ nvme_free_request(struct nvme_request *req)
 	STAILQ_INSERT_HEAD(&req->qpair->free_req, req, stailq);
 
 	if(!nvme_qpair_is_admin_queue(req->qpair)) {
+		__atomic_store_n(&req->qpair->num_active_reqs, req->qpair->num_active_reqs - 1, __ATOMIC_RELAXED);
 		pthread_spin_unlock(&req->qpair->req_lock);
 	}
 }
@@ -1063,6 +1094,7 @@ nvme_qpair_free_request(struct spdk_nvme_qpair *qpair, struct nvme_request *req)
 	STAILQ_INSERT_HEAD(&qpair->free_req, req, stailq);
 
 	if(!nvme_qpair_is_admin_queue(qpair)) {
+		__atomic_store_n(&qpair->num_active_reqs, qpair->num_active_reqs - 1, __ATOMIC_RELAXED);
 		pthread_spin_unlock(&qpair->req_lock);
 	}  
 }
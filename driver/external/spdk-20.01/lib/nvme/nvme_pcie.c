@@ -272,6 +272,35 @@ nvme_pcie_ctrlr(struct spdk_nvme_ctrlr *ctrlr)
 	return SPDK_CONTAINEROF(ctrlr, struct nvme_pcie_ctrlr, ctrlr);
 }
 
+/*
+ * NUMA socket the controller is attached to. Queue memory is placed there so
+ * that the device and the driver do not have to cross the socket interconnect.
+ */
+static int
+nvme_pcie_ctrlr_get_socket_id(struct spdk_nvme_ctrlr *ctrlr)
+{
+	struct nvme_pcie_ctrlr *pctrlr = nvme_pcie_ctrlr(ctrlr);
+
+	if (pctrlr->devhandle == NULL) {
+		return SPDK_ENV_SOCKET_ID_ANY;
+	}
+	return spdk_pci_device_get_socket_id(pctrlr->devhandle);
+}
+
+/*
+ * Allocate on the given socket, falling back to any socket if it has no free memory.
+ */
+static void *
+nvme_pcie_zmalloc_socket(size_t size, size_t align, int socket_id, uint32_t flags)
+{
+	void *buf = spdk_zmalloc(size, align, NULL, socket_id, flags);
+
+	if (buf == NULL && socket_id != SPDK_ENV_SOCKET_ID_ANY) {
+		buf = spdk_zmalloc(size, align, NULL, SPDK_ENV_SOCKET_ID_ANY, flags);
+	}
+	return buf;
+}
+
 static int
 _nvme_pcie_hotplug_monitor(struct spdk_nvme_probe_ctx *probe_ctx)
 {
@@ -1012,6 +1041,7 @@ nvme_pcie_qpair_construct(struct spdk_nvme_qpair *qpair,
 	uint32_t                flags = SPDK_MALLOC_DMA;
 	uint64_t		sq_paddr = 0;
 	uint64_t		cq_paddr = 0;
+	int			socket_id = nvme_pcie_ctrlr_get_socket_id(ctrlr);
 
 	if (opts) {
 		pqpair->sq_vaddr = opts->sq.vaddr;
@@ -1066,9 +1096,8 @@ nvme_pcie_qpair_construct(struct spdk_nvme_qpair *qpair,
 			/* To ensure physical address contiguity we make each ring occupy
 			 * a single hugepage only. See MAX_IO_QUEUE_ENTRIES.
 			 */
-			pqpair->cmd = spdk_zmalloc(pqpair->num_entries * sizeof(struct spdk_nvme_cmd),
-						   page_align, NULL,
-						   SPDK_ENV_SOCKET_ID_ANY, flags);
+			pqpair->cmd = nvme_pcie_zmalloc_socket(pqpair->num_entries * sizeof(struct spdk_nvme_cmd),
+							       page_align, socket_id, flags);
 			if (pqpair->cmd == NULL) {
 				SPDK_ERRLOG("alloc qpair_cmd failed\n");
 				return -ENOMEM;
@@ -1089,9 +1118,8 @@ nvme_pcie_qpair_construct(struct spdk_nvme_qpair *qpair,
 	if (pqpair->cq_vaddr) {
 		pqpair->cpl = pqpair->cq_vaddr;
 	} else {
-		pqpair->cpl = spdk_zmalloc(pqpair->num_entries * sizeof(struct spdk_nvme_cpl),
-					   page_align, NULL,
-					   SPDK_ENV_SOCKET_ID_ANY, flags);
+		pqpair->cpl = nvme_pcie_zmalloc_socket(pqpair->num_entries * sizeof(struct spdk_nvme_cpl),
+						       page_align, socket_id, flags);
 		if (pqpair->cpl == NULL) {
 			SPDK_ERRLOG("alloc qpair_cpl failed\n");
 			return -ENOMEM;
@@ -1118,8 +1146,8 @@ nvme_pcie_qpair_construct(struct spdk_nvme_qpair *qpair,
 	 *   This ensures the PRP list embedded in the nvme_tracker object will not span a
 	 *   4KB boundary, while allowing access to trackers in tr[] via normal array indexing.
 	 */
-	pqpair->tr = spdk_zmalloc(num_trackers * sizeof(*tr), sizeof(*tr), NULL,
-				  SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_SHARE);
+	pqpair->tr = nvme_pcie_zmalloc_socket(num_trackers * sizeof(*tr), sizeof(*tr),
+					      socket_id, SPDK_MALLOC_SHARE);
 	if (pqpair->tr == NULL) {
 		SPDK_ERRLOG("nvme_tr failed\n");
 		return -ENOMEM;
@@ -1127,7 +1155,10 @@ nvme_pcie_qpair_construct(struct spdk_nvme_qpair *qpair,
 
 	uint32_t total_prp_buffer_size = spdk_align32pow2(num_trackers * sizeof(struct nvme_tracker_dptr));
 	SPDK_DEBUGLOG("q[%d] prp_buffer_size=%d\n", pqpair->qpair.id, total_prp_buffer_size);
-	struct nvme_tracker_dptr* tr_dptr = spdk_dma_zmalloc(total_prp_buffer_size, total_prp_buffer_size, NULL);
+	struct nvme_tracker_dptr* tr_dptr = spdk_dma_zmalloc_socket(total_prp_buffer_size, total_prp_buffer_size, NULL, socket_id);
+	if (tr_dptr == NULL && socket_id != SPDK_ENV_SOCKET_ID_ANY) {
+		tr_dptr = spdk_dma_zmalloc(total_prp_buffer_size, total_prp_buffer_size, NULL);
+	}
 	if (tr_dptr == NULL) {
 		SPDK_ERRLOG("tr_dptr failed\n");
 		return -ENOMEM;
@@ -1340,10 +1371,47 @@ nvme_pcie_qpair_submit_tracker(struct spdk_nvme_qpair *qpair, struct nvme_tracke
 	}
 
 	if (!pqpair->flags.delay_cmd_submit) {
-		nvme_pcie_qpair_ring_sq_doorbell(qpair);
+		if (qpair->submit_batch <= 1 || ++qpair->num_unflushed >= qpair->submit_batch) {
+			nvme_pcie_qpair_ring_sq_doorbell(qpair);
+			qpair->num_unflushed = 0;
+		}
 	}
 }
 
+/*
+ * Ring the SQ doorbell for submissions held back by qpair->submit_batch.
+ * The caller must serialize this with submissions on the same qpair.
+ */
+void
+nvme_pcie_qpair_flush_submissions(struct spdk_nvme_qpair *qpair)
+{
+	if (qpair->num_unflushed == 0) {
+		return;
+	}
+
+	nvme_pcie_qpair_ring_sq_doorbell(qpair);
+	qpair->num_unflushed = 0;
+}
+
+/*
+ * Check whether a command whose timeout callback already fired is still outstanding.
+ * The caller must serialize this with submissions and completions on the same qpair.
+ */
+bool
+nvme_pcie_qpair_has_timed_out_reqs(struct spdk_nvme_qpair *qpair)
+{
+	struct nvme_pcie_qpair *pqpair = nvme_pcie_qpair(qpair);
+	struct nvme_tracker *tr;
+
+	TAILQ_FOREACH(tr, &pqpair->outstanding_tr, tq_list) {
+		if (tr->req != NULL && tr->req->timed_out) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
 static void
 nvme_pcie_qpair_complete_tracker(struct spdk_nvme_qpair *qpair, struct nvme_tracker *tr,
 				 struct spdk_nvme_cpl *cpl, bool print_on_error)
@@ -1679,8 +1747,8 @@ nvme_pcie_ctrlr_create_io_qpair(struct spdk_nvme_ctrlr *ctrlr, uint16_t qid,
 
 	assert(ctrlr != NULL);
 
-	pqpair = spdk_zmalloc(sizeof(*pqpair), 64, NULL,
-			      SPDK_ENV_SOCKET_ID_ANY, SPDK_MALLOC_SHARE);
+	pqpair = nvme_pcie_zmalloc_socket(sizeof(*pqpair), 64,
+					  nvme_pcie_ctrlr_get_socket_id(ctrlr), SPDK_MALLOC_SHARE);
 	if (pqpair == NULL) {
 		return NULL;
 	}
@@ -2235,10 +2303,23 @@ nvme_pcie_qpair_check_timeout(struct spdk_nvme_qpair *qpair)
 	}
 
 	t02 = spdk_get_ticks();
+
+	/*
+	 * With per opcode timeouts the outstanding list is no longer ordered by
+	 *  deadline, so it is scanned in full but only once per check interval.
+	 */
+	if (qpair->opc_timeout_ticks != NULL) {
+		if (t02 < qpair->next_timeout_check_tick) {
+			return;
+		}
+		qpair->next_timeout_check_tick = t02 + qpair->timeout_check_ticks;
+	}
+
 	TAILQ_FOREACH_SAFE(tr, &pqpair->outstanding_tr, tq_list, tmp) {
 		assert(tr->req != NULL);
 
-		if (nvme_request_check_timeout(tr->req, tr->cid, active_proc, t02)) {
+		if (nvme_request_check_timeout(tr->req, tr->cid, active_proc, t02) &&
+		    qpair->opc_timeout_ticks == NULL) {
 			/*
 			 * The requests are in order, so as soon as one has not timed out,
 			 * stop iterating.
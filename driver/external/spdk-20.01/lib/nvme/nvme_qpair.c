@@ -33,6 +33,7 @@
 
 #include "nvme_internal.h"
 #include "spdk/nvme_ocssd.h"
+#include "spdk/kvnvme_spdk.h"
 
 static void nvme_qpair_abort_reqs(struct spdk_nvme_qpair *qpair, uint32_t dnr);
 static int nvme_qpair_resubmit_request(struct spdk_nvme_qpair *qpair, struct nvme_request *req);
@@ -506,6 +507,75 @@ spdk_nvme_qpair_process_completions(struct spdk_nvme_qpair *qpair, uint32_t max_
 	return ret;
 }
 
+void
+spdk_nvme_qpair_set_submit_batch(struct spdk_nvme_qpair *qpair, uint16_t submit_batch)
+{
+	if (qpair->trtype != SPDK_NVME_TRANSPORT_PCIE) {
+		return;
+	}
+
+	qpair->submit_batch = submit_batch;
+	nvme_pcie_qpair_flush_submissions(qpair);
+}
+
+int
+spdk_nvme_qpair_set_opc_timeout(struct spdk_nvme_qpair *qpair, uint8_t opc, uint64_t timeout_us)
+{
+	uint64_t timeout_ticks;
+	int i;
+
+	if (qpair->opc_timeout_ticks == NULL) {
+		qpair->opc_timeout_ticks = calloc(256, sizeof(uint64_t));
+		if (qpair->opc_timeout_ticks == NULL) {
+			return -ENOMEM;
+		}
+	}
+
+	timeout_ticks = timeout_us ? timeout_us * spdk_get_ticks_hz() / 1000000ULL : UINT64_MAX;
+	qpair->opc_timeout_ticks[opc] = timeout_ticks ? timeout_ticks : 1;
+
+	/* Check often enough that a command overruns its deadline by at most 1/4 of the shortest timeout */
+	qpair->timeout_check_ticks = UINT64_MAX;
+	for (i = 0; i < 256; i++) {
+		if (qpair->opc_timeout_ticks[i] != 0 && qpair->opc_timeout_ticks[i] != UINT64_MAX) {
+			qpair->timeout_check_ticks = spdk_min(qpair->timeout_check_ticks,
+							      spdk_max(qpair->opc_timeout_ticks[i] / 4, 1));
+		}
+	}
+	if (qpair->timeout_check_ticks == UINT64_MAX) {
+		qpair->timeout_check_ticks = spdk_get_ticks_hz();
+	}
+	qpair->next_timeout_check_tick = 0;
+
+	return 0;
+}
+
+void
+spdk_nvme_qpair_flush_submissions(struct spdk_nvme_qpair *qpair)
+{
+	if (qpair->trtype != SPDK_NVME_TRANSPORT_PCIE) {
+		return;
+	}
+
+	nvme_pcie_qpair_flush_submissions(qpair);
+}
+
+uint32_t
+spdk_nvme_qpair_get_num_active_reqs(struct spdk_nvme_qpair *qpair)
+{
+	return __atomic_load_n(&qpair->num_active_reqs, __ATOMIC_RELAXED);
+}
+
+bool
+spdk_nvme_qpair_has_timed_out_reqs(struct spdk_nvme_qpair *qpair)
+{
+	if (qpair->trtype != SPDK_NVME_TRANSPORT_PCIE) {
+		return false;
+	}
+
+	return nvme_pcie_qpair_has_timed_out_reqs(qpair);
+}
+
 spdk_nvme_qp_failure_reason
 spdk_nvme_qpair_get_failure_reason(struct spdk_nvme_qpair *qpair)
 {
@@ -540,6 +610,15 @@ nvme_qpair_init(struct spdk_nvme_qpair *qpair, uint16_t id,
 	pthread_spin_init(&qpair->sq_lock, 0);
 	pthread_spin_init(&qpair->cq_lock, 0);
 	qpair->current_qd = 0;
+	qpair->submit_batch = 0;
+	qpair->num_unflushed = 0;
+	qpair->owner = 0;
+	qpair->opc_timeout_ticks = NULL;
+	qpair->timeout_check_ticks = 0;
+	qpair->num_active_reqs = 0;
+	qpair->cq_event_fd = -1;
+	qpair->cq_event_armed = 0;
+	qpair->next_timeout_check_tick = 0;
 
 	req_size_padded = (sizeof(struct nvme_request) + 63) & ~(size_t)63;
 
@@ -588,6 +667,8 @@ nvme_qpair_deinit(struct spdk_nvme_qpair *qpair)
 	}
 
 	spdk_free(qpair->req_buf);
+	free(qpair->opc_timeout_ticks);
+	qpair->opc_timeout_ticks = NULL;
 }
 
 static inline int
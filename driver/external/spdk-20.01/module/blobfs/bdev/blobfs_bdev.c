@@ -45,7 +45,9 @@
 
 #include "spdk_internal/log.h"
 
+#ifdef SPDK_CONFIG_FUSE
 #include "blobfs_fuse.h"
+#endif
 
 /* Dummy bdev module used to to claim bdevs. */
 static struct spdk_bdev_module blobfs_bdev_module = {
@@ -70,14 +72,17 @@ struct blobfs_bdev_operation_ctx {
 	spdk_blobfs_bdev_op_complete cb_fn;
 	void *cb_arg;
 
+#ifdef SPDK_CONFIG_FUSE
 	/* Variables for mount operation */
 	const char *mountpoint;
+	struct spdk_blobfs_fuse_opts fuse_opts;
 	struct spdk_thread *fs_loading_thread;
 
 	/* Used in bdev_event_cb to do some proper operations on blobfs_fuse for
 	 * asynchronous event of the backend bdev.
 	 */
 	struct spdk_blobfs_fuse *bfuse;
+#endif
 };
 
 static void
@@ -252,7 +257,7 @@ _blobfs_bdev_mount_fuse_start(void *_ctx)
 	ctx->cb_fn = NULL;
 
 	rc = spdk_blobfs_fuse_start(ctx->bdev_name, ctx->mountpoint, ctx->fs,
-				    blobfs_bdev_unmount, ctx, &ctx->bfuse);
+				    &ctx->fuse_opts, blobfs_bdev_unmount, ctx, &ctx->bfuse);
 	if (rc != 0) {
 		SPDK_ERRLOG("Failed to mount blobfs on bdev %s to %s\n", ctx->bdev_name, ctx->mountpoint);
 
@@ -300,8 +305,15 @@ blobfs_bdev_fuse_event_cb(enum spdk_bdev_event_type type, struct spdk_bdev *bdev
 }
 
 void
-spdk_blobfs_bdev_mount(const char *bdev_name, const char *mountpoint,
-		       spdk_blobfs_bdev_op_complete cb_fn, void *cb_arg)
+spdk_blobfs_fuse_opts_init(struct spdk_blobfs_fuse_opts *opts)
+{
+	memset(opts, 0, sizeof(*opts));
+}
+
+void
+spdk_blobfs_bdev_mount_ext(const char *bdev_name, const char *mountpoint,
+			   const struct spdk_blobfs_fuse_opts *opts,
+			   spdk_blobfs_bdev_op_complete cb_fn, void *cb_arg)
 {
 	struct blobfs_bdev_operation_ctx *ctx;
 	struct spdk_bs_dev *bs_dev;
@@ -318,6 +330,11 @@ spdk_blobfs_bdev_mount(const char *bdev_name, const char *mountpoint,
 
 	ctx->bdev_name = bdev_name;
 	ctx->mountpoint = mountpoint;
+	if (opts != NULL) {
+		ctx->fuse_opts = *opts;
+	} else {
+		spdk_blobfs_fuse_opts_init(&ctx->fuse_opts);
+	}
 	ctx->cb_fn = cb_fn;
 	ctx->cb_arg = cb_arg;
 
@@ -355,4 +372,11 @@ invalid:
 	cb_fn(cb_arg, rc);
 }
 
+void
+spdk_blobfs_bdev_mount(const char *bdev_name, const char *mountpoint,
+		       spdk_blobfs_bdev_op_complete cb_fn, void *cb_arg)
+{
+	spdk_blobfs_bdev_mount_ext(bdev_name, mountpoint, NULL, cb_fn, cb_arg);
+}
+
 #endif
@@ -33,11 +33,13 @@
 
 #include "spdk/stdinc.h"
 
+#include "spdk/likely.h"
 #include "spdk/log.h"
 #include "spdk/env.h"
 #include "spdk/event.h"
 #include "spdk/thread.h"
 #include "spdk/string.h"
+#include "spdk/util.h"
 #include "spdk/blobfs.h"
 
 #include "blobfs_fuse.h"
@@ -49,8 +51,8 @@
 struct spdk_blobfs_fuse {
 	char *bdev_name;
 	char *mountpoint;
-	struct spdk_fs_thread_ctx *channel;
 	struct spdk_filesystem *fs;
+	struct spdk_blobfs_fuse_opts opts;
 
 	struct fuse *fuse_handle;
 	pthread_t	fuse_tid;
@@ -59,8 +61,43 @@ struct spdk_blobfs_fuse {
 	void *cb_arg;
 };
 
-/* Each thread serves one blobfs */
+/* Each thread serves one blobfs, through its own blobfs thread context. The
+ * FUSE threads of a multithreaded loop come and go, so the context is made
+ * by the first request of a thread and freed when the thread exits.
+ */
 static __thread struct spdk_blobfs_fuse *thd_bfuse;
+static __thread struct spdk_fs_thread_ctx *thd_channel;
+static pthread_key_t g_channel_key;
+static pthread_once_t g_channel_key_once = PTHREAD_ONCE_INIT;
+
+static void
+blobfs_fuse_channel_free(void *channel)
+{
+	spdk_fs_free_thread_ctx(channel);
+}
+
+static void
+blobfs_fuse_channel_key_init(void)
+{
+	pthread_key_create(&g_channel_key, blobfs_fuse_channel_free);
+}
+
+static int
+blobfs_fuse_thread_init(void)
+{
+	if (spdk_likely(thd_channel != NULL)) {
+		return 0;
+	}
+
+	thd_bfuse = fuse_get_context()->private_data;
+	thd_channel = spdk_fs_alloc_thread_ctx(thd_bfuse->fs);
+	if (thd_channel == NULL) {
+		return -ENOMEM;
+	}
+	pthread_setspecific(g_channel_key, thd_channel);
+
+	return 0;
+}
 
 static void
 blobfs_fuse_free(struct spdk_blobfs_fuse *bfuse)
@@ -98,13 +135,18 @@ spdk_fuse_getattr(const char *path, struct stat *stbuf, struct fuse_file_info *f
 	struct spdk_file_stat stat;
 	int rc;
 
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
 	if (!strcmp(path, "/")) {
 		stbuf->st_mode = S_IFDIR | 0755;
 		stbuf->st_nlink = 2;
 		return 0;
 	}
 
-	rc = spdk_fs_file_stat(thd_bfuse->fs, thd_bfuse->channel, path, &stat);
+	rc = spdk_fs_file_stat(thd_bfuse->fs, thd_channel, path, &stat);
 	if (rc == 0) {
 		stbuf->st_mode = S_IFREG | 0644;
 		stbuf->st_nlink = 1;
@@ -122,6 +164,12 @@ spdk_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 	struct spdk_file *file;
 	const char *filename;
 	spdk_fs_iter iter;
+	int rc;
+
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
 
 	filler(buf, ".", NULL, 0, 0);
 	filler(buf, "..", NULL, 0, 0);
@@ -140,13 +188,27 @@ spdk_fuse_readdir(const char *path, void *buf, fuse_fill_dir_t filler,
 static int
 spdk_fuse_mknod(const char *path, mode_t mode, dev_t rdev)
 {
-	return spdk_fs_create_file(thd_bfuse->fs, thd_bfuse->channel, path);
+	int rc;
+
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	return spdk_fs_create_file(thd_bfuse->fs, thd_channel, path);
 }
 
 static int
 spdk_fuse_unlink(const char *path)
 {
-	return spdk_fs_delete_file(thd_bfuse->fs, thd_bfuse->channel, path);
+	int rc;
+
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	return spdk_fs_delete_file(thd_bfuse->fs, thd_channel, path);
 }
 
 static int
@@ -155,17 +217,22 @@ spdk_fuse_truncate(const char *path, off_t size, struct fuse_file_info *fi)
 	struct spdk_file *file;
 	int rc;
 
-	rc = spdk_fs_open_file(thd_bfuse->fs, thd_bfuse->channel, path, 0, &file);
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = spdk_fs_open_file(thd_bfuse->fs, thd_channel, path, 0, &file);
 	if (rc != 0) {
 		return -rc;
 	}
 
-	rc = spdk_file_truncate(file, thd_bfuse->channel, size);
+	rc = spdk_file_truncate(file, thd_channel, size);
 	if (rc != 0) {
 		return -rc;
 	}
 
-	spdk_file_close(file, thd_bfuse->channel);
+	spdk_file_close(file, thd_channel);
 
 	return 0;
 }
@@ -182,12 +249,18 @@ spdk_fuse_open(const char *path, struct fuse_file_info *info)
 	struct spdk_file *file;
 	int rc;
 
-	rc = spdk_fs_open_file(thd_bfuse->fs, thd_bfuse->channel, path, 0, &file);
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = spdk_fs_open_file(thd_bfuse->fs, thd_channel, path, 0, &file);
 	if (rc != 0) {
 		return -rc;
 	}
 
 	info->fh = (uintptr_t)file;
+	info->direct_io = thd_bfuse->opts.direct_io;
 	return 0;
 }
 
@@ -195,16 +268,28 @@ static int
 spdk_fuse_release(const char *path, struct fuse_file_info *info)
 {
 	struct spdk_file *file = (struct spdk_file *)info->fh;
+	int rc;
+
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
 
-	return spdk_file_close(file, thd_bfuse->channel);
+	return spdk_file_close(file, thd_channel);
 }
 
 static int
 spdk_fuse_read(const char *path, char *buf, size_t len, off_t offset, struct fuse_file_info *info)
 {
 	struct spdk_file *file = (struct spdk_file *)info->fh;
+	int rc;
 
-	return spdk_file_read(file, thd_bfuse->channel, buf, offset, len);
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	return spdk_file_read(file, thd_channel, buf, offset, len);
 }
 
 static int
@@ -214,7 +299,12 @@ spdk_fuse_write(const char *path, const char *buf, size_t len, off_t offset,
 	struct spdk_file *file = (struct spdk_file *)info->fh;
 	int rc;
 
-	rc = spdk_file_write(file, thd_bfuse->channel, (void *)buf, offset, len);
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	rc = spdk_file_write(file, thd_channel, (void *)buf, offset, len);
 	if (rc == 0) {
 		return len;
 	} else {
@@ -237,10 +327,49 @@ spdk_fuse_fsync(const char *path, int datasync, struct fuse_file_info *info)
 static int
 spdk_fuse_rename(const char *old_path, const char *new_path, unsigned int flags)
 {
-	return spdk_fs_rename_file(thd_bfuse->fs, thd_bfuse->channel, old_path, new_path);
+	int rc;
+
+	rc = blobfs_fuse_thread_init();
+	if (rc != 0) {
+		return rc;
+	}
+
+	return spdk_fs_rename_file(thd_bfuse->fs, thd_channel, old_path, new_path);
+}
+
+static void *
+spdk_fuse_init(struct fuse_conn_info *conn, struct fuse_config *cfg)
+{
+	struct spdk_blobfs_fuse *bfuse = fuse_get_context()->private_data;
+	unsigned int want = 0;
+
+	if (bfuse->opts.max_write != 0) {
+		conn->max_write = bfuse->opts.max_write;
+	}
+	if (bfuse->opts.max_read != 0) {
+		conn->max_read = bfuse->opts.max_read;
+	}
+
+	if (bfuse->opts.splice) {
+		want |= FUSE_CAP_SPLICE_READ | FUSE_CAP_SPLICE_WRITE | FUSE_CAP_SPLICE_MOVE;
+	}
+	/* Page cache write-back would bypass the direct I/O asked for */
+	if (bfuse->opts.writeback_cache && !bfuse->opts.direct_io) {
+		want |= FUSE_CAP_WRITEBACK_CACHE;
+	}
+	if ((want & conn->capable) != want) {
+		SPDK_NOTICELOG("Kernel does not support FUSE capabilities 0x%x\n",
+			       want & ~conn->capable);
+	}
+	conn->want |= want & conn->capable;
+
+	cfg->direct_io = bfuse->opts.direct_io;
+
+	return bfuse;
 }
 
 static struct fuse_operations spdk_fuse_oper = {
+	.init		= spdk_fuse_init,
 	.getattr	= spdk_fuse_getattr,
 	.readdir	= spdk_fuse_readdir,
 	.mknod		= spdk_fuse_mknod,
@@ -263,18 +392,25 @@ fuse_loop_new_thread(void *arg)
 
 	spdk_unaffinitize_thread();
 
-	thd_bfuse = bfuse;
-	SPDK_NOTICELOG("Start to loop blobfs on bdev %s mounted at %s\n", bfuse->bdev_name,
-		       bfuse->mountpoint);
+	SPDK_NOTICELOG("Start to loop blobfs on bdev %s mounted at %s (%s)\n", bfuse->bdev_name,
+		       bfuse->mountpoint, bfuse->opts.multithread ? "multithread" : "single thread");
 
-	bfuse->channel = spdk_fs_alloc_thread_ctx(bfuse->fs);
-
-	fuse_loop(bfuse->fuse_handle);
+	if (bfuse->opts.multithread) {
+		/* Returns after its worker threads, and their blobfs contexts, are gone */
+		fuse_loop_mt(bfuse->fuse_handle, 0);
+	} else {
+		fuse_loop(bfuse->fuse_handle);
+	}
 	fuse_unmount(bfuse->fuse_handle);
 	fuse_destroy(bfuse->fuse_handle);
 	SPDK_NOTICELOG("Blobfs on bdev %s unmounted from %s\n", bfuse->bdev_name, bfuse->mountpoint);
 
-	spdk_fs_free_thread_ctx(bfuse->channel);
+	/* The context of this thread has to go before the filesystem is unloaded */
+	if (thd_channel != NULL) {
+		pthread_setspecific(g_channel_key, NULL);
+		spdk_fs_free_thread_ctx(thd_channel);
+		thd_channel = NULL;
+	}
 
 	bfuse->cb_fn(bfuse->cb_arg);
 
@@ -285,10 +421,12 @@ fuse_loop_new_thread(void *arg)
 
 int
 spdk_blobfs_fuse_start(const char *bdev_name, const char *mountpoint, struct spdk_filesystem *fs,
+		       const struct spdk_blobfs_fuse_opts *fuse_opts,
 		       blobfs_fuse_unmount_cb cb_fn, void *cb_arg, struct spdk_blobfs_fuse **_bfuse)
 {
 	/* Set argv[1] as bdev_name in order to show bdev_name as the mounting source */
-	char *argv[1] = {(char *)bdev_name};
+	char max_read_opt[32];
+	char *argv[3] = {(char *)bdev_name, "-o", max_read_opt};
 	struct fuse_args args = FUSE_ARGS_INIT(1, argv);
 	struct fuse_cmdline_opts opts = {};
 	struct fuse *fuse_handle;
@@ -301,16 +439,28 @@ spdk_blobfs_fuse_start(const char *bdev_name, const char *mountpoint, struct spd
 		return -ENOMEM;
 	}
 
+	bfuse->opts = *fuse_opts;
+	bfuse->opts.max_write = spdk_min(bfuse->opts.max_write, SPDK_BLOBFS_FUSE_MAX_IO_SIZE);
+	bfuse->opts.max_read = spdk_min(bfuse->opts.max_read, SPDK_BLOBFS_FUSE_MAX_IO_SIZE);
+
+	/* The kernel takes max_read from the mount options only */
+	if (bfuse->opts.max_read != 0) {
+		snprintf(max_read_opt, sizeof(max_read_opt), "max_read=%u", bfuse->opts.max_read);
+		args.argc = 3;
+	}
+
 	rc = fuse_parse_cmdline(&args, &opts);
 	assert(rc == 0);
 
+	pthread_once(&g_channel_key_once, blobfs_fuse_channel_key_init);
+
 	bfuse->bdev_name = strdup(bdev_name);
 	bfuse->mountpoint = strdup(mountpoint);
 	bfuse->fs = fs;
 	bfuse->cb_fn = cb_fn;
 	bfuse->cb_arg = cb_arg;
 
-	fuse_handle = fuse_new(&args, &spdk_fuse_oper, sizeof(spdk_fuse_oper), NULL);
+	fuse_handle = fuse_new(&args, &spdk_fuse_oper, sizeof(spdk_fuse_oper), bfuse);
 	fuse_opt_free_args(&args);
 	if (fuse_handle == NULL) {
 		SPDK_ERRLOG("could not create fuse handle!\n");
@@ -36,6 +36,7 @@
 
 #include "spdk/stdinc.h"
 #include "spdk/blobfs.h"
+#include "spdk/blobfs_bdev.h"
 
 struct spdk_blobfs_fuse;
 
@@ -44,8 +45,8 @@ void spdk_blobfs_fuse_send_request(fs_request_fn fn, void *arg);
 typedef void (*blobfs_fuse_unmount_cb)(void *arg);
 
 int spdk_blobfs_fuse_start(const char *bdev_name, const char *mountpoint,
-			   struct spdk_filesystem *fs, blobfs_fuse_unmount_cb cb_fn,
-			   void *cb_arg, struct spdk_blobfs_fuse **bfuse);
+			   struct spdk_filesystem *fs, const struct spdk_blobfs_fuse_opts *opts,
+			   blobfs_fuse_unmount_cb cb_fn, void *cb_arg, struct spdk_blobfs_fuse **bfuse);
 
 void spdk_blobfs_fuse_stop(struct spdk_blobfs_fuse *bfuse);
 
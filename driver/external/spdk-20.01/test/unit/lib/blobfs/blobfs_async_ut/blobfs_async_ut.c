@@ -55,8 +55,6 @@ DEFINE_STUB_V(spdk_trace_register_description, (const char *name,
 		uint16_t tpoint_id, uint8_t owner_type,
 		uint8_t object_type, uint8_t new_object,
 		uint8_t arg1_is_ptr, const char *arg1_name));
-DEFINE_STUB_V(_spdk_trace_record, (uint64_t tsc, uint16_t tpoint_id, uint16_t poller_id,
-				   uint32_t size, uint64_t object_id, uint64_t arg1));
 
 /* Return NULL to test hardcoded defaults. */
 struct spdk_conf_section *
@@ -527,6 +525,116 @@ fs_writev_readv_async(void)
 	CU_ASSERT(g_fserrno == 0);
 }
 
+static uint32_t g_xattr_updates;
+static uint32_t g_syncs_done;
+
+void
+_spdk_trace_record(uint64_t tsc, uint16_t tpoint_id, uint16_t poller_id,
+		   uint32_t size, uint64_t object_id, uint64_t arg1)
+{
+	if (tpoint_id == TRACE_BLOBFS_XATTR_START) {
+		g_xattr_updates++;
+	}
+}
+
+static void
+sync_cb(void *ctx, int fserrno)
+{
+	g_fserrno = fserrno;
+	g_syncs_done++;
+}
+
+static void
+fs_sync_group_commit(void)
+{
+	struct spdk_filesystem *fs;
+	struct spdk_bs_dev *dev;
+	struct spdk_trace_histories *histories;
+	struct cache_buffer *buf;
+	uint32_t i;
+
+	dev = init_dev();
+
+	spdk_fs_init(dev, NULL, NULL, fs_op_with_handle_complete, NULL);
+	poll_threads();
+	SPDK_CU_ASSERT_FATAL(g_fs != NULL);
+	CU_ASSERT(g_fserrno == 0);
+	fs = g_fs;
+
+	g_file = NULL;
+	g_fserrno = 1;
+	spdk_fs_open_file_async(fs, "file1", SPDK_BLOBFS_OPEN_CREATE, open_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	/* Give the file room for one cache buffer, without data yet */
+	g_fserrno = 1;
+	spdk_file_truncate_async(g_file, CACHE_BUFFER_SIZE, fs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+	CU_ASSERT(g_file->append_pos == 0);
+
+	/* Count the xattr length updates through their tracepoint */
+	histories = calloc(1, sizeof(*histories));
+	SPDK_CU_ASSERT_FATAL(histories != NULL);
+	histories->flags.tpoint_mask[TRACE_GROUP_BLOBFS] = 1ULL << (TRACE_BLOBFS_XATTR_START & 0x3F);
+	g_trace_histories = histories;
+	g_xattr_updates = 0;
+	g_syncs_done = 0;
+
+	/* Buffered append of 4KB */
+	buf = cache_insert_buffer(g_file, 0);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	memset(buf->buf, 0x5a, 8192);
+	buf->bytes_filled = 4096;
+	g_file->append_pos = 4096;
+
+	/* Three syncs of the same data share one flush and one xattr update */
+	g_fserrno = 1;
+	for (i = 0; i < 3; i++) {
+		spdk_file_sync_async(g_file, fs->sync_target.sync_io_channel, sync_cb, NULL);
+	}
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+	CU_ASSERT(g_syncs_done == 3);
+	CU_ASSERT(g_xattr_updates == 1);
+	CU_ASSERT(g_file->length_xattr == 4096);
+	CU_ASSERT(TAILQ_EMPTY(&g_file->sync_requests));
+
+	/* Another 4KB and two more syncs add a single update */
+	buf->bytes_filled = 8192;
+	g_file->append_pos = 8192;
+	g_fserrno = 1;
+	spdk_file_sync_async(g_file, fs->sync_target.sync_io_channel, sync_cb, NULL);
+	spdk_file_sync_async(g_file, fs->sync_target.sync_io_channel, sync_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+	CU_ASSERT(g_syncs_done == 5);
+	CU_ASSERT(g_xattr_updates == 2);
+	CU_ASSERT(g_file->length_xattr == 8192);
+	CU_ASSERT(buf->bytes_flushed == 8192);
+
+	/* Nothing new to sync completes without an update */
+	spdk_file_sync_async(g_file, fs->sync_target.sync_io_channel, sync_cb, NULL);
+	poll_threads();
+	CU_ASSERT(g_syncs_done == 6);
+	CU_ASSERT(g_xattr_updates == 2);
+
+	g_trace_histories = NULL;
+	free(histories);
+
+	g_fserrno = 1;
+	spdk_file_close_async(g_file, fs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+
+	g_fserrno = 1;
+	spdk_fs_unload(fs, fs_op_complete, NULL);
+	poll_threads();
+	CU_ASSERT(g_fserrno == 0);
+}
+
 static void
 tree_find_buffer_ut(void)
 {
@@ -683,6 +791,7 @@ int main(int argc, char **argv)
 		CU_add_test(suite, "fs_rename", fs_rename) == NULL ||
 		CU_add_test(suite, "fs_rw_async", fs_rw_async) == NULL ||
 		CU_add_test(suite, "fs_writev_readv_async", fs_writev_readv_async) == NULL ||
+		CU_add_test(suite, "fs_sync_group_commit", fs_sync_group_commit) == NULL ||
 		CU_add_test(suite, "tree_find_buffer", tree_find_buffer_ut) == NULL ||
 		CU_add_test(suite, "channel_ops", channel_ops) == NULL ||
 		CU_add_test(suite, "channel_ops_sync", channel_ops_sync) == NULL
@@ -133,7 +133,8 @@ spdk_bs_bdev_claim(struct spdk_bs_dev *bs_dev, struct spdk_bdev_module *module)
 
 int
 spdk_blobfs_fuse_start(const char *bdev_name, const char *mountpoint, struct spdk_filesystem *fs,
-		       blobfs_fuse_unmount_cb cb_fn, void *cb_arg, struct spdk_blobfs_fuse **_bfuse)
+		       const struct spdk_blobfs_fuse_opts *opts, blobfs_fuse_unmount_cb cb_fn,
+		       void *cb_arg, struct spdk_blobfs_fuse **_bfuse)
 {
 	if (g_blobfs_fuse_start_fail) {
 		return -1;
@@ -85,6 +85,12 @@ send_request(fs_request_fn fn, void *arg)
 	spdk_thread_send_msg(g_dispatch_thread, (spdk_msg_fn)fn, arg);
 }
 
+static void
+send_request_mq(fs_request_fn fn, void *arg, int qid)
+{
+	send_request(fn, arg);
+}
+
 static void
 ut_call_fn(void *arg)
 {
@@ -138,6 +144,7 @@ _fs_init(void *arg)
 	SPDK_CU_ASSERT_FATAL(g_fs != NULL);
 	SPDK_CU_ASSERT_FATAL(g_fs->bdev == dev);
 	CU_ASSERT(g_fserrno == 0);
+	set_fs_set_send_request_mq_fn(g_fs, send_request_mq);
 }
 
 static void
@@ -156,6 +163,7 @@ _fs_load(void *arg)
 	SPDK_CU_ASSERT_FATAL(g_fs != NULL);
 	SPDK_CU_ASSERT_FATAL(g_fs->bdev == dev);
 	CU_ASSERT(g_fserrno == 0);
+	set_fs_set_send_request_mq_fn(g_fs, send_request_mq);
 }
 
 static void
@@ -597,6 +605,386 @@ fs_delete_file_without_close(void)
 
 }
 
+static struct cache_buffer *
+ut_clock_insert_clean(struct spdk_file *file, uint64_t index)
+{
+	struct cache_buffer *buf;
+
+	buf = cache_insert_buffer(file, index * CACHE_BUFFER_SIZE);
+	SPDK_CU_ASSERT_FATAL(buf != NULL);
+	buf->bytes_filled = CACHE_BUFFER_SIZE;
+	buf->bytes_flushed = CACHE_BUFFER_SIZE;
+
+	return buf;
+}
+
+/* Make the cache pool look exhausted, so that allocations have to evict */
+static size_t
+ut_cache_pool_drain(void)
+{
+	struct test_mempool *mp = (struct test_mempool *)g_cache_pool;
+	size_t count = mp->count;
+
+	mp->count = 0;
+	return count;
+}
+
+static void
+ut_cache_pool_restore(size_t count)
+{
+	struct test_mempool *mp = (struct test_mempool *)g_cache_pool;
+
+	mp->count += count;
+}
+
+static void
+cache_clock_second_chance(void)
+{
+	int rc;
+	size_t pool_count;
+	void *buf1, *buf2;
+	struct cache_buffer *hit, *cold;
+	struct spdk_fs_thread_ctx *channel;
+
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_thread_ctx(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	/* Buffers CACHE_CLOCK_SHARDS apart in one file share a shard */
+	hit = ut_clock_insert_clean(g_file, 0);
+	cold = ut_clock_insert_clean(g_file, CACHE_CLOCK_SHARDS);
+	CU_ASSERT(hit->clock_shard == cold->clock_shard);
+	hit->referenced = CACHE_CLOCK_REF_HIGH;
+	cold->referenced = 0;
+
+	pool_count = ut_cache_pool_drain();
+
+	/* The buffer ahead on the ring was hit, so the one behind it goes first */
+	buf1 = alloc_cache_memory_buffer(NULL);
+	SPDK_CU_ASSERT_FATAL(buf1 != NULL);
+	CU_ASSERT(spdk_tree_find_buffer(g_file->tree, 0) == hit);
+	CU_ASSERT(spdk_tree_find_buffer(g_file->tree, CACHE_CLOCK_SHARDS * CACHE_BUFFER_SIZE) == NULL);
+	CU_ASSERT(hit->referenced == CACHE_CLOCK_REF_HIGH - 1);
+	CU_ASSERT(g_cache_clock[hit->clock_shard].count == 1);
+
+	/* Each sweep takes one reference away until the hit buffer is evicted as well */
+	buf2 = alloc_cache_memory_buffer(NULL);
+	SPDK_CU_ASSERT_FATAL(buf2 != NULL);
+	CU_ASSERT(g_file->tree->present_mask == 0);
+
+	CU_ASSERT(alloc_cache_memory_buffer(NULL) == NULL);
+
+	spdk_mempool_put(g_cache_pool, buf1);
+	spdk_mempool_put(g_cache_pool, buf2);
+	ut_cache_pool_restore(pool_count);
+
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_thread_ctx(channel);
+
+	ut_send_request(_fs_unload, NULL);
+}
+
+static void
+cache_clock_eviction_order(void)
+{
+	int rc;
+	size_t pool_count;
+	void *buf1, *buf2;
+	struct spdk_file *lo_file, *hi_file;
+	struct cache_buffer *lo_buf, *hi_buf, *dirty;
+	struct spdk_fs_thread_ctx *channel;
+
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_thread_ctx(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "lofile", SPDK_BLOBFS_OPEN_CREATE, &lo_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(lo_file != NULL);
+	rc = spdk_fs_open_file(g_fs, channel, "hifile", SPDK_BLOBFS_OPEN_CREATE, &hi_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(hi_file != NULL);
+	spdk_file_set_priority(hi_file, SPDK_FILE_PRIORITY_HIGH);
+
+	hi_buf = ut_clock_insert_clean(hi_file, 0);
+	hi_buf->referenced = 0;
+	lo_buf = ut_clock_insert_clean(lo_file, 0);
+	lo_buf->referenced = CACHE_CLOCK_REF_LOW;
+	dirty = ut_clock_insert_clean(lo_file, 1);
+	dirty->referenced = 0;
+	dirty->bytes_flushed = 0;
+
+	pool_count = ut_cache_pool_drain();
+
+	/* Low priority files are swept first, even if their buffers were hit */
+	buf1 = alloc_cache_memory_buffer(NULL);
+	SPDK_CU_ASSERT_FATAL(buf1 != NULL);
+	CU_ASSERT(spdk_tree_find_buffer(lo_file->tree, 0) == NULL);
+	CU_ASSERT(spdk_tree_find_buffer(lo_file->tree, CACHE_BUFFER_SIZE) == dirty);
+	CU_ASSERT(spdk_tree_find_buffer(hi_file->tree, 0) == hi_buf);
+
+	/* Buffers of the allocating file are left alone */
+	CU_ASSERT(alloc_cache_memory_buffer(hi_file) == NULL);
+	CU_ASSERT(spdk_tree_find_buffer(hi_file->tree, 0) == hi_buf);
+
+	/* Then high priority files, dirty buffers are never evicted */
+	buf2 = alloc_cache_memory_buffer(NULL);
+	SPDK_CU_ASSERT_FATAL(buf2 != NULL);
+	CU_ASSERT(hi_file->tree->present_mask == 0);
+	CU_ASSERT(spdk_tree_find_buffer(lo_file->tree, CACHE_BUFFER_SIZE) == dirty);
+
+	CU_ASSERT(alloc_cache_memory_buffer(NULL) == NULL);
+	CU_ASSERT(spdk_tree_find_buffer(lo_file->tree, CACHE_BUFFER_SIZE) == dirty);
+
+	spdk_mempool_put(g_cache_pool, buf1);
+	spdk_mempool_put(g_cache_pool, buf2);
+	ut_cache_pool_restore(pool_count);
+
+	dirty->bytes_flushed = CACHE_BUFFER_SIZE;
+	cache_free_buffers(lo_file);
+
+	spdk_file_close(lo_file, channel);
+	spdk_file_close(hi_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "lofile");
+	CU_ASSERT(rc == 0);
+	rc = spdk_fs_delete_file(g_fs, channel, "hifile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_thread_ctx(channel);
+
+	ut_send_request(_fs_unload, NULL);
+}
+
+static uint32_t g_readahead_count;
+
+/* Complete readahead requests in place, as if the blob read finished */
+static void
+ut_send_readahead(fs_request_fn fn, void *arg, int qid)
+{
+	struct spdk_fs_request *req = arg;
+	struct spdk_fs_cb_args *args = &req->args;
+	struct cache_buffer *cache_buffer = args->op.readahead.cache_buffer;
+
+	if (fn != __readahead) {
+		send_request_mq(fn, arg, qid);
+		return;
+	}
+
+	cache_buffer->bytes_filled = args->op.readahead.length;
+	cache_buffer->bytes_flushed = args->op.readahead.length;
+	cache_buffer->in_progress = false;
+	free_fs_request(req);
+	g_readahead_count++;
+}
+
+static void
+ut_readahead(struct spdk_file *file, struct spdk_fs_thread_ctx *channel,
+	     uint64_t offset, uint64_t length)
+{
+	pthread_spin_lock(&file->lock);
+	file_readahead(file, offset, length, (struct spdk_fs_channel *)channel);
+	pthread_spin_unlock(&file->lock);
+}
+
+static bool
+ut_is_readahead(struct spdk_file *file, uint64_t index)
+{
+	struct cache_buffer *buf;
+
+	buf = spdk_tree_find_buffer(file->tree, index * CACHE_BUFFER_SIZE);
+	return buf != NULL && buf->readahead;
+}
+
+static void
+readahead_hint(void)
+{
+	int rc;
+	struct spdk_fs_thread_ctx *channel;
+
+	ut_send_request(_fs_init, NULL);
+
+	set_fs_set_send_request_mq_fn(g_fs, ut_send_readahead);
+	channel = spdk_fs_alloc_thread_ctx(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	rc = spdk_file_truncate(g_file, channel, 40 * CACHE_BUFFER_SIZE);
+	CU_ASSERT(rc == 0);
+
+	/* RANDOM: scattered reads prefetch nothing */
+	g_readahead_count = 0;
+	spdk_file_set_readahead_hint(g_file, SPDK_FILE_READAHEAD_RANDOM);
+	ut_readahead(g_file, channel, 0, 4096);
+	ut_readahead(g_file, channel, 10 * CACHE_BUFFER_SIZE, 4096);
+	CU_ASSERT(g_readahead_count == 0);
+
+	/* RANDOM: a reader that turns sequential still gets readahead */
+	ut_readahead(g_file, channel, 0, CACHE_READAHEAD_THRESHOLD / 2);
+	CU_ASSERT(g_readahead_count == 0);
+	ut_readahead(g_file, channel, CACHE_READAHEAD_THRESHOLD / 2, CACHE_READAHEAD_THRESHOLD / 2);
+	CU_ASSERT(g_readahead_count == 2);
+	CU_ASSERT(ut_is_readahead(g_file, 1));
+	CU_ASSERT(ut_is_readahead(g_file, 2));
+
+	/* SEQUENTIAL: the maximum window is prefetched from the first read */
+	g_readahead_count = 0;
+	spdk_file_set_readahead_hint(g_file, SPDK_FILE_READAHEAD_SEQUENTIAL);
+	CU_ASSERT(g_file->readahead_window == MAX_READAHEAD_SIZE);
+	ut_readahead(g_file, channel, 20 * CACHE_BUFFER_SIZE, 4096);
+	CU_ASSERT(g_readahead_count == MAX_READAHEAD_SIZE / CACHE_BUFFER_SIZE);
+	CU_ASSERT(ut_is_readahead(g_file, 21));
+	CU_ASSERT(ut_is_readahead(g_file, 20 + MAX_READAHEAD_SIZE / CACHE_BUFFER_SIZE));
+
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_thread_ctx(channel);
+
+	ut_send_request(_fs_unload, NULL);
+}
+
+static void
+readahead_stride(void)
+{
+	int rc;
+	uint64_t i;
+	struct spdk_fs_thread_ctx *channel;
+
+	ut_send_request(_fs_init, NULL);
+
+	set_fs_set_send_request_mq_fn(g_fs, ut_send_readahead);
+	channel = spdk_fs_alloc_thread_ctx(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	rc = spdk_file_truncate(g_file, channel, 40 * CACHE_BUFFER_SIZE);
+	CU_ASSERT(rc == 0);
+
+	/* The stride is prefetched once it repeated READAHEAD_STRIDE_HITS times */
+	g_readahead_count = 0;
+	for (i = 0; i <= READAHEAD_STRIDE_HITS + 1; i++) {
+		ut_readahead(g_file, channel, i * 2 * CACHE_BUFFER_SIZE, 4096);
+	}
+	CU_ASSERT(g_readahead_count == g_file->readahead_window / CACHE_BUFFER_SIZE);
+	CU_ASSERT(ut_is_readahead(g_file, 8));
+	CU_ASSERT(ut_is_readahead(g_file, 10));
+	CU_ASSERT(!ut_is_readahead(g_file, 9));
+
+	/* Strides shorter than a cache buffer are not prefetched */
+	g_readahead_count = 0;
+	for (i = 0; i <= READAHEAD_STRIDE_HITS + 1; i++) {
+		ut_readahead(g_file, channel, 20 * CACHE_BUFFER_SIZE + i * 8192, 4096);
+	}
+	CU_ASSERT(g_readahead_count == 0);
+
+	/* RANDOM turns stride prefetching off */
+	spdk_file_set_readahead_hint(g_file, SPDK_FILE_READAHEAD_RANDOM);
+	for (i = 0; i <= READAHEAD_STRIDE_HITS + 1; i++) {
+		ut_readahead(g_file, channel, (24 + i * 3) * CACHE_BUFFER_SIZE, 4096);
+	}
+	CU_ASSERT(g_readahead_count == 0);
+
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_thread_ctx(channel);
+
+	ut_send_request(_fs_unload, NULL);
+}
+
+static void
+file_read_multi(void)
+{
+	int rc;
+	char *w_buf;
+	char r_buf[4][4096];
+	uint64_t length, i;
+	struct spdk_file_read_vec vecs[4];
+	struct spdk_fs_thread_ctx *channel;
+
+	ut_send_request(_fs_init, NULL);
+
+	channel = spdk_fs_alloc_thread_ctx(g_fs);
+
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", SPDK_BLOBFS_OPEN_CREATE, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+
+	length = 3 * CACHE_BUFFER_SIZE;
+	w_buf = malloc(length);
+	SPDK_CU_ASSERT_FATAL(w_buf != NULL);
+	for (i = 0; i < length; i++) {
+		w_buf[i] = (char)(i % 251);
+	}
+	rc = spdk_file_write(g_file, channel, w_buf, 0, length);
+	CU_ASSERT(rc == 0);
+
+	spdk_file_close(g_file, channel);
+	spdk_fs_free_thread_ctx(channel);
+	ut_send_request(_fs_unload, NULL);
+
+	/* Reload so that every range misses the cache */
+	ut_send_request(_fs_load, NULL);
+
+	channel = spdk_fs_alloc_thread_ctx(g_fs);
+	g_file = NULL;
+	rc = spdk_fs_open_file(g_fs, channel, "testfile", 0, &g_file);
+	CU_ASSERT(rc == 0);
+	SPDK_CU_ASSERT_FATAL(g_file != NULL);
+	spdk_file_set_readahead_hint(g_file, SPDK_FILE_READAHEAD_RANDOM);
+
+	/* Inside a buffer, across two buffers, past the end and beyond the end */
+	vecs[0].offset = 100;
+	vecs[1].offset = 2 * CACHE_BUFFER_SIZE - 1000;
+	vecs[2].offset = length - 1000;
+	vecs[3].offset = length + CACHE_BUFFER_SIZE;
+	for (i = 0; i < 4; i++) {
+		memset(r_buf[i], 0, sizeof(r_buf[i]));
+		vecs[i].payload = r_buf[i];
+		vecs[i].length = sizeof(r_buf[i]);
+		vecs[i].rc = -1;
+	}
+
+	rc = spdk_file_read_multi(g_file, channel, vecs, 4);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(vecs[0].rc == sizeof(r_buf[0]));
+	CU_ASSERT(memcmp(r_buf[0], w_buf + vecs[0].offset, sizeof(r_buf[0])) == 0);
+	CU_ASSERT(vecs[1].rc == sizeof(r_buf[1]));
+	CU_ASSERT(memcmp(r_buf[1], w_buf + vecs[1].offset, sizeof(r_buf[1])) == 0);
+	CU_ASSERT(vecs[2].rc == 1000);
+	CU_ASSERT(memcmp(r_buf[2], w_buf + vecs[2].offset, 1000) == 0);
+	CU_ASSERT(vecs[3].rc == 0);
+
+	/* A second pass gives the same data */
+	memset(r_buf[1], 0, sizeof(r_buf[1]));
+	rc = spdk_file_read_multi(g_file, channel, &vecs[1], 1);
+	CU_ASSERT(rc == 0);
+	CU_ASSERT(vecs[1].rc == sizeof(r_buf[1]));
+	CU_ASSERT(memcmp(r_buf[1], w_buf + vecs[1].offset, sizeof(r_buf[1])) == 0);
+
+	free(w_buf);
+	spdk_file_close(g_file, channel);
+	rc = spdk_fs_delete_file(g_fs, channel, "testfile");
+	CU_ASSERT(rc == 0);
+
+	spdk_fs_free_thread_ctx(channel);
+
+	ut_send_request(_fs_unload, NULL);
+}
+
 static bool g_thread_exit = false;
 
 static void
@@ -645,7 +1033,12 @@ int main(int argc, char **argv)
 		CU_add_test(suite, "create_sync", fs_create_sync) == NULL ||
 		CU_add_test(suite, "rename_sync", fs_rename_sync) == NULL ||
 		CU_add_test(suite, "append_no_cache", cache_append_no_cache) == NULL ||
-		CU_add_test(suite, "delete_file_without_close", fs_delete_file_without_close) == NULL
+		CU_add_test(suite, "delete_file_without_close", fs_delete_file_without_close) == NULL ||
+		CU_add_test(suite, "cache_clock_second_chance", cache_clock_second_chance) == NULL ||
+		CU_add_test(suite, "cache_clock_eviction_order", cache_clock_eviction_order) == NULL ||
+		CU_add_test(suite, "readahead_hint", readahead_hint) == NULL ||
+		CU_add_test(suite, "readahead_stride", readahead_stride) == NULL ||
+		CU_add_test(suite, "file_read_multi", file_read_multi) == NULL
 	) {
 		CU_cleanup_registry();
 		return CU_get_error();
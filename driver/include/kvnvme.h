@@ -36,6 +36,7 @@
 
 #include <errno.h>
 #include <string.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <getopt.h>
@@ -58,6 +59,9 @@
 #define	DEFAULT_IO_QUEUE_DEPTH		256
 #define DEFAULT_IO_QUEUE_ID	(-1)
 
+/* Most blocks one Write Zeroes command covers (16 bit 0's based count) */
+#define	KV_NVME_WRITE_ZEROES_MAX_BLOCKS	(UINT16_MAX + 1)
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -134,6 +138,38 @@ int kv_env_fini(void);
  */
 int kv_nvme_init(const char *bdf, kv_nvme_io_options *options, unsigned int ssd_type);
 
+/**
+ * @brief Initialize several KV NVMe Devices in parallel
+ *        Controllers are probed and initialized together, and each device sets up its I/O Queues
+ *        and CQ threads on a thread of its own, so the startup takes as long as the slowest device.
+ * @param nr_devices Number of devices
+ * @param bdfs BDFs of the devices in a string format
+ * @param options Array of KV UDD I/O options structures, one per device
+ * @param ssd_type LBA Type SSD (0) or KV Type SSD (1)
+ * @param results Array receiving the kv_nvme_init() result of each device, may be NULL
+ * @return 0 : Success
+ * @return != 0: Failure of the first device which failed, the other devices stay initialized
+ */
+int kv_nvme_init_devices(unsigned int nr_devices, const char **bdfs, kv_nvme_io_options *options, unsigned int ssd_type, int *results);
+
+/**
+ * @brief Start the shared completion reactor. KV NVMe Devices initialized while it runs
+ *        have their I/O Queues reaped by its poller threads instead of CQ threads of their own
+ *        (num_cq_threads / cq_thread_mask / cq_core_list are ignored), and the I/O Queues are
+ *        moved between the pollers to balance the completion load
+ * @param cpus CPUs to run the poller threads on, one poller per CPU
+ * @return 0 : Success
+ * @return != 0: Failure
+ */
+int kv_nvme_reactor_start(const cpu_set_t *cpus);
+
+/**
+ * @brief Stop the shared completion reactor, after the KV NVMe Devices using it are finalized
+ * @return 0 : Success
+ * @return != 0: Failure
+ */
+int kv_nvme_reactor_stop(void);
+
 /**
  * @brief Return whether SDK is initialized.
  *         when not initialized(=return 0), most of SDK APIs will not work
@@ -165,7 +201,8 @@ uint64_t kv_nvme_get_waf(uint64_t handle);
 int kv_nvme_get_log_page(uint64_t handle, uint8_t log_id, void* buffer, uint32_t buffer_size);
 
 /**
- * @brief Get the I/O Queue Type (Sync or Async) of an I/O Queue in a KV NVMe Device
+ * @brief Get the preferred I/O Queue Type (Sync or Async) of an I/O Queue in a KV NVMe Device
+ *        Every I/O Queue serves both Sync and Async I/Os, the type only tells which of them the CPU was configured for (sync_mask)
  * @param handle Handle to the KV NVMe Device
  * @param core_id CPU Core ID of the current executing I/O thread
  * @return 1 : Sync I/O Queue
@@ -192,6 +229,12 @@ uint32_t kv_nvme_get_sector_size(uint64_t handle);
  */
 uint64_t kv_nvme_get_num_sectors(uint64_t handle);
 
+/**
+ * @brief return whether the namespace supports the Write Zeroes command
+ * @param handle Handle to the KV NVMe Device
+ */
+bool kv_nvme_write_zeroes_supported(uint64_t handle);
+
 /**
  * @brief return current QD being submitted
  * @param handle Handle to the KV NVMe Device
@@ -301,6 +344,17 @@ int kv_nvme_delete(uint64_t handle, int qid, const kv_pair *key);
  */
 int kv_nvme_delete_async(uint64_t handle, int qid, const kv_pair *key);
 
+/**
+ * @brief Write zeroes to a block range of an LBA NVMe Device Asynchronously
+ * @param handle Handle to the LBA NVMe Device
+ * @param qid submission queue id
+ * @param kv_pair key holds the first block, value.length the number of blocks
+ *        (at most KV_NVME_WRITE_ZEROES_MAX_BLOCKS)
+ * @return 0 : Success
+ * @return KV_ERR_DD_UNSUPPORTED_CMD: the device has no Write Zeroes command
+ */
+int kv_nvme_write_zeroes_async(uint64_t handle, int qid, const kv_pair *kv);
+
 /**
  * @brief Checks if given key exist and returns status(status code=0 : exist, 0x10=not exist)
  * @param kv kv_pair which contains a namespace and key information
@@ -446,6 +500,59 @@ void *kv_zalloc_socket(unsigned long long size, int socket_id);
  */
 void kv_free(void *ptr);
 
+/**
+ * @brief Register memory not allocated by kv_alloc family so it can be used for I/O
+ * @param addr Start address of the memory (2MB aligned)
+ * @param size Size of the memory (multiple of 2MB)
+ * @return KV_SUCCESS : Memory is registered
+ * @return KV_ERR_DD_INVALID_PARAM : Address or size is not 2MB aligned, or the memory can not be translated
+ */
+int kv_mem_register(void *addr, unsigned long long size);
+
+/**
+ * @brief return whether devices are accessed through an IOMMU (vfio), so that
+ * memory registered by kv_mem_register is translated by IO virtual address
+ * and may be backed by pages the kernel can migrate
+ */
+bool kv_iommu_is_enabled(void);
+
+/**
+ * @brief Unregister memory registered by kv_mem_register
+ * @param addr Start address of the memory given to kv_mem_register
+ * @param size Size of the memory given to kv_mem_register
+ * @return KV_SUCCESS : Memory is unregistered
+ * @return KV_ERR_DD_INVALID_PARAM : The memory is not registered
+ */
+int kv_mem_unregister(void *addr, unsigned long long size);
+
+/**
+ * @brief Parse a CPU list such as "0-31,64-95"
+ * @param cpu_list comma separated CPU IDs and ranges
+ * @param cpus [out] parsed CPU set, empty on failure
+ * @return KV_SUCCESS: Success
+ * @return KV_ERR_DD_INVALID_PARAM: Malformed list or CPU ID beyond CPU_SETSIZE
+ */
+int kv_cpu_list_parse(const char *cpu_list, cpu_set_t *cpus);
+
+/**
+ * @brief Format a CPU set as a CPU list, the inverse of kv_cpu_list_parse()
+ * @param cpus CPU set
+ * @param buf [out] buffer for the CPU list
+ * @param len size of buf
+ * @return KV_SUCCESS: Success
+ * @return KV_ERR_DD_INVALID_PARAM: buf is too small
+ */
+int kv_cpu_list_format(const cpu_set_t *cpus, char *buf, size_t len);
+
+/**
+ * @brief Resolve the CPUs of a device from its options, the CPU lists if set, the CPU masks otherwise
+ * @param options I/O options of the device
+ * @param io_cpus [out] CPUs submitting I/O to the device, may be NULL
+ * @param sync_cpus [out] CPUs among io_cpus doing Sync I/O, may be NULL
+ * @param cq_cpus [out] CPUs running the CQ processing threads, may be NULL
+ */
+void kv_nvme_get_io_cpus(const kv_nvme_io_options *options, cpu_set_t *io_cpus, cpu_set_t *sync_cpus, cpu_set_t *cq_cpus);
+
 /**
  * @brief Show API Info (buildtime / system info)
  */
@@ -461,6 +568,38 @@ void kv_nvme_process_completion(uint64_t handle);
  */
 void kv_nvme_process_completion_queue(uint64_t handle, uint32_t queue_id);
 
+/**
+ * @brief Ring the SQ doorbell for Async I/Os deferred by the submit_batch option
+ * @param handle Handle to the KV NVMe Device
+ * @param qid CPU Core ID of the Async I/O Queue
+ * @return KV_SUCCESS: Success
+ * @return KV_ERR_DD_INVALID_PARAM: Invalid handle or no Async I/O Queue on qid
+ */
+int kv_nvme_flush_submissions(uint64_t handle, int qid);
+
+/**
+ * @brief Acquire an I/O Queue for exclusive use by the calling thread
+ *        The owner submits to and polls (kv_nvme_process_completion_queue) the queue without locks.
+ *        Other threads get KV_ERR_DD_QPAIR_OWNED and the CQ threads skip the queue until it is released.
+ * @param handle Handle to the KV NVMe Device
+ * @param qid [in] CPU Core ID of the I/O Queue to acquire, or -1 for any free Async I/O Queue
+ *            [out] CPU Core ID of the acquired I/O Queue
+ * @return KV_SUCCESS: Success
+ * @return KV_ERR_DD_QPAIR_OWNED: The requested I/O Queue is acquired by another thread
+ * @return KV_ERR_DD_NO_AVAILABLE_QUEUE: No free Async I/O Queue
+ */
+int kv_nvme_acquire_qpair(uint64_t handle, int *qid);
+
+/**
+ * @brief Release an I/O Queue acquired by kv_nvme_acquire_qpair()
+ *        Deferred submissions are flushed and outstanding I/Os are completed by the CQ threads afterwards.
+ * @param handle Handle to the KV NVMe Device
+ * @param qid CPU Core ID of the acquired I/O Queue
+ * @return KV_SUCCESS: Success
+ * @return KV_ERR_DD_INVALID_PARAM: The I/O Queue is not acquired by the calling thread
+ */
+int kv_nvme_release_qpair(uint64_t handle, int qid);
+
 #ifdef __cplusplus
 }
 
@@ -136,6 +136,14 @@ uint64_t kv_get_num_sectors(uint64_t handle);
  */
 int kv_get_log_page(uint64_t handle, uint8_t log_id, void* buffer, uint32_t buffer_size);
 
+/**
+ * @brief Returns the internal fragmentation of the slab memory of a device
+ * @param handle device handle
+ * @return 0.0 ~ 1.0: portion of slab item space in use which is not used by key-value data
+ * @return <0: invalid parameter
+ */
+double kv_get_slab_fragmentation(uint64_t handle);
+
 
 // Key-Value pair
 
@@ -297,6 +305,111 @@ int kv_iterate_read_async(uint64_t handle, kv_iterate* it);
  */
 int kv_iterate_info(uint64_t handle, kv_iterate_handle_info* info, int nr_handle);
 
+/**
+ * @brief open a cursor, a key-only scan which shares the device's iterate handles with other cursors
+ *        No iterate handle is held until the first kv_cursor_read(). When all the handles are taken,
+ *        the least recently read idle cursor is suspended, and resumes on its next read by reopening
+ *        and skipping the keys up to the last one it emitted.
+ * @param handle Handle to the KV NVMe Device
+ * @param keyspace_id keyspace_id
+ * @param bitmask  bitmask
+ * @param prefix  prefix of matching key set
+ * @param iterate_type KV_KEY_ITERATE or KV_KEY_ITERATE_WITH_DELETE
+ * @param cursor opened cursor (OUT)
+ * @return KV_SUCCESS
+ * @return KV_ERR_SDK_INVALID_PARAM
+ * @return KV_ERR_HEAP_ALLOC_FAILURE
+ */
+int kv_cursor_open(uint64_t handle, const uint8_t keyspace_id, const uint32_t bitmask, const uint32_t prefix, const uint8_t iterate_type, kv_cursor **cursor);
+
+/**
+ * @brief read the next matching keys of a cursor, in the same buffer format as kv_iterate_read()
+ *        A cursor is read by one thread at a time. After an error, the cursor's iterate handle is closed
+ *        and the next read resumes the scan where it stopped.
+ * @param cursor cursor opened by kv_cursor_open() or kv_cursor_restore()
+ * @param it kv_iterate structure including the result buffer (it->iterator is set by the cursor)
+ * @return KV_SUCCESS
+ * @return KV_ERR_ITERATE_READ_EOF : no more keys, it may still hold the last keys
+ * @return KV_ERR_ITERATE_NO_AVAILABLE_HANDLE : all iterate handles are held by reading cursors or iterators
+ * @return != 0 : other failures of kv_iterate_open() / kv_iterate_read()
+ */
+int kv_cursor_read(kv_cursor *cursor, kv_iterate *it);
+
+/**
+ * @brief close the iterate handle of a cursor, keeping its position for the next kv_cursor_read()
+ * @param cursor cursor
+ * @return KV_SUCCESS
+ * @return KV_ERR_SDK_INVALID_PARAM
+ */
+int kv_cursor_suspend(kv_cursor *cursor);
+
+/**
+ * @brief close a cursor and its iterate handle, and free it
+ * @param cursor cursor
+ * @return KV_SUCCESS
+ * @return KV_ERR_SDK_INVALID_PARAM
+ */
+int kv_cursor_close(kv_cursor *cursor);
+
+/**
+ * @brief serialize the condition and position of a cursor into a token, to resume the scan with kv_cursor_restore()
+ * @param cursor cursor
+ * @param token token buffer, KV_CURSOR_TOKEN_MAX_LEN bytes are always enough (OUT)
+ * @param token_length size of the token buffer (IN), length of the token (OUT)
+ * @return KV_SUCCESS
+ * @return KV_ERR_BUFFER
+ * @return KV_ERR_SDK_INVALID_PARAM
+ */
+int kv_cursor_save(kv_cursor *cursor, void *token, uint32_t *token_length);
+
+/**
+ * @brief open a cursor resuming the scan saved in a token by kv_cursor_save(), possibly by another process
+ * @param handle Handle to the KV NVMe Device
+ * @param token token
+ * @param token_length length of the token
+ * @param cursor opened cursor (OUT)
+ * @return KV_SUCCESS
+ * @return KV_ERR_SDK_INVALID_PARAM
+ * @return KV_ERR_HEAP_ALLOC_FAILURE
+ */
+int kv_cursor_restore(uint64_t handle, const void *token, uint32_t token_length, kv_cursor **cursor);
+
+/**
+ * @brief open a key view iterator over an iterate handle opened with kv_iterate_open() (key-only types)
+ *        Iterate reads go to a ring of nr_buffers buffers, and kv_iterate_next() returns the keys where
+ *        the device wrote them, without copying them.
+ * @param handle Handle to the KV NVMe Device
+ * @param iterator iterate handle, still owned and closed by the caller
+ * @param nr_buffers number of iterate buffers of the ring, 0 = 2
+ * @param it opened key view iterator (OUT)
+ * @return KV_SUCCESS
+ * @return KV_ERR_SDK_INVALID_PARAM
+ * @return KV_ERR_HEAP_ALLOC_FAILURE
+ * @return KV_ERR_SLAB_ALLOC_FAILURE
+ */
+int kv_key_iterator_open(uint64_t handle, uint32_t iterator, uint32_t nr_buffers, kv_key_iterator **it);
+
+/**
+ * @brief return the next key of an iterate handle as a view into the iterate buffer
+ *        The kv_key is rewritten by the next call. The key bytes stay valid until the ring wraps,
+ *        that is while the keys of the following nr_buffers - 1 iterate reads are walked.
+ * @param it key view iterator
+ * @param key next key (OUT), NULL at the end
+ * @return KV_SUCCESS
+ * @return KV_ERR_ITERATE_READ_EOF : no more keys
+ * @return KV_ERR_ITERATE_ERROR : malformed iterate buffer
+ * @return KV_ERR_IO
+ */
+int kv_iterate_next(kv_key_iterator *it, const kv_key **key);
+
+/**
+ * @brief free a key view iterator and its buffers, the iterate handle stays open
+ * @param it key view iterator
+ * @return KV_SUCCESS
+ * @return KV_ERR_SDK_INVALID_PARAM
+ */
+int kv_key_iterator_close(kv_key_iterator *it);
+
 /**
  * @brief Appends value to existing value by given key(deprecated)
  * @param handle Handle to the KV NVMe Device
@@ -352,6 +465,7 @@ int kv_format_device(uint64_t handle, int erase_user_data);
 
 /**
  * @brief Returns I/O Queue type for current (I/O)thread
+ *        (preferred type only, every I/O queue accepts both sync and async I/O)
  * @param handle device handle
  * @param core_id CPU(=I/O queue) ID
  * @return SYNC_IO_QUEUE (1)
@@ -403,20 +517,6 @@ int kv_is_sdk_initialized(void);
  */
 int kv_get_dev_idx_on_handle(uint64_t handle);
 
-/**
- * @brief Set affinity for sync IO
- * @param did device id
- * @return true = switched context, false = cannot switch context
- */
-bool context_switch_async_to_sync(int did);
-
-/**
- * @brief Set affinity for async IO
- * @param did device id
- * @return true = switched context, false = cannot switch context
- */
-bool context_switch_sync_to_async(int did);
-
 /**
  * @brief Show API Info (buildtime / system info)
  */
@@ -64,10 +64,13 @@
 
 #define KV_ITERATE_READ_BUFFER_SIZE (32*1024) //32KB
 #define KV_MAX_ITERATE_HANDLE 16	//maximum 4 handles
+#define KV_CURSOR_TOKEN_MAX_LEN (26 + KV_MAX_KEY_LEN)	//serialized kv_cursor: scan conditions, position and last key
 
 #define DEV_ID_LEN 32
 #define NR_MAX_SSD 64
 #define MAX_CPU_CORES 64
+#define KV_CPU_LIST_LEN 256	//e.g. "0-63,128-191"
+#define KV_MAX_LCORE 128	//CONFIG_RTE_MAX_LCORE of the bundled DPDK, CPUs from here on can not be EAL lcores
 
 // can be on any socket
 #define SOCKET_ID_ANY (-1)
@@ -112,6 +115,7 @@ enum kv_cache_reclaim {
 enum kv_slab_mm_alloc_policy {
 	SLAB_MM_ALLOC_POSIX = 0x10,	/**< slab allocator for using heap memory */
 	SLAB_MM_ALLOC_HUGE =0x20,	/**< slab allocator for using hugepage memory */
+	SLAB_MM_ALLOC_THP = 0x30,	/**< slab allocator for using mlock'ed transparent huge pages registered to the driver, needs an IOMMU (vfio) */
 };
 
 /**
@@ -190,6 +194,16 @@ enum kv_iterate_read_option {
 	KV_ITERATE_READ_DEFAULT = 0x00,			/**<  [DEFAULT] default operation for command */
 };
 
+/**
+ * @brief I/O priority classes, set on kv_param.io_priority
+ */
+enum kv_io_priority {
+	KV_IO_PRIO_NORMAL = 0x00,		/**<  [DEFAULT] foreground I/O without a QoS class */
+	KV_IO_PRIO_HIGH = 0x01,			/**<  latency sensitive I/O, low priority I/O yields to it */
+	KV_IO_PRIO_LOW = 0x02,			/**<  background I/O such as bulk loads and compaction */
+	KV_IO_PRIO_MAX,
+};
+
 /**
  * @brief options used for store operation
  */
@@ -230,6 +244,9 @@ enum kv_result {
 	KV_ERR_DD_NO_AVAILABLE_QUEUE = 0x104,
 	KV_ERR_DD_UNSUPPORTED_CMD = 0x105,
   KV_ERR_DD_ITERATE_COND_INVALID = 0x106,  /**<  iterator condition is not valid */
+	KV_ERR_DD_QPAIR_OWNED = 0x107,				/**<  I/O queue is acquired by another thread */
+	KV_ERR_QUEUE_FULL = 0x108,				/**<  submission and overflow queue are full, retry after reaping completions */
+	KV_ERR_DD_IO_TIMEOUT = 0x109,				/**<  command exceeded its timeout and was aborted */
 
 
         //0x200 ~ 0x2FF for SDK Error
@@ -266,6 +283,32 @@ typedef struct {
         uint32_t queue_depth;
         /** Shared memory size in MB */
 	uint32_t mem_size_mb;
+        /** Number of Async I/O submissions per SQ doorbell write. 0 or 1 rings the doorbell on every submission */
+        uint32_t submit_batch;
+        /** Number of Async I/Os held in the software overflow queue of a qpair while its SQ is full. 0 = queue_depth, -1 = disabled */
+        int32_t overflow_depth;
+        /** Per command timeouts in ms, 0 = no timeout. Timed out commands are aborted and complete with KV_ERR_DD_IO_TIMEOUT */
+        uint32_t store_timeout_ms;
+        uint32_t retrieve_timeout_ms;
+        uint32_t delete_timeout_ms;
+        uint32_t exist_timeout_ms;
+        uint32_t iterate_timeout_ms;
+        /** Per priority class rate limits (indexed by enum kv_io_priority), 0 = unlimited */
+        uint32_t prio_iops_limit[KV_IO_PRIO_MAX];
+        uint64_t prio_bps_limit[KV_IO_PRIO_MAX];
+        /** Low priority I/Os are held back while a high priority I/O was submitted within this many us, 0 = never */
+        uint32_t low_prio_yield_us;
+        /** Core Masks whose I/O Queues get high / low priority under NVMe weighted round robin arbitration, 0 = round robin */
+        uint64_t high_prio_mask;
+        uint64_t low_prio_mask;
+        /** CPU lists such as "0-31,64-95", used instead of core_mask / sync_mask / cq_thread_mask when set. CPUs are not limited to MAX_CPU_CORES */
+        char core_list[KV_CPU_LIST_LEN];
+        char sync_core_list[KV_CPU_LIST_LEN];
+        char cq_core_list[KV_CPU_LIST_LEN];
+        /** Maximum number of I/O Queues, CPUs share I/O Queues beyond it. 0 = one per CPU, as far as the controller allows */
+        uint32_t num_io_queues;
+        /** CQ threads sleep on eventfds while their I/O Queues are idle, as long as they complete fewer I/Os per second than this. 0 = always poll */
+        uint32_t cq_event_iops;
 } kv_nvme_io_options;
 
 /**
@@ -276,10 +319,12 @@ typedef struct {
         int cache_algorithm;			/**< cache indexing algorithms (radix only) */
         int cache_reclaim_policy;		/**< cache eviction and reclaim policies (lru only) */
         uint64_t slab_size;			/**< size of slab memory used for cache and I/O buffer(B) */
-        int slab_alloc_policy;			/**< slab memory allocation source (hugepage only) */
+        int slab_alloc_policy;			/**< slab memory allocation source (hugepage or transparent huge page) */
         int ssd_type;				/**< type of ssds. (KV SSD only) */
-	int submit_retry_interval;              /**< submit retry interval (us unit,
-						when -1, no retry on LBA/KV SSD, otherwise, retry with usleep for given interval on KV SSD, retry without usleep on LBA SSD */
+	int submit_retry_interval;              /**< back-pressure policy when a qpair and its overflow queue are full,
+						when -1, async I/Os return KV_ERR_QUEUE_FULL immediately, otherwise, the submitter reaps completions of the qpair and retries */
+	char cq_reactor_core_list[KV_CPU_LIST_LEN];	/**< CPUs of the completion reactor shared by all devices, one poller per CPU,
+						empty: each device runs its own CQ threads (num_cq_threads / cq_thread_mask / cq_core_list) */
 
 
         int nr_ssd;				/**< number of SSDs */
@@ -292,6 +337,13 @@ typedef struct {
         pthread_mutex_t cb_cnt_mutex;		/**< mutex for callback counter */
 
         uint64_t app_hugemem_size;		/**< size of additional hugepage memory set by user app */
+
+        double slab_factor;			/**< growth factor of item size between slab classes */
+        uint32_t slab_min_value_size;		/**< value size of the smallest slab class (B) */
+        uint32_t slab_max_class;		/**< maximum number of slab classes */
+        uint64_t slab_unit_size;		/**< size of a slab, the unit moved between slab classes (B) */
+        uint32_t slab_sampling_interval;	/**< record value size of 1 out of N slab allocations (0: off) */
+        bool slab_rebalance;			/**< move empty slabs to the slab class running out of memory, on a miss (default on) */
 }kv_sdk;
 
 /**
@@ -326,6 +378,7 @@ typedef struct {
 		int iterate_read_option;
 		int exist_option;
 	}io_option;			/**< options for operations */	
+	uint8_t io_priority;		/**< I/O priority class (enum kv_io_priority) */
 } kv_param;	
 
 
@@ -353,6 +406,16 @@ enum kv_sdk_iterate_status {
 	ITERATE_HANDLE_CLOSED  = 0x00,		/**< iterator handle closed */
 };
 
+/**
+ * @brief A resumable scan over an iterate condition, sharing the device's iterate handles with other scans (opaque)
+ */
+typedef struct kv_cursor kv_cursor;
+
+/**
+ * @brief Walks the keys of key-only iterate reads in place, in the buffers the device wrote (opaque)
+ */
+typedef struct kv_key_iterator kv_key_iterator;
+
 typedef struct {
 	uint8_t handle_id;
 	uint8_t status;
@@ -49,61 +49,10 @@
 #define KV_DEFAULT_NUM_DEVICES_PER_CQ_CORE (4)          /* 1 CQ core per 4 devices */
 #define KV_DEFAULT_PORTION_CQ_CORES (1/4.0f)            /* preserve 1/4 of total system cores as cq */
 
-typedef struct {
-	uint8_t sync_cores[MAX_CPU_CORES];
-	uint8_t async_cores[MAX_CPU_CORES];
-	uint8_t next_sync_idx;
-	uint8_t next_async_idx;
-	uint8_t num_sync_cores;
-	uint8_t num_async_cores;
-	pthread_mutex_t sync_core_mutex;
-	pthread_mutex_t async_core_mutex;
-}kv_core_allocator;
-kv_core_allocator core_allocator[NR_MAX_SSD];
-int g_num_devices;
-
 int kv_get_num_cores(void){
 	return (int)sysconf(_SC_NPROCESSORS_ONLN);
 }
 
-int kv_get_sync_core(int did){
-	if (did < 0 || did >= g_num_devices){
-		fprintf(stderr, "[%s] Invaild parameter\n", __FUNCTION__);
-		return -1;
-	}
-
-	kv_core_allocator *allocator = &core_allocator[did];
-	if (allocator->num_sync_cores == 0){
-		fprintf(stderr, "[%s] This device does not support sync I/O\n", __FUNCTION__);
-		return -1;
-	}
-
-	pthread_mutex_lock(&allocator->sync_core_mutex);
-	uint8_t core = allocator->sync_cores[allocator->next_sync_idx];
-	allocator->next_sync_idx = (allocator->next_sync_idx + 1) % allocator->num_sync_cores;
-	pthread_mutex_unlock(&allocator->sync_core_mutex);
-	return (int)core;
-}
-
-int kv_get_async_core(int did){
-	if (did < 0 || did >= g_num_devices){
-		fprintf(stderr, "[%s] Invaild parameter\n", __FUNCTION__);
-		return -1;
-	}
-
-	kv_core_allocator *allocator = &core_allocator[did];
-	if (allocator->num_async_cores == 0){
-		fprintf(stderr, "[%s] This device does not support async I/O\n", __FUNCTION__);
-		return -1;
-	}
-
-	pthread_mutex_lock(&allocator->async_core_mutex);
-	uint8_t core = allocator->async_cores[allocator->next_async_idx];
-	allocator->next_async_idx = (allocator->next_async_idx + 1) % allocator->num_async_cores;
-	pthread_mutex_unlock(&allocator->async_core_mutex);
-	return (int)core;
-}
-
 static void kv_set_sdk_nxx_default(kv_sdk *sdk_opt){
         sdk_opt->slab_size = KV_DEFAULT_SLAB_SIZE_PER_DEV;
         sdk_opt->use_cache = false;
@@ -140,12 +89,29 @@ static void kv_copy_dev_config(kv_sdk *dst, kv_sdk *src){
 			dst->dd_options[i].num_cq_threads = NOT_SET;
 			dst->dd_options[i].cq_thread_mask = NOT_SET;
 		}
+		memcpy(dst->dd_options[i].core_list, src->dd_options[i].core_list, sizeof(src->dd_options[i].core_list));
+		memcpy(dst->dd_options[i].sync_core_list, src->dd_options[i].sync_core_list, sizeof(src->dd_options[i].sync_core_list));
+		memcpy(dst->dd_options[i].cq_core_list, src->dd_options[i].cq_core_list, sizeof(src->dd_options[i].cq_core_list));
+		dst->dd_options[i].num_io_queues = src->dd_options[i].num_io_queues;
+		dst->dd_options[i].cq_event_iops = src->dd_options[i].cq_event_iops;
 
 		if (src->dd_options[i].queue_depth){
 			dst->dd_options[i].queue_depth = src->dd_options[i].queue_depth;
 		} else {
 			dst->dd_options[i].queue_depth = NOT_SET;
 		}
+		dst->dd_options[i].submit_batch = src->dd_options[i].submit_batch;
+		dst->dd_options[i].overflow_depth = src->dd_options[i].overflow_depth;
+		dst->dd_options[i].store_timeout_ms = src->dd_options[i].store_timeout_ms;
+		dst->dd_options[i].retrieve_timeout_ms = src->dd_options[i].retrieve_timeout_ms;
+		dst->dd_options[i].delete_timeout_ms = src->dd_options[i].delete_timeout_ms;
+		dst->dd_options[i].exist_timeout_ms = src->dd_options[i].exist_timeout_ms;
+		dst->dd_options[i].iterate_timeout_ms = src->dd_options[i].iterate_timeout_ms;
+		memcpy(dst->dd_options[i].prio_iops_limit, src->dd_options[i].prio_iops_limit, sizeof(src->dd_options[i].prio_iops_limit));
+		memcpy(dst->dd_options[i].prio_bps_limit, src->dd_options[i].prio_bps_limit, sizeof(src->dd_options[i].prio_bps_limit));
+		dst->dd_options[i].low_prio_yield_us = src->dd_options[i].low_prio_yield_us;
+		dst->dd_options[i].high_prio_mask = src->dd_options[i].high_prio_mask;
+		dst->dd_options[i].low_prio_mask = src->dd_options[i].low_prio_mask;
 	}
 }
 
@@ -247,56 +213,11 @@ exit:
 	return ret;
 }
 
-static void kv_init_core_allocator(kv_sdk *sdk_opt){
-	g_num_devices = sdk_opt->nr_ssd;
-	kv_core_allocator *allocator;
-	uint8_t core_id;
-
-	for(int i = 0; i < g_num_devices; i++){
-		allocator = &core_allocator[i];
-
-		pthread_mutex_init(&allocator->sync_core_mutex, NULL);
-		pthread_mutex_init(&allocator->async_core_mutex, NULL);
-
-		uint64_t core_mask = sdk_opt->dd_options[i].core_mask;
-		uint64_t sync_mask = sdk_opt->dd_options[i].sync_mask;
-		allocator->num_sync_cores = allocator->num_async_cores = 0;
-		for(int j = 0; j < MAX_CPU_CORES; j++){
-			if (core_mask & (1ULL << j)){
-				if (sync_mask & (1ULL << j)){
-					allocator->sync_cores[allocator->num_sync_cores++] = j;
-				} else {
-					allocator->async_cores[allocator->num_async_cores++] = j;
-				}
-			}
-		}
-
-		if(allocator->num_sync_cores){
-			allocator->next_sync_idx = rand() % allocator->num_sync_cores;
-		}
-		if(allocator->num_async_cores){
-			allocator->next_async_idx = rand() % allocator->num_async_cores;
-		}
-	}
-	return;
-}
-
 static void kv_print_config_info(kv_sdk *sdk_opt){
 	for(int i = 0; i < sdk_opt->nr_ssd; i++){
 		printf("[dev_opt][dev_id=%d] bdf=%s, cm=0x%lX, sm=0x%lX, num_cq=%lu, cm=0x%lX qd=%u\n", i, \
 			sdk_opt->dev_id[i], sdk_opt->dd_options[i].core_mask, sdk_opt->dd_options[i].sync_mask, \
 			sdk_opt->dd_options[i].num_cq_threads, sdk_opt->dd_options[i].cq_thread_mask, sdk_opt->dd_options[i].queue_depth);
-
-		kv_core_allocator *allocator = &core_allocator[i];
-		printf(" num_sync_cores=%u(", allocator->num_sync_cores);
-		for(int j = 0; j < allocator->num_sync_cores; j++) printf("%d,", allocator->sync_cores[j]);
-		printf(")\n");
-		if (allocator->num_sync_cores) printf(" next_sync_idx=%u\n", allocator->next_sync_idx);
-
-		printf(" num_async_cores=%u(", allocator->num_async_cores);
-		for(int j = 0; j < allocator->num_async_cores; j++) printf("%d,", allocator->async_cores[j]);
-		printf(")\n");
-		if (allocator->num_async_cores) printf(" next_async_idx=%u\n", allocator->next_async_idx);
 	}
 }
 
@@ -310,7 +231,6 @@ int kv_sdk_load_nxx_config(kv_sdk *sdk_opt, int init_from, void *option){
 	}
 	kv_set_sdk_nxx_default(sdk_opt);			//set sdk options
 
-	kv_init_core_allocator(sdk_opt);
 	//kv_print_config_info(sdk_opt);
 exit:
 	return ret;
@@ -48,8 +48,6 @@
 #define KV_DEFAULT_IO_QUEUE_SIZE (32u)			/* QD 32 */
 
 int kv_get_num_cores(void);
-int kv_get_sync_core(int did);
-int kv_get_async_core(int did);
 int kv_sdk_load_nxx_config(kv_sdk *sdk_opt, int init_from, void *option);
 
 #endif /* KVCONFIG_NXX_H_ */
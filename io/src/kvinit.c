@@ -42,6 +42,7 @@
 #include <sys/time.h>
 #include <sys/wait.h>
 #include <errno.h>
+#include <dirent.h>
 
 #include "kv_apis.h"
 #include "kvcache.h"
@@ -96,12 +97,132 @@ static void parse_description(struct spdk_json_val* values, int idx, kv_nvme_io_
                                 }
                         }
                 }
+	        if (memcmp(values[i].start, "core_list", values[i].len) == 0) {
+			i++;
+			memcpy(opt.core_list, values[i].start, MIN(values[i].len, KV_CPU_LIST_LEN - 1));
+                }
+	        if (memcmp(values[i].start, "sync_core_list", values[i].len) == 0) {
+			i++;
+			memcpy(opt.sync_core_list, values[i].start, MIN(values[i].len, KV_CPU_LIST_LEN - 1));
+                }
+	        if (memcmp(values[i].start, "cq_core_list", values[i].len) == 0) {
+			i++;
+			memcpy(opt.cq_core_list, values[i].start, MIN(values[i].len, KV_CPU_LIST_LEN - 1));
+                }
+	        if (memcmp(values[i].start, "num_io_queues", values[i].len) == 0) {
+			i++;
+			uint32_t nr_queues;
+			spdk_json_decode_uint32(&values[i], &nr_queues);
+                        opt.num_io_queues = nr_queues;
+                }
+	        if (memcmp(values[i].start, "cq_event_iops", values[i].len) == 0) {
+			i++;
+			uint32_t event_iops;
+			spdk_json_decode_uint32(&values[i], &event_iops);
+                        opt.cq_event_iops = event_iops;
+                }
 	        if (memcmp(values[i].start, "queue_depth", values[i].len) == 0) {
 			i++;
 			uint32_t qd;
 			spdk_json_decode_uint32(&values[i], &qd);
                         opt.queue_depth = qd;
                 }
+	        if (memcmp(values[i].start, "submit_batch", values[i].len) == 0) {
+			i++;
+			uint32_t batch;
+			spdk_json_decode_uint32(&values[i], &batch);
+                        opt.submit_batch = batch;
+                }
+	        if (memcmp(values[i].start, "overflow_depth", values[i].len) == 0) {
+			i++;
+			int32_t depth;
+			spdk_json_decode_int32(&values[i], &depth);
+                        opt.overflow_depth = depth;
+                }
+	        if (memcmp(values[i].start, "store_timeout_ms", values[i].len) == 0) {
+			i++;
+			uint32_t timeout_ms;
+			spdk_json_decode_uint32(&values[i], &timeout_ms);
+                        opt.store_timeout_ms = timeout_ms;
+                }
+	        if (memcmp(values[i].start, "retrieve_timeout_ms", values[i].len) == 0) {
+			i++;
+			uint32_t timeout_ms;
+			spdk_json_decode_uint32(&values[i], &timeout_ms);
+                        opt.retrieve_timeout_ms = timeout_ms;
+                }
+	        if (memcmp(values[i].start, "delete_timeout_ms", values[i].len) == 0) {
+			i++;
+			uint32_t timeout_ms;
+			spdk_json_decode_uint32(&values[i], &timeout_ms);
+                        opt.delete_timeout_ms = timeout_ms;
+                }
+	        if (memcmp(values[i].start, "exist_timeout_ms", values[i].len) == 0) {
+			i++;
+			uint32_t timeout_ms;
+			spdk_json_decode_uint32(&values[i], &timeout_ms);
+                        opt.exist_timeout_ms = timeout_ms;
+                }
+	        if (memcmp(values[i].start, "iterate_timeout_ms", values[i].len) == 0) {
+			i++;
+			uint32_t timeout_ms;
+			spdk_json_decode_uint32(&values[i], &timeout_ms);
+                        opt.iterate_timeout_ms = timeout_ms;
+                }
+	        if (memcmp(values[i].start, "high_prio_iops", values[i].len) == 0) {
+			i++;
+			uint32_t iops;
+			spdk_json_decode_uint32(&values[i], &iops);
+                        opt.prio_iops_limit[KV_IO_PRIO_HIGH] = iops;
+                }
+	        if (memcmp(values[i].start, "high_prio_bps", values[i].len) == 0) {
+			i++;
+			uint64_t bps;
+			spdk_json_decode_uint64(&values[i], &bps);
+                        opt.prio_bps_limit[KV_IO_PRIO_HIGH] = bps;
+                }
+	        if (memcmp(values[i].start, "normal_prio_iops", values[i].len) == 0) {
+			i++;
+			uint32_t iops;
+			spdk_json_decode_uint32(&values[i], &iops);
+                        opt.prio_iops_limit[KV_IO_PRIO_NORMAL] = iops;
+                }
+	        if (memcmp(values[i].start, "normal_prio_bps", values[i].len) == 0) {
+			i++;
+			uint64_t bps;
+			spdk_json_decode_uint64(&values[i], &bps);
+                        opt.prio_bps_limit[KV_IO_PRIO_NORMAL] = bps;
+                }
+	        if (memcmp(values[i].start, "low_prio_iops", values[i].len) == 0) {
+			i++;
+			uint32_t iops;
+			spdk_json_decode_uint32(&values[i], &iops);
+                        opt.prio_iops_limit[KV_IO_PRIO_LOW] = iops;
+                }
+	        if (memcmp(values[i].start, "low_prio_bps", values[i].len) == 0) {
+			i++;
+			uint64_t bps;
+			spdk_json_decode_uint64(&values[i], &bps);
+                        opt.prio_bps_limit[KV_IO_PRIO_LOW] = bps;
+                }
+	        if (memcmp(values[i].start, "low_prio_yield_us", values[i].len) == 0) {
+			i++;
+			uint32_t yield_us;
+			spdk_json_decode_uint32(&values[i], &yield_us);
+                        opt.low_prio_yield_us = yield_us;
+                }
+	        if (memcmp(values[i].start, "high_prio_mask", values[i].len) == 0) {
+			i++;
+                        uint64_t val = (uint64_t)strtoull((char*)values[i].start, NULL, 16);
+			if (!val) continue;
+                        opt.high_prio_mask = val;
+                }
+	        if (memcmp(values[i].start, "low_prio_mask", values[i].len) == 0) {
+			i++;
+                        uint64_t val = (uint64_t)strtoull((char*)values[i].start, NULL, 16);
+			if (!val) continue;
+                        opt.low_prio_mask = val;
+                }
 
 	}
 
@@ -112,9 +233,65 @@ static void parse_description(struct spdk_json_val* values, int idx, kv_nvme_io_
                 opt_dst->sync_mask = opt.sync_mask;
                 opt_dst->cq_thread_mask = opt.cq_thread_mask;
         }
+        if (strlen(opt.core_list)){
+                //Like core_mask, core_list comes with its sync_core_list and cq_core_list, empty unless specified
+                memcpy(opt_dst->core_list, opt.core_list, sizeof(opt_dst->core_list));
+                memcpy(opt_dst->sync_core_list, opt.sync_core_list, sizeof(opt_dst->sync_core_list));
+        }
+        if (strlen(opt.cq_core_list)){
+                cpu_set_t cq_cpus;
+                memcpy(opt_dst->cq_core_list, opt.cq_core_list, sizeof(opt_dst->cq_core_list));
+                if (kv_cpu_list_parse(opt.cq_core_list, &cq_cpus) == KV_SUCCESS){
+                        opt_dst->num_cq_threads = CPU_COUNT(&cq_cpus);
+                }
+        }
+        if (opt.num_io_queues){
+                opt_dst->num_io_queues = opt.num_io_queues;
+        }
+        if (opt.cq_event_iops){
+                opt_dst->cq_event_iops = opt.cq_event_iops;
+        }
         if (opt.queue_depth){
                 opt_dst->queue_depth = opt.queue_depth;
         }
+        if (opt.submit_batch){
+                opt_dst->submit_batch = opt.submit_batch;
+        }
+        if (opt.overflow_depth){
+                opt_dst->overflow_depth = opt.overflow_depth;
+        }
+        if (opt.store_timeout_ms){
+                opt_dst->store_timeout_ms = opt.store_timeout_ms;
+        }
+        if (opt.retrieve_timeout_ms){
+                opt_dst->retrieve_timeout_ms = opt.retrieve_timeout_ms;
+        }
+        if (opt.delete_timeout_ms){
+                opt_dst->delete_timeout_ms = opt.delete_timeout_ms;
+        }
+        if (opt.exist_timeout_ms){
+                opt_dst->exist_timeout_ms = opt.exist_timeout_ms;
+        }
+        if (opt.iterate_timeout_ms){
+                opt_dst->iterate_timeout_ms = opt.iterate_timeout_ms;
+        }
+        for (int prio = 0; prio < KV_IO_PRIO_MAX; prio++){
+                if (opt.prio_iops_limit[prio]){
+                        opt_dst->prio_iops_limit[prio] = opt.prio_iops_limit[prio];
+                }
+                if (opt.prio_bps_limit[prio]){
+                        opt_dst->prio_bps_limit[prio] = opt.prio_bps_limit[prio];
+                }
+        }
+        if (opt.low_prio_yield_us){
+                opt_dst->low_prio_yield_us = opt.low_prio_yield_us;
+        }
+        if (opt.high_prio_mask){
+                opt_dst->high_prio_mask = opt.high_prio_mask;
+        }
+        if (opt.low_prio_mask){
+                opt_dst->low_prio_mask = opt.low_prio_mask;
+        }
 
 }
 
@@ -125,9 +302,14 @@ void dump_kv_sdk_options(void){
 	fprintf(stderr, "cache algorithm: %d \t(0: radix)\n", g_sdk.cache_algorithm);
 	fprintf(stderr, "cache reclaim policy: %d (0: LRU)\n", g_sdk.cache_reclaim_policy);
 	fprintf(stderr, "slab size: %lu \t(%luMB)\n", g_sdk.slab_size, g_sdk.slab_size/MB);
+	fprintf(stderr, "slab alloc policy: 0x%x \t(0x20: huge, 0x30: thp)\n", g_sdk.slab_alloc_policy);
+	fprintf(stderr, "slab profile: factor=%.2f min_value_size=%u max_class=%u unit_size=%luKB\n", g_sdk.slab_factor, g_sdk.slab_min_value_size, g_sdk.slab_max_class, g_sdk.slab_unit_size/KB);
+	fprintf(stderr, "slab sampling interval: %u \t(0: off)\n", g_sdk.slab_sampling_interval);
+	fprintf(stderr, "slab rebalance: %d \t(0: off, 1: on)\n", g_sdk.slab_rebalance);
 	fprintf(stderr, "app_hugemem_size size: %lu \t(%luMB)\n", g_sdk.app_hugemem_size, g_sdk.app_hugemem_size/MB);
 	fprintf(stderr, "ssd type: %d \t\t(0: kv, 1: lba)\n", g_sdk.ssd_type);
-	fprintf(stderr, "submit_retry_interval: %d \t\t(us unit)\n", g_sdk.submit_retry_interval);
+	fprintf(stderr, "submit_retry_interval: %d \t\t(-1: return KV_ERR_QUEUE_FULL instead of waiting)\n", g_sdk.submit_retry_interval);
+	fprintf(stderr, "cq_reactor_core_list: %s \t(empty: CQ threads per device)\n", g_sdk.cq_reactor_core_list);
 	fprintf(stderr, "nr ssd : %d\n", g_sdk.nr_ssd);
 	for(int i=0;i<g_sdk.nr_ssd;i++){
 		fprintf(stderr, "\tdevice id[%d]: %s\n", i, g_sdk.dev_id[i]);
@@ -135,7 +317,26 @@ void dump_kv_sdk_options(void){
 		fprintf(stderr, "\tsync mask: %08lx\n", g_sdk.dd_options[i].sync_mask);
 		fprintf(stderr, "\tnum_cq_threads: %ld\n", g_sdk.dd_options[i].num_cq_threads);
 		fprintf(stderr, "\tcq_thread_mask: %08lx\n", g_sdk.dd_options[i].cq_thread_mask);
-		fprintf(stderr, "\tqueue_depth: %d\n\n", g_sdk.dd_options[i].queue_depth);
+		fprintf(stderr, "\tcore_list: %s \t(empty: use core mask)\n", g_sdk.dd_options[i].core_list);
+		fprintf(stderr, "\tsync_core_list: %s\n", g_sdk.dd_options[i].sync_core_list);
+		fprintf(stderr, "\tcq_core_list: %s \t(empty: use cq_thread_mask)\n", g_sdk.dd_options[i].cq_core_list);
+		fprintf(stderr, "\tnum_io_queues: %u \t(0: one per core)\n", g_sdk.dd_options[i].num_io_queues);
+		fprintf(stderr, "\tcq_event_iops: %u \t(0: CQ threads always poll)\n", g_sdk.dd_options[i].cq_event_iops);
+		fprintf(stderr, "\tqueue_depth: %d\n", g_sdk.dd_options[i].queue_depth);
+		fprintf(stderr, "\tsubmit_batch: %d \t(0: no batching)\n", g_sdk.dd_options[i].submit_batch);
+		fprintf(stderr, "\toverflow_depth: %d \t(0: queue_depth, -1: disabled)\n", g_sdk.dd_options[i].overflow_depth);
+		fprintf(stderr, "\ttimeout_ms: store=%u retrieve=%u delete=%u exist=%u iterate=%u \t(0: no timeout)\n",
+			g_sdk.dd_options[i].store_timeout_ms, g_sdk.dd_options[i].retrieve_timeout_ms, g_sdk.dd_options[i].delete_timeout_ms,
+			g_sdk.dd_options[i].exist_timeout_ms, g_sdk.dd_options[i].iterate_timeout_ms);
+		fprintf(stderr, "\tprio iops limit: high=%u normal=%u low=%u \t(0: unlimited)\n",
+			g_sdk.dd_options[i].prio_iops_limit[KV_IO_PRIO_HIGH], g_sdk.dd_options[i].prio_iops_limit[KV_IO_PRIO_NORMAL],
+			g_sdk.dd_options[i].prio_iops_limit[KV_IO_PRIO_LOW]);
+		fprintf(stderr, "\tprio bps limit: high=%lu normal=%lu low=%lu \t(0: unlimited)\n",
+			g_sdk.dd_options[i].prio_bps_limit[KV_IO_PRIO_HIGH], g_sdk.dd_options[i].prio_bps_limit[KV_IO_PRIO_NORMAL],
+			g_sdk.dd_options[i].prio_bps_limit[KV_IO_PRIO_LOW]);
+		fprintf(stderr, "\tlow_prio_yield_us: %u \t(0: never yield)\n", g_sdk.dd_options[i].low_prio_yield_us);
+		fprintf(stderr, "\thigh prio mask: %08lx\n", g_sdk.dd_options[i].high_prio_mask);
+		fprintf(stderr, "\tlow prio mask: %08lx\n\n", g_sdk.dd_options[i].low_prio_mask);
 	}
 
 	fprintf(stderr, "log level: %d\n", g_sdk.log_level);
@@ -151,8 +352,15 @@ void kv_sdk_load_default(kv_sdk *sdk_opt){
 	sdk_opt->slab_size = 512*1024*1024ULL;
 	sdk_opt->app_hugemem_size = 0;
 	sdk_opt->slab_alloc_policy = SLAB_MM_ALLOC_HUGE;
+	sdk_opt->slab_factor = 2.0;
+	sdk_opt->slab_min_value_size = 4*KB;
+	sdk_opt->slab_max_class = MAX_NUM_SLAB_CLASS;
+	sdk_opt->slab_unit_size = HUGEPAGE_SIZE;
+	sdk_opt->slab_sampling_interval = 0;
+	sdk_opt->slab_rebalance = true;
 	sdk_opt->ssd_type = KV_TYPE_SSD;
 	sdk_opt->submit_retry_interval = 1;
+	memset(sdk_opt->cq_reactor_core_list, 0, sizeof(sdk_opt->cq_reactor_core_list));
 	sdk_opt->log_level = 0;
 	strcpy(sdk_opt->log_file, "/tmp/kvsdk.log");
 
@@ -162,7 +370,24 @@ void kv_sdk_load_default(kv_sdk *sdk_opt){
 	sdk_opt->dd_options[0].sync_mask = 0x00;
 	sdk_opt->dd_options[0].num_cq_threads = 0x01;
 	sdk_opt->dd_options[0].cq_thread_mask = 0x02;
+	memset(sdk_opt->dd_options[0].core_list, 0, sizeof(sdk_opt->dd_options[0].core_list));
+	memset(sdk_opt->dd_options[0].sync_core_list, 0, sizeof(sdk_opt->dd_options[0].sync_core_list));
+	memset(sdk_opt->dd_options[0].cq_core_list, 0, sizeof(sdk_opt->dd_options[0].cq_core_list));
+	sdk_opt->dd_options[0].num_io_queues = 0;
+	sdk_opt->dd_options[0].cq_event_iops = 0;
 	sdk_opt->dd_options[0].queue_depth = 64;
+	sdk_opt->dd_options[0].submit_batch = 0;
+	sdk_opt->dd_options[0].overflow_depth = 0;
+	sdk_opt->dd_options[0].store_timeout_ms = 0;
+	sdk_opt->dd_options[0].retrieve_timeout_ms = 0;
+	sdk_opt->dd_options[0].delete_timeout_ms = 0;
+	sdk_opt->dd_options[0].exist_timeout_ms = 0;
+	sdk_opt->dd_options[0].iterate_timeout_ms = 0;
+	memset(sdk_opt->dd_options[0].prio_iops_limit, 0, sizeof(sdk_opt->dd_options[0].prio_iops_limit));
+	memset(sdk_opt->dd_options[0].prio_bps_limit, 0, sizeof(sdk_opt->dd_options[0].prio_bps_limit));
+	sdk_opt->dd_options[0].low_prio_yield_us = 0;
+	sdk_opt->dd_options[0].high_prio_mask = 0;
+	sdk_opt->dd_options[0].low_prio_mask = 0;
 }
 
 
@@ -266,12 +491,62 @@ int kv_sdk_load_option(kv_sdk* sdk_opt, char* log_path){ //json parser using SPD
 	                                        sdk_opt->slab_alloc_policy = SLAB_MM_ALLOC_HUGE;
 					} else if (memcmp(values[i].start, "posix", values[i].len) == 0) {
 						sdk_opt->slab_alloc_policy = SLAB_MM_ALLOC_POSIX;
+					} else if (memcmp(values[i].start, "thp", values[i].len) == 0) {
+						sdk_opt->slab_alloc_policy = SLAB_MM_ALLOC_THP;
 					} else {
 	                                        fprintf(stderr, "Unknown slab alloc policy: %.*s\n", values[i].len, (char*)values[i].start);
 		                                ret = KV_ERR_SDK_OPTION_LOAD;
 			                        goto exit;
 	                                }
 				}
+				else if (memcmp(values[i].start, "slab_factor", values[i].len) == 0) {
+					i++;
+					char factor[32] = {0,};
+					memcpy(factor, values[i].start, MIN(values[i].len, sizeof(factor) - 1));
+					double slab_factor = strtod(factor, NULL);
+					if (slab_factor <= 1.0) {
+						fprintf(stderr, "slab_factor should be larger than 1.0: %.*s\n", values[i].len, (char*)values[i].start);
+						ret = KV_ERR_SDK_OPTION_LOAD;
+						goto exit;
+					}
+					sdk_opt->slab_factor = slab_factor;
+				}
+				else if (memcmp(values[i].start, "slab_min_value_size", values[i].len) == 0) {
+					i++;
+					uint32_t slab_min_value_size = 0;
+					spdk_json_decode_uint32(&values[i], &slab_min_value_size);
+					sdk_opt->slab_min_value_size = slab_min_value_size;
+				}
+				else if (memcmp(values[i].start, "slab_max_class", values[i].len) == 0) {
+					i++;
+					uint32_t slab_max_class = 0;
+					spdk_json_decode_uint32(&values[i], &slab_max_class);
+					sdk_opt->slab_max_class = slab_max_class;
+				}
+				else if (memcmp(values[i].start, "slab_unit_size", values[i].len) == 0) {
+					i++;
+					uint32_t slab_unit_size = 0;
+					spdk_json_decode_uint32(&values[i], &slab_unit_size);
+					sdk_opt->slab_unit_size = (uint64_t)slab_unit_size * KB;
+				}
+				else if (memcmp(values[i].start, "slab_sampling_interval", values[i].len) == 0) {
+					i++;
+					uint32_t slab_sampling_interval = 0;
+					spdk_json_decode_uint32(&values[i], &slab_sampling_interval);
+					sdk_opt->slab_sampling_interval = slab_sampling_interval;
+				}
+				else if (memcmp(values[i].start, "slab_rebalance", values[i].len) == 0) {
+					i++;
+					if (memcmp(values[i].start, "on", values[i].len) == 0) {
+						sdk_opt->slab_rebalance = true;
+					} else if (memcmp(values[i].start, "off", values[i].len) == 0) {
+						sdk_opt->slab_rebalance = false;
+					} else {
+						fprintf(stderr, "Unknown slab rebalance on/off option: %.*s\n", values[i].len, (char*)values[i].start);
+						ret = KV_ERR_SDK_OPTION_LOAD;
+						goto exit;
+					}
+				}
 				else if (memcmp(values[i].start, "ssd_type", values[i].len) == 0) {
 					i++;
 	                                if (memcmp(values[i].start, "kv", values[i].len) == 0) {
@@ -292,6 +567,11 @@ int kv_sdk_load_option(kv_sdk* sdk_opt, char* log_path){ //json parser using SPD
 					spdk_json_decode_int32(&values[i], &submit_retry_interval);
 					sdk_opt->submit_retry_interval = submit_retry_interval > max_interval ? max_interval : submit_retry_interval;
 				}
+				else if (memcmp(values[i].start, "cq_reactor_core_list", values[i].len) == 0) {
+					i++;
+					memset(sdk_opt->cq_reactor_core_list, 0, sizeof(sdk_opt->cq_reactor_core_list));
+					memcpy(sdk_opt->cq_reactor_core_list, values[i].start, MIN(values[i].len, KV_CPU_LIST_LEN - 1));
+				}
 				else if (memcmp(values[i].start, "log_level", values[i].len) == 0) {
 					i++;
 					uint32_t log_level = 0;
@@ -362,9 +642,25 @@ int kv_sdk_load_option_from_str(kv_sdk *sdk_opt){
 	if (sdk_opt->slab_size >0) {
 		g_sdk.slab_size = sdk_opt->slab_size;
 	}
-	if ((sdk_opt->slab_alloc_policy == SLAB_MM_ALLOC_HUGE) || (sdk_opt->slab_alloc_policy == SLAB_MM_ALLOC_POSIX)) {
+	if (sdk_opt->slab_alloc_policy == SLAB_MM_ALLOC_THP) {
+		g_sdk.slab_alloc_policy = SLAB_MM_ALLOC_THP;
+	} else if ((sdk_opt->slab_alloc_policy == SLAB_MM_ALLOC_HUGE) || (sdk_opt->slab_alloc_policy == SLAB_MM_ALLOC_POSIX)) {
 		g_sdk.slab_alloc_policy = SLAB_MM_ALLOC_HUGE;
 	}
+	if (sdk_opt->slab_factor > 1.0) {
+		g_sdk.slab_factor = sdk_opt->slab_factor;
+	}
+	if (sdk_opt->slab_min_value_size) {
+		g_sdk.slab_min_value_size = sdk_opt->slab_min_value_size;
+	}
+	if (sdk_opt->slab_max_class) {
+		g_sdk.slab_max_class = sdk_opt->slab_max_class;
+	}
+	if (sdk_opt->slab_unit_size) {
+		g_sdk.slab_unit_size = sdk_opt->slab_unit_size;
+	}
+	g_sdk.slab_sampling_interval = sdk_opt->slab_sampling_interval;
+	g_sdk.slab_rebalance = sdk_opt->slab_rebalance;
 	if ((sdk_opt->ssd_type == KV_TYPE_SSD) || (sdk_opt->ssd_type == LBA_TYPE_SSD)) {
 		g_sdk.ssd_type = sdk_opt->ssd_type;
 	}
@@ -380,6 +676,9 @@ int kv_sdk_load_option_from_str(kv_sdk *sdk_opt){
 	if (sdk_opt->submit_retry_interval) {
 		g_sdk.submit_retry_interval = sdk_opt->submit_retry_interval;
 	}
+	if (strlen(sdk_opt->cq_reactor_core_list) > 0) {
+		memcpy(g_sdk.cq_reactor_core_list, sdk_opt->cq_reactor_core_list, sizeof(g_sdk.cq_reactor_core_list));
+	}
 
 	g_sdk.nr_ssd = 0;
 	for(int j=0; j<NR_MAX_SSD; j++){
@@ -395,9 +694,64 @@ int kv_sdk_load_option_from_str(kv_sdk *sdk_opt){
 				g_sdk.dd_options[j].num_cq_threads = sdk_opt->dd_options[j].num_cq_threads;
 			}
 		}
+		if (strlen(sdk_opt->dd_options[j].core_list)) {
+			memcpy(g_sdk.dd_options[j].core_list, sdk_opt->dd_options[j].core_list, sizeof(g_sdk.dd_options[j].core_list));
+			memcpy(g_sdk.dd_options[j].sync_core_list, sdk_opt->dd_options[j].sync_core_list, sizeof(g_sdk.dd_options[j].sync_core_list));
+		}
+		if (strlen(sdk_opt->dd_options[j].cq_core_list)) {
+			cpu_set_t cq_cpus;
+			memcpy(g_sdk.dd_options[j].cq_core_list, sdk_opt->dd_options[j].cq_core_list, sizeof(g_sdk.dd_options[j].cq_core_list));
+			if (kv_cpu_list_parse(sdk_opt->dd_options[j].cq_core_list, &cq_cpus) == KV_SUCCESS) {
+				g_sdk.dd_options[j].num_cq_threads = CPU_COUNT(&cq_cpus);
+			}
+		}
+		if (sdk_opt->dd_options[j].num_io_queues) {
+			g_sdk.dd_options[j].num_io_queues = sdk_opt->dd_options[j].num_io_queues;
+		}
+		if (sdk_opt->dd_options[j].cq_event_iops) {
+			g_sdk.dd_options[j].cq_event_iops = sdk_opt->dd_options[j].cq_event_iops;
+		}
 		if (sdk_opt->dd_options[j].queue_depth) {
 			g_sdk.dd_options[j].queue_depth = sdk_opt->dd_options[j].queue_depth;
 		}
+		if (sdk_opt->dd_options[j].submit_batch) {
+			g_sdk.dd_options[j].submit_batch = sdk_opt->dd_options[j].submit_batch;
+		}
+		if (sdk_opt->dd_options[j].overflow_depth) {
+			g_sdk.dd_options[j].overflow_depth = sdk_opt->dd_options[j].overflow_depth;
+		}
+		if (sdk_opt->dd_options[j].store_timeout_ms) {
+			g_sdk.dd_options[j].store_timeout_ms = sdk_opt->dd_options[j].store_timeout_ms;
+		}
+		if (sdk_opt->dd_options[j].retrieve_timeout_ms) {
+			g_sdk.dd_options[j].retrieve_timeout_ms = sdk_opt->dd_options[j].retrieve_timeout_ms;
+		}
+		if (sdk_opt->dd_options[j].delete_timeout_ms) {
+			g_sdk.dd_options[j].delete_timeout_ms = sdk_opt->dd_options[j].delete_timeout_ms;
+		}
+		if (sdk_opt->dd_options[j].exist_timeout_ms) {
+			g_sdk.dd_options[j].exist_timeout_ms = sdk_opt->dd_options[j].exist_timeout_ms;
+		}
+		if (sdk_opt->dd_options[j].iterate_timeout_ms) {
+			g_sdk.dd_options[j].iterate_timeout_ms = sdk_opt->dd_options[j].iterate_timeout_ms;
+		}
+		for (int prio = 0; prio < KV_IO_PRIO_MAX; prio++) {
+			if (sdk_opt->dd_options[j].prio_iops_limit[prio]) {
+				g_sdk.dd_options[j].prio_iops_limit[prio] = sdk_opt->dd_options[j].prio_iops_limit[prio];
+			}
+			if (sdk_opt->dd_options[j].prio_bps_limit[prio]) {
+				g_sdk.dd_options[j].prio_bps_limit[prio] = sdk_opt->dd_options[j].prio_bps_limit[prio];
+			}
+		}
+		if (sdk_opt->dd_options[j].low_prio_yield_us) {
+			g_sdk.dd_options[j].low_prio_yield_us = sdk_opt->dd_options[j].low_prio_yield_us;
+		}
+		if (sdk_opt->dd_options[j].high_prio_mask) {
+			g_sdk.dd_options[j].high_prio_mask = sdk_opt->dd_options[j].high_prio_mask;
+		}
+		if (sdk_opt->dd_options[j].low_prio_mask) {
+			g_sdk.dd_options[j].low_prio_mask = sdk_opt->dd_options[j].low_prio_mask;
+		}
 		g_sdk.nr_ssd++;
 	}
 
@@ -418,22 +772,61 @@ int kv_sdk_load_option_from_str(kv_sdk *sdk_opt){
 #define qpair_memsize (1*KB)
 #define tracker_memsize (5*KB)
 #define memsize_margin_ratio (0.2)
+/**
+ * SLAB_MM_ALLOC_THP slabs may be migrated by the kernel, which only an IOMMU
+ * hides from the devices. kv_iommu_is_enabled() tells once the environment is
+ * up; this guesses it beforehand from sysfs, as DPDK does, so that the hugepage
+ * reservation can leave the slabs out.
+ */
+static bool kv_sdk_iommu_probe(void){
+	DIR *dir;
+	struct dirent *ent;
+	FILE *fp;
+	bool has_group = false;
+	char noiommu = 'N';
+
+	dir = opendir("/sys/kernel/iommu_groups");
+	if (dir) {
+		while ((ent = readdir(dir)) != NULL) {
+			if (ent->d_name[0] != '.') {
+				has_group = true;
+				break;
+			}
+		}
+		closedir(dir);
+	}
+
+	fp = fopen("/sys/module/vfio/parameters/enable_unsafe_noiommu_mode", "r");
+	if (fp) {
+		if (fscanf(fp, "%c", &noiommu) != 1) {
+			noiommu = 'N';
+		}
+		fclose(fp);
+	}
+
+	return has_group && noiommu != 'Y';
+}
+
 /**
  * returns total hugepage memory per device needed to initialize SDK in MB (2MB aligned)
+ * slab memory is not taken from hugepages with SLAB_MM_ALLOC_THP
  */
 static uint64_t kv_sdk_total_mem_needed(void){
 	uint32_t queue_depth = g_sdk.dd_options[0].queue_depth;
 	uint64_t driver_hugemem_size = 0;
 	uint64_t total_hugemem_size_MB = 0;
+	uint64_t slab_hugemem_size = (g_sdk.slab_alloc_policy == SLAB_MM_ALLOC_THP) ? 0 : g_sdk.slab_size;
 
 	for(int i = 0; i < g_sdk.nr_ssd; i++) {
-		uint32_t num_used_cores = 0;
-		for(int j = 0; j < MAX_CPU_CORES; j++){
-			if(g_sdk.dd_options[i].core_mask & (1ULL << j)){
-                                        num_used_cores++;
-			}
-                }
-		driver_hugemem_size += (uint64_t)(device_memsize + MAX(qpair_memsize + (tracker_memsize * queue_depth) - 4*KB, 5*KB) * num_used_cores) + g_sdk.slab_size;
+		cpu_set_t io_cpus;
+		uint32_t num_used_cores;
+
+		kv_nvme_get_io_cpus(&g_sdk.dd_options[i], &io_cpus, NULL, NULL);
+		num_used_cores = CPU_COUNT(&io_cpus);
+		if (g_sdk.dd_options[i].num_io_queues && num_used_cores > g_sdk.dd_options[i].num_io_queues) {
+			num_used_cores = g_sdk.dd_options[i].num_io_queues;
+		}
+		driver_hugemem_size += (uint64_t)(device_memsize + MAX(qpair_memsize + (tracker_memsize * queue_depth) - 4*KB, 5*KB) * num_used_cores) + slab_hugemem_size;
 	}
 
 
@@ -447,7 +840,8 @@ int kv_sdk_init(int init_from, void *option){
 	char *json_path;
 	uint64_t total_mem_size_MB;
 	kv_sdk *sdk_opt = NULL;
-	char spdk_core_mask[64] = {0};
+	char spdk_core_mask[KV_CPU_LIST_LEN + 2] = {0};
+	cpu_set_t spdk_cpus, io_cpus;
 	struct spdk_env_opts spdk_opts;
 	spdk_env_opts_init(&spdk_opts);
 
@@ -491,13 +885,37 @@ int kv_sdk_init(int init_from, void *option){
 		goto exit;
 	}
 
-	if (g_sdk.slab_size < MIN_TOTAL_SLAB_SIZE) {
-		fprintf(stderr, "SDK: slab_size(%luMB) should be larger than %lluMB, set slab_size to %lluMB\n", g_sdk.slab_size/MB, MIN_TOTAL_SLAB_SIZE/MB, MIN_TOTAL_SLAB_SIZE/MB);
-		g_sdk.slab_size = MIN_TOTAL_SLAB_SIZE;
+	uint64_t min_total_slab_size = (uint64_t)g_sdk.slab_max_class * g_sdk.slab_unit_size;
+	if (g_sdk.slab_size < min_total_slab_size) {
+		fprintf(stderr, "SDK: slab_size(%luMB) should be larger than %luMB, set slab_size to %luMB\n", g_sdk.slab_size/MB, min_total_slab_size/MB, min_total_slab_size/MB);
+		g_sdk.slab_size = min_total_slab_size;
+	}
+
+	if (g_sdk.slab_alloc_policy == SLAB_MM_ALLOC_THP && !kv_sdk_iommu_probe()) {
+		fprintf(stderr, "SDK: slab_alloc_policy thp needs an IOMMU, slabs are allocated from hugepages\n");
+		g_sdk.slab_alloc_policy = SLAB_MM_ALLOC_HUGE;
 	}
 
 	total_mem_size_MB = kv_sdk_total_mem_needed(); //hugemem size for slab, dd init, and user app
-	sprintf(spdk_core_mask, "0x%lX", g_sdk.dd_options[0].core_mask);
+	//SPDK env takes the CPUs of every device, as a "[list]" so that cores beyond 63 can be named.
+	//The driver pins its threads itself and needs no EAL lcore, so CPUs DPDK can't take are left out
+	CPU_ZERO(&spdk_cpus);
+	for(int i = 0; i < g_sdk.nr_ssd; i++) {
+		kv_nvme_get_io_cpus(&g_sdk.dd_options[i], &io_cpus, NULL, NULL);
+		CPU_OR(&spdk_cpus, &spdk_cpus, &io_cpus);
+	}
+	for(int cpu = KV_MAX_LCORE; cpu < CPU_SETSIZE; cpu++) {
+		if (CPU_ISSET(cpu, &spdk_cpus)) {
+			log_debug(KV_LOG_INFO, "[%s] CPU %d is not an EAL lcore, DPDK supports %d lcores\n", __FUNCTION__, cpu, KV_MAX_LCORE);
+			CPU_CLR(cpu, &spdk_cpus);
+		}
+	}
+	spdk_core_mask[0] = '[';
+	if (!CPU_COUNT(&spdk_cpus) || kv_cpu_list_format(&spdk_cpus, spdk_core_mask + 1, KV_CPU_LIST_LEN) != KV_SUCCESS) {
+		sprintf(spdk_core_mask, "0x%lX", g_sdk.dd_options[0].core_mask);
+	} else {
+		strcat(spdk_core_mask, "]");
+	}
 	spdk_opts.mem_size = total_mem_size_MB;
 	spdk_opts.core_mask = spdk_core_mask;
 	spdk_opts.shm_id = getpid();
@@ -508,6 +926,17 @@ int kv_sdk_init(int init_from, void *option){
 	}
 	fprintf(stderr, "SDK: total hugemem size=%dMB core_mask=%s shm_id=%d\n\n", spdk_opts.mem_size, spdk_opts.core_mask, spdk_opts.shm_id);
 
+	/*
+	 * e.g. an IOMMU is present but the devices are bound to uio. The hugepage
+	 * reservation above leaves out the slab memory, so falling back to huge
+	 * here would overrun it: fail instead.
+	 */
+	if (g_sdk.slab_alloc_policy == SLAB_MM_ALLOC_THP && !kv_iommu_is_enabled()) {
+		fprintf(stderr, "SDK: slab_alloc_policy thp needs the devices bound to vfio-pci behind an IOMMU, use huge instead\n");
+		ret = KV_ERR_SDK_INVALID_PARAM;
+		goto exit;
+	}
+
 	ret = kvslab_init(g_sdk.slab_size, g_sdk.slab_alloc_policy, g_sdk.nr_ssd);
 	log_debug(KV_LOG_INFO, "[%s] slab_init=%d log_level=%d\n",__FUNCTION__,ret, g_sdk.slab_alloc_policy);
 	if (ret != KV_SUCCESS) {
@@ -523,12 +952,35 @@ int kv_sdk_init(int init_from, void *option){
 		}
 	}
 
+	if (strlen(g_sdk.cq_reactor_core_list) > 0) {
+		cpu_set_t reactor_cpus;
+		ret = kv_cpu_list_parse(g_sdk.cq_reactor_core_list, &reactor_cpus);
+		if (ret == KV_SUCCESS) {
+			ret = kv_nvme_reactor_start(&reactor_cpus);
+		}
+		if (ret != KV_SUCCESS) {
+			fprintf(stderr, "KV completion reactor start failed on CPUs %s\n", g_sdk.cq_reactor_core_list);
+			goto exit;
+		}
+	}
+
+	//devices are probed and set up in parallel, the driver logs the init time of each
+	const char *bdfs[NR_MAX_SSD];
+	int init_results[NR_MAX_SSD] = {0, };
 	for(int i=0;i<g_sdk.nr_ssd;i++){
-		ret = kv_nvme_init(g_sdk.dev_id[i], &g_sdk.dd_options[i], g_sdk.ssd_type);
-		log_debug(KV_LOG_INFO, "[%s] ret=%d for %s\n",__FUNCTION__, ret, g_sdk.dev_id[i]);
+		bdfs[i] = g_sdk.dev_id[i];
+	}
+	if (g_sdk.nr_ssd > 0) {
+		ret = kv_nvme_init_devices(g_sdk.nr_ssd, bdfs, g_sdk.dd_options, g_sdk.ssd_type, init_results);
+		for(int i=0;i<g_sdk.nr_ssd;i++){
+			log_debug(KV_LOG_INFO, "[%s] ret=%d for %s\n",__FUNCTION__, init_results[i], g_sdk.dev_id[i]);
+		}
 		if (ret != KV_SUCCESS) {
 			goto exit;
 		}
+	}
+
+	for(int i=0;i<g_sdk.nr_ssd;i++){
 		//TODO: run setup.sh
 		//if (ret == KV_ERR_DD_NO_DEVICE){
 		//	fprintf(stderr, "Run setup scripts..\n");
@@ -580,6 +1032,9 @@ int kv_sdk_finalize(){
 		ret = kv_nvme_finalize(g_sdk.dev_id[i]);
 		log_debug(KV_LOG_INFO, "kv_nvme_finalize() of %x ret = %d\n", g_sdk.dev_handle[i], ret);
 	}
+	if (strlen(g_sdk.cq_reactor_core_list) > 0) {
+		kv_nvme_reactor_stop();
+	}
 
 	log_deinit();
 	
@@ -166,36 +166,6 @@ static void sdk_async_store_cb(kv_pair* kv, unsigned int result, unsigned int st
 }
 
 
-bool context_switch_async_to_sync(int did){
-	int core_id;
-	cpu_set_t cpuset;
-
-	// set sync core
-	core_id = kv_get_sync_core(did);
-	if (core_id < 0){
-		return false;
-	}
-	CPU_ZERO(&cpuset);
-	CPU_SET(core_id, &cpuset);
-	sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
-	return true;
-}
-
-bool context_switch_sync_to_async(int did){
-	int core_id;
-	cpu_set_t cpuset;
-
-	// set async core
-	core_id = kv_get_async_core(did);
-	if (core_id < 0){
-		return false;
-	}
-	CPU_ZERO(&cpuset);
-	CPU_SET(core_id, &cpuset);
-	sched_setaffinity(0, sizeof(cpu_set_t), &cpuset);
-	return true;
-}
-
 static void copy_kv_pair(kv_pair* dst, kv_pair* src, int op_types){
 	dst->keyspace_id = src->keyspace_id;
 	dst->key.length = src->key.length;
@@ -225,6 +195,19 @@ static void copy_kv_pair(kv_pair* dst, kv_pair* src, int op_types){
         memcpy((char*)&dst->param, (char*)&src->param, sizeof(src->param));
 }
 
+/*
+ * Make room on a saturated qpair by reaping its completions, which also refills the SQ
+ * from the driver's overflow queue, instead of sleeping. Returns false when the caller
+ * handles back-pressure itself (submit_retry_interval == -1) and gets KV_ERR_QUEUE_FULL.
+ */
+static bool kv_wait_for_queue_slot(uint64_t handle, int qid){
+	if(g_sdk.submit_retry_interval == -1){
+		return false;
+	}
+	kv_nvme_process_completion_queue(handle, (uint32_t)qid);
+	return true;
+}
+
 int _kv_store(uint64_t handle, kv_pair* dst){
         int did;
 	int ret = KV_SUCCESS;
@@ -249,11 +232,6 @@ int _kv_store(uint64_t handle, kv_pair* dst){
 	copy_kv_pair(io_kv, dst, op_store);
 
 	ret = kv_nvme_write(handle, qid, io_kv);
-	if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-		if(context_switch_async_to_sync(did)){
-			ret = kv_nvme_write(handle, qid, io_kv);
-		}
-	}
 	dst->value.length = io_kv->value.length;
 	dst->value.actual_value_size = io_kv->value.actual_value_size;
 
@@ -314,31 +292,15 @@ int _kv_store_async(uint64_t handle, kv_pair* dst){
 	io_kv->param.async_cb = sdk_async_store_cb;
 	io_kv->param.private_data = param;
 
-	ret = KV_ERR_IO;
-	while(ret) {
+	ret = kv_nvme_write_async(handle, qid, io_kv);
+	while(ret == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, qid)) {
 		ret = kv_nvme_write_async(handle, qid, io_kv);
-		if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-			if(context_switch_sync_to_async(did)){
-				ret = kv_nvme_write_async(handle, qid, io_kv);
-			}
-			else{
-				slab_free_pair(io_kv);
-				goto err;
-			}
-		}
+	}
 
-		log_debug(KV_LOG_DEBUG, "[kv_nvme_write_async] ret=%d key=%s\n", ret, io_kv->key.key);
-		if(ret){
-			if(g_sdk.submit_retry_interval == -1){
-				break;
-			}
-			if(g_sdk.ssd_type == KV_TYPE_SSD){
-				usleep(g_sdk.submit_retry_interval);
-			}
-		}
-		else{
-			break;
-		}
+	log_debug(KV_LOG_DEBUG, "[kv_nvme_write_async] ret=%d key=%s\n", ret, io_kv->key.key);
+	if(ret){
+		free(param);
+		slab_free_pair(io_kv);
 	}
 
 err:
@@ -412,11 +374,6 @@ int _kv_retrieve(uint64_t handle, kv_pair* dst){
         copy_kv_pair(io_kv, dst, op_retrieve);
 
 	ret = kv_nvme_read(handle, qid, io_kv);
-	if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-		if(context_switch_async_to_sync(did)){
-			ret = kv_nvme_read(handle, qid, io_kv);
-		}
-	}
 	log_debug(KV_LOG_DEBUG, "[kv_nvme_read] ret=%d key=%s value=%s\n",ret, io_kv->key.key, io_kv->value.value);
 	if(ret != KV_SUCCESS){
 		slab_free_pair(io_kv);
@@ -491,31 +448,15 @@ int _kv_retrieve_async(uint64_t handle, kv_pair* dst){
 	io_kv->param.async_cb = sdk_async_retrieve_cb;
 	io_kv->param.private_data = param;
 
-	ret = KV_ERR_IO;
-	while(ret){
+	ret = kv_nvme_read_async(handle, qid, io_kv);
+	while(ret == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, qid)) {
 		ret = kv_nvme_read_async(handle, qid, io_kv);
-		if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-			if(context_switch_sync_to_async(did)){
-				ret = kv_nvme_read_async(handle, qid, io_kv);
-			}
-			else{
-				slab_free_pair(io_kv);
-				goto err;
-			}
-		}
+	}
 
-		log_debug(KV_LOG_DEBUG, "[kv_nvme_read_async] ret=%d key=%s\n", ret, io_kv->key.key);
-		if(ret){
-			if(g_sdk.submit_retry_interval == -1){
-				break;
-			}
-			if(g_sdk.ssd_type == KV_TYPE_SSD){
-				usleep(g_sdk.submit_retry_interval);
-			}
-		}
-		else{
-			break;
-		}
+	log_debug(KV_LOG_DEBUG, "[kv_nvme_read_async] ret=%d key=%s\n", ret, io_kv->key.key);
+	if(ret){
+		free(param);
+		slab_free_pair(io_kv);
 	}
 
 err:
@@ -574,11 +515,6 @@ int _kv_delete(uint64_t handle, kv_pair* dst){
 	copy_kv_pair(io_kv, dst, op_delete);
 
 	ret = kv_nvme_delete(handle, qid, io_kv);
-	if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-		if(context_switch_async_to_sync(did)){
-			ret = kv_nvme_delete(handle, qid, io_kv);
-		}
-	}
 
         log_debug(KV_LOG_DEBUG, "[kv_nvme_delete] ret=%d key=%s\n",ret, dst->key.key);
 
@@ -631,30 +567,15 @@ int _kv_delete_async(uint64_t handle, kv_pair* dst){
 	io_kv->param.async_cb = sdk_async_delete_cb;
 	io_kv->param.private_data = param;
 
-	ret = KV_ERR_IO;
-	while(ret){
+	ret = kv_nvme_delete_async(handle, qid, io_kv);
+	while(ret == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, qid)) {
 		ret = kv_nvme_delete_async(handle, qid, io_kv);
-		if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-			if(context_switch_sync_to_async(did)){
-				ret = kv_nvme_delete_async(handle, qid, io_kv);
-			}
-			else{
-				slab_free_pair(io_kv);
-				goto err;
-			}
-		}
-		log_debug(KV_LOG_DEBUG, "[kv_nvme_delete_async] ret=%d key=%s\n", ret, dst->key.key);
-		if(ret){
-			if(g_sdk.submit_retry_interval == -1){
-				break;
-			}
-			if(g_sdk.ssd_type == KV_TYPE_SSD){
-				usleep(g_sdk.submit_retry_interval);
-			}
-		}
-		else{
-			break;
-		}
+	}
+
+	log_debug(KV_LOG_DEBUG, "[kv_nvme_delete_async] ret=%d key=%s\n", ret, dst->key.key);
+	if(ret){
+		free(param);
+		slab_free_pair(io_kv);
 	}
 
 err:
@@ -709,11 +630,6 @@ int _kv_exist(uint64_t handle, kv_pair* dst){
         copy_kv_pair(io_kv, dst, op_exist);
 
 	ret = kv_nvme_exist(handle, qid, io_kv);
-	if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-		if(context_switch_async_to_sync(did)){
-			ret = kv_nvme_exist(handle, qid, io_kv);
-		}
-	}
 
 	slab_free_pair(io_kv);
 
@@ -760,30 +676,15 @@ int _kv_exist_async(uint64_t handle, kv_pair* dst){
 	io_kv->param.async_cb = sdk_async_exist_cb;
 	io_kv->param.private_data = param;
 
-	ret = KV_ERR_IO;
-	while(ret){
+	ret = kv_nvme_exist_async(handle, qid, io_kv);
+	while(ret == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, qid)) {
 		ret = kv_nvme_exist_async(handle, qid, io_kv);
-		if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-			if(context_switch_sync_to_async(did)){
-				ret = kv_nvme_exist_async(handle, qid, io_kv);
-			}
-			else{
-				slab_free_pair(io_kv);
-				goto err;
-			}
-		}
-		log_debug(KV_LOG_DEBUG, "[kv_nvme_exist_async] ret=%d key=%s\n", ret, dst->key.key);
-		if(ret){
-			if(g_sdk.submit_retry_interval == -1){
-				break;
-			}
-			if(g_sdk.ssd_type == KV_TYPE_SSD){
-				usleep(g_sdk.submit_retry_interval);
-			}
-		}
-		else{
-			break;
-		}
+	}
+
+	log_debug(KV_LOG_DEBUG, "[kv_nvme_exist_async] ret=%d key=%s\n", ret, dst->key.key);
+	if(ret){
+		free(param);
+		slab_free_pair(io_kv);
 	}
 
 err:
@@ -849,11 +750,6 @@ static void sdk_async_iterate_read_cb(kv_iterate* it, unsigned int result, unsig
 			io_it->kv.value.length = ssd_it_read_size;
 			//printf("submit iterate_read: io_it->value.length = %d\n",io_it->value.length);
 			int ret = kv_nvme_iterate_read(handle, io_it);
-			if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-				if(context_switch_async_to_sync(did)){
-					ret = kv_nvme_iterate_read(handle, io_it);
-				}
-			}
 
 			if(ret != KV_SUCCESS && ret != KV_ERR_ITERATE_READ_EOF){
 				status = KV_ERR_IO;
@@ -969,29 +865,15 @@ int _kv_iterate_read_async(uint64_t handle, kv_iterate* dst){
 	io_it->kv.param.async_cb = sdk_async_iterate_read_cb;
 	io_it->kv.param.private_data = param;
 
-	ret = KV_ERR_IO;
-	while(ret) {
+	ret = kv_nvme_iterate_read_async(handle, qid, io_it);
+	while(ret == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, qid)) {
 		ret = kv_nvme_iterate_read_async(handle, qid, io_it);
-		if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-			if(context_switch_sync_to_async(did)){
-				ret = kv_nvme_iterate_read_async(handle, qid, io_it);
-			}
-			else{
-				slab_free_iterate(io_it);
-				goto err;
-			}
-		}
+	}
 
-		log_debug(KV_LOG_DEBUG, "[%s] submit done. ret=%d iterator id=%d dst->value.length=%d\n", __FUNCTION__, ret, io_it->iterator, dst->kv.value.length);
-		if(ret){
-			if(g_sdk.submit_retry_interval == -1){
-				break;
-			}
-			usleep(g_sdk.submit_retry_interval);
-		}
-		else{
-			break;
-		}
+	log_debug(KV_LOG_DEBUG, "[%s] submit done. ret=%d iterator id=%d dst->value.length=%d\n", __FUNCTION__, ret, io_it->iterator, dst->kv.value.length);
+	if(ret){
+		free(param);
+		slab_free_iterate(io_it);
 	}
 	
 err:
@@ -1037,11 +919,6 @@ int _kv_iterate_read(uint64_t handle, kv_iterate* dst){
 		io_it->value.length = ssd_it_read_size;
 		//printf("submit iterate_read: io_it->value.length = %d\n",io_it->value.length);
 		ret = kv_nvme_iterate_read(handle, io_it);
-		if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-			if(context_switch_async_to_sync(did)){
-				ret = kv_nvme_iterate_read(handle, io_it);
-			}
-		}
 
 		if(ret != KV_SUCCESS && ret != KV_ERR_ITERATE_READ_EOF){
 			ret = KV_ERR_IO;
@@ -1064,11 +941,6 @@ int _kv_iterate_read(uint64_t handle, kv_iterate* dst){
 	io_it->kv.key.length = 0;
 	io_it->kv.value.length = ssd_it_read_size;
 	ret = kv_nvme_iterate_read(handle, qid, io_it);
-	if(ret == KV_ERR_DD_INVALID_QUEUE_TYPE) {
-		if(context_switch_async_to_sync(did)){
-			ret = kv_nvme_iterate_read(handle, qid, io_it);
-		}
-	}
 
 	if(ret != KV_SUCCESS && ret != KV_ERR_ITERATE_READ_EOF){
 		dst->kv.key.length = 0;
@@ -1104,30 +976,18 @@ err:
 }
 
 uint32_t _kv_iterate_open(uint64_t handle, const uint8_t keyspace_id, const uint32_t bitmask, const uint32_t prefix, const uint8_t iterate_type){
-	uint32_t iterator = KV_INVALID_ITERATE_HANDLE;
-	while(1) {
+	uint32_t iterator = kv_nvme_iterate_open(handle, keyspace_id, bitmask, prefix, iterate_type);
+	while(iterator == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, DEFAULT_IO_QUEUE_ID)) {
 		iterator = kv_nvme_iterate_open(handle, keyspace_id, bitmask, prefix, iterate_type);
-		if (iterator == KV_ERR_DD_NO_AVAILABLE_RESOURCE) {
-			usleep(g_sdk.submit_retry_interval);
-		}
-		else {
-			break;
-		}
 	}
 	return iterator;
 }
 
 int _kv_iterate_close(uint64_t handle, const uint8_t iterator){
-	int ret = KV_ERR_DD_INVALID_PARAM;
-	while(1) {
-                ret = kv_nvme_iterate_close(handle, iterator);
-                if (ret == KV_ERR_DD_NO_AVAILABLE_RESOURCE) {
-			usleep(g_sdk.submit_retry_interval);
-                }
-                else {
-                        break;
-                }
-        }
+	int ret = kv_nvme_iterate_close(handle, iterator);
+	while(ret == KV_ERR_QUEUE_FULL && kv_wait_for_queue_slot(handle, DEFAULT_IO_QUEUE_ID)) {
+		ret = kv_nvme_iterate_close(handle, iterator);
+	}
 	return ret;
 }
 
@@ -0,0 +1,609 @@
+/**
+ *   BSD LICENSE
+ *
+ *   Copyright (c) 2017 Samsung Electronics Co., Ltd.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Samsung Electronics Co., Ltd. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <endian.h>
+#include <pthread.h>
+#include <sys/queue.h>
+
+#include "kv_types.h"
+#include "kv_apis.h"
+#include "kvnvme.h"
+#include "kvslab.h"
+#include "kvlog.h"
+
+#define KV_CURSOR_TOKEN_MAGIC 0x5243564B /* "KVCR" */
+#define KV_CURSOR_TOKEN_VERSION 1
+#define KV_CURSOR_TOKEN_HEADER_LEN ((uint32_t)(KV_CURSOR_TOKEN_MAX_LEN - KV_MAX_KEY_LEN))
+
+#define KV_KEY_ITERATOR_DEFAULT_BUFFERS 2
+
+extern uint32_t _kv_iterate_open(uint64_t handle, const uint8_t keyspace_id, const uint32_t bitmask, const uint32_t prefix, const uint8_t iterate_type);
+extern int _kv_iterate_close(uint64_t handle, const uint8_t iterator);
+extern int _kv_iterate_read(uint64_t handle, kv_iterate* it);
+extern int _kv_check_iterate_param(uint64_t handle, kv_iterate* it);
+extern int kv_get_dev_idx_on_handle(uint64_t handle);
+
+/*
+ * Position of a cursor in the key stream of a freshly opened device handle.
+ * Unless keys are deleted by the iteration itself, a reopened handle starts over,
+ * so the keys already emitted are skipped up to the last one, or by count if the
+ * last key is gone from the device.
+ */
+enum kv_cursor_state {
+	KV_CURSOR_STREAMING = 0,	/**< emitting keys */
+	KV_CURSOR_SKIP_TO_KEY = 1,	/**< skipping keys up to and including last_key */
+	KV_CURSOR_SKIP_COUNT = 2,	/**< skipping nr_skip keys */
+};
+
+struct kv_cursor {
+	uint64_t handle;			/**< device handle */
+	uint8_t keyspace_id;			/**< iterate condition */
+	uint8_t iterate_type;
+	uint32_t bitmask;
+	uint32_t prefix;
+	uint32_t iterator;			/**< device iterate handle, KV_INVALID_ITERATE_HANDLE while suspended */
+	bool busy;				/**< a read is in progress, the handle may not be taken away */
+	bool eof;				/**< all the keys were emitted */
+	enum kv_cursor_state state;
+	uint64_t nr_emitted;			/**< keys emitted so far */
+	uint64_t nr_skip;			/**< keys left to skip in KV_CURSOR_SKIP_COUNT */
+	uint16_t last_key_length;		/**< last key emitted */
+	uint8_t last_key[KV_MAX_KEY_LEN];
+	TAILQ_ENTRY(kv_cursor) link;		/**< entry of g_attached_cursors while holding a device handle */
+};
+
+/* Cursors holding a device handle, least recently read first */
+static TAILQ_HEAD(, kv_cursor) g_attached_cursors = TAILQ_HEAD_INITIALIZER(g_attached_cursors);
+static pthread_mutex_t g_cursor_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* called with g_cursor_mutex held */
+static void _kv_cursor_detach(kv_cursor *cursor){
+	int ret;
+
+	if(cursor->iterator == KV_INVALID_ITERATE_HANDLE){
+		return;
+	}
+
+	ret = _kv_iterate_close(cursor->handle, cursor->iterator);
+	if(ret != KV_SUCCESS){
+		log_debug(KV_LOG_INFO, "[%s] close of iterator %u ret=0x%x\n", __FUNCTION__, cursor->iterator, ret);
+	}
+	TAILQ_REMOVE(&g_attached_cursors, cursor, link);
+	cursor->iterator = KV_INVALID_ITERATE_HANDLE;
+
+	if(!cursor->eof && cursor->nr_emitted && cursor->iterate_type != KV_KEY_ITERATE_WITH_DELETE){
+		cursor->state = KV_CURSOR_SKIP_TO_KEY;
+	}
+}
+
+/*
+ * Open a device handle for the cursor. When the device is out of handles, or already
+ * iterates the same condition, the handle of an idle cursor is taken: least recently
+ * read first, or the one with the same condition.
+ * called with g_cursor_mutex held
+ */
+static int _kv_cursor_attach(kv_cursor *cursor){
+	kv_cursor *victim = NULL;
+	uint32_t iterator;
+
+	while(1){
+		iterator = _kv_iterate_open(cursor->handle, cursor->keyspace_id, cursor->bitmask, cursor->prefix, cursor->iterate_type);
+		if(iterator != KV_INVALID_ITERATE_HANDLE && iterator <= KV_MAX_ITERATE_HANDLE){
+			break;
+		}
+		if(iterator != KV_ERR_ITERATE_NO_AVAILABLE_HANDLE && iterator != KV_ERR_ITERATE_HANDLE_ALREADY_OPENED){
+			fprintf(stderr, "[%s] iterate open failed ret=0x%x\n", __FUNCTION__, iterator);
+			return (iterator == KV_INVALID_ITERATE_HANDLE) ? KV_ERR_ITERATE_ERROR : (int)iterator;
+		}
+
+		TAILQ_FOREACH(victim, &g_attached_cursors, link){
+			if(victim->busy || victim->handle != cursor->handle){
+				continue;
+			}
+			if(iterator == KV_ERR_ITERATE_NO_AVAILABLE_HANDLE || (victim->prefix == cursor->prefix && victim->bitmask == cursor->bitmask)){
+				break;
+			}
+		}
+		if(!victim){
+			log_debug(KV_LOG_INFO, "[%s] no idle cursor to take a handle from, ret=0x%x\n", __FUNCTION__, iterator);
+			return (int)iterator;
+		}
+
+		log_debug(KV_LOG_DEBUG, "[%s] suspending cursor of prefix 0x%x at %lu keys\n", __FUNCTION__, victim->prefix, victim->nr_emitted);
+		_kv_cursor_detach(victim);
+	}
+
+	cursor->iterator = iterator;
+	TAILQ_INSERT_TAIL(&g_attached_cursors, cursor, link);
+	if(cursor->state == KV_CURSOR_SKIP_COUNT && cursor->nr_skip == 0){
+		cursor->state = KV_CURSOR_STREAMING;
+	}
+	return KV_SUCCESS;
+}
+
+static int _kv_cursor_acquire(kv_cursor *cursor){
+	int ret = KV_SUCCESS;
+
+	pthread_mutex_lock(&g_cursor_mutex);
+	if(cursor->iterator == KV_INVALID_ITERATE_HANDLE){
+		ret = _kv_cursor_attach(cursor);
+	}
+	if(ret == KV_SUCCESS){
+		cursor->busy = true;
+		TAILQ_REMOVE(&g_attached_cursors, cursor, link);
+		TAILQ_INSERT_TAIL(&g_attached_cursors, cursor, link);
+	}
+	pthread_mutex_unlock(&g_cursor_mutex);
+
+	return ret;
+}
+
+static void _kv_cursor_release(kv_cursor *cursor, bool close_handle){
+	pthread_mutex_lock(&g_cursor_mutex);
+	cursor->busy = false;
+	if(close_handle){
+		_kv_cursor_detach(cursor);
+	}
+	pthread_mutex_unlock(&g_cursor_mutex);
+}
+
+/*
+ * Parse the (4B key length, key) entry at *offset of a key-only iterate buffer and move
+ * *offset past it. Fails if the entry runs past the buffer or the key is too long.
+ */
+static int _kv_iterate_parse_key(char *buf, uint32_t buf_length, uint32_t *offset, char **key, uint32_t *key_length){
+	if(*offset + KV_ITERATE_READ_BUFFER_OFFSET > buf_length){
+		return KV_ERR_ITERATE_ERROR;
+	}
+	memcpy(key_length, buf + *offset, KV_ITERATE_READ_BUFFER_OFFSET);
+	if(*key_length > KV_MAX_KEY_LEN || *offset + KV_ITERATE_READ_BUFFER_OFFSET + *key_length > buf_length){
+		return KV_ERR_ITERATE_ERROR;
+	}
+
+	*key = buf + *offset + KV_ITERATE_READ_BUFFER_OFFSET;
+	*offset += KV_ITERATE_READ_BUFFER_OFFSET + *key_length;
+	return KV_SUCCESS;
+}
+
+/*
+ * Drop the keys already emitted from a key-only iterate buffer: the count of keys
+ * followed by (4B key length, key) entries. The last key kept is recorded.
+ */
+static int _kv_cursor_filter(kv_cursor *cursor, kv_iterate *it){
+	char *buf = (char *)it->kv.value.value;
+	uint32_t buf_length = it->kv.value.length;
+	uint32_t nr_keys = 0, nr_kept = 0, key_length = 0, last_key_length = 0;
+	uint32_t offset = KV_ITERATE_READ_BUFFER_OFFSET, keep_offset = KV_ITERATE_READ_BUFFER_OFFSET, last_key_offset = 0;
+
+	if(buf_length < KV_ITERATE_READ_BUFFER_OFFSET){
+		it->kv.value.length = 0;
+		return KV_SUCCESS;
+	}
+
+	memcpy(&nr_keys, buf, KV_ITERATE_READ_BUFFER_OFFSET);
+	for(uint32_t i = 0; i < nr_keys; i++){
+		char *key;
+
+		if(_kv_iterate_parse_key(buf, buf_length, &offset, &key, &key_length) != KV_SUCCESS){
+			return KV_ERR_ITERATE_ERROR;
+		}
+
+		if(cursor->state == KV_CURSOR_SKIP_TO_KEY){
+			if(key_length == cursor->last_key_length && !memcmp(key, cursor->last_key, key_length)){
+				cursor->state = KV_CURSOR_STREAMING;
+			}
+			keep_offset = offset;
+			continue;
+		}
+		if(cursor->state == KV_CURSOR_SKIP_COUNT){
+			if(--cursor->nr_skip == 0){
+				cursor->state = KV_CURSOR_STREAMING;
+			}
+			keep_offset = offset;
+			continue;
+		}
+
+		last_key_offset = key - buf;
+		last_key_length = key_length;
+		nr_kept++;
+	}
+
+	if(nr_kept){
+		memcpy(cursor->last_key, buf + last_key_offset, last_key_length);
+		cursor->last_key_length = last_key_length;
+		cursor->nr_emitted += nr_kept;
+		if(keep_offset != KV_ITERATE_READ_BUFFER_OFFSET){
+			memmove(buf + KV_ITERATE_READ_BUFFER_OFFSET, buf + keep_offset, offset - keep_offset);
+		}
+	}
+
+	memcpy(buf, &nr_kept, KV_ITERATE_READ_BUFFER_OFFSET);
+	it->kv.value.length = nr_kept ? KV_ITERATE_READ_BUFFER_OFFSET + (offset - keep_offset) : 0;
+	return KV_SUCCESS;
+}
+
+int _kv_cursor_open(uint64_t handle, const uint8_t keyspace_id, const uint32_t bitmask, const uint32_t prefix, const uint8_t iterate_type, kv_cursor **cursor){
+	if(handle == 0 || !cursor){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+	if(iterate_type != KV_KEY_ITERATE && iterate_type != KV_KEY_ITERATE_WITH_DELETE){
+		fprintf(stderr, "[%s] cursors support key-only iterate types (type: %u) \n", __FUNCTION__, iterate_type);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	kv_cursor *cur = calloc(1, sizeof(kv_cursor));
+	if(!cur){
+		fprintf(stderr, "[%s] kv_cursor alloc err\n", __FUNCTION__);
+		return KV_ERR_HEAP_ALLOC_FAILURE;
+	}
+
+	cur->handle = handle;
+	cur->keyspace_id = keyspace_id;
+	cur->iterate_type = iterate_type;
+	cur->bitmask = bitmask;
+	cur->prefix = prefix;
+	cur->iterator = KV_INVALID_ITERATE_HANDLE;
+	cur->state = KV_CURSOR_STREAMING;
+
+	*cursor = cur;
+	return KV_SUCCESS;
+}
+
+int _kv_cursor_read(kv_cursor *cursor, kv_iterate *it){
+	int ret = KV_SUCCESS;
+
+	if(!cursor){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+	if((ret = _kv_check_iterate_param(cursor->handle, it)) != KV_SUCCESS){
+		return ret;
+	}
+	if(cursor->eof){
+		it->kv.value.length = 0;
+		return KV_ERR_ITERATE_READ_EOF;
+	}
+
+	ret = _kv_cursor_acquire(cursor);
+	if(ret != KV_SUCCESS){
+		it->kv.value.length = 0;
+		return ret;
+	}
+
+	do {
+		it->iterator = cursor->iterator;
+		it->kv.key.length = 0;
+		it->kv.value.length = KV_ITERATE_READ_BUFFER_SIZE;
+		it->kv.value.offset = 0;
+
+		ret = _kv_iterate_read(cursor->handle, it);
+		if(ret == KV_SUCCESS || ret == KV_ERR_ITERATE_READ_EOF){
+			if(_kv_cursor_filter(cursor, it) != KV_SUCCESS){
+				fprintf(stderr, "[%s] malformed iterate buffer from iterator %u\n", __FUNCTION__, cursor->iterator);
+				ret = KV_ERR_ITERATE_ERROR;
+			}
+		}
+		if(ret != KV_SUCCESS && ret != KV_ERR_ITERATE_READ_EOF){
+			//the device recommends closing the handle after an error, the next read resumes on a new one
+			it->kv.value.length = 0;
+			_kv_cursor_release(cursor, true);
+			return ret;
+		}
+
+		if(ret == KV_ERR_ITERATE_READ_EOF && cursor->state == KV_CURSOR_SKIP_TO_KEY){
+			//the last key emitted is gone, restart and skip as many keys as were emitted
+			log_debug(KV_LOG_INFO, "[%s] last key of prefix 0x%x not found, resuming at key %lu\n", __FUNCTION__, cursor->prefix, cursor->nr_emitted);
+			_kv_cursor_release(cursor, true);
+			cursor->state = KV_CURSOR_SKIP_COUNT;
+			cursor->nr_skip = cursor->nr_emitted;
+			ret = _kv_cursor_acquire(cursor);
+			if(ret != KV_SUCCESS){
+				it->kv.value.length = 0;
+				return ret;
+			}
+			it->kv.value.length = 0;
+		}
+	} while(ret == KV_SUCCESS && it->kv.value.length == 0);
+
+	if(ret == KV_ERR_ITERATE_READ_EOF){
+		cursor->eof = true;
+	}
+	_kv_cursor_release(cursor, cursor->eof);
+
+	return ret;
+}
+
+int _kv_cursor_suspend(kv_cursor *cursor){
+	if(!cursor){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	pthread_mutex_lock(&g_cursor_mutex);
+	_kv_cursor_detach(cursor);
+	pthread_mutex_unlock(&g_cursor_mutex);
+
+	return KV_SUCCESS;
+}
+
+int _kv_cursor_close(kv_cursor *cursor){
+	int ret = _kv_cursor_suspend(cursor);
+
+	if(ret == KV_SUCCESS){
+		free(cursor);
+	}
+	return ret;
+}
+
+/*
+ * Token layout, little endian: magic(4) version(1) keyspace_id(1) iterate_type(1) eof(1)
+ * bitmask(4) prefix(4) nr_emitted(8) last_key_length(2) last_key(last_key_length)
+ */
+int _kv_cursor_save(kv_cursor *cursor, void *token, uint32_t *token_length){
+	uint8_t *p = (uint8_t *)token;
+	uint32_t u32;
+	uint64_t u64;
+	uint16_t u16;
+
+	if(!cursor || !token || !token_length){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+	if(*token_length < KV_CURSOR_TOKEN_HEADER_LEN + cursor->last_key_length){
+		fprintf(stderr, "[%s] token buffer too small (%u bytes) \n", __FUNCTION__, *token_length);
+		return KV_ERR_BUFFER;
+	}
+
+	u32 = htole32(KV_CURSOR_TOKEN_MAGIC);
+	memcpy(p, &u32, sizeof(u32)); p += sizeof(u32);
+	*p++ = KV_CURSOR_TOKEN_VERSION;
+	*p++ = cursor->keyspace_id;
+	*p++ = cursor->iterate_type;
+	*p++ = cursor->eof;
+	u32 = htole32(cursor->bitmask);
+	memcpy(p, &u32, sizeof(u32)); p += sizeof(u32);
+	u32 = htole32(cursor->prefix);
+	memcpy(p, &u32, sizeof(u32)); p += sizeof(u32);
+	u64 = htole64(cursor->nr_emitted);
+	memcpy(p, &u64, sizeof(u64)); p += sizeof(u64);
+	u16 = htole16(cursor->last_key_length);
+	memcpy(p, &u16, sizeof(u16)); p += sizeof(u16);
+	memcpy(p, cursor->last_key, cursor->last_key_length); p += cursor->last_key_length;
+
+	*token_length = p - (uint8_t *)token;
+	return KV_SUCCESS;
+}
+
+int _kv_cursor_restore(uint64_t handle, const void *token, uint32_t token_length, kv_cursor **cursor){
+	const uint8_t *p = (const uint8_t *)token;
+	uint8_t keyspace_id, iterate_type, eof;
+	uint32_t u32, bitmask, prefix;
+	uint64_t u64;
+	uint16_t u16;
+	int ret;
+
+	if(!token || !cursor || token_length < KV_CURSOR_TOKEN_HEADER_LEN){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	memcpy(&u32, p, sizeof(u32)); p += sizeof(u32);
+	if(le32toh(u32) != KV_CURSOR_TOKEN_MAGIC || *p++ != KV_CURSOR_TOKEN_VERSION){
+		fprintf(stderr, "[%s] not a cursor token \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+	keyspace_id = *p++;
+	iterate_type = *p++;
+	eof = *p++;
+	memcpy(&u32, p, sizeof(u32)); p += sizeof(u32);
+	bitmask = le32toh(u32);
+	memcpy(&u32, p, sizeof(u32)); p += sizeof(u32);
+	prefix = le32toh(u32);
+	memcpy(&u64, p, sizeof(u64)); p += sizeof(u64);
+	memcpy(&u16, p, sizeof(u16)); p += sizeof(u16);
+	u16 = le16toh(u16);
+	if(u16 > KV_MAX_KEY_LEN || token_length < KV_CURSOR_TOKEN_HEADER_LEN + u16){
+		fprintf(stderr, "[%s] truncated cursor token \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	ret = _kv_cursor_open(handle, keyspace_id, bitmask, prefix, iterate_type, cursor);
+	if(ret != KV_SUCCESS){
+		return ret;
+	}
+
+	(*cursor)->eof = eof;
+	(*cursor)->nr_emitted = le64toh(u64);
+	(*cursor)->last_key_length = u16;
+	memcpy((*cursor)->last_key, p, u16);
+	if(!eof && (*cursor)->nr_emitted && iterate_type != KV_KEY_ITERATE_WITH_DELETE){
+		(*cursor)->state = KV_CURSOR_SKIP_TO_KEY;
+	}
+
+	return KV_SUCCESS;
+}
+
+/*
+ * Key views over the iterate buffers as the device returned them. Every read goes to the
+ * next buffer of a ring, so the keys of the last nr_buffers reads stay valid in place.
+ */
+struct kv_key_iterator {
+	uint64_t handle;			/**< device handle */
+	uint32_t iterator;			/**< device iterate handle, owned by the caller */
+	kv_iterate **ring;			/**< iterate buffers */
+	uint32_t nr_buffers;
+	uint32_t cur;				/**< ring slot being walked */
+	bool started;				/**< a buffer was read */
+	bool eof;				/**< the device has no keys after the current buffer */
+	uint32_t nr_keys_left;			/**< keys left in the current buffer */
+	uint32_t offset;			/**< offset of the next key entry in the current buffer */
+	kv_key view;				/**< key returned by kv_iterate_next() */
+};
+
+int _kv_key_iterator_close(kv_key_iterator *it);
+
+int _kv_key_iterator_open(uint64_t handle, uint32_t iterator, uint32_t nr_buffers, kv_key_iterator **it){
+	int did;
+
+	if(handle == 0 || !it || iterator == KV_INVALID_ITERATE_HANDLE || iterator > KV_MAX_ITERATE_HANDLE){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	did = kv_get_dev_idx_on_handle(handle);
+	if(did == KV_ERR_SDK_INVALID_PARAM){
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	kv_key_iterator *kit = calloc(1, sizeof(kv_key_iterator));
+	if(!kit){
+		fprintf(stderr, "[%s] kv_key_iterator alloc err\n", __FUNCTION__);
+		return KV_ERR_HEAP_ALLOC_FAILURE;
+	}
+
+	kit->nr_buffers = nr_buffers ? nr_buffers : KV_KEY_ITERATOR_DEFAULT_BUFFERS;
+	kit->ring = calloc(kit->nr_buffers, sizeof(kv_iterate *));
+	if(!kit->ring){
+		fprintf(stderr, "[%s] kv_key_iterator alloc err\n", __FUNCTION__);
+		free(kit);
+		return KV_ERR_HEAP_ALLOC_FAILURE;
+	}
+
+	for(uint32_t i = 0; i < kit->nr_buffers; i++){
+		kit->ring[i] = slab_alloc_iterate(KV_MAX_KEY_LEN+1, KV_ITERATE_READ_BUFFER_SIZE, did);
+		if(!kit->ring[i]){
+			fprintf(stderr, "slab_alloc_iterator error on %s\n", __FUNCTION__);
+			_kv_key_iterator_close(kit);
+			return KV_ERR_SLAB_ALLOC_FAILURE;
+		}
+	}
+
+	kit->handle = handle;
+	kit->iterator = iterator;
+
+	*it = kit;
+	return KV_SUCCESS;
+}
+
+/*
+ * Read the next iterate buffer into the next slot of the ring, in place
+ */
+static int _kv_key_iterator_fill(kv_key_iterator *kit){
+	kv_iterate *io_it;
+	int ret;
+
+	kit->cur = kit->started ? (kit->cur + 1) % kit->nr_buffers : 0;
+	kit->started = true;
+	kit->nr_keys_left = 0;
+	kit->offset = KV_ITERATE_READ_BUFFER_OFFSET;
+
+	io_it = kit->ring[kit->cur];
+	io_it->iterator = kit->iterator;
+	io_it->kv.keyspace_id = 0; //Note : keyspace_id is zero on iterate_read request
+	io_it->kv.key.length = 0;
+	io_it->kv.value.length = KV_ITERATE_READ_BUFFER_SIZE;
+	io_it->kv.value.offset = 0;
+
+	ret = kv_nvme_iterate_read(kit->handle, DEFAULT_IO_QUEUE_ID, io_it);
+	if(ret == KV_ERR_ITERATE_READ_EOF){
+		kit->eof = true;
+	}
+	else if(ret != KV_SUCCESS){
+		log_debug(KV_LOG_INFO, "[%s] iterator=%u ret=0x%x\n", __FUNCTION__, kit->iterator, ret);
+		io_it->kv.value.length = 0;
+		return KV_ERR_IO;
+	}
+
+	if(io_it->kv.value.length >= KV_ITERATE_READ_BUFFER_OFFSET){
+		memcpy(&kit->nr_keys_left, io_it->kv.value.value, KV_ITERATE_READ_BUFFER_OFFSET);
+	}
+	return KV_SUCCESS;
+}
+
+int _kv_iterate_next(kv_key_iterator *it, const kv_key **key){
+	uint32_t key_length = 0;
+	int ret;
+
+	if(!it || !key){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	*key = NULL;
+	while(it->nr_keys_left == 0){
+		if(it->eof){
+			return KV_ERR_ITERATE_READ_EOF;
+		}
+		if((ret = _kv_key_iterator_fill(it)) != KV_SUCCESS){
+			return ret;
+		}
+	}
+
+	kv_iterate *io_it = it->ring[it->cur];
+	char *key_start;
+
+	if(_kv_iterate_parse_key((char *)io_it->kv.value.value, io_it->kv.value.length, &it->offset, &key_start, &key_length) != KV_SUCCESS){
+		fprintf(stderr, "[%s] malformed iterate buffer from iterator %u\n", __FUNCTION__, it->iterator);
+		it->nr_keys_left = 0;
+		return KV_ERR_ITERATE_ERROR;
+	}
+
+	it->view.key = key_start;
+	it->view.length = key_length;
+	it->nr_keys_left--;
+
+	*key = &it->view;
+	return KV_SUCCESS;
+}
+
+int _kv_key_iterator_close(kv_key_iterator *it){
+	if(!it){
+		fprintf(stderr, "[%s] Invalid Parameter \n", __FUNCTION__);
+		return KV_ERR_SDK_INVALID_PARAM;
+	}
+
+	for(uint32_t i = 0; i < it->nr_buffers; i++){
+		if(it->ring[i]){
+			slab_free_iterate(it->ring[i]);
+		}
+	}
+	free(it->ring);
+	free(it);
+
+	return KV_SUCCESS;
+}
@@ -64,6 +64,16 @@ extern int _kv_iterate_close(uint64_t handle, const uint8_t iterator);
 extern int _kv_iterate_read(uint64_t handle, kv_iterate* it);
 extern int _kv_iterate_read_async(uint64_t handle, kv_iterate* it);
 
+extern int _kv_cursor_open(uint64_t handle, const uint8_t keyspace_id, const uint32_t bitmask, const uint32_t prefix, const uint8_t iterate_type, kv_cursor **cursor);
+extern int _kv_cursor_read(kv_cursor *cursor, kv_iterate *it);
+extern int _kv_cursor_suspend(kv_cursor *cursor);
+extern int _kv_cursor_close(kv_cursor *cursor);
+extern int _kv_cursor_save(kv_cursor *cursor, void *token, uint32_t *token_length);
+extern int _kv_cursor_restore(uint64_t handle, const void *token, uint32_t token_length, kv_cursor **cursor);
+extern int _kv_key_iterator_open(uint64_t handle, uint32_t iterator, uint32_t nr_buffers, kv_key_iterator **it);
+extern int _kv_iterate_next(kv_key_iterator *it, const kv_key **key);
+extern int _kv_key_iterator_close(kv_key_iterator *it);
+
 int kv_store(uint64_t handle, kv_pair* kv){
 	return _kv_store(handle, kv);
 }
@@ -119,6 +129,42 @@ int kv_iterate_info(uint64_t handle, kv_iterate_handle_info* info, int nr_handle
 	return kv_nvme_iterate_info(handle, info, nr_handle);
 }
 
+int kv_cursor_open(uint64_t handle, const uint8_t keyspace_id, const uint32_t bitmask, const uint32_t prefix, const uint8_t iterate_type, kv_cursor **cursor){
+	return _kv_cursor_open(handle, keyspace_id, bitmask, prefix, iterate_type, cursor);
+}
+
+int kv_cursor_read(kv_cursor *cursor, kv_iterate *it){
+	return _kv_cursor_read(cursor, it);
+}
+
+int kv_cursor_suspend(kv_cursor *cursor){
+	return _kv_cursor_suspend(cursor);
+}
+
+int kv_cursor_close(kv_cursor *cursor){
+	return _kv_cursor_close(cursor);
+}
+
+int kv_cursor_save(kv_cursor *cursor, void *token, uint32_t *token_length){
+	return _kv_cursor_save(cursor, token, token_length);
+}
+
+int kv_cursor_restore(uint64_t handle, const void *token, uint32_t token_length, kv_cursor **cursor){
+	return _kv_cursor_restore(handle, token, token_length, cursor);
+}
+
+int kv_key_iterator_open(uint64_t handle, uint32_t iterator, uint32_t nr_buffers, kv_key_iterator **it){
+	return _kv_key_iterator_open(handle, iterator, nr_buffers, it);
+}
+
+int kv_iterate_next(kv_key_iterator *it, const kv_key **key){
+	return _kv_iterate_next(it, key);
+}
+
+int kv_key_iterator_close(kv_key_iterator *it){
+	return _kv_key_iterator_close(it);
+}
+
 int kv_get_active_iterator(uint64_t handle, uint32_t* nr_open_handle,  uint8_t* arr_open_handle){
 	return 0;
 }
@@ -151,8 +197,15 @@ int kv_get_devices_on_cpu(int core_id, int* nr_device, uint64_t* arr_handle){
 	int ret = KV_ERR_IO;
 	int i;
 	int nr_dev = 0;
+	cpu_set_t io_cpus;
+
+	if(core_id < 0 || core_id >= CPU_SETSIZE){
+		*nr_device = 0;
+		return ret;
+	}
 	for(i=0;i<g_sdk.nr_ssd;i++){
-		if(g_sdk.dd_options[i].core_mask & (1ULL << core_id)){
+		kv_nvme_get_io_cpus(&g_sdk.dd_options[i], &io_cpus, NULL, NULL);
+		if(CPU_ISSET(core_id, &io_cpus)){
 			arr_handle[nr_dev] = g_sdk.dev_handle[i];
 			nr_dev++;
 			ret = KV_SUCCESS;
@@ -171,10 +224,12 @@ int kv_get_cpus_on_device(uint64_t handle, int* nr_core, int* arr_core){
 	int i,j;
 	int nr_cpu = 0;
 	char* bdf = NULL;
+	cpu_set_t io_cpus;
 	for(i=0;i<g_sdk.nr_ssd;i++){
 		if(handle == g_sdk.dev_handle[i]){
-			for(j=0;j<MAX_CPU_CORES; j++){
-				if(g_sdk.dd_options[i].core_mask & (1ULL << j)){
+			kv_nvme_get_io_cpus(&g_sdk.dd_options[i], &io_cpus, NULL, NULL);
+			for(j=0;j<CPU_SETSIZE; j++){
+				if(CPU_ISSET(j, &io_cpus)){
 					arr_core[nr_cpu] = j;
 					nr_cpu++;
 				}
@@ -229,6 +284,14 @@ int kv_get_log_page(uint64_t handle, uint8_t log_id, void* buffer, uint32_t buff
 	return kv_nvme_get_log_page(handle, log_id, buffer, buffer_size);
 }
 
+double kv_get_slab_fragmentation(uint64_t handle){
+	int did = kv_get_dev_idx_on_handle(handle);
+	if (handle == 0 || did == KV_ERR_SDK_INVALID_PARAM) {
+		return -1.0;
+	}
+	return kvslab_fragmentation(did);
+}
+
 int kv_io_queue_type(uint64_t handle, int core_id){
 	if(handle == 0){
 		return KV_ERR_SDK_INVALID_PARAM;
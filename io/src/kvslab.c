@@ -34,39 +34,372 @@
 #include<stdlib.h>
 #include<unistd.h>
 #include<string.h>
+#include<sched.h>
+#include<dirent.h>
 
 #include "kvutil.h"
 #include "kvslab.h"
 #include "kvcache.h"
+#include "kvnvme.h"
 
 #define MEMORY_ALIGNMENT (256)
 
+#define SYSFS_NODE_PATH "/sys/devices/system/node"
+#define SYSFS_PCI_DEVICE_PATH "/sys/bus/pci/devices"
+
+extern kv_sdk g_sdk;
+
 static pthread_mutex_t *kvsl_slab_mutex;
 
+/*
+ * slabs are created per (device, numa node) so that items are allocated
+ * from memory local to the submitting core. kvsl_slab_map translates
+ * [did * kvsl_nr_node + node] into the slab id used by kvslab_core.
+ */
+static int kvsl_nr_slab;		/* # slab (pool) */
+static int kvsl_nr_node = 1;		/* # numa node */
+static int kvsl_nr_cpu;			/* # cpu in kvsl_cpu_node */
+static int *kvsl_cpu_node;		/* numa node of each cpu */
+static int *kvsl_slab_map;		/* (device, numa node) to slab id */
+static int *kvsl_slab_socket;		/* numa node of each slab */
+static size_t *kvsl_slab_memory;	/* memory size of each slab */
+static int *kvsl_dev_slab_start;	/* first slab id of each device, [nr_ssd] is kvsl_nr_slab */
+
+/*
+ * value size histogram for tuning the slab profile. Each power of two is
+ * divided into KVSL_HIST_SUB_BUCKET buckets, and 1 out of
+ * kvsl_sampling_interval allocations is recorded (0: sampling off).
+ */
+#define KVSL_HIST_SUB_BUCKET (4)
+#define KVSL_HIST_NR_BUCKET (32 * KVSL_HIST_SUB_BUCKET)
+static uint32_t kvsl_sampling_interval;
+static uint64_t kvsl_sampling_cnt;
+static uint64_t kvsl_value_hist[KVSL_HIST_NR_BUCKET];
+
+static int kvsl_read_sysfs_int(const char* path, int* val){
+	FILE* fp = fopen(path, "r");
+	if(!fp){
+		return -1;
+	}
+	int ret = (fscanf(fp, "%d", val) == 1) ? 0 : -1;
+	fclose(fp);
+	return ret;
+}
+
+/*
+ * parse cpulist of a node (e.g. "0-7,16-23") and mark the cpus on node
+ */
+static void kvsl_parse_node_cpulist(int node){
+	char path[256];
+	char buf[4096];
+	FILE* fp;
+
+	snprintf(path, sizeof(path), SYSFS_NODE_PATH "/node%d/cpulist", node);
+	fp = fopen(path, "r");
+	if(!fp){
+		return;
+	}
+	if(!fgets(buf, sizeof(buf), fp)){
+		fclose(fp);
+		return;
+	}
+	fclose(fp);
+
+	char* p = buf;
+	while(*p && *p != '\n'){
+		char* end;
+		long first = strtol(p, &end, 10);
+		long last = first;
+		if(end == p){
+			break;
+		}
+		if(*end == '-'){
+			p = end + 1;
+			last = strtol(p, &end, 10);
+		}
+		for(long cpu = first; cpu <= last && cpu < kvsl_nr_cpu; cpu++){
+			kvsl_cpu_node[cpu] = node;
+		}
+		p = (*end == ',') ? end + 1 : end;
+	}
+}
+
+/*
+ * detect numa topology from sysfs. On a kernel without numa support every
+ * cpu is considered to be on node 0.
+ */
+static int kvsl_detect_numa_topology(void){
+	DIR* dir;
+	struct dirent* ent;
+	int node, max_node = 0;
+
+	kvsl_nr_cpu = sysconf(_SC_NPROCESSORS_CONF);
+	if(kvsl_nr_cpu <= 0){
+		kvsl_nr_cpu = MAX_CPU_CORES;
+	}
+	kvsl_cpu_node = calloc(kvsl_nr_cpu, sizeof(int));
+	if(!kvsl_cpu_node){
+		return KVSLAB_ENOMEM;
+	}
+
+	dir = opendir(SYSFS_NODE_PATH);
+	if(!dir){
+		kvsl_nr_node = 1;
+		return KVSLAB_OK;
+	}
+	while((ent = readdir(dir)) != NULL){
+		if(sscanf(ent->d_name, "node%d", &node) != 1 || node < 0){
+			continue;
+		}
+		max_node = MAX(max_node, node);
+		kvsl_parse_node_cpulist(node);
+	}
+	closedir(dir);
+
+	kvsl_nr_node = max_node + 1;
+	return KVSLAB_OK;
+}
+
+/*
+ * numa node the PCIe device is attached to, 0 if unknown
+ */
+static int kvsl_get_device_node(const char* dev_id){
+	char path[256];
+	int node = -1;
+
+	snprintf(path, sizeof(path), SYSFS_PCI_DEVICE_PATH "/%s/numa_node", dev_id);
+	if(kvsl_read_sysfs_int(path, &node) != 0 || node < 0 || node >= kvsl_nr_node){
+		return 0;
+	}
+	return node;
+}
+
+/*
+ * build the (device, node) -> slab map. A device gets one slab on every node
+ * that holds one of its cores (core_list or core_mask), and its slab memory is divided among
+ * them. Other nodes are mapped to the slab on the device's own node if any,
+ * or to the first slab of the device. The slab memory is set by
+ * kvsl_split_slab_memory once the slab profile is known.
+ */
+static int kvsl_build_slab_map(int nr_ssd){
+	int did, node, cpu;
+
+	kvsl_slab_map = malloc(sizeof(int) * nr_ssd * kvsl_nr_node);
+	kvsl_slab_socket = malloc(sizeof(int) * nr_ssd * kvsl_nr_node);
+	kvsl_slab_memory = malloc(sizeof(size_t) * nr_ssd * kvsl_nr_node);
+	kvsl_dev_slab_start = malloc(sizeof(int) * (nr_ssd + 1));
+	if(!kvsl_slab_map || !kvsl_slab_socket || !kvsl_slab_memory || !kvsl_dev_slab_start){
+		return KVSLAB_ENOMEM;
+	}
+
+	kvsl_nr_slab = 0;
+	for(did = 0; did < nr_ssd; did++){
+		int* map = &kvsl_slab_map[did * kvsl_nr_node];
+		int dev_node = kvsl_get_device_node(g_sdk.dev_id[did]);
+		int first = kvsl_nr_slab;
+		cpu_set_t io_cpus;
+
+		kvsl_dev_slab_start[did] = first;
+		kv_nvme_get_io_cpus(&g_sdk.dd_options[did], &io_cpus, NULL, NULL);
+
+		for(node = 0; node < kvsl_nr_node; node++){
+			map[node] = -1;
+		}
+		for(cpu = 0; cpu < CPU_SETSIZE && cpu < kvsl_nr_cpu; cpu++){
+			if(!CPU_ISSET(cpu, &io_cpus)){
+				continue;
+			}
+			node = kvsl_cpu_node[cpu];
+			if(map[node] < 0){
+				map[node] = kvsl_nr_slab;
+				kvsl_slab_socket[kvsl_nr_slab] = node;
+				kvsl_nr_slab++;
+			}
+		}
+		if(kvsl_nr_slab == first){
+			map[dev_node] = kvsl_nr_slab;
+			kvsl_slab_socket[kvsl_nr_slab] = dev_node;
+			kvsl_nr_slab++;
+		}
+
+		int nr_dev_slab = kvsl_nr_slab - first;
+		int fallback = (map[dev_node] >= 0) ? map[dev_node] : first;
+		for(node = 0; node < kvsl_nr_node; node++){
+			if(map[node] < 0){
+				map[node] = fallback;
+			}
+		}
+		log_debug(KV_LOG_INFO, "[%s] device %s: numa node %d, %d slab(s)\n", __func__, g_sdk.dev_id[did], dev_node, nr_dev_slab);
+	}
+	kvsl_dev_slab_start[nr_ssd] = kvsl_nr_slab;
+	return KVSLAB_OK;
+}
+
+/*
+ * divide the slab memory of each device among its slabs in whole memory slabs.
+ * A device needs one memory slab per class at least, as without NUMA
+ * placement; the minimum applies to the device, not to each of its slabs, so
+ * the device stays within the hugepages kv_sdk_total_mem_needed reserves.
+ * Each slab needs one memory slab per class too, or a class may find neither a
+ * free nor an evictable one, so a device whose memory is too small to give
+ * each of its slabs that many keeps only the slab on its own node. Slab ids
+ * are renumbered, and the number of slabs is returned.
+ */
+static int kvsl_split_slab_memory(size_t total_slab_size, size_t slab_size, int nr_ssd){
+	uint32_t nr_class = kvsl_nr_class();
+	uint32_t nr_unit = MAX(nr_class, total_slab_size / slab_size);
+	int next = 0;
+
+	for(int did = 0; did < nr_ssd; did++){
+		int* map = &kvsl_slab_map[did * kvsl_nr_node];
+		int first = kvsl_dev_slab_start[did];
+		int nr_dev_slab = kvsl_dev_slab_start[did + 1] - first;
+
+		kvsl_dev_slab_start[did] = next;
+		if(nr_unit / nr_dev_slab < nr_class){
+			int keep = map[kvsl_get_device_node(g_sdk.dev_id[did])];
+
+			log_debug(KV_LOG_INFO, "[%s] device %s: %u memory slabs do not fill %d slab(s) of %u classes, 1 slab\n", __func__, g_sdk.dev_id[did], nr_unit, nr_dev_slab, nr_class);
+			kvsl_slab_socket[next] = kvsl_slab_socket[keep];
+			kvsl_slab_memory[next] = (size_t)nr_unit * slab_size;
+			for(int node = 0; node < kvsl_nr_node; node++){
+				map[node] = next;
+			}
+			next++;
+			continue;
+		}
+		for(int i = 0; i < nr_dev_slab; i++){
+			uint32_t units = nr_unit / nr_dev_slab + (((uint32_t)i < nr_unit % nr_dev_slab) ? 1 : 0);
+			kvsl_slab_socket[next + i] = kvsl_slab_socket[first + i];
+			kvsl_slab_memory[next + i] = (size_t)units * slab_size;
+		}
+		for(int node = 0; node < kvsl_nr_node; node++){
+			map[node] += next - first;
+		}
+		next += nr_dev_slab;
+	}
+	kvsl_dev_slab_start[nr_ssd] = next;
+	return next;
+}
+
+/*
+ * slab id of a device which is local to the calling core
+ */
+static inline int kvsl_local_slab(int did){
+	int cpu = sched_getcpu();
+	int node = (cpu >= 0 && cpu < kvsl_nr_cpu) ? kvsl_cpu_node[cpu] : 0;
+	return kvsl_slab_map[did * kvsl_nr_node + node];
+}
+
+static inline int kvsl_hist_bucket(uint32_t size){
+	if(size < KVSL_HIST_SUB_BUCKET){
+		return size;
+	}
+	int msb = 31 - __builtin_clz(size);
+	int sub = (size >> (msb - 2)) & (KVSL_HIST_SUB_BUCKET - 1);
+	return (msb - 1) * KVSL_HIST_SUB_BUCKET + sub;
+}
+
+static inline uint64_t kvsl_hist_bucket_min(int bucket){
+	if(bucket < KVSL_HIST_SUB_BUCKET){
+		return bucket;
+	}
+	int msb = bucket / KVSL_HIST_SUB_BUCKET + 1;
+	return (uint64_t)(KVSL_HIST_SUB_BUCKET + bucket % KVSL_HIST_SUB_BUCKET) << (msb - 2);
+}
+
+static inline void kvsl_sample_value_size(uint32_t value_len){
+	if(!kvsl_sampling_interval || value_len == 0){
+		return;
+	}
+	if(__sync_fetch_and_add(&kvsl_sampling_cnt, 1) % kvsl_sampling_interval == 0){
+		__sync_fetch_and_add(&kvsl_value_hist[kvsl_hist_bucket(value_len)], 1);
+	}
+}
+
+void kvslab_print_value_histogram(void){
+	uint64_t total = 0;
+
+	if(!kvsl_sampling_interval){
+		return;
+	}
+	for(int i = 0; i < KVSL_HIST_NR_BUCKET; i++){
+		total += kvsl_value_hist[i];
+	}
+	log_debug(KV_LOG_INFO, "[VALUE SIZE HISTOGRAM] (1/%u sampled, %lu samples)\n", kvsl_sampling_interval, total);
+	log_debug(KV_LOG_INFO, "  %12s %12s %12s %8s\n", "[from]", "[to]", "[count]", "[ratio]");
+	for(int i = 0; i < KVSL_HIST_NR_BUCKET; i++){
+		if(!kvsl_value_hist[i]){
+			continue;
+		}
+		log_debug(KV_LOG_INFO, "  %12lu %12lu %12lu %7.2f%%\n", kvsl_hist_bucket_min(i), kvsl_hist_bucket_min(i + 1) - 1, kvsl_value_hist[i], kvsl_value_hist[i] * 100.0 / total);
+	}
+}
+
+double kvslab_fragmentation(int did){
+	uint64_t chunk_bytes = 0, data_bytes = 0;
+
+	if(did < 0 || !kvsl_dev_slab_start || did >= g_sdk.nr_ssd){
+		return 0.0;
+	}
+	for(int sid = kvsl_dev_slab_start[did]; sid < kvsl_dev_slab_start[did + 1]; sid++){
+		uint64_t chunk, data;
+		kvsl_slab_usage((uint16_t)sid, &chunk, &data);
+		chunk_bytes += chunk;
+		data_bytes += data;
+	}
+	if(chunk_bytes == 0){
+		return 0.0;
+	}
+	return 1.0 - (double)data_bytes / (double)chunk_bytes;
+}
+
 int kvslab_init(size_t total_slab_size, int slab_alloc_policy, int nr_ssd){
 	kvsl_rstatus_t status;
 
-	double factor = 2.0;
-	size_t chunk_size = KV_MEM_ALIGN(KVSLAB_ITEM_HDR_SIZE + 4*KB + sizeof(kv_pair) + KV_MAX_KEY_LEN + MEMORY_ALIGNMENT, KVSLAB_ALIGNMENT); //4KB value with 255B key
-
 	/**
-	 * slab can support upto 64KB value length for now.
+	 * slab profile is given by g_sdk (see kv_sdk_load_option). Default is
+	 * 11 classes growing by 2.0 from 4KB value with 255B key in 4MB slabs.
 	 */
-	size_t slab_size = KV_MEM_ALIGN(HUGEPAGE_SIZE, KVSLAB_ALIGNMENT);
+	double factor = (g_sdk.slab_factor > 1.0) ? g_sdk.slab_factor : 2.0;
+	uint32_t min_value_size = g_sdk.slab_min_value_size ? g_sdk.slab_min_value_size : 4*KB;
+	uint8_t max_nr_class = g_sdk.slab_max_class ? MIN(g_sdk.slab_max_class, KVSLAB_SLABCLASS_MAX_ID) : MAX_NUM_SLAB_CLASS;
+	size_t chunk_size = KV_MEM_ALIGN(KVSLAB_ITEM_HDR_SIZE + min_value_size + sizeof(kv_pair) + KV_MAX_KEY_LEN + MEMORY_ALIGNMENT, KVSLAB_ALIGNMENT);
+	size_t slab_size = KV_MEM_ALIGN(g_sdk.slab_unit_size ? g_sdk.slab_unit_size : HUGEPAGE_SIZE, KVSLAB_ALIGNMENT);
 	size_t max_slab_memory = KV_MEM_ALIGN(total_slab_size, KVSLAB_ALIGNMENT);
 
-	kvsl_set_options(false, factor, max_slab_memory, chunk_size, slab_size, slab_alloc_policy, nr_ssd);
+	if(chunk_size > slab_size - KVSLAB_SLAB_HDR_SIZE){
+		fprintf(stderr, "slab_min_value_size(%u) does not fit in a slab of %luB\n", min_value_size, slab_size);
+		return KVSLAB_ERROR;
+	}
+
+	kvsl_sampling_interval = g_sdk.slab_sampling_interval;
+	kvsl_sampling_cnt = 0;
+	memset(kvsl_value_hist, 0, sizeof(kvsl_value_hist));
+
+	status = kvsl_detect_numa_topology();
+	if (status != KVSLAB_OK) {
+		return KVSLAB_ERROR;
+	}
+	status = kvsl_build_slab_map(nr_ssd);
+	if (status != KVSLAB_OK) {
+		return KVSLAB_ERROR;
+	}
+
+	kvsl_set_options(false, factor, max_slab_memory, chunk_size, slab_size, slab_alloc_policy, kvsl_nr_slab, kvsl_slab_socket, kvsl_slab_memory, max_nr_class, g_sdk.slab_rebalance);
+	kvsl_nr_slab = kvsl_split_slab_memory(max_slab_memory, slab_size, nr_ssd);
+	kvsl_set_nr_slab(kvsl_nr_slab);
 
 	status = kvsl_slab_init();
 	if (status != KVSLAB_OK) {
 		return KVSLAB_ERROR;
 	}
 
-        kvsl_slab_mutex = malloc(nr_ssd*sizeof(pthread_mutex_t));
+        kvsl_slab_mutex = malloc(kvsl_nr_slab*sizeof(pthread_mutex_t));
         if(!kvsl_slab_mutex){
                 return KVSLAB_ERROR;
         }
-        for(int i=0; i<nr_ssd; i++){
+        for(int i=0; i<kvsl_nr_slab; i++){
                 if(pthread_mutex_init(&kvsl_slab_mutex[i], NULL) != 0){
                         return KVSLAB_ERROR;
                 }
@@ -79,6 +412,7 @@ int kvslab_init(size_t total_slab_size, int slab_alloc_policy, int nr_ssd){
 
 int kvslab_destroy(){
 	print_slab_class_info(true);
+	kvslab_print_value_histogram();
 
 	if(kvsl_slab_mutex){
 		free(kvsl_slab_mutex);
@@ -87,6 +421,17 @@ int kvslab_destroy(){
 	if (result != KVSLAB_OK) {
 		exit(1);
 	}
+
+	free(kvsl_slab_map);
+	free(kvsl_slab_socket);
+	free(kvsl_slab_memory);
+	free(kvsl_cpu_node);
+	free(kvsl_dev_slab_start);
+	kvsl_dev_slab_start = NULL;
+	kvsl_slab_map = NULL;
+	kvsl_slab_socket = NULL;
+	kvsl_slab_memory = NULL;
+	kvsl_cpu_node = NULL;
 	return 0;
 }
 	
@@ -139,9 +484,12 @@ kv_pair* slab_alloc_pair(int key_len, int value_len, int did){
 	if(key_len <= 0 || value_len < 0 || did < 0){
                 goto err;
         }
-	check_lock(pthread_mutex_lock(&kvsl_slab_mutex[did]));
-	struct kvsl_item* item = kvsl_get_free_item(key_len+value_len+sizeof(kv_pair)+MEMORY_ALIGNMENT, (uint8_t)did);
-	check_lock(pthread_mutex_unlock(&kvsl_slab_mutex[did]));
+	kvsl_sample_value_size(value_len);
+
+	int sid = kvsl_local_slab(did);
+	check_lock(pthread_mutex_lock(&kvsl_slab_mutex[sid]));
+	struct kvsl_item* item = kvsl_get_free_item(key_len+value_len+sizeof(kv_pair)+MEMORY_ALIGNMENT, (uint16_t)sid);
+	check_lock(pthread_mutex_unlock(&kvsl_slab_mutex[sid]));
 
 	if(!item){
 		goto err;
@@ -161,9 +509,10 @@ kv_iterate* slab_alloc_iterate(int key_len, int value_len, int did){
 	if(key_len <=0 || value_len <= 0 || did < 0){
                 goto err;
         }
-	check_lock(pthread_mutex_lock(&kvsl_slab_mutex[did]));
-	struct kvsl_item* item = kvsl_get_free_item(key_len+value_len+sizeof(kv_iterate)+MEMORY_ALIGNMENT, (uint8_t)did);
-	check_lock(pthread_mutex_unlock(&kvsl_slab_mutex[did]));
+	int sid = kvsl_local_slab(did);
+	check_lock(pthread_mutex_lock(&kvsl_slab_mutex[sid]));
+	struct kvsl_item* item = kvsl_get_free_item(key_len+value_len+sizeof(kv_iterate)+MEMORY_ALIGNMENT, (uint16_t)sid);
+	check_lock(pthread_mutex_unlock(&kvsl_slab_mutex[sid]));
 
 	if(!item){
 		goto err;
@@ -189,5 +538,5 @@ void slab_free_pair(kv_pair* kv){
         }
 	struct kvsl_item* item = kvsl_data_item((void*)kv);
 
-	kvsl_slab_decrease_use_cnt(item->did, item->sid);
+	kvsl_item_release(item);
 }
@@ -39,6 +39,8 @@
 
 int kvslab_init(size_t total_slab_size, int slab_alloc_policy, int nr_ssd);
 int kvslab_destroy();
+double kvslab_fragmentation(int did);
+void kvslab_print_value_histogram(void);
 
 kv_pair* posix_alloc_pair(int key_len, int value_len, int flag);
 kv_pair* slab_alloc_pair(int key_len, int value_len, int did);
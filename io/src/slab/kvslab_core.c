@@ -35,11 +35,18 @@
  * kvslab_core.c
  */
 
+#include <unistd.h>
+#include <sys/syscall.h>
+
 #include <kvslab_core.h>
 #include "kvutil.h"
 #include "kvnvme.h"
 #include "kvcache.h"
 
+#ifndef MPOL_PREFERRED
+#define MPOL_PREFERRED (1)
+#endif
+
 #define SAFE_MALLOC(_n, _c, _t)				\
 	(_n) = (_t*)malloc((_c) * (sizeof(_t)));	\
 	if(!(_n)) {					\
@@ -62,6 +69,9 @@ struct kvsl_slabinfo **kv_stable;		/* table of slabinfo indexed by sid */
 static uint32_t kv_nmslab;		/* # memory slabs */
 static size_t kv_mspace;		/* memory space */
 
+static void **kv_mregion;		/* memory region holding all slabs of a slab (THP) */
+static size_t *kv_mregion_size;		/* size of memory region (THP) */
+
 extern kv_cache g_cache;
 
 
@@ -87,7 +97,7 @@ static void kvsl_generate_profile(void){
 	id = KVSLAB_SLABCLASS_MIN_ID;
 	item_sz = min_item_sz;
 
-	while (id < MAX_NUM_SLAB_CLASS && item_sz < max_item_sz) {
+	while (id < kv_settings.max_nr_class && item_sz < max_item_sz) {
 		/* save the cur item chunk size */
 		last_item_sz = item_sz;
 		profile[id] = item_sz;
@@ -105,21 +115,25 @@ static void kvsl_generate_profile(void){
 		kv_settings.profile_last_id = id;
 		kv_settings.max_chunk_size = max_item_sz;
 	} else {
-		kv_settings.profile_last_id = MAX_NUM_SLAB_CLASS - 1;
-		kv_settings.max_chunk_size = profile[MAX_NUM_SLAB_CLASS - 1];
+		kv_settings.profile_last_id = kv_settings.max_nr_class - 1;
+		kv_settings.max_chunk_size = profile[kv_settings.max_nr_class - 1];
 	}
 
 	log_debug(KV_LOG_INFO, "[DONE]%s\n", __func__);
 }
 
 
-void kvsl_set_options(bool use_default, double factor, size_t max_slab_memory, size_t chunk_size, size_t slab_size, int slab_alloc_policy, int nr_slab){
+void kvsl_set_options(bool use_default, double factor, size_t max_slab_memory, size_t chunk_size, size_t slab_size, int slab_alloc_policy, int nr_slab, int *slab_socket, size_t *slab_memory, uint8_t max_nr_class, bool rebalance){
 	if (use_default == true) {
 		kv_settings.factor = KVSLAB_FACTOR;			/*default=1.25*/
 		kv_settings.max_slab_memory = KVSLAB_SLAB_MEMORY;	/*default=64MB*/
 		kv_settings.chunk_size = KVSLAB_CHUNK_SIZE;		/*default=Item header + Item payload (aligned by unsigned long size)*/
 		kv_settings.slab_size = KVSLAB_SLAB_SIZE;		/*default=1MB*/
 		kv_settings.nr_slab = 1;
+		kv_settings.slab_socket = NULL;
+		kv_settings.slab_memory = NULL;
+		kv_settings.max_nr_class = MAX_NUM_SLAB_CLASS;
+		kv_settings.rebalance = false;
 	} else {
 		kv_settings.factor = factor;
 		kv_settings.max_slab_memory = max_slab_memory;
@@ -127,6 +141,10 @@ void kvsl_set_options(bool use_default, double factor, size_t max_slab_memory, s
 		kv_settings.slab_size = slab_size;
 		kv_settings.slab_alloc_policy = slab_alloc_policy;
 		kv_settings.nr_slab = nr_slab;
+		kv_settings.slab_socket = slab_socket;
+		kv_settings.slab_memory = slab_memory;
+		kv_settings.max_nr_class = MIN(MAX(max_nr_class, 1), KVSLAB_SLABCLASS_MAX_ID);
+		kv_settings.rebalance = rebalance;
 	}
 
 	memset(kv_settings.profile, 0, sizeof(kv_settings.profile));
@@ -140,9 +158,10 @@ void kvsl_set_options(bool use_default, double factor, size_t max_slab_memory, s
 				"  max_slab_memory=%lu\n"
 				"  chunk_size=%lu\n"
 				"  slab_size=%lu\n"
-				"  profile_last_id=%d\n\n", \
-				"  num_slab=%d\n\n", \
-				kv_settings.factor, kv_settings.max_slab_memory, kv_settings.chunk_size, kv_settings.slab_size, kv_settings.profile_last_id, kv_settings.nr_slab);
+				"  profile_last_id=%d\n"
+				"  num_slab=%d\n"
+				"  rebalance=%d\n\n", \
+				kv_settings.factor, kv_settings.max_slab_memory, kv_settings.chunk_size, kv_settings.slab_size, kv_settings.profile_last_id, kv_settings.nr_slab, kv_settings.rebalance);
 }
 
 
@@ -216,7 +235,7 @@ static uint8_t kvsl_item_slabcid(uint32_t size){
  * Return and optionally verify the idx^th item with a given size in the
  * in given slab.
  */
-static struct kvsl_item * kvsl_slab_to_item(struct kvsl_slab *slab, uint32_t idx, uint8_t did, size_t size, bool verify){
+static struct kvsl_item * kvsl_slab_to_item(struct kvsl_slab *slab, uint32_t idx, uint16_t did, size_t size, bool verify){
 	struct kvsl_item *it;
 
 	KVSLAB_ASSERT(slab->magic == KVSLAB_SLAB_MAGIC);
@@ -249,7 +268,7 @@ static bool kvsl_slab_full(struct kvsl_slabinfo *sinfo){
 }
 
 
-static struct kvsl_item * _kvsl_slab_get_item(uint8_t cid, uint8_t did){
+static struct kvsl_item * _kvsl_slab_get_item(uint8_t cid, uint16_t did){
 	struct kvsl_slabclass *c;
 	struct kvsl_slabinfo *sinfo;
 	struct kvsl_slab *slab;
@@ -305,43 +324,10 @@ static int kvsl_cache_delete(kv_pair* kv){
 }
 
 
-#define MAX_RETRY_CNT (10)
-static kvsl_rstatus_t kvsl_slab_evict(uint8_t did){
-	struct kvsl_slabclass *c;	/* slab class */
-	struct kvsl_slabinfo *msinfo;	/* memory slabinfo */
-
-	KVSLAB_ASSERT(!KVSLAB_TAILQ_EMPTY(&kv_full_msinfoq[did]));
-	KVSLAB_ASSERT(kv_nfull_msinfoq[did] > 0);
-
-	/* get memory sinfo from full q */
-	/* find slab of which sinfo->in_use_cnt == 0 */
-	msinfo = NULL;
-	struct kvsl_slabinfo *tmp_sinfo;
-	while (msinfo == NULL){
-	    KVSLAB_TAILQ_FOREACH(tmp_sinfo, &kv_full_msinfoq[did], tqe){
-		pthread_mutex_lock(&tmp_sinfo->in_use_cnt_mutex);
-		if (tmp_sinfo->in_use_cnt <= 0){
-		    msinfo = tmp_sinfo;
-		    pthread_mutex_unlock(&tmp_sinfo->in_use_cnt_mutex);
-		goto find;
-		}
-		pthread_mutex_unlock(&tmp_sinfo->in_use_cnt_mutex);
-	    }
-	}
-
-find:
-	kv_nfull_msinfoq[did]--;
-	KVSLAB_TAILQ_REMOVE(&kv_full_msinfoq[did], msinfo, tqe);
-	KVSLAB_ASSERT(kvsl_slab_full(msinfo));
-
-	c = &kv_ctable[msinfo->cid];
-	c->nmslab[did]--;
-	c->nevict[did]++;
-
-	/* move msinfo to free q */
-	kv_nfree_msinfoq[did]++;
-	KVSLAB_TAILQ_INSERT_TAIL(&kv_free_msinfoq[did], msinfo, tqe);
-
+/*
+ * make the first nitem items of a slab invalid and drop them from the cache
+ */
+static void kvsl_slab_invalidate_items(struct kvsl_slabinfo *msinfo, struct kvsl_slabclass *c, uint32_t nitem, uint16_t did){
 	struct kvsl_slab *slab;	/* read slab */
 	uint32_t idx;		/* idx^th item */
 
@@ -350,7 +336,7 @@ find:
 
 	if(g_cache.rtree.size!=0){
 		int ret = 0;
-		for (idx = 0; idx < c->nitem; idx++) {
+		for (idx = 0; idx < nitem; idx++) {
 			struct kvsl_item *it = kvsl_slab_to_item(slab, idx, did, c->size, false);
 			it->evicted = true;
 
@@ -380,12 +366,94 @@ find:
 		}
 	}
 	msinfo->cid = KVSLAB_SLABCLASS_INVALID_ID;
+}
+
+
+#define MAX_RETRY_CNT (10)
+static kvsl_rstatus_t kvsl_slab_evict(uint16_t did){
+	struct kvsl_slabclass *c;	/* slab class */
+	struct kvsl_slabinfo *msinfo;	/* memory slabinfo */
+
+	/* get memory sinfo from full q */
+	/* find slab of which sinfo->in_use_cnt == 0 */
+	msinfo = NULL;
+	struct kvsl_slabinfo *tmp_sinfo;
+	KVSLAB_TAILQ_FOREACH(tmp_sinfo, &kv_full_msinfoq[did], tqe){
+		pthread_mutex_lock(&tmp_sinfo->in_use_cnt_mutex);
+		if (tmp_sinfo->in_use_cnt <= 0){
+			msinfo = tmp_sinfo;
+			pthread_mutex_unlock(&tmp_sinfo->in_use_cnt_mutex);
+			break;
+		}
+		pthread_mutex_unlock(&tmp_sinfo->in_use_cnt_mutex);
+	}
+	/* every full slab has items in use, the caller holds the slab mutex so
+	 * none can be released meanwhile: fail instead of spinning */
+	if (msinfo == NULL) {
+		return KVSLAB_ENOMEM;
+	}
+
+	kv_nfull_msinfoq[did]--;
+	KVSLAB_TAILQ_REMOVE(&kv_full_msinfoq[did], msinfo, tqe);
+	KVSLAB_ASSERT(kvsl_slab_full(msinfo));
+
+	c = &kv_ctable[msinfo->cid];
+	c->nmslab[did]--;
+	c->nevict[did]++;
+
+	/* move msinfo to free q */
+	kv_nfree_msinfoq[did]++;
+	KVSLAB_TAILQ_INSERT_TAIL(&kv_free_msinfoq[did], msinfo, tqe);
+
+	kvsl_slab_invalidate_items(msinfo, c, c->nitem, did);
 
 	return KVSLAB_OK;
 }
 
 
-static struct kvsl_item * kvsl_slab_get_item(uint8_t cid, uint8_t did){
+/*
+ * move partial slabs which have no item in use back to the free q, so that
+ * a class running out of slabs can take them instead of evicting a full one.
+ * cid is the class asking for a slab, and its own partial slabs are kept.
+ */
+static uint32_t kvsl_slab_rebalance(uint8_t cid, uint16_t did){
+	struct kvsl_slabclass *c;
+	struct kvsl_slabinfo *sinfo, *tmp_sinfo;
+	uint32_t nmoved = 0;
+
+	for (uint8_t i = KVSLAB_SLABCLASS_MIN_ID; i < kv_nctable; i++) {
+		if (i == cid) {
+			continue;
+		}
+		c = &kv_ctable[i];
+		sinfo = KVSLAB_TAILQ_FIRST(&c->partial_msinfoq[did]);
+		while (sinfo != NULL) {
+			tmp_sinfo = KVSLAB_TAILQ_NEXT(sinfo, tqe);
+
+			pthread_mutex_lock(&sinfo->in_use_cnt_mutex);
+			bool empty = (sinfo->in_use_cnt <= 0);
+			pthread_mutex_unlock(&sinfo->in_use_cnt_mutex);
+
+			if (empty) {
+				KVSLAB_TAILQ_REMOVE(&c->partial_msinfoq[did], sinfo, tqe);
+				c->nmslab[did]--;
+				c->nrebalance[did]++;
+
+				kvsl_slab_invalidate_items(sinfo, c, sinfo->nalloc, did);
+
+				kv_nfree_msinfoq[did]++;
+				KVSLAB_TAILQ_INSERT_TAIL(&kv_free_msinfoq[did], sinfo, tqe);
+				nmoved++;
+			}
+			sinfo = tmp_sinfo;
+		}
+	}
+
+	return nmoved;
+}
+
+
+static struct kvsl_item * kvsl_slab_get_item(uint8_t cid, uint16_t did){
 	kvsl_rstatus_t status;
 	struct kvsl_slabclass *c;
 	struct kvsl_slabinfo *sinfo;
@@ -426,10 +494,11 @@ static struct kvsl_item * kvsl_slab_get_item(uint8_t cid, uint8_t did){
 		return _kvsl_slab_get_item(cid, did);
 	}
 
-	KVSLAB_ASSERT(!KVSLAB_TAILQ_EMPTY(&kv_full_msinfoq[did]));
-	KVSLAB_ASSERT(kv_nfull_msinfoq[did] > 0);
+	//if there aren't slabs in partial q and free q, take empty slabs of other classes first
+	if (kv_settings.rebalance && kvsl_slab_rebalance(cid, did) > 0) {
+		return kvsl_slab_get_item(cid, did);
+	}
 
-	//if there aren't slabs in partial q and free q
 	status = kvsl_slab_evict(did);
 	if (status != KVSLAB_OK) {
 	    return NULL;
@@ -452,7 +521,7 @@ static bool kvsl_slab_valid_id(uint8_t cid){
 }
 
 
-static struct kvsl_item * kvsl_item_get(uint32_t size, uint8_t cid, uint8_t did){
+static struct kvsl_item * kvsl_item_get(uint32_t size, uint8_t cid, uint16_t did){
 	struct kvsl_item *it;
 
 	KVSLAB_ASSERT(kvsl_slab_valid_id(cid));
@@ -467,6 +536,10 @@ static struct kvsl_item * kvsl_item_get(uint32_t size, uint8_t cid, uint8_t did)
 	it->cid = cid;
 	it->did = did;
 	it->evicted = false;
+	it->ndata = size;
+
+	__sync_fetch_and_add(&kv_ctable[cid].nlive[did], 1);
+	__sync_fetch_and_add(&kv_ctable[cid].nlive_data[did], kvsl_item_ntotal(size));
 
 	/*debug*/
 	//printf("    [ALLOC] cid=%u, sid=%u(%u/%u), offset=%u mod_offset=%lu\n", \
@@ -476,7 +549,7 @@ static struct kvsl_item * kvsl_item_get(uint32_t size, uint8_t cid, uint8_t did)
 }
 
 
-struct kvsl_item* kvsl_get_free_item(uint32_t size, uint8_t did){
+struct kvsl_item* kvsl_get_free_item(uint32_t size, uint16_t did){
 	uint8_t cid;
 	struct kvsl_item *it;
 
@@ -491,20 +564,68 @@ struct kvsl_item* kvsl_get_free_item(uint32_t size, uint8_t did){
 	return it;
 }
 
-void kvsl_slab_increase_use_cnt(uint8_t did, uint32_t sid){
+void kvsl_slab_increase_use_cnt(uint16_t did, uint32_t sid){
 	struct kvsl_slabinfo *sinfo = &kv_stable[did][sid];
 	pthread_mutex_lock(&sinfo->in_use_cnt_mutex);
 	sinfo->in_use_cnt++;
 	pthread_mutex_unlock(&sinfo->in_use_cnt_mutex);
 }
 
-void kvsl_slab_decrease_use_cnt(uint8_t did, uint32_t sid){
+void kvsl_slab_decrease_use_cnt(uint16_t did, uint32_t sid){
 	struct kvsl_slabinfo *sinfo = &kv_stable[did][sid];
 	pthread_mutex_lock(&sinfo->in_use_cnt_mutex);
 	sinfo->in_use_cnt--;
 	pthread_mutex_unlock(&sinfo->in_use_cnt_mutex);
 }
 
+void kvsl_item_release(struct kvsl_item *it){
+	__sync_fetch_and_sub(&kv_ctable[it->cid].nlive[it->did], 1);
+	__sync_fetch_and_sub(&kv_ctable[it->cid].nlive_data[it->did], kvsl_item_ntotal(it->ndata));
+
+	kvsl_slab_decrease_use_cnt(it->did, it->sid);
+}
+
+/*
+ * bytes of chunks held by items in use, and bytes actually requested for them
+ */
+/*
+ * number of slab classes of the profile made by kvsl_set_options
+ */
+uint8_t kvsl_nr_class(void){
+	return kv_settings.profile_last_id + 1;
+}
+
+/*
+ * number of slabs, when kvslab_init merges the slabs of a device
+ */
+void kvsl_set_nr_slab(int nr_slab){
+	kv_settings.nr_slab = nr_slab;
+}
+
+void kvsl_slab_usage(uint16_t did, uint64_t *chunk_bytes, uint64_t *data_bytes){
+	*chunk_bytes = 0;
+	*data_bytes = 0;
+	for (uint8_t cid = KVSLAB_SLABCLASS_MIN_ID; cid < kv_nctable; cid++) {
+		struct kvsl_slabclass *c = &kv_ctable[cid];
+		*chunk_bytes += c->nlive[did] * c->size;
+		*data_bytes += c->nlive_data[did];
+	}
+}
+
+/*
+ * internal fragmentation of a slab: the portion of chunk space held by items in
+ * use which is not used by their data (0.0 when no item is in use)
+ */
+double kvsl_slab_fragmentation(uint16_t did){
+	uint64_t chunk_bytes, data_bytes;
+
+	kvsl_slab_usage(did, &chunk_bytes, &data_bytes);
+	if (chunk_bytes == 0) {
+		return 0.0;
+	}
+	return 1.0 - (double)data_bytes / (double)chunk_bytes;
+}
+
 static kvsl_rstatus_t kvsl_slab_init_ctable(void){
 	struct kvsl_slabclass *c;
 	uint8_t cid;
@@ -530,10 +651,16 @@ static kvsl_rstatus_t kvsl_slab_init_ctable(void){
 		SAFE_MALLOC(c->partial_msinfoq, nr_slab, struct kvsl_slabhinfo);
 		SAFE_MALLOC(c->nmslab, nr_slab, uint32_t);
 		SAFE_MALLOC(c->nevict, nr_slab, uint64_t);
+		SAFE_MALLOC(c->nrebalance, nr_slab, uint64_t);
+		SAFE_MALLOC(c->nlive, nr_slab, uint64_t);
+		SAFE_MALLOC(c->nlive_data, nr_slab, uint64_t);
 		for (int i=0; i<nr_slab; i++){
 			KVSLAB_TAILQ_INIT(&c->partial_msinfoq[i]);
 			c->nmslab[i] = 0;
 			c->nevict[i] = 0;
+			c->nrebalance[i] = 0;
+			c->nlive[i] = 0;
+			c->nlive_data[i] = 0;
 		}
 	}
 
@@ -542,11 +669,91 @@ static kvsl_rstatus_t kvsl_slab_init_ctable(void){
 }
 
 
+/*
+ * Allocate a slab memory region from transparent huge pages instead of the
+ * hugepage pool. The region is 2MB aligned so that the kernel can back it
+ * with huge pages, locked so that it is not swapped out, and registered to
+ * the driver at once so that it can be used for I/O.
+ * mlock does not keep the kernel from migrating or compacting the pages, so
+ * their physical addresses may change: the region is only used behind an
+ * IOMMU, where the device works on IO virtual addresses (see kv_sdk_init).
+ */
+static void *kvsl_thp_region_alloc(size_t size, int socket_id){
+	size_t map_size = size + KVSLAB_THP_ALIGN;
+	uint8_t *map, *addr;
+
+	map = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if (map == MAP_FAILED) {
+		fprintf(stderr, "slab region mmap fail(size=%luMB): %s\n", size / MB, strerror(errno));
+		return NULL;
+	}
+
+	/* trim the head and tail to make the region 2MB aligned */
+	addr = (uint8_t *)KV_PTR_ALIGN(map, KVSLAB_THP_ALIGN);
+	if (addr > map) {
+		munmap(map, addr - map);
+	}
+	if (map + map_size > addr + size) {
+		munmap(addr + size, (map + map_size) - (addr + size));
+	}
+
+	if (madvise(addr, size, MADV_HUGEPAGE) != 0) {
+		fprintf(stderr, "slab region madvise(MADV_HUGEPAGE) fail: %s\n", strerror(errno));
+	}
+	if (socket_id >= 0 && socket_id < (int)(sizeof(unsigned long) * 8)) {
+		unsigned long nodemask = 1UL << socket_id;
+		if (syscall(SYS_mbind, addr, size, MPOL_PREFERRED, &nodemask, sizeof(nodemask) * 8, 0) != 0) {
+			log_debug(KV_LOG_INFO, "slab region mbind to node %d fail: %s\n", socket_id, strerror(errno));
+		}
+	}
+
+	/* mlock also faults in the whole region */
+	if (mlock(addr, size) != 0) {
+		fprintf(stderr, "slab region mlock fail(size=%luMB): %s, check memlock limit(ulimit -l)\n", size / MB, strerror(errno));
+		munmap(addr, size);
+		return NULL;
+	}
+
+	if (kv_mem_register(addr, size) != KV_SUCCESS) {
+		fprintf(stderr, "slab region register fail(size=%luMB)\n", size / MB);
+		munlock(addr, size);
+		munmap(addr, size);
+		return NULL;
+	}
+
+	return addr;
+}
+
+
+static void kvsl_thp_region_free(void *addr, size_t size){
+	if (addr == NULL) {
+		return;
+	}
+	kv_mem_unregister(addr, size);
+	munlock(addr, size);
+	munmap(addr, size);
+}
+
+
 static kvsl_rstatus_t kvsl_slab_init_stable(int did){
 	struct kvsl_slabinfo *sinfo;
 	uint32_t idx;
+	uint32_t nmslab = kv_nmslab;
+	int socket_id = SOCKET_ID_ANY;
 
-	kv_nstable[did] = kv_nmslab;
+	/*
+	 * each slab may have its own size and numa node (see kvslab_init), which
+	 * already holds at least one memory slab per class. The slab never takes
+	 * more than its share, not even on a retry.
+	 */
+	if (kv_settings.slab_memory) {
+		nmslab = MAX(1, kv_settings.slab_memory[did] / kv_settings.slab_size);
+	}
+	if (kv_settings.slab_socket) {
+		socket_id = kv_settings.slab_socket[did];
+	}
+
+	kv_nstable[did] = nmslab;
 	kv_stable[did] = malloc(sizeof(*kv_stable[did]) * kv_nstable[did]);
 
 	if (kv_stable[did] == NULL) {
@@ -554,13 +761,32 @@ static kvsl_rstatus_t kvsl_slab_init_stable(int did){
 		return KVSLAB_ENOMEM;
 	}
 
+	if (kv_settings.slab_alloc_policy == SLAB_MM_ALLOC_THP) {
+		size_t region_size = KV_MEM_ALIGN(nmslab * kv_settings.slab_size, KVSLAB_THP_ALIGN);
+		kv_mregion[did] = kvsl_thp_region_alloc(region_size, socket_id);
+		if (kv_mregion[did] == NULL && region_size > (size_t)nmslab * kv_settings.slab_size) {
+			/* retry without the 2MB padding, still within the slab memory share */
+			fprintf(stderr, "slab region alloc fail(did %d), retry with the unaligned size\n", did);
+			region_size = (size_t)nmslab * kv_settings.slab_size;
+			kv_mregion[did] = kvsl_thp_region_alloc(region_size, socket_id);
+		}
+		if (kv_mregion[did] == NULL) {
+			kv_nstable[did] = 0;
+			return KVSLAB_ERROR;
+		}
+		kv_mregion_size[did] = region_size;
+	}
+
 	/* init memory slabinfo q  */
-	for (idx = 0; idx < kv_nmslab; idx++) {
+	for (idx = 0; idx < nmslab; idx++) {
 		sinfo = &kv_stable[did][idx];
 
 		switch(kv_settings.slab_alloc_policy){
 			case SLAB_MM_ALLOC_HUGE:
-				sinfo->addr = kv_zalloc(kv_settings.slab_size);
+				sinfo->addr = kv_zalloc_socket(kv_settings.slab_size, socket_id);
+				break;
+			case SLAB_MM_ALLOC_THP:
+				sinfo->addr = (uint8_t *)kv_mregion[did] + (size_t)idx * kv_settings.slab_size;
 				break;
 			case SLAB_MM_ALLOC_POSIX:
 			default:
@@ -573,7 +799,7 @@ static kvsl_rstatus_t kvsl_slab_init_stable(int did){
 			if ((idx) >= kv_nctable) {
 				kv_nstable[did] = idx;
 				fprintf(stderr, "but minimal slab memory size was satisfied for device#%d", did);
-				fprintf(stderr, " (target total size=%luMB, actual allocated total size=%luMB)\n", kv_nmslab * kv_settings.slab_size / MB, idx * kv_settings.slab_size / MB);
+				fprintf(stderr, " (target total size=%luMB, actual allocated total size=%luMB)\n", nmslab * kv_settings.slab_size / MB, idx * kv_settings.slab_size / MB);
 				return KVSLAB_OK;
 			}
 			return KVSLAB_ERROR;
@@ -590,7 +816,7 @@ static kvsl_rstatus_t kvsl_slab_init_stable(int did){
 		KVSLAB_TAILQ_INSERT_TAIL(&kv_free_msinfoq[did], sinfo, tqe);
 	}
 
-	log_debug(KV_LOG_INFO, "[DONE]%s\n", __func__);
+	log_debug(KV_LOG_INFO, "[DONE]%s (slab=%d, num_of_slab=%u, socket=%d)\n", __func__, did, kv_nstable[did], socket_id);
 	return KVSLAB_OK;
 }
 
@@ -599,26 +825,34 @@ void print_slab_class_info(bool print_detail){
 	struct kvsl_slabclass *c;
 	uint8_t cid;
 
+	size_t total_mspace = 0;
+	for (int i = 0; i < kv_settings.nr_slab; i++) {
+		total_mspace += kv_nstable[i] * kv_settings.slab_size;
+	}
+
 	log_debug(KV_LOG_INFO, "[SLAB CLASS INFORMATION]\n");
 	log_debug(KV_LOG_INFO, "  - num_of_class=%u\n", kv_nctable);
 	log_debug(KV_LOG_INFO, "  - num_of_slab_per_device=%u\n", kv_nmslab);
 	log_debug(KV_LOG_INFO, "  - total_size_of_slab_mem_per_deivce=%lu (%luMB)\n", kv_mspace, kv_mspace/MB);
-	log_debug(KV_LOG_INFO, "  - total_size_of_slab_mem=%lu (%luMB)\n", kv_mspace * kv_settings.nr_slab, (kv_mspace * kv_settings.nr_slab)/MB);
+	log_debug(KV_LOG_INFO, "  - total_size_of_slab_mem=%lu (%luMB)\n", total_mspace, total_mspace/MB);
 
 	log_debug(KV_LOG_INFO, "  - min_item_size=%lu (cid=%u, num_of_item=%u)\n", kv_ctable[KVSLAB_SLABCLASS_MIN_ID].size, KVSLAB_SLABCLASS_MIN_ID, kv_ctable[KVSLAB_SLABCLASS_MIN_ID].nitem);
 	log_debug(KV_LOG_INFO, "  - max_item_size=%lu (cid=%u, num_of_item=%u)\n", kv_ctable[kv_nctable-1].size, kv_nctable-1, kv_ctable[kv_nctable-1].nitem);
 
 	if (print_detail) {
 		log_debug(KV_LOG_INFO, "[CTABLE INFORMATION]\n");
-		log_debug(KV_LOG_INFO, "  %7s %10s %10s %10s %10s   %10s %10s\n", "[class]", "[nitem]", "[size]", "[data]", "[slack]", "[nmslab]", "[nevict]");
+		log_debug(KV_LOG_INFO, "  %7s %10s %10s %10s %10s   %10s %10s %10s %10s\n", "[class]", "[nitem]", "[size]", "[data]", "[slack]", "[nmslab]", "[nevict]", "[nrebal]", "[nlive]");
 		for (cid = KVSLAB_SLABCLASS_MIN_ID; cid < kv_nctable; cid++) {
 			c = &kv_ctable[cid];
 			log_debug(KV_LOG_INFO, "  %7u %10u %10lu %10lu %10lu\n",	\
 					cid, c->nitem, c->size, c->size - KVSLAB_ITEM_HDR_SIZE, c->slack);
 			for(int i=0; i<kv_settings.nr_slab; i++){
-				log_debug(KV_LOG_INFO, "%55s %10u %10u (did: %d)\n", " ", c->nmslab[i], c->nevict[i], i);
+				log_debug(KV_LOG_INFO, "%55s %10u %10lu %10lu %10lu (did: %d, socket: %d)\n", " ", c->nmslab[i], c->nevict[i], c->nrebalance[i], c->nlive[i], i, kv_settings.slab_socket ? kv_settings.slab_socket[i] : SOCKET_ID_ANY);
 			}
 		}
+		for (int i = 0; i < kv_settings.nr_slab; i++) {
+			log_debug(KV_LOG_INFO, "  - internal_fragmentation=%.2f%% (did: %d)\n", kvsl_slab_fragmentation(i) * 100, i);
+		}
 	}
 }
 
@@ -633,7 +867,7 @@ void print_slab_info(void){
 	printf("  - total_size_of_slab_mem_per_device=%lu (%luMB)\n", kv_mspace, kv_mspace/MB);
 
 	for (i = 0;  i < kv_settings.nr_slab; i++) {
-		printf(" device [%d]\n", i);
+		printf(" slab [%d] (num_of_slab=%u)\n", i, kv_nstable[i]);
 		printf("  %7s %10s %10s\n", "[sid]", "[nalloc]", "[cid]");
 		for (j = 0; j < kv_nstable[i]; j++) {
 			sinfo = &kv_stable[i][j];
@@ -659,6 +893,8 @@ kvsl_rstatus_t kvsl_slab_init(void){
 
 	SAFE_MALLOC(kv_nstable, nr_slab, uint32_t);
 	SAFE_MALLOC(kv_stable, nr_slab, struct kvsl_slabinfo*);
+	SAFE_MALLOC(kv_mregion, nr_slab, void*);
+	SAFE_MALLOC(kv_mregion_size, nr_slab, size_t);
 
 	kv_nctable = 0;
 	kv_ctable = NULL;
@@ -684,6 +920,8 @@ kvsl_rstatus_t kvsl_slab_init(void){
 
 		kv_nstable[did] = 0;
 		kv_stable[did] = NULL;
+		kv_mregion[did] = NULL;
+		kv_mregion_size[did] = 0;
 
 		/* init slab info table and slab */
 		status = kvsl_slab_init_stable(did);
@@ -700,7 +938,8 @@ kvsl_rstatus_t kvsl_slab_init(void){
 		}
 		*(volatile char*)slab = *(volatile char*)slab;
 	}
-	log_debug(KV_LOG_INFO, "[DONE]memset total slabs with %s allocation for slabs\n", (kv_settings.slab_alloc_policy==SLAB_MM_ALLOC_HUGE)?"HUGE MEMORY":"POSIX MALLOC");
+	log_debug(KV_LOG_INFO, "[DONE]memset total slabs with %s allocation for slabs\n", (kv_settings.slab_alloc_policy==SLAB_MM_ALLOC_HUGE)?"HUGE MEMORY":
+			(kv_settings.slab_alloc_policy==SLAB_MM_ALLOC_THP)?"TRANSPARENT HUGE PAGE":"POSIX MALLOC");
 	log_debug(KV_LOG_INFO, "[DONE]%s\n", __func__);
 	return KVSLAB_OK;
 }
@@ -715,11 +954,14 @@ kvsl_rstatus_t kvsl_slab_deinit(void){
 	free(kv_full_msinfoq);
 
 	for(int did = 0; did < kv_settings.nr_slab; did++){
-		for(uint32_t idx = 0; idx < kv_nmslab; idx++){
+		for(uint32_t idx = 0; idx < kv_nstable[did]; idx++){
 			switch(kv_settings.slab_alloc_policy){
 				case SLAB_MM_ALLOC_HUGE:
 					kv_free(kv_stable[did][idx].addr);
 					break;
+				case SLAB_MM_ALLOC_THP:
+					/* freed with the region below */
+					break;
 				case SLAB_MM_ALLOC_POSIX:
 				default:
 					free(kv_stable[did][idx].addr);
@@ -727,16 +969,22 @@ kvsl_rstatus_t kvsl_slab_deinit(void){
 			}
 		}
 		free(kv_stable[did]);
+		kvsl_thp_region_free(kv_mregion[did], kv_mregion_size[did]);
 	}
 
 	free(kv_nstable);
 	free(kv_stable);
+	free(kv_mregion);
+	free(kv_mregion_size);
 
 	for(uint8_t cid = KVSLAB_SLABCLASS_MIN_ID; cid < kv_nctable; cid++){
 		struct kvsl_slabclass* c = &kv_ctable[cid];
 		free(c->partial_msinfoq);
 		free(c->nmslab);
 		free(c->nevict);
+		free(c->nrebalance);
+		free(c->nlive);
+		free(c->nlive_data);
 	}
 	free(kv_ctable);
 
@@ -68,6 +68,7 @@ typedef int kvsl_rstatus_t; /* return type */
 #define KVSLAB_SLABCLASS_MAX_IDS       UCHAR_MAX
 
 #define HUGEPAGE_SIZE (4ULL*1024*1024)
+#define KVSLAB_THP_ALIGN (2ULL*1024*1024)
 #define MAX_NUM_SLAB_CLASS (11)
 #define MIN_TOTAL_SLAB_SIZE (HUGEPAGE_SIZE*MAX_NUM_SLAB_CLASS)
 
@@ -81,11 +82,15 @@ struct kvsl_settings {
 	uint8_t profile_last_id;		/* last id in slab profile */
 	int slab_alloc_policy;			/* malloc or huge page alloc */
 	int nr_slab;				/* number of slab */
+	int *slab_socket;			/* numa node each slab is placed on (NULL: any) */
+	size_t *slab_memory;			/* memory of each slab in bytes (NULL: max_slab_memory) */
+	uint8_t max_nr_class;			/* maximum number of slab class */
+	bool rebalance;				/* move empty slabs between classes */
 };
 
 
-void kvsl_set_options(bool use_default, double factor, size_t max_slab_memory, size_t chunk_size, size_t slab_size, int slab_alloc_policy, int nr_slab);
-struct kvsl_item* kvsl_get_free_item(uint32_t size, uint8_t did);
+void kvsl_set_options(bool use_default, double factor, size_t max_slab_memory, size_t chunk_size, size_t slab_size, int slab_alloc_policy, int nr_slab, int *slab_socket, size_t *slab_memory, uint8_t max_nr_class, bool rebalance);
+struct kvsl_item* kvsl_get_free_item(uint32_t size, uint16_t did);
 
 
 struct kvsl_item {
@@ -93,9 +98,8 @@ struct kvsl_item {
 	uint32_t offset;	/* raw offset from owner slab base (const), (slab_get_item) */
 	uint32_t sid;		/* slab id (const), (_slab_get_item) */
 	uint8_t cid;		/* slab class id (const), (item_get) */
-	uint8_t did;		/* (multi slab) device(slab) id*/
 	uint8_t evicted;	/* valid or invalid item, (item_get or slab_evict) */
-	uint8_t unused[1];	/* unused */
+	uint16_t did;		/* (multi slab) slab id, one per device and numa node */
 	uint32_t ndata;		/* date length */
 	uint8_t end[1];		/* item data */
 };
@@ -137,8 +141,8 @@ struct kvsl_slab {
 	uint32_t magic;		/* slab magic (const) */
 	uint32_t sid;		/* slab id */
 	uint8_t cid;		/* slab class id */
-	uint8_t did;		/* (multi slab) device(slab) id*/
-	uint8_t unused[2];	/* unused */
+	uint8_t unused[1];	/* unused */
+	uint16_t did;		/* (multi slab) slab id, one per device and numa node */
 	uint8_t data[1];	/* opaque data */
 };
 
@@ -149,7 +153,7 @@ struct kvsl_slabinfo {
 	KVSLAB_TAILQ_ENTRY(kvsl_slabinfo) tqe;	/* link in free q / partial q / full q */
 	uint32_t nalloc;			/* # item alloced (monotonic) */
 	uint8_t cid;				/* class id */
-	uint8_t did;
+	uint16_t did;
 	uint32_t in_use_cnt;			/*used item cnt*/
 	pthread_mutex_t in_use_cnt_mutex;	/*used item cnt mutex*/
 };
@@ -165,6 +169,9 @@ struct kvsl_slabclass {
 	struct kvsl_slabhinfo *partial_msinfoq; /* partial slabinfo q */
 	uint32_t *nmslab;	/* # memory slab */
 	uint64_t *nevict;	/* # eviect time */
+	uint64_t *nrebalance;	/* # empty slab moved to other class */
+	uint64_t *nlive;	/* # item in use */
+	uint64_t *nlive_data;	/* requested bytes of items in use */
 };
 
 
@@ -174,7 +181,12 @@ kvsl_rstatus_t kvsl_slab_deinit(void);
 void print_slab_class_info(bool print_detail);
 void print_slab_info(void);
 
-void kvsl_slab_increase_use_cnt(uint8_t did, uint32_t sid);
-void kvsl_slab_decrease_use_cnt(uint8_t did, uint32_t sid);
+void kvsl_slab_increase_use_cnt(uint16_t did, uint32_t sid);
+void kvsl_slab_decrease_use_cnt(uint16_t did, uint32_t sid);
+void kvsl_item_release(struct kvsl_item *it);
+uint8_t kvsl_nr_class(void);
+void kvsl_set_nr_slab(int nr_slab);
+void kvsl_slab_usage(uint16_t did, uint64_t *chunk_bytes, uint64_t *data_bytes);
+double kvsl_slab_fragmentation(uint16_t did);
 
 #endif /* KVSLAB_CORE_H_ */
@@ -197,48 +197,33 @@ int sdk_iterate(void){
                 }
         }
 	
-	fprintf(stderr,"Iterate Open ");
+	fprintf(stderr,"Cursor Open ");
 	uint32_t bitmask = 0xFFFFFFFF;
 	uint32_t prefix = 0;
 	memcpy(&prefix,kv[0]->key.key,4);
-        uint32_t iterator = KV_INVALID_ITERATE_HANDLE;
+	kv_cursor* cursor = NULL;
 	uint8_t keyspace_id = KV_KEYSPACE_IODATA;
 	fprintf(stderr,"DONE\n");
 	fprintf(stderr,"keyspace_id=%d bitmask=0x%x bit_pattern=0x%x\n",keyspace_id, bitmask, prefix);
 
+	//a cursor takes an iterate handle on its first read, and gives it back to other cursors when idle
         gettimeofday(&start, NULL);
-        iterator = kv_iterate_open(handle, keyspace_id, bitmask, prefix, KV_KEY_ITERATE);
-        //iterator = kv_iterate_open(handle, keyspace_id, bitmask, prefix, KV_KEY_ITERATE_WITH_RETRIEVE);
+        ret = kv_cursor_open(handle, keyspace_id, bitmask, prefix, KV_KEY_ITERATE, &cursor);
         gettimeofday(&end, NULL);
+        show_elapsed_time(&start,&end,"kv_cursor_open",1, 0, NULL);
 
-	memset((char*)&info,0,sizeof(info));
-        ret = kv_iterate_info(handle, info, nr_iterate_handle);
         if(ret == KV_SUCCESS){
-		for(i=0;i<nr_iterate_handle;i++){
-                        fprintf(stderr, "Retrieve iterate_handle_info[%d] : info.handle_id=%d info.status=%d info.type=%d info.keyspace_id=%d info.prefix=%08x info.bitmask=%08x info.is_eof=%d\n",
-                                i+1, info[i].handle_id, info[i].status, info[i].type, info[i].keyspace_id, info[i].prefix, info[i].bitmask, info[i].is_eof);
-		}
-	}
-
-        show_elapsed_time(&start,&end,"kv_iterate_open",1, 0, NULL);
-        if(iterator != KV_INVALID_ITERATE_HANDLE && iterator != KV_ERR_ITERATE_ERROR){
-		fprintf(stderr,"Iterate open success : iterator id=%d\n", iterator);
 		int num_keys_read = 0;
 		int it_read_success_count = 0;
                 gettimeofday(&start, NULL);
 		do{
-			int request_read_size = iterate_buffer_size;
 			int cur_num_keys_read = 0;
-                        it->iterator = iterator;
 			it->kv.keyspace_id = 0;
                         it->kv.param.io_option.iterate_read_option = KV_ITERATE_READ_DEFAULT;
-                        it->kv.value.length = request_read_size;
-                        it->kv.value.offset = 0;
                         memset(it->kv.key.key, 0, key_length);
-                        memset(it->kv.value.value, 0, it->kv.value.length);
-			fprintf(stderr,"Iterate Read Request=%d\n",it->kv.value.length);
-			ret = kv_iterate_read(handle, it);
-                        fprintf(stderr,"Iterate Read Result: it->kv.key.length=%d it->kv.value.length=%d ret=0x%x\n", it->kv.key.length, it->kv.value.length, ret);
+                        memset(it->kv.value.value, 0, iterate_buffer_size);
+			ret = kv_cursor_read(cursor, it);
+                        fprintf(stderr,"Cursor Read Result: it->kv.key.length=%d it->kv.value.length=%d ret=0x%x\n", it->kv.key.length, it->kv.value.length, ret);
 
 			//KV_KEY_ITERATE case
 			if(it->kv.key.length == 0 && it->kv.value.length > 0){
@@ -253,23 +238,23 @@ int sdk_iterate(void){
                 }while(ret == KV_SUCCESS);
 		fail_unless(ret == KV_ERR_ITERATE_READ_EOF); // && num_keys_read == insert_count);
                 gettimeofday(&end, NULL);
-                show_elapsed_time(&start,&end,"kv_iterate_read",1, 0, NULL);
+                show_elapsed_time(&start,&end,"kv_cursor_read",1, 0, NULL);
                 fprintf(stderr,"it_read_success_count = %d\n", it_read_success_count);
 		if(num_keys_read > 0){
 			fprintf(stderr,"num_keys_read = %d\n", num_keys_read);
 		}
 
-                fprintf(stderr,"Iterate Close ");
+                fprintf(stderr,"Cursor Close ");
                 gettimeofday(&start, NULL);
-                ret = kv_iterate_close(handle, iterator);
+                ret = kv_cursor_close(cursor);
                 gettimeofday(&end, NULL);
 		fail_unless(ret == KV_SUCCESS);
 		fprintf(stderr,"DONE\n");
-                fprintf(stderr,"Iterate Close Result: ret=0x%x\n", ret);
-                show_elapsed_time(&start,&end,"kv_iterate_close",1, 0, NULL);
+                fprintf(stderr,"Cursor Close Result: ret=0x%x\n", ret);
+                show_elapsed_time(&start,&end,"kv_cursor_close",1, 0, NULL);
         }
         else{
-                fprintf(stderr,"Iterate open failed : iterator id=%d\n", iterator);
+                fprintf(stderr,"Cursor open failed : ret=0x%x\n", ret);
         }
 
 
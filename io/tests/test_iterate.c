@@ -426,6 +426,54 @@ void test_iterate_read(uint64_t handle, uint32_t prefix, int key_length, int val
 	fprintf(stderr, "Done.\n");
 }
 
+kv_iterate* test_alloc_iterate(int key_length){
+        kv_iterate* it = (kv_iterate*)malloc(sizeof(kv_iterate));
+        assert(it != NULL);
+        it->kv.key.key = calloc(key_length+1, 1);
+        assert(it->kv.key.key != NULL);
+        it->kv.value.value = malloc(KV_ITERATE_READ_BUFFER_SIZE);
+        assert(it->kv.value.value != NULL);
+        return it;
+}
+
+void test_free_iterate(kv_iterate* it){
+        free(it->kv.key.key);
+        free(it->kv.value.value);
+        free(it);
+}
+
+//count the keys of prefix with plain kv_iterate_read, the reference for the other ways to iterate
+int test_collect_iterate_read(uint64_t handle, uint32_t prefix, int key_length, uint8_t* key_exist){
+        uint32_t iterator;
+        int ret, key_cnt = 0;
+        kv_iterate* it = test_alloc_iterate(key_length);
+
+        iterator = kv_iterate_open(handle, KV_KEYSPACE_IODATA, BIT_MASK, prefix, KV_KEY_ITERATE);
+        assert(iterator != KV_INVALID_ITERATE_HANDLE && iterator <= KV_MAX_ITERATE_HANDLE);
+        it->iterator = iterator;
+        do{
+                it->kv.key.length = 0;
+                it->kv.value.length = KV_ITERATE_READ_BUFFER_SIZE;
+                it->kv.value.offset = 0;
+                it->kv.param.io_option.iterate_read_option = KV_ITERATE_READ_DEFAULT;
+                ret = kv_iterate_read(handle, it);
+                key_cnt += validate_iterate_read(key_exist, it, key_length, prefix, KV_KEY_ITERATE);
+        }while(ret == KV_SUCCESS);
+        assert(ret == KV_ERR_ITERATE_READ_EOF);
+        assert(kv_iterate_close(handle, iterator) == KV_SUCCESS);
+
+        test_free_iterate(it);
+        return key_cnt;
+}
+
+//every key is seen once, and by the same keys as kv_iterate_read
+void test_check_same_keys(uint8_t* key_exist, uint8_t* expected, int test_cnt){
+        for(int i = 0; i < test_cnt; i++){
+                assert(expected[i] == 1);
+                assert(key_exist[i] == 1);
+        }
+}
+
 kv_pair** test_alloc_kv_pair(int key_length, int value_length, int test_cnt){
         kv_pair** kv = (kv_pair**)malloc(sizeof(kv_pair*)*test_cnt);
         assert(kv != NULL);
@@ -473,6 +521,144 @@ void test_basic_io(uint64_t dev_handle, int test_cnt){
 	printf("Done.\n\n");
 }
 
+void test_cursor_and_key_view(uint64_t dev_handle, int test_cnt){
+        printf("◆ Test cursor and key view iterator against iterate_read...");
+
+        uint32_t prefix = rand() % BIT_MASK;
+        uint32_t be_prefix = htobe32(prefix);
+        int key_length = KEY_LENGTH;
+        int value_length = VALUE_LENGTH;
+        uint8_t* expected = (uint8_t*)calloc(test_cnt, sizeof(uint8_t));
+        uint8_t* key_exist = (uint8_t*)calloc(test_cnt, sizeof(uint8_t));
+        kv_iterate* it = test_alloc_iterate(key_length);
+        kv_cursor* cursor;
+        kv_key_iterator* kit;
+        const kv_key* key;
+        uint32_t iterator;
+        int ret, key_cnt = 0;
+
+        assert(expected != NULL && key_exist != NULL);
+
+        kv_pair** kv = test_alloc_kv_pair(key_length, value_length, test_cnt);
+        test_store(dev_handle, prefix, kv, key_length, value_length, test_cnt);
+
+        assert(test_collect_iterate_read(dev_handle, prefix, key_length, expected) == test_cnt);
+
+        //cursor: same buffer format as kv_iterate_read
+        fprintf(stderr, "  Cursor...");
+        assert(kv_cursor_open(dev_handle, KV_KEYSPACE_IODATA, BIT_MASK, prefix, KV_KEY_ITERATE, &cursor) == KV_SUCCESS);
+        do{
+                it->kv.param.io_option.iterate_read_option = KV_ITERATE_READ_DEFAULT;
+                ret = kv_cursor_read(cursor, it);
+                key_cnt += validate_iterate_read(key_exist, it, key_length, prefix, KV_KEY_ITERATE);
+        }while(ret == KV_SUCCESS);
+        assert(ret == KV_ERR_ITERATE_READ_EOF);
+        assert(kv_cursor_close(cursor) == KV_SUCCESS);
+        assert(key_cnt == test_cnt);
+        test_check_same_keys(key_exist, expected, test_cnt);
+        fprintf(stderr, "Done.\n");
+
+        //key view: the returned kv_key is only used before the next kv_iterate_next()
+        fprintf(stderr, "  Key view...");
+        memset(key_exist, 0, test_cnt*sizeof(uint8_t));
+        key_cnt = 0;
+        iterator = kv_iterate_open(dev_handle, KV_KEYSPACE_IODATA, BIT_MASK, prefix, KV_KEY_ITERATE);
+        assert(iterator != KV_INVALID_ITERATE_HANDLE && iterator <= KV_MAX_ITERATE_HANDLE);
+        assert(kv_key_iterator_open(dev_handle, iterator, 0, &kit) == KV_SUCCESS);
+        while((ret = kv_iterate_next(kit, &key)) == KV_SUCCESS){
+                assert(key != NULL && key->length == key_length);
+                assert(memcmp(key->key, &be_prefix, PREFIX_LENGTH) == 0);
+                int idx = get_key_idx((char*)key->key);
+                assert(idx >= 0 && idx < test_cnt);
+                key_exist[idx]++;
+                key_cnt++;
+        }
+        assert(ret == KV_ERR_ITERATE_READ_EOF && key == NULL);
+        assert(kv_key_iterator_close(kit) == KV_SUCCESS);
+        assert(kv_iterate_close(dev_handle, iterator) == KV_SUCCESS);
+        assert(key_cnt == test_cnt);
+        test_check_same_keys(key_exist, expected, test_cnt);
+        fprintf(stderr, "Done.\n");
+
+        test_delete(dev_handle, prefix, kv, key_length, test_cnt);
+        test_free_kv_pair(kv, test_cnt);
+        test_free_iterate(it);
+        free(key_exist);
+        free(expected);
+
+        printf("Done.\n\n");
+}
+
+//read the cursor until at least until keys were counted in total, or no keys are left
+int test_cursor_read_until(kv_cursor* cursor, kv_iterate* it, uint8_t* key_exist, int key_length, uint32_t prefix, int* key_cnt, int until){
+        int ret;
+
+        do{
+                it->kv.param.io_option.iterate_read_option = KV_ITERATE_READ_DEFAULT;
+                ret = kv_cursor_read(cursor, it);
+                *key_cnt += validate_iterate_read(key_exist, it, key_length, prefix, KV_KEY_ITERATE);
+        }while(ret == KV_SUCCESS && *key_cnt < until);
+        assert(ret == KV_SUCCESS || ret == KV_ERR_ITERATE_READ_EOF);
+
+        return ret;
+}
+
+void test_cursor_resume(uint64_t dev_handle, int test_cnt){
+        printf("◆ Test cursor stopping mid-namespace and resuming...");
+
+        uint32_t prefix = rand() % BIT_MASK;
+        int key_length = KEY_LENGTH;
+        int value_length = VALUE_LENGTH;
+        uint8_t* expected = (uint8_t*)calloc(test_cnt, sizeof(uint8_t));
+        uint8_t* key_exist = (uint8_t*)calloc(test_cnt, sizeof(uint8_t));
+        kv_iterate* it = test_alloc_iterate(key_length);
+        uint8_t token[KV_CURSOR_TOKEN_MAX_LEN];
+        uint32_t token_length = sizeof(token);
+        kv_cursor* cursor;
+        int ret, key_cnt = 0;
+
+        assert(expected != NULL && key_exist != NULL);
+
+        kv_pair** kv = test_alloc_kv_pair(key_length, value_length, test_cnt);
+        test_store(dev_handle, prefix, kv, key_length, value_length, test_cnt);
+
+        assert(test_collect_iterate_read(dev_handle, prefix, key_length, expected) == test_cnt);
+
+        assert(kv_cursor_open(dev_handle, KV_KEYSPACE_IODATA, BIT_MASK, prefix, KV_KEY_ITERATE, &cursor) == KV_SUCCESS);
+
+        //stop halfway and give up the iterate handle, the next read reopens it
+        fprintf(stderr, "  Suspend...");
+        ret = test_cursor_read_until(cursor, it, key_exist, key_length, prefix, &key_cnt, test_cnt / 2);
+        assert(ret == KV_SUCCESS && key_cnt < test_cnt);
+        assert(kv_cursor_suspend(cursor) == KV_SUCCESS);
+        fprintf(stderr, "Done.\n");
+
+        //stop again and resume from a saved token, as another process would
+        fprintf(stderr, "  Save and restore...");
+        ret = test_cursor_read_until(cursor, it, key_exist, key_length, prefix, &key_cnt, test_cnt * 3 / 4);
+        if(ret == KV_SUCCESS){
+                assert(kv_cursor_save(cursor, token, &token_length) == KV_SUCCESS);
+                assert(kv_cursor_close(cursor) == KV_SUCCESS);
+                assert(kv_cursor_restore(dev_handle, token, token_length, &cursor) == KV_SUCCESS);
+                ret = test_cursor_read_until(cursor, it, key_exist, key_length, prefix, &key_cnt, test_cnt + 1);
+        }
+        assert(ret == KV_ERR_ITERATE_READ_EOF);
+        assert(kv_cursor_close(cursor) == KV_SUCCESS);
+        fprintf(stderr, "Done.\n");
+
+        //no key is emitted twice or skipped across the stops
+        assert(key_cnt == test_cnt);
+        test_check_same_keys(key_exist, expected, test_cnt);
+
+        test_delete(dev_handle, prefix, kv, key_length, test_cnt);
+        test_free_kv_pair(kv, test_cnt);
+        test_free_iterate(it);
+        free(key_exist);
+        free(expected);
+
+        printf("Done.\n\n");
+}
+
 void* iterate_read_thread(void* data){
 	test_thread_param* param = (test_thread_param*)data;
 
@@ -553,6 +739,10 @@ int test(){
 
 	test_basic_io(dev_handle, 1 * 10000); //store retrieve iterate_read delete
 
+	test_cursor_and_key_view(dev_handle, 1 * 10000); //store, iterate with a cursor and a key view, delete
+
+	test_cursor_resume(dev_handle, 1 * 10000); //store, iterate with a cursor stopped and resumed twice, delete
+
 	test_multi_iterate(dev_handle, 1 * 1000); //store multi-iterate_read delete
 
 	test_finalize();
@@ -0,0 +1,116 @@
+/**
+ *   BSD LICENSE
+ *
+ *   Copyright (c) 2017 Samsung Electronics Co., Ltd.
+ *   All rights reserved.
+ *
+ *   Redistribution and use in source and binary forms, with or without
+ *   modification, are permitted provided that the following conditions
+ *   are met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ *       notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above copyright
+ *       notice, this list of conditions and the following disclaimer in
+ *       the documentation and/or other materials provided with the
+ *       distribution.
+ *     * Neither the name of Samsung Electronics Co., Ltd. nor the names of
+ *       its contributors may be used to endorse or promote products derived
+ *       from this software without specific prior written permission.
+ *
+ *   THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *   "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *   LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ *   A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ *   OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ *   SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ *   LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ *   DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ *   THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ *   (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ *   OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <syslog.h>
+#include <check.h>
+
+#include "kvutil.h"
+#include "kvslab.h"
+#include "kvnvme.h"
+
+extern kv_sdk g_sdk;
+extern struct kvsl_slabclass *kv_ctable;
+
+/*
+ * the smallest class takes every memory slab of a device of minimal slab
+ * memory and keeps all its full slabs in use, only its partial slab is
+ * emptied. A larger class then has no free slab and no full slab to evict.
+ * Returns whether the larger class got an item.
+ */
+static bool hoard_then_alloc(bool rebalance){
+	int key_length = 16;
+	int small_value = 16;
+	int large_value = 64*1024;
+	kv_pair **kv;
+	kv_pair *large;
+	uint32_t nitem, nr_small, i;
+	bool ok;
+
+	g_sdk.slab_rebalance = rebalance;
+	/* one memory slab per class */
+	fail_unless(kvslab_init(1, SLAB_MM_ALLOC_POSIX, 1) == 0);
+
+	nitem = kv_ctable[KVSLAB_SLABCLASS_MIN_ID].nitem;
+	nr_small = (kvsl_nr_class() - 1) * nitem + 1;
+	kv = (kv_pair**)malloc(sizeof(kv_pair*) * nr_small);
+	fail_unless(kv != NULL);
+	for(i = 0; i < nr_small; i++){
+		kv[i] = slab_alloc_pair(key_length, small_value, 0);
+		fail_unless(kv[i] != NULL);
+	}
+	/* the last item is alone in the partial slab */
+	slab_free_pair(kv[nr_small - 1]);
+
+	large = slab_alloc_pair(key_length, large_value, 0);
+	ok = (large != NULL);
+
+	slab_free_pair(large);
+	for(i = 0; i < nr_small - 1; i++){
+		slab_free_pair(kv[i]);
+	}
+	free(kv);
+	kvslab_destroy();
+	return ok;
+}
+
+START_TEST(slab_rebalance){
+	printf("%s start\n",__FUNCTION__);
+
+	/* no slab to evict: the allocation fails instead of spinning */
+	fail_unless(!hoard_then_alloc(false));
+	/* the empty partial slab of the hoarding class is moved */
+	fail_unless(hoard_then_alloc(true));
+}
+END_TEST
+
+int main(void)
+{
+	setlogmask(LOG_UPTO(LOG_DEBUG));
+
+	Suite *s1 = suite_create("slab");
+	TCase *tc1 = tcase_create("slab");
+	SRunner *sr = srunner_create(s1);
+	int nf;
+
+	suite_add_tcase(s1,tc1);
+	tcase_add_test(tc1, slab_rebalance);
+
+	srunner_run_all(sr, CK_ENV);
+	nf = srunner_ntests_failed(sr);
+	srunner_free(sr);
+
+	return nf == 0 ? 0 : 1;
+}